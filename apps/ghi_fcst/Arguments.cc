@@ -20,7 +20,9 @@
 #include <string.h>
 #include <fstream>
 #include <unistd.h>
+#include <getopt.h>
 #include <iostream>
+#include <run_profile/run_profile.hh>
 #include "Arguments.hh"
 
 using std::ifstream;
@@ -29,6 +31,72 @@ using std::endl;
 
 // Constant and macros
 
+//
+// Range mode defaults, matching what scripts/python/ghi_fcst.py passes
+// for a single issue time: NWP files from the issue hour and the hour
+// before, observation files every 15 minutes over the previous hour
+//
+const int DEFAULT_NWP_LOOKBACK = 3600;
+const int DEFAULT_OBS_LOOKBACK = 3600;
+const int DEFAULT_OBS_DELTA = 900;
+const int DEFAULT_READER_CACHE_SIZE = 32;
+
+//
+// Long options, for range mode
+//
+enum
+{
+  OPT_FROM = 256,
+  OPT_TO,
+  OPT_STEP,
+  OPT_NWP_PATTERN,
+  OPT_OBS_PATTERN,
+  OPT_NWP_LOOKBACK,
+  OPT_OBS_LOOKBACK,
+  OPT_OBS_DELTA,
+  OPT_CACHE_SIZE,
+  OPT_PREDICTOR_CACHE,
+  OPT_SITE_LOCATIONS,
+  OPT_SHADING,
+  OPT_SHADING_SITES,
+  OPT_PROFILE,
+  OPT_LATENCY_BUDGET,
+  OPT_BLEND_NWP,
+  OPT_BLEND_CONF,
+  OPT_BLEND_MAP,
+  OPT_BLEND_SITES,
+  OPT_BLEND_CLIMATE_ZONES,
+  OPT_BLEND_OUTPUT_DIR,
+  OPT_NWP_INTERP
+};
+
+static struct option longOptions[] =
+{
+  {"from", required_argument, 0, OPT_FROM},
+  {"to", required_argument, 0, OPT_TO},
+  {"step", required_argument, 0, OPT_STEP},
+  {"nwp-pattern", required_argument, 0, OPT_NWP_PATTERN},
+  {"obs-pattern", required_argument, 0, OPT_OBS_PATTERN},
+  {"nwp-lookback", required_argument, 0, OPT_NWP_LOOKBACK},
+  {"obs-lookback", required_argument, 0, OPT_OBS_LOOKBACK},
+  {"obs-delta", required_argument, 0, OPT_OBS_DELTA},
+  {"cache-size", required_argument, 0, OPT_CACHE_SIZE},
+  {"predictor-cache", required_argument, 0, OPT_PREDICTOR_CACHE},
+  {"site-locations", required_argument, 0, OPT_SITE_LOCATIONS},
+  {"shading", required_argument, 0, OPT_SHADING},
+  {"shading-sites", required_argument, 0, OPT_SHADING_SITES},
+  {"profile", no_argument, 0, OPT_PROFILE},
+  {"latency-budget", required_argument, 0, OPT_LATENCY_BUDGET},
+  {"blend-nwp", required_argument, 0, OPT_BLEND_NWP},
+  {"blend-conf", required_argument, 0, OPT_BLEND_CONF},
+  {"blend-map", required_argument, 0, OPT_BLEND_MAP},
+  {"blend-sites", required_argument, 0, OPT_BLEND_SITES},
+  {"blend-climate-zones", required_argument, 0, OPT_BLEND_CLIMATE_ZONES},
+  {"blend-output-dir", required_argument, 0, OPT_BLEND_OUTPUT_DIR},
+  {"nwp-interp", required_argument, 0, OPT_NWP_INTERP},
+  {0, 0, 0, 0}
+};
+
 // Types, structures and classes
 
 // Global variables 
@@ -70,17 +138,43 @@ Arguments::Arguments(int argc, char **argv)
 
   debugLevel = 0;
 
+  rangeMode = false;
+
+  rangeStart = -1;
+
+  rangeEnd = -1;
+
+  rangeStep = 0;
+
+  nwpLookback = DEFAULT_NWP_LOOKBACK;
+
+  obsLookback = DEFAULT_OBS_LOOKBACK;
+
+  obsDelta = DEFAULT_OBS_DELTA;
+
+  readerCacheSize = DEFAULT_READER_CACHE_SIZE;
+
+  profile = false;
+
+  numThreads = 0;
+
+  nwpInterpGap = 0;
+
   bool errflg = false;
 
   int c; 
 
-  while ((c = getopt(argc, argv, "d:hl:m:o:s:t:")) != EOF)
+  while ((c = getopt_long(argc, argv, "d:hj:l:m:o:s:t:", longOptions, NULL)) != EOF)
     switch (c)
       {
       case 'd':
 	debugLevel = atoi(optarg);
 	break;
 
+      case 'j':
+        numThreads = atoi(optarg);
+        break;
+
       case 'm':
          nwpFilesStr =  optarg;
          parseCommaDelimStr(nwpFilesStr, nwpFiles);	
@@ -108,6 +202,95 @@ Arguments::Arguments(int argc, char **argv)
       case 't':
         fcstStartTime = atol(optarg); 
         break;
+
+      case OPT_FROM:
+        rangeStart = atol(optarg);
+        break;
+
+      case OPT_TO:
+        rangeEnd = atol(optarg);
+        break;
+
+      case OPT_STEP:
+        rangeStep = atoi(optarg);
+        break;
+
+      case OPT_NWP_PATTERN:
+        nwpPattern = optarg;
+        break;
+
+      case OPT_OBS_PATTERN:
+        obsPattern = optarg;
+        break;
+
+      case OPT_NWP_LOOKBACK:
+        nwpLookback = atoi(optarg);
+        break;
+
+      case OPT_OBS_LOOKBACK:
+        obsLookback = atoi(optarg);
+        break;
+
+      case OPT_OBS_DELTA:
+        obsDelta = atoi(optarg);
+        break;
+
+      case OPT_CACHE_SIZE:
+        readerCacheSize = atoi(optarg);
+        break;
+
+      case OPT_PREDICTOR_CACHE:
+        predictorCacheDir = optarg;
+        break;
+
+      case OPT_SITE_LOCATIONS:
+        siteLocationFile = optarg;
+        break;
+
+      case OPT_SHADING:
+        shadingDir = optarg;
+        break;
+
+      case OPT_SHADING_SITES:
+        shadingSiteFile = optarg;
+        break;
+
+      case OPT_PROFILE:
+        profile = true;
+        break;
+
+      case OPT_LATENCY_BUDGET:
+        latencyBudget = optarg;
+        profile = true;
+        break;
+
+      case OPT_BLEND_NWP:
+        blendNwpPattern = optarg;
+        break;
+
+      case OPT_BLEND_CONF:
+        blendConfFile = optarg;
+        break;
+
+      case OPT_BLEND_MAP:
+        blendMapFile = optarg;
+        break;
+
+      case OPT_BLEND_SITES:
+        blendSiteFile = optarg;
+        break;
+
+      case OPT_BLEND_CLIMATE_ZONES:
+        blendClimateZoneFile = optarg;
+        break;
+
+      case OPT_BLEND_OUTPUT_DIR:
+        blendOutputDir = optarg;
+        break;
+
+      case OPT_NWP_INTERP:
+        nwpInterpGap = atoi(optarg);
+        break;
  
       case '?':
 	errflg = 1;
@@ -129,7 +312,68 @@ Arguments::Arguments(int argc, char **argv)
     return;
   }
 
-  if ( (int)obsFiles.size() == 0 || (int)nwpFiles.size() == 0)
+  if (shadingDir != "" && shadingSiteFile == "")
+  {
+    error = "--shading needs --shading-sites.";
+    return;
+  }
+
+  if (nwpInterpGap < 0)
+  {
+    error = "--nwp-interp must not be negative.";
+    return;
+  }
+
+  bool blendArg = (blendNwpPattern != "" || blendConfFile != "" || blendMapFile != "" ||
+                   blendSiteFile != "" || blendClimateZoneFile != "" ||
+                   blendOutputDir != "");
+
+  if (blendArg && (blendNwpPattern == "" || blendConfFile == "" || blendMapFile == "" ||
+                   blendSiteFile == "" || blendClimateZoneFile == "" ||
+                   blendOutputDir == ""))
+  {
+    error = "--blend-nwp, --blend-conf, --blend-map, --blend-sites, "
+            "--blend-climate-zones and --blend-output-dir go together.";
+    return;
+  }
+
+  if (latencyBudget != "")
+  {
+    RunProfile budgetCheck("ghi_fcst");
+
+    if (budgetCheck.parse_budgets(latencyBudget))
+    {
+      error = budgetCheck.error() + ".";
+      return;
+    }
+  }
+
+  rangeMode = (rangeStart >= 0 || rangeEnd >= 0);
+
+  if (rangeMode)
+  {
+     if (rangeStart < 0 || rangeEnd < rangeStart || rangeStep <= 0)
+     {
+        error = "Range mode needs --from, --to no earlier than --from, "
+                "and a positive --step.";
+        return;
+     }
+
+     if (nwpPattern == "" || obsPattern == "")
+     {
+        error = "Range mode needs --nwp-pattern and --obs-pattern.";
+        return;
+     }
+
+     if (nwpLookback < 0 || obsLookback < 0 || obsDelta <= 0 ||
+         readerCacheSize <= 0)
+     {
+        error = "Invalid range mode lookback, observation delta or "
+                "cache size.";
+        return;
+     }
+  }
+  else if ( (int)obsFiles.size() == 0 || (int)nwpFiles.size() == 0)
   {
      error = "Input is empty for observations or NWP forecast files. "
              "Both are needed.";
@@ -166,10 +410,59 @@ void Arguments::usage(char *programName)
   fprintf(stderr, "\t-d  <debug level>\n");
   fprintf(stderr, "\t-m <NWP model forecast files> (a comma delimited list)\n");
   fprintf(stderr, "\t-h  help\n");
+  fprintf(stderr, "\t-j  <number of threads parsing input files and loading models,\n"
+                  "\t\t0 for one per processor (default), 1 to load them in turn>\n");
   fprintf(stderr, "\t-l  <log direcotry>\n");
   fprintf(stderr, "\t-o  <meteorological observations file>\n");
   fprintf(stderr, "\t-s  <single forecast lead in minutes>\n");
   fprintf(stderr, "\t-t  <unix time of first forecast>\n"); 
+  fprintf(stderr, "\t--predictor-cache <dir>  keep NWP predictors in this directory\n"
+                  "\t\tfor reuse by runs made from the same NWP files\n");
+  fprintf(stderr, "\t--site-locations <csv>  compute TOA, solar elevation and azimuth\n"
+                  "\t\tfrom site locations (int_id, lat, lon columns) instead of\n"
+                  "\t\treading them from the input files\n");
+  fprintf(stderr, "\t--shading <dir>  mask observed GHI and Kt with the shading tables\n"
+                  "\t\tin this directory, for observations that are not shading QC'd\n");
+  fprintf(stderr, "\t--shading-sites <csv>  station names (stid) and site ids (int_id)\n"
+                  "\t\tof the shading tables\n");
+  fprintf(stderr, "\t--nwp-interp <seconds>  interpolate NWP files whose valid times are\n"
+                  "\t\tup to this far apart, e.g. 3600 for hourly HRRR, to the\n"
+                  "\t\tforecast times; irradiance is interpolated as clear sky index\n");
+  fprintf(stderr, "\t--profile  write the time, CPU time and bytes read of each stage\n"
+                  "\t\tand missing predictor counts to <output>.profile.json\n");
+  fprintf(stderr, "\t--latency-budget <spec>  warn when a stage takes longer than its\n"
+                  "\t\tbudget, seconds for all stages or stage=secs,...[,default secs],\n"
+                  "\t\tstages startup, parse_nwp, parse_obs, load_models, load_blend,\n"
+                  "\t\tpredict, write_netcdf, blend; the parse and load stages run\n"
+                  "\t\tconcurrently within startup and add up the time of their files\n"
+                  "\t\tand models; implies --profile\n");
+  fprintf(stderr, "\nNWP and statcast blend, replacing NWP_Statcast_blender.py "
+                  "(all or none):\n");
+  fprintf(stderr, "\t--blend-nwp <path>  gridded NWP GHI forecast with strftime conversions\n"
+                  "\t\texpanded at the forecast start time,\n"
+                  "\t\te.g. /d1/nwp/%%Y%%m%%d/wrf_hrrr_blend.%%Y%%m%%d.%%H00.nc\n");
+  fprintf(stderr, "\t--blend-conf <json>  lead time and spatial blending weights\n");
+  fprintf(stderr, "\t--blend-map <file>  grid point to site map, json or binary\n");
+  fprintf(stderr, "\t--blend-sites <csv>  station names (stid) and site ids (int_id)\n"
+                  "\t\tof the map\n");
+  fprintf(stderr, "\t--blend-climate-zones <csv>  climate zone of each grid point\n");
+  fprintf(stderr, "\t--blend-output-dir <dir>  write "
+                  "YYYYMMDD/NWP_statcast_blend.YYYYMMDD.HHMM.nc here\n");
+  fprintf(stderr, "\nRange (archive/backfill) mode, replacing -m, -o and -t:\n");
+  fprintf(stderr, "\t--from <unix time>  first issue time\n");
+  fprintf(stderr, "\t--to <unix time>  last issue time\n");
+  fprintf(stderr, "\t--step <seconds>  time between issue times, e.g. 900\n");
+  fprintf(stderr, "\t--nwp-pattern <path>  NWP file path with strftime conversions\n"
+                  "\t\tand glob wildcards, e.g. /d1/nwp/%%Y%%m%%d/wrfsolar.%%Y%%m%%d.%%H*\n");
+  fprintf(stderr, "\t--obs-pattern <path>  observation file path with strftime conversions\n");
+  fprintf(stderr, "\t--nwp-lookback <seconds>  look for NWP files this far back, hourly "
+                  "(default %d)\n", DEFAULT_NWP_LOOKBACK);
+  fprintf(stderr, "\t--obs-lookback <seconds>  look for observation files this far back "
+                  "(default %d)\n", DEFAULT_OBS_LOOKBACK);
+  fprintf(stderr, "\t--obs-delta <seconds>  time between observation files (default %d)\n",
+                  DEFAULT_OBS_DELTA);
+  fprintf(stderr, "\t--cache-size <n>  parsed files of each kind kept in memory "
+                  "(default %d)\n", DEFAULT_READER_CACHE_SIZE);
 }
 
 void Arguments::print()
@@ -200,6 +493,33 @@ void Arguments::print()
 
   }
 
+  if (rangeMode)
+  {
+    fprintf(stderr, "  Range mode: issue times %ld to %ld every %d seconds\n",
+            (long)rangeStart, (long)rangeEnd, rangeStep);
+    fprintf(stderr, "    NWP pattern: %s (lookback %d)\n", nwpPattern.c_str(),
+            nwpLookback);
+    fprintf(stderr, "    Observation pattern: %s (lookback %d, delta %d)\n",
+            obsPattern.c_str(), obsLookback, obsDelta);
+  }
+
+  if (predictorCacheDir != "")
+    fprintf(stderr,"  predictorCacheDir: %s\n", predictorCacheDir.c_str());
+
+  if (siteLocationFile != "")
+    fprintf(stderr,"  siteLocationFile: %s\n", siteLocationFile.c_str());
+
+  if (shadingDir != "")
+    fprintf(stderr,"  shadingDir: %s (sites %s)\n", shadingDir.c_str(),
+            shadingSiteFile.c_str());
+
+  if (blendNwpPattern != "")
+    fprintf(stderr,"  blend: %s into %s (map %s)\n", blendNwpPattern.c_str(),
+            blendOutputDir.c_str(), blendMapFile.c_str());
+
+  if (nwpInterpGap > 0)
+    fprintf(stderr,"  nwpInterpGap: %d\n", nwpInterpGap);
+
   if (logDir != "")
     fprintf(stderr,"  logDir: %s\n", logDir.c_str());
 
@@ -142,6 +142,139 @@ public:
    */
   int fcstLeadsNum;
 
+  /**
+   * Flag indicating range (archive/backfill) mode: forecasts are made for
+   * every issue time from rangeStart to rangeEnd in steps of rangeStep
+   */
+  bool rangeMode;
+
+  /**
+   * First issue time in range mode (unix time)
+   */
+  time_t rangeStart;
+
+  /**
+   * Last issue time in range mode (unix time)
+   */
+  time_t rangeEnd;
+
+  /**
+   * Seconds between issue times in range mode
+   */
+  int rangeStep;
+
+  /**
+   * NWP file path pattern for range mode: strftime conversions are
+   * expanded at the issue time and at each hour back to nwpLookback,
+   * then glob wildcards are matched
+   */
+  string nwpPattern;
+
+  /**
+   * Observation file path pattern for range mode: strftime conversions
+   * are expanded at the issue time and every obsDelta seconds back to
+   * obsLookback, then glob wildcards are matched
+   */
+  string obsPattern;
+
+  /**
+   * Seconds before the issue time to look for NWP files
+   */
+  int nwpLookback;
+
+  /**
+   * Seconds before the issue time to look for observation files
+   */
+  int obsLookback;
+
+  /**
+   * Seconds between observation files
+   */
+  int obsDelta;
+
+  /**
+   * Number of parsed files of each kind kept in memory in range mode
+   */
+  int readerCacheSize;
+
+  /**
+   * Directory of the on-disk NWP predictor cache, empty if not used
+   */
+  string predictorCacheDir;
+
+  /**
+   * Csv file of site locations from which solar geometry is computed,
+   * empty to read it from the input files
+   */
+  string siteLocationFile;
+
+  /**
+   * Directory of the shading tables masking observed GHI and Kt, empty
+   * if the observations are already shading QC'd
+   */
+  string shadingDir;
+
+  /**
+   * Csv file mapping the station names of the shading tables ("stid")
+   * to observation site ids ("int_id")
+   */
+  string shadingSiteFile;
+
+  /**
+   * Largest time in seconds between NWP valid times that is interpolated
+   * to the forecast times, 0 to use NWP values at their valid times only
+   */
+  int nwpInterpGap;
+
+  /**
+   * Number of threads parsing input files and loading models, 0 for one
+   * per processor
+   */
+  int numThreads;
+
+  /**
+   * Flag indicating that a run profile is written next to the output
+   */
+  bool profile;
+
+  /**
+   * Latency budgets of the run profile stages, empty if none
+   */
+  string latencyBudget;
+
+  /**
+   * Gridded NWP GHI forecast path into which the forecast is blended,
+   * with strftime conversions expanded at the forecast start time; empty
+   * if no blend is made
+   */
+  string blendNwpPattern;
+
+  /**
+   * Blend configuration json (lead time and spatial weights)
+   */
+  string blendConfFile;
+
+  /**
+   * Grid point to site map of the blend, json or binary
+   */
+  string blendMapFile;
+
+  /**
+   * Csv mapping the station names of the blend map ("stid") to site ids
+   * ("int_id")
+   */
+  string blendSiteFile;
+
+  /**
+   * Csv of the climate zone of each grid point ("grid_id", "climateZone")
+   */
+  string blendClimateZoneFile;
+
+  /**
+   * Directory of the blended output, written to YYYYMMDD subdirectories
+   */
+  string blendOutputDir;
+
   /** 
    * @param[in] commaStr  Comma delimited list of file strings
    * @param[out] vec  Vector containing individual file string elements 
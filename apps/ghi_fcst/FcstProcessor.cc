@@ -20,10 +20,15 @@
 #include <fstream>
 #include <time.h>
 #include <math.h>
+#include <glob.h>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <string>
+#include <mutex>
+#include <boost/filesystem/operations.hpp>
 #include <log/log.hh>
+#include <site_store/nc_lock.hh>
 #include "Arguments.hh"
 #include "FcstProcessor.hh"
 #include "cdf_field_writer.hh"
@@ -36,10 +41,78 @@ extern int DebugLevel;
 
 const float FcstProcessor::CUBIST_MISSING = NC_FILL_FLOAT;
 
+//
+// NWP predictor cache files older than this many seconds are removed
+//
+const int PREDICTOR_CACHE_MAX_AGE = 86400;
+
+SolarSites *FcstProcessor::solarSites = NULL;
+
+ShadingMask *FcstProcessor::shadingMask = NULL;
+
+int FcstProcessor::nwpInterpGap = 0;
+
+RunProfile *FcstProcessor::loadProfile = NULL;
+
+//
+// Cubist model files are read through library state, so tasks loading
+// models concurrently take this lock
+//
+static std::mutex cubistLoadMutex;
+
+//
+// Run profile names of the predictors, in loadPredictors() order. NULL
+// entries are not fed to the models and are not counted when missing.
+//
+static const char *PREDICTOR_NAMES[] =
+{
+  "obs_T", "obs_RH", NULL, "obs_P", NULL, NULL, "obs_solarEl", "obs_solarAz",
+  NULL, "obs_Kt", "obs_Kt_15", "obs_Kt_30", "obs_Kt_45", NULL, NULL,
+  "nwp_solarAz", "nwp_solarEl", NULL, "nwp_MR_gen", NULL, "nwp_DNI_gen",
+  "nwp_DHI_gen", "nwp_TAOD_gen", NULL, "nwp_WVP_gen", "nwp_WP_tot_gen",
+  "nwp_tau_qc_tot_gen", "nwp_tau_qs_gen", "nwp_tau_qi_tot_gen", "nwp_T",
+  "nwp_MR", "nwp_P", NULL, NULL, NULL, "nwp_DNI", "nwp_DHI", "nwp_TAOD",
+  "nwp_cloud_frac", "nwp_WVP", "nwp_WP_tot", "nwp_tau_qc_tot", "nwp_tau_qs",
+  "nwp_tau_qi_tot", "nwp_Kt"
+};
+
+static const int NUM_PREDICTOR_NAMES = sizeof(PREDICTOR_NAMES) / sizeof(PREDICTOR_NAMES[0]);
+
 FcstProcessor::FcstProcessor(const Arguments &argsParam):
-  args(argsParam)
+  args(argsParam), siteMgr(NULL), nwpPredictorCache(NULL), runProfile(NULL),
+  statcastBlender(NULL), haveBlend(false), deferWrites(false), lastGenTime(0)
 { 
   error = string("");
+
+  nwpInterpGap = args.nwpInterpGap;
+
+  if (args.predictorCacheDir != "")
+  {
+     nwpPredictorCache = new NwpPredictorCache(args.predictorCacheDir,
+                                               args.nwpInterpGap);
+  }
+
+  if (args.profile)
+  {
+     runProfile = new RunProfile("ghi_fcst");
+
+     //
+     // Checked by Arguments
+     //
+     if (args.latencyBudget != "")
+     {
+        runProfile->parse_budgets(args.latencyBudget);
+     }
+  }
+
+  loadProfile = runProfile;
+
+  if (args.blendNwpPattern != "")
+  {
+     statcastBlender = new StatcastBlender(args.blendConfFile, args.blendMapFile,
+                                           args.blendSiteFile,
+                                           args.blendClimateZoneFile);
+  }
 }
 
 FcstProcessor::~FcstProcessor()
@@ -48,6 +121,32 @@ FcstProcessor::~FcstProcessor()
   {
      delete siteMgr;
   }
+  if (nwpPredictorCache)
+  {
+     delete nwpPredictorCache;
+  }
+  if (runProfile)
+  {
+     loadProfile = NULL;
+
+     delete runProfile;
+  }
+  if (statcastBlender)
+  {
+     delete statcastBlender;
+  }
+  if (solarSites)
+  {
+     delete solarSites;
+
+     solarSites = NULL;
+  }
+  if (shadingMask)
+  {
+     delete shadingMask;
+
+     shadingMask = NULL;
+  }
   for (int i =0; i< (int) leadTimeCubistModels.size();i++)
   {
      if (leadTimeCubistModels[i])
@@ -68,9 +167,39 @@ int FcstProcessor::run()
   }
 
   //
-  // Instantiate manager of NWP forecast files and load files
-  //  
-  NwpMgr nwpMgr;
+  // Solar geometry from site locations, rather than from the input files
+  //
+  if (args.siteLocationFile != "")
+  {
+     solarSites = new SolarSites(args.siteLocationFile);
+
+     if (solarSites->parse())
+     {
+        Logg->write_time("Error: Failure to read site location file %s\n",
+                         args.siteLocationFile.c_str());
+        return 1;
+     }
+  }
+
+  //
+  // Shading mask for observations that have not been shading QC'd
+  //
+  if (args.shadingDir != "")
+  {
+     shadingMask = new ShadingMask();
+
+     if (shadingMask->compile(args.shadingDir, args.shadingSiteFile) != 0)
+     {
+        Logg->write_time("Error: Failure to compile shading tables: %s\n",
+                         shadingMask->error().c_str());
+        return 1;
+     }
+  }
+
+  if (args.rangeMode)
+  {
+     return runRange();
+  }
 
   if ((int) args.nwpFiles.size() == 0)
   {
@@ -79,83 +208,118 @@ int FcstProcessor::run()
      return 1;
   }
 
-  for (int i = 0; i < (int) args.nwpFiles.size(); i++)
+  if ((int) args.obsFiles.size() == 0)
   {
-    if (DebugLevel > 1)
-    {
-      Logg->write_time("Info: Reading wrf-solar file %s\n", 
-		       args.nwpFiles[i].c_str());
+     Logg->write_time("ERROR: No Observation data available. ghi_fcst cannot run.\n");
 
-    }
+     return 1;
+  }
 
-    NwpReader *nwpReader = new NwpReader(args.nwpFiles[i]);  
+  //
+  // Parse the NWP and observation files and create the cubist interface
+  // for each lead time concurrently. Cubist is the statistical learning
+  // algorithm used to create machine learning models. Readers go into
+  // slots in command line order and are added to the managers in that
+  // order once all tasks are done.
+  //
+  // netCDF inputs parse one at a time under the netCDF lock, so together
+  // they take the sum of their parse times; what runs concurrently is
+  // that sum with model loading and with site store inputs, which are
+  // mapped and parse without the lock. The run profile's
+  // netcdf_lock_wait stage is the time the parse tasks spent waiting.
+  //
+  vector <NwpReader *> nwpReaders(args.nwpFiles.size(), (NwpReader *)NULL);
 
-    nwpReader->parse();
+  vector <ObsReader *> obsReaders(args.obsFiles.size(), (ObsReader *)NULL);
 
-    string nwpError = nwpReader->getError();
+  TaskPool taskPool(args.numThreads);
 
-    if ( strcmp(nwpError.c_str(),"") != 0 )
+  for (int i = 0; i < (int) args.nwpFiles.size(); i++)
+  {
+    taskPool.add(args.nwpFiles[i], [this, i, &nwpReaders]()
     {
-      Logg->write_time("ERROR: Failure to reading wrf-solar file %s: %s\n", 
-		       args.nwpFiles[i].c_str(), nwpError.c_str());
+      ScopedTimer timer(runProfile, "parse_nwp");
 
-      return 1;
-    }
-    else
+      string readError;
+
+      nwpReaders[i] = loadNwpReader(args.nwpFiles[i], readError);
+
+      return readError;
+    });
+  }
+
+  for (int i = 0; i < (int) args.obsFiles.size(); i++)
+  {
+    taskPool.add(args.obsFiles[i], [this, i, &obsReaders]()
     {
-      nwpMgr.add(nwpReader);
-    }
+      ScopedTimer timer(runProfile, "parse_obs");
+
+      string readError;
+
+      obsReaders[i] = loadObsReader(args.obsFiles[i], readError);
+
+      return readError;
+    });
   }
 
-  //
-  // Instantiate manager of observations files and load files 
-  //
-  ObsMgr obsMgr;
+  addModelTasks(taskPool);
 
-  if ((int) args.obsFiles.size() == 0)
+  if (statcastBlender)
   {
-     Logg->write_time("ERROR: No Observation data available. ghi_fcst cannot run.\n");
+    taskPool.add(args.blendMapFile, [this]()
+    {
+      ScopedTimer timer(runProfile, "load_blend");
 
-     return 1;
+      return statcastBlender->load() ? statcastBlender->getError() : string("");
+    });
   }
 
-  for (int i = 0; i < (int) args.obsFiles.size(); i++)
+  ScopedTimer startupTimer(runProfile, "startup");
+
+  int numFailed = taskPool.run();
+
+  startupTimer.stop();
+
+  if (DebugLevel > 0)
+  {
+     Logg->write_time("Info: Read %d NWP and %d observation files and %d "
+                      "models on %d threads\n", (int) nwpReaders.size(),
+                      (int) obsReaders.size(), args.fcstLeadsNum,
+                      taskPool.getThreadsUsed());
+  }
+
+  //
+  // The managers own the readers, including those parsed before a failure
+  //
+  NwpMgr nwpMgr;
+
+  ObsMgr obsMgr;
+
+  for (int i = 0; i < (int) nwpReaders.size(); i++)
   {
-    if (DebugLevel > 1)
+    if (nwpReaders[i])
     {
-      Logg->write_time("Info: Reading observations file %s\n", 
-		       args.obsFiles[i].c_str());
+      nwpMgr.add(nwpReaders[i]);
     }
-     
-    ObsReader *obsReader = new ObsReader(args.obsFiles[i], 900);    
-     
-    //
-    // Parse the file
-    //
-    if (obsReader->parse())
-    {
-      string obsError = obsReader->getError();
+  }
 
-      Logg->write_time("Error: Failure to read netCDF file %s: %s", 
-		       args.obsFiles[i].c_str(), obsError.c_str());
-      
-      return 1;
-    }
-    else
+  for (int i = 0; i < (int) obsReaders.size(); i++)
+  {
+    if (obsReaders[i])
     {
-       obsMgr.add(obsReader);
+      obsMgr.add(obsReaders[i]);
     }
   }
 
-  //
-  // Create cubist interface objects for each lead time
-  // Cubist is the statistical learning algorithm used
-  // to create machine learning models
-  //
-  if( loadCubistModels())
+  if (numFailed)
   {
-     Logg->write_time("Error: Cubist interface did not initialize properly "
-                      "for one or more models" );
+     for (int i = 0; i < (int) taskPool.getErrors().size(); i++)
+     {
+        Logg->write_time("Error: %s\n", taskPool.getErrors()[i].c_str());
+     }
+
+     Logg->write_time("Error: %d of the input files and models failed to "
+                      "load\n", numFailed);
 
      return 1;
   }
@@ -180,6 +344,8 @@ int FcstProcessor::run()
   //
   double fcstGenTime;
 
+  ScopedTimer predictTimer(runProfile, "predict");
+
   if ( predict(nwpMgr, obsMgr, fcstGenTime))
   {
     Logg->write_time("Error: Prediction failure.");
@@ -187,16 +353,463 @@ int FcstProcessor::run()
     return 1;
   }
 
+  predictTimer.stop();
+
+  lastGenTime = fcstGenTime;
+
   //
   // Write netCDF output file
   //
-  writeNetcdf(args.cdlFile, args.outputDir, fcstGenTime);
+  if (!deferWrites)
+  {
+    ScopedTimer writeTimer(runProfile, "write_netcdf");
+
+    writeNetcdf(args.cdlFile, args.outputDir, fcstGenTime);
+  }
+
+  string blendError;
+
+  if (statcastBlender && blendStatcast(fcstGenTime, blendError))
+  {
+    Logg->write_time("Error: Blend failure: %s\n", blendError.c_str());
+
+    return 1;
+  }
+
+  if (!deferWrites)
+  {
+    writeProfile();
+  }
 
   return 0;
 }
 
+int FcstProcessor::writeDeferred()
+{
+  ScopedTimer writeTimer(runProfile, "write_netcdf");
+
+  writeNetcdf(args.cdlFile, args.outputDir, lastGenTime);
+
+  writeTimer.stop();
+
+  int ret = 0;
+
+  if (haveBlend)
+  {
+    ScopedTimer blendTimer(runProfile, "write_blend");
+
+    string writeError;
+
+    if (StatcastBlender::write(blendOut, blendFile, writeError))
+    {
+      Logg->write_time("Error: Blend failure: %s\n", writeError.c_str());
+
+      ret = 1;
+    }
+  }
+
+  writeProfile();
+
+  return ret;
+}
+
+int FcstProcessor::runRange()
+{
+  //
+  // Models and sites do not change with issue time, so load them once
+  //
+  if( loadCubistModels())
+  {
+     Logg->write_time("Error: Cubist interface did not initialize properly "
+                      "for one or more models\n" );
+
+     return 1;
+  }
+
+  if (statcastBlender)
+  {
+     ScopedTimer blendLoadTimer(runProfile, "load_blend");
+
+     if (statcastBlender->load())
+     {
+        Logg->write_time("Error: Failure to load blend: %s\n",
+                         statcastBlender->getError().c_str());
+        return 1;
+     }
+  }
+
+  siteMgr = new SiteMgr(args.siteIdFile);
+
+  if( siteMgr->parse())
+  {
+     Logg->write_time("Error: Failure to read siteID file: %s\n",
+                      args.siteIdFile.c_str());
+     return 1;
+  }
+
+  ReaderCache<NwpReader> nwpCache(args.readerCacheSize, loadNwpReader);
+
+  ReaderCache<ObsReader> obsCache(args.readerCacheSize, loadObsReader);
+
+  int numWritten = 0;
+
+  int numSkipped = 0;
+
+  for (time_t issueTime = args.rangeStart; issueTime <= args.rangeEnd;
+       issueTime += args.rangeStep)
+  {
+    //
+    // Input files for this issue time, as chosen by ghi_fcst.py: NWP files
+    // from the issue hour back to the lookback, observation files every
+    // obsDelta seconds back to the lookback
+    //
+    vector<time_t> nwpTimes;
+
+    for (int dt = 0; dt <= args.nwpLookback; dt += 3600)
+    {
+      nwpTimes.push_back(issueTime - dt);
+    }
+
+    vector<time_t> obsTimes;
+
+    for (int dt = 0; dt <= args.obsLookback; dt += args.obsDelta)
+    {
+      obsTimes.push_back(issueTime - dt);
+    }
+
+    vector<string> nwpPaths;
+
+    vector<string> obsPaths;
+
+    expandPattern(args.nwpPattern, nwpTimes, nwpPaths);
+
+    expandPattern(args.obsPattern, obsTimes, obsPaths);
+
+    nwpCache.beginBatch();
+
+    obsCache.beginBatch();
+
+    //
+    // The managers borrow readers from the caches and must not delete them
+    //
+    NwpMgr nwpMgr;
+
+    ObsMgr obsMgr;
+
+    //
+    // Cache hits add calls but little time to the parse stages
+    //
+    ScopedTimer nwpTimer(runProfile, "parse_nwp");
+
+    for (int i = 0; i < (int) nwpPaths.size(); i++)
+    {
+      string readError;
+
+      NwpReader *nwpReader = nwpCache.get(nwpPaths[i], readError);
+
+      if (nwpReader == NULL)
+      {
+        Logg->write_time("Warning: Failure to read wrf-solar file %s: %s\n",
+                         nwpPaths[i].c_str(), readError.c_str());
+      }
+      else
+      {
+        nwpMgr.add(nwpReader);
+      }
+    }
+
+    nwpTimer.stop();
+
+    ScopedTimer obsTimer(runProfile, "parse_obs");
+
+    for (int i = 0; i < (int) obsPaths.size(); i++)
+    {
+      string readError;
+
+      ObsReader *obsReader = obsCache.get(obsPaths[i], readError);
+
+      if (obsReader == NULL)
+      {
+        Logg->write_time("Warning: Failure to read observations file %s: %s\n",
+                         obsPaths[i].c_str(), readError.c_str());
+      }
+      else
+      {
+        obsMgr.add(obsReader);
+      }
+    }
+
+    obsTimer.stop();
+
+    if (nwpMgr.size() == 0 || obsMgr.size() == 0)
+    {
+      Logg->write_time("Warning: Skipping issue time %ld: %d NWP and %d "
+                       "observation files\n", (long)issueTime, nwpMgr.size(),
+                       obsMgr.size());
+
+      nwpMgr.release();
+
+      obsMgr.release();
+
+      numSkipped++;
+
+      continue;
+    }
+
+    if (DebugLevel > 0)
+    {
+      Logg->write_time("Info: Issue time %ld: %d NWP and %d observation "
+                       "files\n", (long)issueTime, nwpMgr.size(),
+                       obsMgr.size());
+    }
+
+    args.fcstStartTime = issueTime;
+
+    clearOutput();
+
+    double fcstGenTime;
+
+    ScopedTimer predictTimer(runProfile, "predict");
+
+    int ret = predict(nwpMgr, obsMgr, fcstGenTime);
+
+    predictTimer.stop();
+
+    nwpMgr.release();
+
+    obsMgr.release();
+
+    if (ret)
+    {
+      Logg->write_time("Error: Prediction failure for issue time %ld.\n",
+                       (long)issueTime);
+
+      numSkipped++;
+
+      continue;
+    }
+
+    ScopedTimer writeTimer(runProfile, "write_netcdf");
+
+    writeNetcdf(args.cdlFile, args.outputDir, fcstGenTime);
+
+    writeTimer.stop();
+
+    //
+    // A missing NWP grid does not stop the range
+    //
+    string blendError;
+
+    if (statcastBlender && blendStatcast(fcstGenTime, blendError))
+    {
+      Logg->write_time("Warning: No blend for issue time %ld: %s\n",
+                       (long)issueTime, blendError.c_str());
+    }
+
+    numWritten++;
+  }
+
+  Logg->write_time("Info: Range mode wrote %d forecasts, skipped %d issue "
+                   "times\n", numWritten, numSkipped);
+
+  Logg->write_time("Info: NWP file cache: %d hits, %d reads. Observation file "
+                   "cache: %d hits, %d reads\n", nwpCache.getHits(),
+                   nwpCache.getMisses(), obsCache.getHits(),
+                   obsCache.getMisses());
+
+  //
+  // One profile for the whole range, next to the last forecast
+  //
+  if (numWritten > 0)
+  {
+    writeProfile();
+  }
+
+  return (numWritten == 0);
+}
+
+void FcstProcessor::clearOutput()
+{
+  siteIds.clear();
+
+  siteNames.clear();
+
+  validTimes.clear();
+
+  ghiAll.clear();
+
+  ktAll.clear();
+
+  toaAll.clear();
+
+  solarElAll.clear();
+
+  wrfGhiAll.clear();
+
+  wrfKtAll.clear();
+
+  wrfToaAll.clear();
+}
+
+void FcstProcessor::expandPattern(const string &pattern,
+                                  const vector<time_t> &times,
+                                  vector<string> &paths)
+{
+  paths.clear();
+
+  for (int i = 0; i < (int) times.size(); i++)
+  {
+    char path[1024];
+
+    time_t t = times[i];
+
+    struct tm tms;
+
+    struct tm *tmPtr = gmtime_r(&t, &tms);
+
+    if (strftime(path, sizeof(path), pattern.c_str(), tmPtr) == 0)
+    {
+      continue;
+    }
+
+    glob_t globBuf;
+
+    if (glob(path, 0, NULL, &globBuf) == 0)
+    {
+      for (size_t j = 0; j < globBuf.gl_pathc; j++)
+      {
+        paths.push_back(globBuf.gl_pathv[j]);
+      }
+    }
+
+    globfree(&globBuf);
+  }
+
+  std::sort(paths.begin(), paths.end());
+
+  paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+}
+
+NwpReader *FcstProcessor::loadNwpReader(const string &path, string &readError)
+{
+  if (DebugLevel > 1)
+  {
+    Logg->write_time("Info: Reading wrf-solar file %s\n", path.c_str());
+  }
+
+  string nwpPath = path;
+
+  NwpReader *nwpReader = new NwpReader(nwpPath);
+
+  nwpReader->setSolarSites(solarSites);
+
+  nwpReader->setInterpolation(nwpInterpGap);
+
+  std::unique_lock<std::mutex> lock(netcdf_lock(), std::defer_lock);
+
+  if (!SiteStore::is_store(path))
+  {
+    ScopedTimer waitTimer(loadProfile, "netcdf_lock_wait");
+
+    lock.lock();
+  }
+
+  nwpReader->parse();
+
+  readError = nwpReader->getError();
+
+  if (readError != "")
+  {
+    delete nwpReader;
+
+    return NULL;
+  }
+
+  return nwpReader;
+}
+
+ObsReader *FcstProcessor::loadObsReader(const string &path, string &readError)
+{
+  if (DebugLevel > 1)
+  {
+    Logg->write_time("Info: Reading observations file %s\n", path.c_str());
+  }
+
+  ObsReader *obsReader = new ObsReader(path, 900);
+
+  obsReader->setSolarSites(solarSites);
+
+  obsReader->setShadingMask(shadingMask);
+
+  std::unique_lock<std::mutex> lock(netcdf_lock(), std::defer_lock);
+
+  if (!SiteStore::is_store(path))
+  {
+    ScopedTimer waitTimer(loadProfile, "netcdf_lock_wait");
+
+    lock.lock();
+  }
+
+  if (obsReader->parse())
+  {
+    readError = obsReader->getError();
+
+    delete obsReader;
+
+    return NULL;
+  }
+
+  return obsReader;
+}
+
 int FcstProcessor::predict( NwpMgr &nwpMgr, ObsMgr &obsMgr, double &fcstGenTime) 
 {
+   //
+   // Map or build the block of NWP predictors shared with other runs made
+   // from the same NWP files
+   //
+   if (nwpPredictorCache)
+   {
+      double genTime = (args.fcstStartTime >= 0) ? 
+                       (double)args.fcstStartTime : nwpMgr.getMostRecentGenTime();
+
+      vector <int> cacheSiteIds;
+
+      for( int s = 0; s < siteMgr->getNumSites(); s++)
+      {
+         cacheSiteIds.push_back(siteMgr->getSiteId(s));
+      }
+
+      vector <int> leadMinutes;
+
+      if (args.subsetFcst)
+      {
+         leadMinutes = args.fcstLeadsSubset;
+      }
+      else
+      {
+         for (int i = 1; i <= args.fcstLeadsNum; i++)
+         {
+            leadMinutes.push_back(i * args.fcstLeadsDelta);
+         }
+      }
+
+      if (nwpPredictorCache->open(nwpMgr, cacheSiteIds, genTime, leadMinutes,
+                                  args.fcstLeadsDelta))
+      {
+         Logg->write_time("Warning: NWP predictor cache not used: %s\n",
+                          nwpPredictorCache->error.c_str());
+
+         delete nwpPredictorCache;
+
+         nwpPredictorCache = NULL;
+      }
+      else
+      {
+         nwpPredictorCache->purge(PREDICTOR_CACHE_MAX_AGE);
+      }
+   }
+
    for( int s = 0; s < siteMgr->getNumSites(); s++)
    {
       //
@@ -323,13 +936,19 @@ int FcstProcessor::predict( NwpMgr &nwpMgr, ObsMgr &obsMgr, double &fcstGenTime)
          // Check for forecasted NWP elevation-- if this is missing, the NWP data
          // for this site and lead must all be missing so we dont make a prediction
          //
-         if ( nwpMgr.getToa(siteId,fcstTime) != NwpReader::NWP_MISSING)
+         if ( nwpValue(NwpReader::TOA, siteId, fcstTime, nwpMgr) !=
+              NwpReader::NWP_MISSING)
          { 
             //
             // Get the prediction using the cubist interface 
             //
             prediction =   leadTimeCubistModels[i-1]->predict(cubistInputStr);
 
+            if (runProfile)
+            {
+               countMissingPredictors(predictorVals);
+            }
+
             //
             // The predictand is Clearness Index, Kt, then bound the 
             // result by 0 below and 1 above
@@ -346,7 +965,8 @@ int FcstProcessor::predict( NwpMgr &nwpMgr, ObsMgr &obsMgr, double &fcstGenTime)
             //
             // Compute GHI at lead time by multiplying Kt by TOA at lead time
             //
-            ghiPrediction = prediction * nwpMgr.getToa(siteId,fcstTime);
+            ghiPrediction = prediction * 
+              nwpValue(NwpReader::TOA, siteId, fcstTime, nwpMgr);
          }
 
          ktAll.push_back(prediction); 
@@ -364,11 +984,13 @@ int FcstProcessor::predict( NwpMgr &nwpMgr, ObsMgr &obsMgr, double &fcstGenTime)
                                  cubistInputStr.c_str());
             }
 
+            struct tm tms;
+
             struct tm * tmPtr;
 
             time_t t = fcstTime;
 
-            tmPtr = gmtime ( &t );
+            tmPtr = gmtime_r ( &t, &tms );
 
             int year = tmPtr->tm_year + 1900;
 
@@ -408,7 +1030,9 @@ void FcstProcessor::writeNetcdf(const string cdlFile, const string outputDir,
   //
   time_t gTime = genTime;
 
-  tm *timePtr = gmtime(&gTime);
+  tm tms;
+
+  tm *timePtr = gmtime_r(&gTime, &tms);
 
   char timeStr[16];
 
@@ -426,6 +1050,10 @@ void FcstProcessor::writeNetcdf(const string cdlFile, const string outputDir,
   string outfile = outputDir + "/" +  "ghi_fcst." + modelBase + "." + timeStr + ".nc";
       
   Logg->write_time("Info: Writing output to %s\n", outfile.c_str());  
+
+  outputFile = outfile;
+
+  std::lock_guard<std::mutex> lock(netcdf_lock());
       
   //  
   // Create output netCDF file 
@@ -473,10 +1101,30 @@ void FcstProcessor::writeNetcdf(const string cdlFile, const string outputDir,
 
 int FcstProcessor::loadCubistModels( )
 {
+   TaskPool taskPool(args.numThreads);
+
+   addModelTasks(taskPool);
+
+   if (taskPool.run())
+   {
+      for (int i = 0; i < (int) taskPool.getErrors().size(); i++)
+      {
+         Logg->write_time("Error: %s\n", taskPool.getErrors()[i].c_str());
+      }
+
+      return 1;
+   }
+
+   return 0;
+}
 
+void FcstProcessor::addModelTasks(TaskPool &taskPool)
+{
    //
-   // Instantiate the cubist interface for each lead time 
+   // One slot for the cubist interface of each lead time
    //
+   leadTimeCubistModels.assign(args.fcstLeadsNum, (cubist_interface *)NULL);
+
    for( int i = 1; i <= args.fcstLeadsNum; i++)
    {
       //
@@ -488,32 +1136,114 @@ int FcstProcessor::loadCubistModels( )
 
       string leadTimeModelStr = args.cubistModel + string(".lt") + string(leadBuf);
 
-      //
-      // Instantiate the interface to the Cubist model
-      //
-      cubist_interface *cubistInterfacePtr = new  cubist_interface(leadTimeModelStr);
-
-      if (cubistInterfacePtr == NULL)
+      taskPool.add(leadTimeModelStr, [this, i, leadTimeModelStr]()
       {
-        Logg->write_time("Error: Failure to initialize cubist model with cubist"
-                         " basename: %s\n", leadTimeModelStr.c_str());
+         ScopedTimer timer(runProfile, "load_models");
 
-        return 1;
-      }
-      else
-      {
-        leadTimeCubistModels.push_back(cubistInterfacePtr);
+         std::lock_guard<std::mutex> lock(cubistLoadMutex);
+
+         //
+         // Instantiate the interface to the Cubist model
+         //
+         cubist_interface *cubistInterfacePtr = new  cubist_interface(leadTimeModelStr);
+
+         if (cubistInterfacePtr == NULL)
+         {
+           return string("Failure to initialize cubist model");
+         }
+
+         leadTimeCubistModels[i-1] = cubistInterfacePtr;
         
-        if (DebugLevel > 1)
-        {
-          Logg->write_time("Info: Initialized cubist model with cubist basename: "
-                           "%s\n", leadTimeModelStr.c_str());
-        }
-      }
+         if (DebugLevel > 1)
+         {
+           Logg->write_time("Info: Initialized cubist model with cubist basename: "
+                            "%s\n", leadTimeModelStr.c_str());
+         }
+
+         return string("");
+      });
    }
-   return 0;
 }
-   
+
+int FcstProcessor::blendStatcast(const double genTime, string &blendError)
+{
+   ScopedTimer timer(runProfile, "blend");
+
+   time_t gTime = genTime;
+
+   struct tm tms;
+
+   struct tm *timePtr = gmtime_r(&gTime, &tms);
+
+   char nwpFile[1024];
+
+   if (strftime(nwpFile, sizeof(nwpFile), args.blendNwpPattern.c_str(), timePtr) == 0)
+   {
+      blendError = string("Cannot expand ") + args.blendNwpPattern;
+      return 1;
+   }
+
+   char dayStr[16];
+
+   char timeStr[16];
+
+   strftime(dayStr, sizeof(dayStr), "%Y%m%d", timePtr);
+
+   strftime(timeStr, sizeof(timeStr), "%Y%m%d.%H%M", timePtr);
+
+   string blendDir = args.blendOutputDir + "/" + dayStr;
+
+   boost::system::error_code ec;
+
+   boost::filesystem::create_directories(blendDir, ec);
+
+   blendFile = blendDir + "/NWP_statcast_blend." + timeStr + ".nc";
+
+   Logg->write_time("Info: Blending %s into %s\n", nwpFile, blendFile.c_str());
+
+   haveBlend = false;
+
+   if (statcastBlender->blend(nwpFile, genTime, siteIds, validTimes, ghiAll,
+                              CUBIST_MISSING, blendOut))
+   {
+      blendError = statcastBlender->getError();
+      return 1;
+   }
+
+   haveBlend = true;
+
+   if (deferWrites)
+   {
+      return 0;
+   }
+
+   return StatcastBlender::write(blendOut, blendFile, blendError);
+}
+
+float FcstProcessor::nwpValue(const NwpReader::Var var, const int siteId,
+                              const double validTime, NwpMgr &nwpMgr)
+{
+   if (nwpPredictorCache)
+   {
+      return nwpPredictorCache->get(var, siteId, validTime, nwpMgr);
+   }
+
+   return nwpMgr.get(var, siteId, validTime);
+}
+
+void FcstProcessor::nwpGather(const NwpReader::Var *vars, const int numVars,
+                              const int siteId, const double validTime,
+                              NwpMgr &nwpMgr, float *values)
+{
+   if (nwpPredictorCache)
+   {
+      nwpPredictorCache->gather(vars, numVars, siteId, validTime, nwpMgr, values);
+
+      return;
+   }
+
+   nwpMgr.gather(vars, numVars, siteId, validTime, values);
+}
 
 void FcstProcessor::loadPredictors(const double fcstTime, const double fcstGenTime,
                              const int siteId, vector <float> & predictorVals, 
@@ -523,43 +1253,56 @@ void FcstProcessor::loadPredictors(const double fcstTime, const double fcstGenTi
    //
    // Get Observerations at forecast generation time
    //
-   float t = obsMgr.getTemp(siteId, fcstGenTime);
+   static const ObsReader::Var OBS_GEN_VARS[] =
+   {
+      ObsReader::TEMP, ObsReader::RH, ObsReader::GHI, ObsReader::PRESSURE,
+      ObsReader::WIND_SPEED, ObsReader::WIND_DIR, ObsReader::ELEVATION,
+      ObsReader::AZIMUTH, ObsReader::TOA, ObsReader::KT
+   };
+
+   const int numObsVars = sizeof(OBS_GEN_VARS) / sizeof(OBS_GEN_VARS[0]);
+
+   float obsGen[numObsVars];
+
+   obsMgr.gather(OBS_GEN_VARS, numObsVars, siteId, fcstGenTime, obsGen);
+
+   float t = obsGen[0];
    predictorVals.push_back(t);
 
    // RH obs not used by models
-   float rh = obsMgr.getRh(siteId, fcstGenTime);
+   float rh = obsGen[1];
    predictorVals.push_back(rh);
         
    // GHI not used in models
-   float obsGhi = obsMgr.getGHI(siteId, fcstGenTime);
+   float obsGhi = obsGen[2];
    predictorVals.push_back(CUBIST_MISSING);
 
    // Pressure not used in models
-   float p = obsMgr.getPressure(siteId, fcstGenTime);
+   float p = obsGen[3];
    predictorVals.push_back(p);
 
    // Wind speed not used by models
-   float ws = obsMgr.getWindSpeed(siteId, fcstGenTime);
+   float ws = obsGen[4];
    // not used
    predictorVals.push_back(CUBIST_MISSING);
 
    // Wind direction not used by models
-   float wd = obsMgr.getWindDir(siteId, fcstGenTime);
+   float wd = obsGen[5];
    // not used
    predictorVals.push_back(CUBIST_MISSING);
 
-   float el = obsMgr.getElevation(siteId, fcstGenTime);
+   float el = obsGen[6];
    predictorVals.push_back(el);
 
-   float az = obsMgr.getAzimuth(siteId, fcstGenTime);
+   float az = obsGen[7];
    predictorVals.push_back(az);
 
    // Used for analysis but not prediction
-   float obsToa =  obsMgr.getToa(siteId, fcstGenTime);
+   float obsToa = obsGen[8];
    //not used
    predictorVals.push_back(CUBIST_MISSING);
 
-   float obsKt = obsMgr.getKt(siteId, fcstGenTime);
+   float obsKt = obsGen[9];
    predictorVals.push_back(obsKt);
    
    //
@@ -580,6 +1323,38 @@ void FcstProcessor::loadPredictors(const double fcstTime, const double fcstGenTi
    float predPlaceHold = CUBIST_MISSING;
    predictorVals.push_back(predPlaceHold);
 
+   //
+   // NWP variables at generation time and at forecast time, each set read
+   // in one lookup of the site and time
+   //
+   static const NwpReader::Var NWP_GEN_VARS[] =
+   {
+      NwpReader::MIXING_RATIO, NwpReader::GHI, NwpReader::DNI, NwpReader::DHI,
+      NwpReader::TAOD5502D, NwpReader::CLOUD_FRAC, NwpReader::WVP, NwpReader::WP_TOT,
+      NwpReader::TAU_QC_TOT, NwpReader::TAU_QS, NwpReader::TAU_QI_TOT
+   };
+
+   static const NwpReader::Var NWP_FCST_VARS[] =
+   {
+      NwpReader::TOA, NwpReader::AZIMUTH, NwpReader::ELEVATION, NwpReader::TEMP,
+      NwpReader::MIXING_RATIO, NwpReader::PSFC, NwpReader::WIND_SPEED, NwpReader::WIND_DIR,
+      NwpReader::GHI, NwpReader::DNI, NwpReader::DHI, NwpReader::TAOD5502D,
+      NwpReader::CLOUD_FRAC, NwpReader::WVP, NwpReader::WP_TOT, NwpReader::TAU_QC_TOT,
+      NwpReader::TAU_QS, NwpReader::TAU_QI_TOT, NwpReader::KT, NwpReader::WRF_TOA2
+   };
+
+   const int numGenVars = sizeof(NWP_GEN_VARS) / sizeof(NWP_GEN_VARS[0]);
+
+   const int numFcstVars = sizeof(NWP_FCST_VARS) / sizeof(NWP_FCST_VARS[0]);
+
+   float nwpGen[numGenVars];
+
+   float nwpFcst[numFcstVars];
+
+   nwpGather(NWP_GEN_VARS, numGenVars, siteId, fcstGenTime, nwpMgr, nwpGen);
+
+   nwpGather(NWP_FCST_VARS, numFcstVars, siteId, fcstTime, nwpMgr, nwpFcst);
+
    //
    // Get Solar variables at forecast time
    //
@@ -587,14 +1362,14 @@ void FcstProcessor::loadPredictors(const double fcstTime, const double fcstGenTi
    //
    // TOA not used for prediction but recorded for analysis
    // 
-   float toaFcst = nwpMgr.getToa(siteId, fcstTime);
+   float toaFcst = nwpFcst[0];
    predictorVals.push_back(CUBIST_MISSING);
    toaAll.push_back(toaFcst);
 
-   float azFcst = nwpMgr.getAzimuth(siteId, fcstTime);
+   float azFcst = nwpFcst[1];
    predictorVals.push_back(azFcst);
 
-   float elFcst = nwpMgr.getElevation(siteId, fcstTime);
+   float elFcst = nwpFcst[2];
    predictorVals.push_back(elFcst);
    solarElAll.push_back(elFcst);
    
@@ -607,99 +1382,99 @@ void FcstProcessor::loadPredictors(const double fcstTime, const double fcstGenTi
    //
    // Get NWP vars generation time
    //
-   float mr = nwpMgr.getMixingRatio(siteId, fcstGenTime);
+   float mr = nwpGen[0];
    predictorVals.push_back(mr);
 
    // model GHI at gen time not used in model
-   float wrfGhiGen = nwpMgr.getGHI(siteId, fcstGenTime);
+   float wrfGhiGen = nwpGen[1];
    // not used
    predictorVals.push_back(CUBIST_MISSING); 
 
-   float dniGen = nwpMgr.getDNI(siteId, fcstGenTime);
+   float dniGen = nwpGen[2];
    predictorVals.push_back(dniGen);
 
-   float dhiGen = nwpMgr.getDHI(siteId, fcstGenTime);
+   float dhiGen = nwpGen[3];
    predictorVals.push_back(dhiGen);
 
-   float toadGen = nwpMgr.getTaod5502d(siteId, fcstGenTime);
+   float toadGen = nwpGen[4];
    predictorVals.push_back(toadGen);
 
-   float cloudFracGen = nwpMgr.getCloudFrac(siteId, fcstGenTime);
+   float cloudFracGen = nwpGen[5];
    // not used
    predictorVals.push_back(CUBIST_MISSING);
 
-   float wvpGen = nwpMgr.getWvp(siteId, fcstGenTime);
+   float wvpGen = nwpGen[6];
    predictorVals.push_back(wvpGen);
 
-   float wpTot = nwpMgr.getWpTot(siteId, fcstGenTime);
+   float wpTot = nwpGen[7];
    predictorVals.push_back(wpTot);
 
-   float tauQcTotGen = nwpMgr.getTauQcTot(siteId, fcstGenTime);
+   float tauQcTotGen = nwpGen[8];
    predictorVals.push_back(tauQcTotGen);
 
-   float tauQsGen = nwpMgr.getTauQs(siteId, fcstGenTime);
+   float tauQsGen = nwpGen[9];
    predictorVals.push_back(tauQsGen);
 
-   float tauQiTot = nwpMgr.getTauQiTot(siteId, fcstGenTime);
+   float tauQiTot = nwpGen[10];
    predictorVals.push_back(tauQiTot);
 
    //
    // NWP variables at forecast time
    //
-   float tFcst = nwpMgr.getTemp(siteId, fcstTime);
+   float tFcst = nwpFcst[3];
    predictorVals.push_back(tFcst);
 
-   float mrFcst = nwpMgr.getMixingRatio(siteId, fcstTime);
+   float mrFcst = nwpFcst[4];
    predictorVals.push_back(mrFcst);
 
-   float pFcst = nwpMgr.getPsfc(siteId, fcstTime);
+   float pFcst = nwpFcst[5];
    predictorVals.push_back(pFcst);
 
    //
    // Wind speed not used in any model
-   float wsFcst = nwpMgr.getWindSpeed(siteId, fcstTime);
+   float wsFcst = nwpFcst[6];
    predictorVals.push_back(CUBIST_MISSING);
 
    //
    // Wind direction not used in any model
    //
-   float wdFcst = nwpMgr.getWindDir(siteId, fcstTime);
+   float wdFcst = nwpFcst[7];
    predictorVals.push_back(CUBIST_MISSING);
 
    // GHI not used in models 
-   float wrfGhiFcst = nwpMgr.getGHI(siteId, fcstTime);
+   float wrfGhiFcst = nwpFcst[8];
    predictorVals.push_back(CUBIST_MISSING);
    // Keep it for post analysis
    wrfGhiAll.push_back(wrfGhiFcst); 
 
-   float dniFcst = nwpMgr.getDNI(siteId, fcstTime);
+   float dniFcst = nwpFcst[9];
    predictorVals.push_back(dniFcst);
 
-   float dhiFcst = nwpMgr.getDHI(siteId, fcstTime);
+   float dhiFcst = nwpFcst[10];
    predictorVals.push_back(dhiFcst);
 
-   float toadFcst = nwpMgr.getTaod5502d(siteId, fcstTime);
+   float toadFcst = nwpFcst[11];
    predictorVals.push_back(toadFcst);
 
-   float cldFracFcst = nwpMgr.getCloudFrac(siteId, fcstTime);
+   float cldFracFcst = nwpFcst[12];
    predictorVals.push_back(cldFracFcst);
 
-   float wvpFcst = nwpMgr.getWvp(siteId, fcstTime);
+   float wvpFcst = nwpFcst[13];
    predictorVals.push_back(wvpFcst);
 
-   float wpTotFcst = nwpMgr.getWpTot(siteId, fcstTime);
+   float wpTotFcst = nwpFcst[14];
    predictorVals.push_back(wpTotFcst);
 
-   float tauQcTotFcst = nwpMgr.getTauQcTot(siteId, fcstTime);
+   float tauQcTotFcst = nwpFcst[15];
    predictorVals.push_back(tauQcTotFcst);
 
-   float tauQsFcst = nwpMgr.getTauQs(siteId, fcstTime);
+   float tauQsFcst = nwpFcst[16];
    predictorVals.push_back(tauQsFcst);
 
-   float tauQiTotFcst = nwpMgr.getTauQiTot(siteId, fcstTime);
+   float tauQiTotFcst = nwpFcst[17];
    predictorVals.push_back(tauQiTotFcst);
 
-   float wrfKtFcst = nwpMgr.getKt(siteId, fcstTime);
+   float wrfKtFcst = nwpFcst[18];
    if ( fabs( wrfKtFcst + 999) > .0000001)
       predictorVals.push_back(wrfKtFcst);
    else
@@ -708,7 +1483,7 @@ void FcstProcessor::loadPredictors(const double fcstTime, const double fcstGenTi
    wrfKtAll.push_back(wrfKtFcst);
 
    // for post analysis
-   float wrfToa2 = nwpMgr.getWrfToa2(siteId, fcstTime);
+   float wrfToa2 = nwpFcst[19];
    wrfToaAll.push_back(wrfToa2);
 
    if (DebugLevel > 1)
@@ -947,6 +1722,51 @@ void FcstProcessor::loadPredictors(const double fcstTime, const double fcstGenTi
    }
 }
 
+void FcstProcessor::countMissingPredictors(const vector <float> &predictorVals)
+{
+  for (int i = 0; i < (int)predictorVals.size() && i < NUM_PREDICTOR_NAMES; i++)
+  {
+    //
+    // The missing values of createCubistInputStr()
+    //
+    if (PREDICTOR_NAMES[i] != NULL && (predictorVals[i] == CUBIST_MISSING ||
+        fabs(predictorVals[i] + 9999.0) <= .00000001 ||
+        fabs(predictorVals[i] + 999.0) <= .00000001))
+    {
+      runProfile->count_missing(PREDICTOR_NAMES[i]);
+    }
+  }
+}
+
+void FcstProcessor::writeProfile()
+{
+  if (runProfile == NULL || outputFile == "")
+  {
+    return;
+  }
+
+  vector<string> overBudget;
+
+  runProfile->over_budget(overBudget);
+
+  for (int i = 0; i < (int)overBudget.size(); i++)
+  {
+    Logg->write_time("Warning: Latency budget: %s\n", overBudget[i].c_str());
+  }
+
+  string profileFile = RunProfile::profile_path(outputFile);
+
+  if (runProfile->write_json(profileFile))
+  {
+    Logg->write_time("Warning: Failure to write run profile: %s\n",
+                     runProfile->error().c_str());
+  }
+  else if (DebugLevel > 0)
+  {
+    Logg->write_time("Info: Wrote run profile %s\n", profileFile.c_str());
+  }
+}
+
 void FcstProcessor::createCubistInputStr(const vector <float> predictorVals, 
                                    string &cubistInputStr)
 {
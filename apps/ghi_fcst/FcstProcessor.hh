@@ -24,12 +24,18 @@
 #include <vector>
 #include <utility>
 #include <cubist_interface/cubist_interface.hh>
+#include <run_profile/run_profile.hh>
 #include "NwpReader.hh"
 #include "Arguments.hh"
 #include "ObsReader.hh"
 #include "NwpMgr.hh"
 #include "ObsMgr.hh"
 #include "SiteMgr.hh"
+#include "ReaderCache.hh"
+#include "NwpPredictorCache.hh"
+#include "SolarSites.hh"
+#include "StatcastBlender.hh"
+#include "TaskPool.hh"
 
 using std::string;
 using std::vector;
@@ -61,6 +67,44 @@ public:
    */
   int run();
 
+  /**
+   * Range (archive/backfill) mode: make a forecast for each issue time from
+   * args.rangeStart to args.rangeEnd. Cubist models and sites are loaded
+   * once, and parsed NWP and observation files are kept in reader caches
+   * so that files shared by neighboring issue times are read once.
+   * Issue times without input files are skipped with a warning.
+   * @return 1 for failure (no forecast written), 0 for success.
+   */
+  int runRange();
+
+  /**
+   * Pipeline mode: run() makes the forecast and the blend in memory and
+   * leaves the netCDF files to writeDeferred()
+   * @param[in] defer  true to defer the writes
+   */
+  void setDeferWrites(const bool defer) { deferWrites = defer; }
+
+  /**
+   * Write the forecast and blend files of a run() with deferred writes,
+   * then the run profile. Only reads the forecast, so it may run in
+   * another thread while the blend is used.
+   * @return 1 for failure, 0 for success.
+   */
+  int writeDeferred();
+
+  /**
+   * The blend made by the last run, NULL if none was made
+   */
+  const StatcastBlender::Blend *getBlend() const
+  {
+    return haveBlend ? &blendOut : NULL;
+  }
+
+  /**
+   * Path of the blend file of the last run
+   */
+  const string &getBlendFile() const { return blendFile; }
+
   string error;
 
   /**
@@ -142,11 +186,110 @@ private:
    */
   vector <float> wrfToaAll;
 
+  /**
+   * On-disk cache of NWP predictors, NULL if not in use
+   */
+  NwpPredictorCache *nwpPredictorCache;
+
+  /**
+   * Site locations from which readers compute solar geometry, NULL if 
+   * solar geometry is read from the input files. Static so that the 
+   * reader cache loaders can use it.
+   */
+  static SolarSites *solarSites;
+
+  /**
+   * Shading mask applied by the observation readers, NULL if none.
+   * Static for the reader cache loaders.
+   */
+  static ShadingMask *shadingMask;
+
+  /**
+   * Largest gap between NWP valid times interpolated by the NWP readers,
+   * 0 for none. Static for the reader cache loaders.
+   */
+  static int nwpInterpGap;
+
+  /**
+   * runProfile, in which the reader cache loaders time their wait for the
+   * netCDF lock. Static for the reader cache loaders.
+   */
+  static RunProfile *loadProfile;
+
+  /**
+   * Per stage run profile, NULL if not profiling
+   */
+  RunProfile *runProfile;
+
+  /**
+   * Blender of the forecast into the gridded NWP forecast, NULL if no
+   * blend is made
+   */
+  StatcastBlender *statcastBlender;
+
+  /**
+   * Blend made by the last blendStatcast(), valid if haveBlend, and the
+   * path it is written to
+   */
+  StatcastBlender::Blend blendOut;
+
+  bool haveBlend;
+
+  string blendFile;
+
+  /**
+   * Leave the netCDF writes of run() to writeDeferred()
+   */
+  bool deferWrites;
+
+  /**
+   * Generation time of the last forecast made by run()
+   */
+  double lastGenTime;
+
+  /**
+   * Path of the last netCDF file written
+   */
+  string outputFile;
+
   /**
    * Integer indicator of the level of debug messaging
    */
   int debugLevel;
 
+  /**
+   * Clear the site and forecast vectors filled by predict() so that the
+   * processor can make the forecast for another issue time
+   */
+  void clearOutput();
+
+  /**
+   * Expand a range mode file pattern at the given times: strftime
+   * conversions are replaced for each time, then glob wildcards are
+   * matched. Paths are returned sorted without duplicates.
+   * @param[in] pattern  File path pattern
+   * @param[in] times  Unix times at which to expand the pattern
+   * @param[out] paths  Existing files matching the pattern
+   */
+  static void expandPattern(const string &pattern, const vector<time_t> &times,
+                            vector<string> &paths);
+
+  /**
+   * Create and parse an NwpReader for the reader cache
+   * @param[in] path  NWP file path
+   * @param[out] readError  Error message on failure
+   * @return Parsed reader, or NULL on failure
+   */
+  static NwpReader *loadNwpReader(const string &path, string &readError);
+
+  /**
+   * Create and parse an ObsReader for the reader cache
+   * @param[in] path  Observation file path
+   * @param[out] readError  Error message on failure
+   * @return Parsed reader, or NULL on failure
+   */
+  static ObsReader *loadObsReader(const string &path, string &readError);
+
   /**
    * For each forecast lead time, load a vector of predictor values, 
    * feed to predictive model, record prediction.
@@ -176,6 +319,24 @@ private:
    */
   int loadCubistModels();
 
+  /**
+   * Add a task instantiating the cubist interface of each lead time, as in
+   * loadCubistModels(), to a task pool. leadTimeCubistModels is sized to
+   * the number of lead times and each task fills its own element.
+   * @param[in] taskPool  Task pool run by the caller
+   */
+  void addModelTasks(TaskPool &taskPool);
+
+  /**
+   * Blend the forecast made by predict() into the gridded NWP forecast
+   * at the generation time and, unless writes are deferred, write the
+   * result to the blend output directory
+   * @param[in] genTime  Generation time of the forecast
+   * @param[out] blendError  Error message on failure
+   * @return 1 for failure, 0 for success
+   */
+  int blendStatcast(const double genTime, string &blendError);
+
   /**
    * Retrieve observations and NWP values to be used as predictors. 
    * @param[in] fcstTime  Forecast valid time 
@@ -191,6 +352,42 @@ private:
   void loadPredictors(const double fcstTime, const double fcstGenTime,
                       const int siteID, vector <float> & predictorVals, 
                       NwpMgr &nwpMgr, ObsMgr &obsMgr);
+  /**
+   * Get an NWP predictor value, from the predictor cache if in use
+   * @param[in] var  NWP variable
+   * @param[in] siteId  Integer site id
+   * @param[in] validTime  Valid time in seconds
+   * @param[in] nwpMgr  Manager class for NWP data
+   * @return Data value
+   */
+  float nwpValue(const NwpReader::Var var, const int siteId,
+                 const double validTime, NwpMgr &nwpMgr);
+
+  /**
+   * Get several NWP predictor values at one valid time, from the predictor
+   * cache if in use
+   * @param[in] vars  NWP variables
+   * @param[in] numVars  Number of variables
+   * @param[in] siteId  Integer site id
+   * @param[in] validTime  Valid time in seconds
+   * @param[in] nwpMgr  Manager class for NWP data
+   * @param[out] values  numVars data values, in the order of vars
+   */
+  void nwpGather(const NwpReader::Var *vars, const int numVars, const int siteId,
+                 const double validTime, NwpMgr &nwpMgr, float *values);
+
+  /**
+   * Count the missing predictors fed to the model in the run profile
+   * @param[in] predictorVals  Predictors in loadPredictors() order
+   */
+  void countMissingPredictors(const vector <float> &predictorVals);
+
+  /**
+   * Write the run profile next to the last output file and warn about
+   * stages over their latency budget
+   */
+  void writeProfile();
+
   /**
    * Interface to the statistical learning model takes a csv string as input. 
    * Create that string from the predictors.
@@ -96,27 +96,14 @@ const int NwpMgr::getNwpFileIndex(const double fcstTime) const
   }                       
 }
 
-const float NwpMgr::getAzimuth( const int siteId, const double fcstTime) 
-{
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {   
-    return _nwpFiles[i]->getAzimuth(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }    
-}
-
-const float NwpMgr::getCloudFrac( const int siteId, const double fcstTime)    
+const float NwpMgr::get(const NwpReader::Var var, const int siteId,
+                         const double fcstTime)
 {
   int i = getNwpFileIndex(fcstTime);
 
   if(i >= 0)
   {
-    return _nwpFiles[i]->getCloudFrac(siteId, fcstTime);
+    return _nwpFiles[i]->get(var, siteId, fcstTime);
   }
   else
   {
@@ -124,284 +111,130 @@ const float NwpMgr::getCloudFrac( const int siteId, const double fcstTime)
   }
 }
 
-const float NwpMgr::getDHI( const int siteId, const double fcstTime)    
+void NwpMgr::gather(const NwpReader::Var *vars, const int numVars, const int siteId,
+                    const double fcstTime, float *values)
 {
   int i = getNwpFileIndex(fcstTime);
 
   if(i >= 0)
   {
-    return _nwpFiles[i]->getDHI(siteId, fcstTime);
+    _nwpFiles[i]->gather(vars, numVars, siteId, fcstTime, values);
   }
   else
   {
-    return NwpReader::NWP_MISSING;
+    for (int j = 0; j < numVars; j++)
+    {
+      values[j] = NwpReader::NWP_MISSING;
+    }
   }
 }
 
-const float NwpMgr::getDNI( const int siteId, const double fcstTime)    
+const float NwpMgr::getAzimuth( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getDNI(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::AZIMUTH, siteId, fcstTime);
 }
 
-const float NwpMgr::getElevation( const int siteId, const double fcstTime)    
+const float NwpMgr::getCloudFrac( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getElevation(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::CLOUD_FRAC, siteId, fcstTime);
 }
 
-const float NwpMgr::getGHI( const int siteId, const double fcstTime)    
+const float NwpMgr::getDHI( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getGHI(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::DHI, siteId, fcstTime);
 }
 
-const float NwpMgr::getKt( const int siteId, const double fcstTime)    
+const float NwpMgr::getDNI( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getKt(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::DNI, siteId, fcstTime);
 }
 
-const float NwpMgr::getMixingRatio( const int siteId, const double fcstTime)    
+const float NwpMgr::getElevation( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getMixingRatio(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::ELEVATION, siteId, fcstTime);
 }
 
-const float NwpMgr::getPsfc( const int siteId, const double fcstTime)    
+const float NwpMgr::getGHI( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getPsfc(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::GHI, siteId, fcstTime);
 }
 
-const float NwpMgr::getRh( const int siteId, const double fcstTime)    
+const float NwpMgr::getKt( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getRh(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::KT, siteId, fcstTime);
 }
 
-const float NwpMgr::getTauQcTot( const int siteId, const double fcstTime)    
+const float NwpMgr::getMixingRatio( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getTauQcTot(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::MIXING_RATIO, siteId, fcstTime);
 }
 
-const float NwpMgr::getTauQiTot( const int siteId, const double fcstTime)    
+const float NwpMgr::getPsfc( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getTauQiTot(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::PSFC, siteId, fcstTime);
 }
 
-const float NwpMgr::getTauQs( const int siteId, const double fcstTime)    
+const float NwpMgr::getRh( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getTauQs(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return NwpReader::NWP_MISSING;
 }
 
-const float NwpMgr::getTaod5502d(const int siteId, const double fcstTime)    
+const float NwpMgr::getTauQcTot( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getTaod5502d(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::TAU_QC_TOT, siteId, fcstTime);
 }
 
-const float NwpMgr::getToa( const int siteId, const double fcstTime)    
+const float NwpMgr::getTauQiTot( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getToa(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::TAU_QI_TOT, siteId, fcstTime);
 }
 
-const float NwpMgr::getTemp( const int siteId, const double fcstTime)    
+const float NwpMgr::getTauQs( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getTemp(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::TAU_QS, siteId, fcstTime);
 }
 
-const float NwpMgr::getWindDir( const int siteId, const double fcstTime)    
+const float NwpMgr::getTaod5502d( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getWindDir(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::TAOD5502D, siteId, fcstTime);
 }
 
-const float NwpMgr::getWindSpeed( const int siteId, const double fcstTime)    
+const float NwpMgr::getToa( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
+  return get(NwpReader::TOA, siteId, fcstTime);
+}
 
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getWindSpeed(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+const float NwpMgr::getTemp( const int siteId, const double fcstTime)
+{
+  return get(NwpReader::TEMP, siteId, fcstTime);
 }
 
-const float NwpMgr::getWpTot( const int siteId, const double fcstTime)    
+const float NwpMgr::getWindDir( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
+  return get(NwpReader::WIND_DIR, siteId, fcstTime);
+}
 
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getWpTot(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+const float NwpMgr::getWindSpeed( const int siteId, const double fcstTime)
+{
+  return get(NwpReader::WIND_SPEED, siteId, fcstTime);
 }
 
-const float NwpMgr::getWvp( const int siteId, const double fcstTime)    
+const float NwpMgr::getWpTot( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
+  return get(NwpReader::WP_TOT, siteId, fcstTime);
+}
 
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getWvp(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+const float NwpMgr::getWvp( const int siteId, const double fcstTime)
+{
+  return get(NwpReader::WVP, siteId, fcstTime);
 }
 
 const float NwpMgr::getWrfKt2( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getWrfKt2(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::WRF_KT2, siteId, fcstTime);
 }
 
 const float NwpMgr::getWrfToa2( const int siteId, const double fcstTime)
 {
-  int i = getNwpFileIndex(fcstTime);
-
-  if(i >= 0)
-  {
-    return _nwpFiles[i]->getWrfToa2(siteId, fcstTime);
-  }
-  else
-  {
-    return NwpReader::NWP_MISSING;
-  }
+  return get(NwpReader::WRF_TOA2, siteId, fcstTime);
 }
-
-
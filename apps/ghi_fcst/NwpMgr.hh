@@ -55,12 +55,47 @@ public:
    */
   void add(NwpReader *nwpFile);
 
+  /**
+   * Remove all NwpReader objects without deleting them, for readers owned
+   * elsewhere (e.g. by a ReaderCache)
+   */
+  void release() { _nwpFiles.clear(); }
+
+  /**
+   * Number of readers held
+   */
+  int size() const { return (int)_nwpFiles.size(); }
+
   const double getGenTime(int fileIndex) const 
                {return _nwpFiles[fileIndex]->getGenTime(); }
 
+  const string &getFileName(int fileIndex) const
+               {return _nwpFiles[fileIndex]->getInputFile(); }
+
   const double getMostRecentGenTime() const {return _nwpFiles[0]->getGenTime(); }
 
   const float getMissing() const { return NwpReader::NWP_MISSING;} 
+
+  /**
+   * Get a data variable for given site ID at given forecast time
+   * @param[in] var  Data variable
+   * @param[in] siteId  Integer site id for forecast data
+   * @param[in] fcstTime  forecast data time in seconds.
+   * @return Data value at forecast time
+   */
+  const float get(const NwpReader::Var var, const int siteId, const double fcstTime);
+
+  /**
+   * Get several data variables for given site ID at given forecast time
+   * from the most recent forecast having the time
+   * @param[in] vars  Data variables
+   * @param[in] numVars  Number of variables
+   * @param[in] siteId  Integer site id for forecast data
+   * @param[in] fcstTime  forecast data time in seconds.
+   * @param[out] values  numVars data values, in the order of vars
+   */
+  void gather(const NwpReader::Var *vars, const int numVars, const int siteId,
+              const double fcstTime, float *values);
    
   /**
    * Get solar azimuth angle for given site ID at given forecast time
@@ -0,0 +1,472 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: NwpPredictorCache.cc,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/08/09 14:20:00 $
+//
+//==============================================================================
+
+/**
+ *
+ * @file NwpPredictorCache.cc  Source code for NwpPredictorCache class
+ *
+ * Cache file layout (native byte order):
+ *   FileHeader
+ *   key text, keyLen bytes, padded to a multiple of 4
+ *   numSites int site ids
+ *   numSites * numTimes * numVars float values
+ *
+ */
+
+// Include files
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <log/log.hh>
+#include "NwpPredictorCache.hh"
+
+extern Log *Logg;
+extern int DebugLevel;
+
+// Constant and macros
+
+static const char CACHE_MAGIC[4] = {'N', 'W', 'P', 'C'};
+
+//
+// Version 2 keeps every NwpReader variable, in NwpReader::Var order
+//
+static const int CACHE_VERSION = 2;
+
+static const char CACHE_PREFIX[] = "nwp_predictors.";
+
+//
+// The block covers issue times up to an hour after the block start,
+// matching the hourly arrival of NWP files
+//
+static const int BLOCK_SPAN = 3600;
+
+struct FileHeader
+{
+  char magic[4];
+  int32_t version;
+  int32_t keyLen;
+  int32_t numSites;
+  int32_t numTimes;
+  int32_t numVars;
+  int64_t blockStart;
+  int32_t timeStep;
+  int32_t pad;
+};
+
+//
+// 64 bit FNV-1a hash
+//
+static uint64_t fnvHash(const void *data, size_t len, uint64_t hash)
+{
+  const unsigned char *p = (const unsigned char *)data;
+
+  for (size_t i = 0; i < len; i++)
+  {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+
+NwpPredictorCache::NwpPredictorCache(const string &cacheDir, const int interpGap) :
+  _cacheDir(cacheDir), _interpGap(interpGap), _blockStart(0), _timeStep(0), _numTimes(0),
+  _values(NULL), _mapped(NULL), _mappedSize(0)
+{
+  error = string("");
+}
+
+NwpPredictorCache::~NwpPredictorCache()
+{
+  close();
+}
+
+void NwpPredictorCache::close()
+{
+  if (_mapped)
+  {
+    munmap(_mapped, _mappedSize);
+
+    _mapped = NULL;
+
+    _mappedSize = 0;
+  }
+
+  _block.clear();
+
+  _values = NULL;
+
+  _siteIds.clear();
+
+  _siteIndex.clear();
+}
+
+int NwpPredictorCache::open(NwpMgr &nwpMgr, const vector<int> &siteIds,
+                            const double genTime,
+                            const vector<int> &leadMinutes,
+                            const int leadsDelta)
+{
+  close();
+
+  if (nwpMgr.size() == 0 || siteIds.size() == 0 || leadMinutes.size() == 0 ||
+      leadsDelta <= 0)
+  {
+    error = "No NWP files, sites or lead times for the predictor cache";
+
+    return 1;
+  }
+
+  int maxLead = 0;
+
+  for (int i = 0; i < (int)leadMinutes.size(); i++)
+  {
+    if (leadMinutes[i] > maxLead)
+    {
+      maxLead = leadMinutes[i];
+    }
+  }
+
+  _timeStep = leadsDelta * 60;
+
+  _blockStart = ((time_t)genTime / BLOCK_SPAN) * BLOCK_SPAN;
+
+  _numTimes = (BLOCK_SPAN + maxLead * 60) / _timeStep + 1;
+
+  _siteIds = siteIds;
+
+  for (int s = 0; s < (int)_siteIds.size(); s++)
+  {
+    _siteIndex[_siteIds[s]] = s;
+  }
+
+  string key;
+
+  makeKey(nwpMgr, leadMinutes, key);
+
+  if (mapFile(key))
+  {
+    if (DebugLevel > 0)
+    {
+      Logg->write_time("Info: Using NWP predictor cache %s\n", _path.c_str());
+    }
+
+    return 0;
+  }
+
+  fill(nwpMgr);
+
+  if (writeFile(key))
+  {
+    Logg->write_time("Warning: %s\n", error.c_str());
+
+    error = string("");
+  }
+  else if (DebugLevel > 0)
+  {
+    Logg->write_time("Info: Wrote NWP predictor cache %s\n", _path.c_str());
+  }
+
+  return 0;
+}
+
+void NwpPredictorCache::makeKey(NwpMgr &nwpMgr, const vector<int> &leadMinutes,
+                                string &key)
+{
+  char buf[256];
+
+  key = string("");
+
+  for (int i = 0; i < nwpMgr.size(); i++)
+  {
+    const string &file = nwpMgr.getFileName(i);
+
+    struct stat st;
+
+    long mtime = (stat(file.c_str(), &st) == 0) ? (long)st.st_mtime : -1;
+
+    snprintf(buf, sizeof(buf), " %ld %.0lf\n", mtime, nwpMgr.getGenTime(i));
+
+    key += file + buf;
+  }
+
+  uint64_t siteHash = fnvHash(&_siteIds[0], _siteIds.size() * sizeof(int),
+                              FNV_OFFSET);
+
+  snprintf(buf, sizeof(buf), "sites %d %016llx\n", (int)_siteIds.size(),
+           (unsigned long long)siteHash);
+
+  key += buf;
+
+  key += "leads";
+
+  for (int i = 0; i < (int)leadMinutes.size(); i++)
+  {
+    snprintf(buf, sizeof(buf), " %d", leadMinutes[i]);
+
+    key += buf;
+  }
+
+  snprintf(buf, sizeof(buf), "\nblock %ld %d %d\ninterp %d\n", (long)_blockStart,
+           _timeStep, _numTimes, _interpGap);
+
+  key += buf;
+
+  uint64_t keyHash = fnvHash(key.data(), key.size(), FNV_OFFSET);
+
+  snprintf(buf, sizeof(buf), "%s%016llx.bin", CACHE_PREFIX,
+           (unsigned long long)keyHash);
+
+  _path = _cacheDir + "/" + buf;
+}
+
+bool NwpPredictorCache::mapFile(const string &key)
+{
+  int fd = ::open(_path.c_str(), O_RDONLY);
+
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat st;
+
+  size_t keyBytes = (key.size() + 3) & ~(size_t)3;
+
+  size_t numValues = _siteIds.size() * _numTimes * NwpReader::NUM_VARS;
+
+  size_t expected = sizeof(FileHeader) + keyBytes +
+                    _siteIds.size() * sizeof(int32_t) +
+                    numValues * sizeof(float);
+
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size != expected)
+  {
+    ::close(fd);
+
+    return false;
+  }
+
+  void *addr = mmap(NULL, expected, PROT_READ, MAP_SHARED, fd, 0);
+
+  ::close(fd);
+
+  if (addr == MAP_FAILED)
+  {
+    return false;
+  }
+
+  const char *p = (const char *)addr;
+
+  const FileHeader *header = (const FileHeader *)p;
+
+  //
+  // The file name is a hash of the key, so check the key itself and the
+  // dimensions before trusting the values
+  //
+  bool match = memcmp(header->magic, CACHE_MAGIC, 4) == 0 &&
+               header->version == CACHE_VERSION &&
+               header->keyLen == (int32_t)key.size() &&
+               header->numSites == (int32_t)_siteIds.size() &&
+               header->numTimes == _numTimes &&
+               header->numVars == NwpReader::NUM_VARS &&
+               header->blockStart == (int64_t)_blockStart &&
+               header->timeStep == _timeStep &&
+               memcmp(p + sizeof(FileHeader), key.data(), key.size()) == 0;
+
+  const int32_t *ids = (const int32_t *)(p + sizeof(FileHeader) + keyBytes);
+
+  for (int s = 0; match && s < (int)_siteIds.size(); s++)
+  {
+    match = (ids[s] == _siteIds[s]);
+  }
+
+  if (!match)
+  {
+    munmap(addr, expected);
+
+    return false;
+  }
+
+  _mapped = addr;
+
+  _mappedSize = expected;
+
+  _values = (const float *)(ids + _siteIds.size());
+
+  return true;
+}
+
+void NwpPredictorCache::fill(NwpMgr &nwpMgr)
+{
+  NwpReader::Var allVars[NwpReader::NUM_VARS];
+
+  for (int v = 0; v < NwpReader::NUM_VARS; v++)
+  {
+    allVars[v] = (NwpReader::Var)v;
+  }
+
+  _block.resize(_siteIds.size() * _numTimes * NwpReader::NUM_VARS);
+
+  float *value = &_block[0];
+
+  for (int s = 0; s < (int)_siteIds.size(); s++)
+  {
+    for (int t = 0; t < _numTimes; t++)
+    {
+      double validTime = (double)(_blockStart + t * _timeStep);
+
+      nwpMgr.gather(allVars, NwpReader::NUM_VARS, _siteIds[s], validTime, value);
+
+      value += NwpReader::NUM_VARS;
+    }
+  }
+
+  _values = &_block[0];
+}
+
+int NwpPredictorCache::writeFile(const string &key)
+{
+  string tmpPath = _path + ".tmp";
+
+  FILE *fp = fopen(tmpPath.c_str(), "wb");
+
+  if (fp == NULL)
+  {
+    error = "Could not open NWP predictor cache file " + tmpPath;
+
+    return 1;
+  }
+
+  FileHeader header;
+
+  memset(&header, 0, sizeof(header));
+
+  memcpy(header.magic, CACHE_MAGIC, 4);
+
+  header.version = CACHE_VERSION;
+
+  header.keyLen = (int32_t)key.size();
+
+  header.numSites = (int32_t)_siteIds.size();
+
+  header.numTimes = _numTimes;
+
+  header.numVars = NwpReader::NUM_VARS;
+
+  header.blockStart = _blockStart;
+
+  header.timeStep = _timeStep;
+
+  size_t keyBytes = (key.size() + 3) & ~(size_t)3;
+
+  vector<char> keyBuf(keyBytes, '\0');
+
+  memcpy(&keyBuf[0], key.data(), key.size());
+
+  vector<int32_t> ids(_siteIds.begin(), _siteIds.end());
+
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+            fwrite(&keyBuf[0], 1, keyBytes, fp) == keyBytes &&
+            fwrite(&ids[0], sizeof(int32_t), ids.size(), fp) == ids.size() &&
+            fwrite(&_block[0], sizeof(float), _block.size(), fp) ==
+              _block.size();
+
+  if (fclose(fp) != 0 || !ok || rename(tmpPath.c_str(), _path.c_str()) != 0)
+  {
+    remove(tmpPath.c_str());
+
+    error = "Could not write NWP predictor cache file " + _path;
+
+    return 1;
+  }
+
+  return 0;
+}
+
+float NwpPredictorCache::get(const NwpReader::Var var, const int siteId,
+                             const double validTime, NwpMgr &nwpMgr) const
+{
+  float value;
+
+  gather(&var, 1, siteId, validTime, nwpMgr, &value);
+
+  return value;
+}
+
+void NwpPredictorCache::gather(const NwpReader::Var *vars, const int numVars,
+                               const int siteId, const double validTime,
+                               NwpMgr &nwpMgr, float *values) const
+{
+  if (_values != NULL)
+  {
+    map<int, int>::const_iterator it = _siteIndex.find(siteId);
+
+    long offset = (long)validTime - (long)_blockStart;
+
+    if (it != _siteIndex.end() && offset >= 0 && offset % _timeStep == 0 &&
+        offset / _timeStep < _numTimes && validTime == (double)(long)validTime)
+    {
+      size_t t = offset / _timeStep;
+
+      const float *row = _values + ((size_t)it->second * _numTimes + t) *
+                                   NwpReader::NUM_VARS;
+
+      for (int i = 0; i < numVars; i++)
+      {
+        values[i] = row[vars[i]];
+      }
+
+      return;
+    }
+  }
+
+  nwpMgr.gather(vars, numVars, siteId, validTime, values);
+}
+
+void NwpPredictorCache::purge(const int maxAge) const
+{
+  DIR *dir = opendir(_cacheDir.c_str());
+
+  if (dir == NULL)
+  {
+    return;
+  }
+
+  time_t now = time(0);
+
+  struct dirent *entry;
+
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (strncmp(entry->d_name, CACHE_PREFIX, strlen(CACHE_PREFIX)) != 0)
+    {
+      continue;
+    }
+
+    string path = _cacheDir + "/" + entry->d_name;
+
+    struct stat st;
+
+    if (path != _path && stat(path.c_str(), &st) == 0 &&
+        now - st.st_mtime > maxAge)
+    {
+      remove(path.c_str());
+    }
+  }
+
+  closedir(dir);
+}
@@ -0,0 +1,177 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: NwpPredictorCache.hh,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/08/09 14:20:00 $
+//
+//==============================================================================
+
+/**
+ *
+ * @file NwpPredictorCache.hh  On-disk cache of the NWP values used as
+ *                             predictors, shared by the 15 minute runs
+ *                             made from the same hourly NWP files.
+ *
+ * @class NwpPredictorCache  Block of NWP predictor values for every site,
+ *                           every valid time on the lead time grid from
+ *                           the start of the issue hour to an hour past
+ *                           the longest lead, and every NwpReader
+ *                           variable. The block is keyed by the NWP
+ *                           file paths and modification times, the NWP
+ *                           generation time, the site list, the lead set
+ *                           and the block start time. A matching block is
+ *                           mapped from disk; otherwise it is filled from
+ *                           the NwpMgr and written for later runs. Values
+ *                           at times off the block grid are read from the
+ *                           NwpMgr directly.
+ * @date 08/09/21
+ */
+
+#ifndef NWP_PREDICTOR_CACHE_HH
+#define NWP_PREDICTOR_CACHE_HH
+
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "NwpMgr.hh"
+
+using std::map;
+using std::string;
+using std::vector;
+
+class NwpPredictorCache
+{
+public:
+
+  /**
+   * Constructor
+   * @param[in] cacheDir  Directory of cache files
+   * @param[in] interpGap  Largest gap between NWP valid times that the
+   *                       readers interpolate, part of the cache key
+   */
+  NwpPredictorCache(const string &cacheDir, const int interpGap);
+
+  /**
+   * Destructor unmaps the cache file
+   */
+  ~NwpPredictorCache();
+
+  /**
+   * Map the block for the inputs from disk, or fill it from the NwpMgr and
+   * write it. Failure to write the cache file is logged but not an error,
+   * since the values are still held in memory.
+   * @param[in] nwpMgr  Manager of the NWP files of this run
+   * @param[in] siteIds  Site ids, in the order used by the forecast
+   * @param[in] genTime  Forecast generation (issue) time
+   * @param[in] leadMinutes  Forecast lead times in minutes
+   * @param[in] leadsDelta  Minutes between lead times
+   * @return 1 for failure, 0 for success
+   */
+  int open(NwpMgr &nwpMgr, const vector<int> &siteIds, const double genTime,
+           const vector<int> &leadMinutes, const int leadsDelta);
+
+  /**
+   * Get an NWP value for a site at a valid time, from the block if the time
+   * is on the block grid, else from the NwpMgr
+   * @param[in] var  NWP variable
+   * @param[in] siteId  Integer site id
+   * @param[in] validTime  Valid time in seconds
+   * @param[in] nwpMgr  Manager of the NWP files of this run
+   * @return Data value, or NwpReader::NWP_MISSING
+   */
+  float get(const NwpReader::Var var, const int siteId, const double validTime,
+            NwpMgr &nwpMgr) const;
+
+  /**
+   * Get several NWP values for a site at a valid time, locating the block
+   * row once
+   * @param[in] vars  NWP variables
+   * @param[in] numVars  Number of variables
+   * @param[in] siteId  Integer site id
+   * @param[in] validTime  Valid time in seconds
+   * @param[in] nwpMgr  Manager of the NWP files of this run
+   * @param[out] values  numVars data values, in the order of vars
+   */
+  void gather(const NwpReader::Var *vars, const int numVars, const int siteId,
+              const double validTime, NwpMgr &nwpMgr, float *values) const;
+
+  /**
+   * @return true if the block was read from an existing cache file
+   */
+  bool wasMapped() const { return _mapped != NULL; }
+
+  /**
+   * Remove cache files not modified for maxAge seconds
+   * @param[in] maxAge  Age in seconds
+   */
+  void purge(const int maxAge) const;
+
+  string error;
+
+private:
+
+  /**
+   * Build the cache key string and its file path
+   */
+  void makeKey(NwpMgr &nwpMgr, const vector<int> &leadMinutes, string &key);
+
+  /**
+   * Map the cache file if it exists and matches the key
+   * @return true if the file was mapped
+   */
+  bool mapFile(const string &key);
+
+  /**
+   * Fill the block from the NwpMgr
+   */
+  void fill(NwpMgr &nwpMgr);
+
+  /**
+   * Write the block under a temporary name and rename it
+   * @return 0 for success, 1 for failure
+   */
+  int writeFile(const string &key);
+
+  /**
+   * Unmap the file and clear the block
+   */
+  void close();
+
+  string _cacheDir;
+
+  int _interpGap;
+
+  string _path;
+
+  /**
+   * First valid time of the block and seconds between valid times
+   */
+  time_t _blockStart;
+
+  int _timeStep;
+
+  int _numTimes;
+
+  /**
+   * Site ids and their row in the block
+   */
+  vector<int> _siteIds;
+
+  map<int, int> _siteIndex;
+
+  /**
+   * Values for [site][time][var], pointing into the mapped file or _block
+   */
+  const float *_values;
+
+  vector<float> _block;
+
+  void *_mapped;
+
+  size_t _mappedSize;
+};
+
+#endif /* NWP_PREDICTOR_CACHE_HH */
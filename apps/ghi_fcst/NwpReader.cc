@@ -22,10 +22,12 @@
 // Include files 
 
 #include <iostream>
+#include <stdio.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/operations.hpp>
 #include "ncfc/ncfc.hh"
 #include "NwpReader.hh"
+#include "SolarSites.hh"
 
 namespace fs = boost::filesystem;
 using std::find;
@@ -33,9 +35,13 @@ using std::cerr;
 using std::endl;
 const float NwpReader::NWP_MISSING = NC_FILL_FLOAT;
 const int NwpReader::FCST_TIME_RESOLUTION = 900;
+constexpr SiteVarDef NwpReader::VARS[];
 
 NwpReader::NwpReader(string &nwpFile): 
-  inputFile(nwpFile)
+  columns(VARS),
+  interpMaxGap(0),
+  inputFile(nwpFile),
+  solarSites(NULL)
 {
 }
 
@@ -54,6 +60,14 @@ int NwpReader::parse()
       error = string("Error: cdf file") + inputFile +  "does not exist";
       return 1;
     }
+
+  //
+  // Files converted by nc2site_store are mapped rather than read
+  //
+  if (SiteStore::is_store(inputFile))
+    {
+      return parseStore();
+    }
     
   vector<string> dimNames;
   dimNames.push_back("max_site_num");
@@ -66,27 +80,17 @@ int NwpReader::parse()
   varNames.push_back("num_sites");
   varNames.push_back("StationName");
   varNames.push_back("StationID");
-  varNames.push_back("Q2");
-  varNames.push_back("SWDDNI");
-  varNames.push_back("SWDDIF");
-  varNames.push_back("SWDOWN");
-  varNames.push_back("TAOD5502D");
-  varNames.push_back("CLDFRAC2D");
-  varNames.push_back("WVP");
-  varNames.push_back("WP_TOT_SUM");
-  varNames.push_back("TAU_QC_TOT");
-  varNames.push_back("TAU_QI_TOT");
-  varNames.push_back("TAU_QS");
-  varNames.push_back("T2");
-  varNames.push_back("PSFC");
-  varNames.push_back("CLRNIDX");
-  varNames.push_back("TOA");
-  varNames.push_back("WSPD10");
-  varNames.push_back("WDIR10");
-  varNames.push_back("custom_TOA");
-  varNames.push_back("apparent_elevation");
-  varNames.push_back("azimuth");
-  varNames.push_back("custom_KT");
+
+  //
+  // Solar geometry is read unless it is computed from site locations
+  //
+  for (int v = 0; v < NUM_VARS; v++)
+  {
+    if (isRead((Var)v))
+    {
+      varNames.push_back(VARS[v].name);
+    }
+  }
 
   Var_input varInput(inputFile.c_str(), varNames, dimNames);
   int ret = varInput.error_status();
@@ -179,6 +183,11 @@ int NwpReader::parse()
   if ( (int) validTime.size() > 0)
   {
     lastFcstTime = validTime[ (int) validTime.size() - 1];
+
+    timeResolution = (validTime.size() > 1) ? (int)(validTime[1] - validTime[0]) :
+                                              FCST_TIME_RESOLUTION;
+
+    timeInterp.set_times(validTime, NWP_MISSING, interpMaxGap);
   }
   else
   {
@@ -188,259 +197,137 @@ int NwpReader::parse()
   }
  
   //
-  // Copy mixing ratio to vector
+  // Copy the data variables to the data arrays
   //
-  ind = varIndexMap["Q2"];
-  int numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  for (int v = 0; v < NUM_VARS; v++)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    mixingRatio.push_back(val);
-  }
+    if (isRead((Var)v))
+    {
+      ind = varIndexMap[VARS[v].name];
 
-  //
-  // Copy DNI to vector
-  //
-  ind = varIndexMap["SWDDNI"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    dni.push_back(val);
+      columns.copy((Var)v, inVarPtrs[ind], inVarSizes[ind]);
+    }
   }
 
   //
-  // Copy diffuse irradiance to vector
+  // Map siteIds to integer indices
   //
-  ind = varIndexMap["SWDDIF"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  for (int i = 0; i < numSites; i++)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    dhi.push_back(val);
+    siteIdIndexMap[siteList[i]] = i;
   }
 
   //
-  // Copy GHI to vector
+  // Map siteIds to integer indices
   //
-  ind = varIndexMap["SWDOWN"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  for (int i = 0; i < numSites; i++)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    ghi.push_back(val);
+    siteNamesMap[siteList[i]] = siteNames[i];
   }
 
-  //
-  // Copy total aerosol optical depth to vector
-  //
-  ind = varIndexMap["TAOD5502D"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    taod5502d.push_back(val);
-  }
-  
-  //
-  // Copy cloud fraction to vector
-  //
-  ind = varIndexMap["CLDFRAC2D"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    cloudFrac.push_back(val);
-  }
+  return 0;
+}
 
-  //
-  // Copy water vapor path to vector
-  //
-  ind = varIndexMap["WVP"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    wvp.push_back(val);
-  }
+int NwpReader::parseStore()
+{
+  if (store.open(inputFile) != 0)
+    {
+      error = string("Error: ") + store.error();
+      return 1;
+    }
 
-  //
-  // Copy total water path ( liquid+ice+snow) to vector 
-  //
-  ind = varIndexMap["WP_TOT_SUM"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    wpTot.push_back(val);
-  }
-  
-  //
-  // Copy mass weighted liquid cloud optical thickness to vector 
-  //
-  ind = varIndexMap["TAU_QC_TOT"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    tauQcTot.push_back(val);
-  }
- 
-  //
-  // Copy mass weighted ice optical thickness to vector 
-  //
-  ind = varIndexMap["TAU_QI_TOT"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    tauQiTot.push_back(val);
-  }
+  numSites = store.num_sites();
 
-  //
-  // Copy mass weighted snow optical thickness to vector 
-  //
-  ind = varIndexMap["TAU_QS"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    tauQs.push_back(val);
-  }
+  creationTime = store.gen_time();
 
-  //
-  // Copy temperature data to vector 
-  //
-  ind = varIndexMap["T2"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-   temp.push_back(val);
-  }
+  for (int i = 0; i < numSites; i++)
+    {
+      char name[16];
 
-  //
-  // Copy pressure data to vector 
-  //
-  ind = varIndexMap["PSFC"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    pSfc.push_back(val);
-  }
+      snprintf(name, sizeof(name), "%d", store.site_id(i));
 
-  //
-  // Clearness index computed with WRF TOA
-  //
-  ind = varIndexMap["CLRNIDX"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    wrfKt2.push_back(val);
-  }
+      siteList.push_back(store.site_id(i));
 
-  
-  //
-  // WRF Top of atmosphere irradiance data to vector 
-  //
-  ind = varIndexMap["TOA"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    wrfToa2.push_back(val);
-  }
+      siteNames.push_back(string(name));
+    }
 
-  //
-  // Copy wind speed data to vector 
-  //
-  ind = varIndexMap["WSPD10"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    windSpeed.push_back(val);
-  }
+  for (int i = 0; i < store.num_times(); i++)
+    {
+      validTime.push_back(store.time(i));
+    }
 
-  //
-  // Copy wind direction data to vector 
-  //
-  ind = varIndexMap["WDIR10"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  if ( (int) validTime.size() > 0)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    windDir.push_back(val);
-  }
+    lastFcstTime = validTime[ (int) validTime.size() - 1];
 
-  //
-  // Copy custom TOA data to vector
-  //https://pvpmc.sandia.gov/modeling-steps/1-weather-design-inputs/irradiance-and-insolation-2/extraterrestrial-radiation/
-  // 
-  ind = varIndexMap["custom_TOA"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    toa.push_back(val);
+    timeResolution = (validTime.size() > 1) ? (int)(validTime[1] - validTime[0]) :
+                                              FCST_TIME_RESOLUTION;
+
+    timeInterp.set_times(validTime, NWP_MISSING, interpMaxGap);
   }
- 
-  //
-  // Copy solar elevation angle data to vector
-  //
-  ind = varIndexMap["apparent_elevation"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  else
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    elevation.push_back(val);
+     error = string("Error: Empty valid_time array for ") + inputFile;
+
+     return 1;
   }
 
   //
-  // Copy solar azimuth angle data to vector
+  // The store keeps the netCDF variable names
   //
-  ind = varIndexMap["azimuth"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  for (int v = 0; v < NUM_VARS; v++)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    azimuth.push_back(val);
-  }
+    if (isRead((Var)v) && columns.view((Var)v, store) != 0)
+    {
+      error = string("Error: ") + VARS[v].name + " is not in site store " + inputFile;
 
-  //
-  // Copy WrfGHI/customTOA to vector
-  //
-  ind = varIndexMap["custom_KT"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  { 
-    float val = ((float *)inVarPtrs[ind])[i];
-    kt.push_back(val);
+      return 1;
+    }
   }
 
-  //
-  // Map siteIds to integer indices
-  //
   for (int i = 0; i < numSites; i++)
   {
     siteIdIndexMap[siteList[i]] = i;
-  }
 
-  //
-  // Map siteIds to integer indices
-  //
-  for (int i = 0; i < numSites; i++)
-  {
     siteNamesMap[siteList[i]] = siteNames[i];
   }
 
   return 0;
 }
 
+void NwpReader::deriveSolar()
+{
+  vector<float> el;
+
+  vector<float> az;
+
+  vector<float> ta;
+
+  solarSites->compute(siteList, validTime, NWP_MISSING, el, az, ta);
+
+  columns[ELEVATION].take(el);
+
+  columns[AZIMUTH].take(az);
+
+  columns[TOA].take(ta);
+}
+
 const bool NwpReader::haveData(double fcstTime) const
 {
+  //
+  // When interpolating, any forecast time between valid times close
+  // enough together
+  //
+  if (interpMaxGap > 0)
+  {
+    int i0, i1;
+
+    float w;
+
+    return (int)fcstTime % FCST_TIME_RESOLUTION == 0 &&
+           timeInterp.bracket(fcstTime, i0, i1, w);
+  }
+
   //
   // Check to see if fcstTime is in [firstFcstTime,lastFcstTime] 
   //
@@ -490,13 +377,19 @@ const int NwpReader::getArrayOffset( const int siteId, double fcstTime)
   }
 }
 
-const float NwpReader::getAzimuth( const int siteId, const double fcstTime)
+const float NwpReader::columnValue(const SiteColumn &column, const int siteId,
+                                   const double fcstTime)
 {
+  if (interpMaxGap > 0)
+  {
+    return timeInterp.value(column, getSiteIndex(siteId), fcstTime);
+  }
+
   int arrayOffset =  getArrayOffset(siteId, fcstTime);
 
   if ( arrayOffset >= 0)
   {
-    return azimuth[arrayOffset];
+    return column[arrayOffset];
   }
   else
   {
@@ -504,296 +397,223 @@ const float NwpReader::getAzimuth( const int siteId, const double fcstTime)
   }
 }
 
-const float NwpReader::getCloudFrac( const int siteId, const double fcstTime)
+const float NwpReader::irradianceValue(const SiteColumn &column, const int siteId,
+                                       const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
+  if (interpMaxGap == 0)
   {
-    return cloudFrac[arrayOffset];
+    return columnValue(column, siteId, fcstTime);
   }
-  else
+
+  //
+  // The clear sky index, irradiance over TOA, is interpolated rather than
+  // the irradiance, which follows the sun between the valid times
+  //
+  if (solarSites != NULL && columns[TOA].size() == 0)
   {
-    return NWP_MISSING;
+    deriveSolar();
   }
-}
 
-const float NwpReader::getDHI( const int siteId, const double fcstTime)
-{
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
+  float toaNow;
 
-  if ( arrayOffset >= 0)
+  if (solarSites != NULL)
   {
-    return dhi[arrayOffset];
+    float el, az;
+
+    solarAt(siteId, fcstTime, el, az, toaNow);
   }
   else
   {
-    return NWP_MISSING;
+    toaNow = timeInterp.value(columns[TOA], getSiteIndex(siteId), fcstTime);
   }
+
+  return timeInterp.value_csi(column, columns[TOA], getSiteIndex(siteId), fcstTime,
+                              toaNow);
 }
 
-const float NwpReader::getDNI( const int siteId, const double fcstTime)
+void NwpReader::solarAt(const int siteId, const double fcstTime, float &el, float &az,
+                        float &ta) const
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
+  vector<float> elv, azv, tav;
 
-  if ( arrayOffset >= 0)
+  solarSites->compute(vector<int>(1, siteId), vector<double>(1, fcstTime), NWP_MISSING,
+                      elv, azv, tav);
+
+  el = elv[0];
+
+  az = azv[0];
+
+  ta = tav[0];
+}
+
+const float NwpReader::get(const Var var, const int siteId, const double fcstTime)
+{
+  if (solarSites != NULL && columns.has(var, SITE_VAR_SOLAR))
   {
-    return dni[arrayOffset];
+    //
+    // Exact solar geometry between the valid times
+    //
+    if (interpMaxGap > 0)
+    {
+      float el, az, ta;
+
+      solarAt(siteId, fcstTime, el, az, ta);
+
+      return var == ELEVATION ? el : (var == AZIMUTH ? az : ta);
+    }
+
+    if (columns[var].size() == 0)
+    {
+      deriveSolar();
+    }
   }
-  else
+
+  if (columns.has(var, SITE_VAR_IRRADIANCE))
   {
-    return NWP_MISSING;
+    return irradianceValue(columns[var], siteId, fcstTime);
   }
+
+  return columnValue(columns[var], siteId, fcstTime);
 }
 
-const float NwpReader::getElevation( const int siteId, const double fcstTime)
+void NwpReader::gather(const Var *vars, const int numVars, const int siteId,
+                       const double fcstTime, float *values)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
+  //
+  // Interpolated values are found per variable
+  //
+  if (interpMaxGap > 0)
   {
-    return elevation[arrayOffset];
+    for (int i = 0; i < numVars; i++)
+    {
+      values[i] = get(vars[i], siteId, fcstTime);
+    }
+
+    return;
   }
-  else
+
+  if (solarSites != NULL && columns[TOA].size() == 0)
   {
-    return NWP_MISSING;
+    for (int i = 0; i < numVars; i++)
+    {
+      if (columns.has(vars[i], SITE_VAR_SOLAR))
+      {
+        deriveSolar();
+
+        break;
+      }
+    }
   }
+
+  columns.gather(vars, numVars, getArrayOffset(siteId, fcstTime), NWP_MISSING, values);
 }
 
-const float NwpReader::getGHI( const int siteId, const double fcstTime)
+const float NwpReader::getAzimuth( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
+  return get(AZIMUTH, siteId, fcstTime);
+}
 
-  if ( arrayOffset >= 0)
-  {
-    return ghi[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+const float NwpReader::getCloudFrac( const int siteId, const double fcstTime)
+{
+  return get(CLOUD_FRAC, siteId, fcstTime);
 }
 
-const float NwpReader::getKt( const int siteId, const double fcstTime)
+const float NwpReader::getDHI( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
+  return get(DHI, siteId, fcstTime);
+}
 
-  if ( arrayOffset >= 0)
-  {
-    return kt[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+const float NwpReader::getDNI( const int siteId, const double fcstTime)
+{
+  return get(DNI, siteId, fcstTime);
 }
 
-const float NwpReader::getMixingRatio(const int siteId, const double fcstTime)
+const float NwpReader::getElevation( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
+  return get(ELEVATION, siteId, fcstTime);
+}
 
-  if ( arrayOffset >= 0)
-  {
-    return mixingRatio[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+const float NwpReader::getGHI( const int siteId, const double fcstTime)
+{
+  return get(GHI, siteId, fcstTime);
 }
 
-const float NwpReader::getPsfc( const int siteId, const double fcstTime)
+const float NwpReader::getKt( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
+  return get(KT, siteId, fcstTime);
+}
 
-  if ( arrayOffset >= 0)
-  {
-    return pSfc[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+const float NwpReader::getMixingRatio( const int siteId, const double fcstTime)
+{
+  return get(MIXING_RATIO, siteId, fcstTime);
 }
 
-const float NwpReader::getRh( const int siteId, const double fcstTime)
+const float NwpReader::getPsfc( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
+  return get(PSFC, siteId, fcstTime);
+}
 
-  if ( arrayOffset >= 0)
-  {
-    return rh[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+const float NwpReader::getRh( const int siteId, const double fcstTime)
+{
+  return NWP_MISSING;
 }
 
 const float NwpReader::getTaod5502d( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return taod5502d[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(TAOD5502D, siteId, fcstTime);
 }
 
 const float NwpReader::getTauQcTot( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return tauQcTot[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(TAU_QC_TOT, siteId, fcstTime);
 }
 
 const float NwpReader::getTauQiTot( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return tauQiTot[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(TAU_QI_TOT, siteId, fcstTime);
 }
 
 const float NwpReader::getTauQs( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return tauQs[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(TAU_QS, siteId, fcstTime);
 }
 
 const float NwpReader::getTemp( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return temp[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(TEMP, siteId, fcstTime);
 }
 
 const float NwpReader::getToa( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return toa[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(TOA, siteId, fcstTime);
 }
 
 const float NwpReader::getWindDir( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return windDir[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(WIND_DIR, siteId, fcstTime);
 }
 
 const float NwpReader::getWindSpeed( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return windSpeed[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(WIND_SPEED, siteId, fcstTime);
 }
 
 const float NwpReader::getWpTot( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return wpTot[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(WP_TOT, siteId, fcstTime);
 }
 
 const float NwpReader::getWvp( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return wvp[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(WVP, siteId, fcstTime);
 }
 
 const float NwpReader::getWrfKt2( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return wrfKt2[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(WRF_KT2, siteId, fcstTime);
 }
 
 const float NwpReader::getWrfToa2( const int siteId, const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return wrfToa2[arrayOffset];
-  }
-  else
-  {
-    return NWP_MISSING;
-  }
+  return get(WRF_TOA2, siteId, fcstTime);
 }
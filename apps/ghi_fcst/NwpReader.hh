@@ -25,11 +25,14 @@
 #include<string>
 #include<map>
 #include<algorithm>
+#include <site_store/site_store.hh>
 
 using std::vector;
 using std::map;
 using std::string;
 
+class SolarSites;
+
 /**
  * @class NwpReader
  */
@@ -47,6 +50,64 @@ public:
    */
   const static int FCST_TIME_RESOLUTION;
 
+  /**
+   * Data variables of the file, in the order of VARS
+   */
+  enum Var
+  {
+    AZIMUTH,
+    CLOUD_FRAC,
+    DHI,
+    DNI,
+    ELEVATION,
+    GHI,
+    KT,
+    MIXING_RATIO,
+    PSFC,
+    TAOD5502D,
+    TAU_QC_TOT,
+    TAU_QI_TOT,
+    TAU_QS,
+    TEMP,
+    TOA,
+    WIND_DIR,
+    WIND_SPEED,
+    WP_TOT,
+    WRF_KT2,
+    WRF_TOA2,
+    WVP,
+    NUM_VARS
+  };
+
+  /**
+   * netCDF name, type, layout and handling of each data variable. The
+   * solar geometry is computed instead of read when the reader has site
+   * locations; irradiance is interpolated as clear sky index.
+   */
+  static constexpr SiteVarDef VARS[NUM_VARS] = {
+    { "azimuth", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, SITE_VAR_SOLAR },
+    { "CLDFRAC2D", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "SWDDIF", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, SITE_VAR_IRRADIANCE },
+    { "SWDDNI", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, SITE_VAR_IRRADIANCE },
+    { "apparent_elevation", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, SITE_VAR_SOLAR },
+    { "SWDOWN", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, SITE_VAR_IRRADIANCE },
+    { "custom_KT", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "Q2", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "PSFC", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "TAOD5502D", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "TAU_QC_TOT", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "TAU_QI_TOT", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "TAU_QS", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "T2", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "custom_TOA", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, SITE_VAR_SOLAR },
+    { "WDIR10", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "WSPD10", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "WP_TOT_SUM", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "CLRNIDX", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "TOA", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "WVP", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+  };
+
   /** 
    * Constructor
    * @param[in] nwpFile  Path of netCDF input file
@@ -59,10 +120,35 @@ public:
   ~NwpReader() {};
  
   /**
-   * Read netCDF file
+   * Read netCDF file, or map the site store file written for it by
+   * nc2site_store
    * @return 0 if netCDF file is successfully read
    */
   int parse(void);
+
+  /**
+   * Compute TOA, solar elevation and azimuth from site locations instead
+   * of reading custom_TOA, apparent_elevation and azimuth from the input
+   * file, which then need not have them. Call before parse().
+   * @param[in] solar  Site locations, owned by the caller
+   */
+  void setSolarSites(const SolarSites *solar)
+  {
+    solarSites = solar;
+  }
+
+  /**
+   * Serve forecast times between the valid times of the file, e.g. 15
+   * minute times from hourly HRRR, by interpolating in time. Irradiance is
+   * interpolated as clear sky index (over TOA); with site locations, solar
+   * geometry is computed at the forecast time. Call before parse().
+   * @param[in] maxGap  Largest time in seconds between valid times that is
+   *                    interpolated, 0 for no interpolation
+   */
+  void setInterpolation(const int maxGap)
+  {
+    interpMaxGap = maxGap;
+  }
   
   /**
    * Method to get error string if file read fails
@@ -72,6 +158,14 @@ public:
     return error; 
   }
 
+  /**
+   * Get the path of the netCDF input file
+   */
+  const string &getInputFile() const
+  {
+    return inputFile;
+  }
+
   /**
    * Get the generation time of the forecast data.
    * There is an assumption that the data in the forecast file
@@ -89,6 +183,27 @@ public:
    */
   const bool haveData(double fcstTime) const; 
 
+  /**
+   * Get a data variable for given site ID at given forecast time
+   * @param[in] var  Data variable
+   * @param[in] siteId  Integer site id for forecast data
+   * @param[in] fcstTime  forecast data time in seconds.
+   * @return forecasted data value
+   */
+  const float get(const Var var, const int siteId, const double fcstTime);
+
+  /**
+   * Get several data variables for given site ID at given forecast time,
+   * locating the site and time once
+   * @param[in] vars  Data variables
+   * @param[in] numVars  Number of variables
+   * @param[in] siteId  Integer site id for forecast data
+   * @param[in] fcstTime  forecast data time in seconds.
+   * @param[out] values  numVars forecasted data values, in the order of vars
+   */
+  void gather(const Var *vars, const int numVars, const int siteId,
+              const double fcstTime, float *values);
+
   /**
    * Get solar azimuth angle for given site ID at given forecast time
    * @param[in] siteId  Integer site id for forecast data
@@ -162,10 +277,11 @@ public:
   const float getPsfc(const int siteId, const double fcstTime);
   
    /**
-   * Get relative humidity for given site ID at given forecast time
+   * Get relative humidity for given site ID at given forecast time. The NWP
+   * files have none, so it is always missing.
    * @param[in] siteId  Integer site id for forecast data
    * @param[in] fcstTime  forecast data time in seconds.
-   * @return forecasted data value
+   * @return NWP_MISSING
    */
   const float getRh(const int siteId, const double fcstTime);
 
@@ -331,155 +447,107 @@ private:
   vector <double> validTime;
 
   /**
-   * Solar azimuth array for all sites and all forecasts
-   */
-  vector <float> azimuth;
-
-  /**
-   *  Max cloud fraction for all sites and all forecasts 
-   */
-  vector <float> cloudFrac;
-
-  /**
-   *  Diffuse horizontal irradiance data array for all sites and all forecasts
-   */
-  vector <float> dhi;
-
-  /**
-   *  Direct normal irradiance data array for all sites and all forecasts
-   */
-  vector <float> dni;
-
-  /**
-   * Solar elevation array for all sites and all forecasts
-   */
-  vector <float> elevation;
-
-  /**
-   *  global horizontal irradiance data array for all sites and all forecasts
+   * Data arrays of the VARS for all sites and all forecasts, site major
    */
-  vector <float> ghi;
+  SiteColumns<Var, NUM_VARS> columns;
 
   /**
-   *  Clearness index data array for all sites and all forecasts
-   */
-  vector <float> kt;
-
-  /**
-   * Mixing ratio data array for all sites and all forecasts
-   */
-  vector <float> mixingRatio;
-
-  /**
-   *  Surface pressure data array for all sites and all forecasts
-   */
-  vector <float> pSfc;
-
-  /**
-   *  Relative humidity data array for all sites and all forecasts
+   * Total number of sites for which forecasts are made
    */
-  vector <float> rh;
+  int numSites;
 
   /**
-   * TAU_QC_TOT: Mass weighted liquid optical thickness data array
-   * for all sites and all forecasts.
+   * Last forecast time in the file.
    */
-  vector <float> tauQcTot;
+  double lastFcstTime;
 
   /**
-   * TAU_QI_TOT: Mass weighted ice effective radius data array
-   * for all sites and all forecasts
+   * Time resolution of lead times, the time between the first two valid
+   * times
    */
-  vector <float> tauQiTot; 
+  int timeResolution;
 
   /**
-   * TAU_QS: Mass weighted snow optical thickness data array
-   * for all sites and all forecasts
+   * Largest time between valid times that is interpolated, 0 if the
+   * reader does not interpolate
    */
-  vector <float> tauQs;
+  int interpMaxGap;
 
   /**
-   * TAOD5502D: Total aerosol optical depth at 550nm data array 
-   * for all sites and all forecasts
+   * Interpolating view of the data arrays at the valid times
    */
-  vector <float> taod5502d;
+  SiteInterp timeInterp;
 
   /**
-   * Temperature (2m)data array for all sites and all forecasts
+   * String containing error message for failed file read
    */
-  vector <float> temp;
+  string error;
 
   /**
-   *  Top of the atmosphere irradiance data array for all sites 
-   *  and all forecasts
+   * String containing input file path 
    */
-  vector <float> toa;
+  string inputFile;
 
   /**
-   *  Wind direction data array for all sites and all forecasts
-   */
-  vector <float> windDir;
-  
-  /**
-   *  Wind speed data array for all sites and all forecasts
-   */
-  vector <float> windSpeed;
+   *  Creation time of input file 
+   */ 
+  double creationTime;
 
   /**
-   * WP_TOT: Total water path, the sum of liquid, ice, and snow water paths 
-   * This array is for all sites and all forecasts 
+   * Site locations for computing solar geometry, NULL to read it
    */
-  vector <float> wpTot;
+  const SolarSites *solarSites;
 
   /**
-   * WVP: Water vapor path data array for all sites and all forecasts
+   * Mapped site store when the input file is one. The data arrays then 
+   * view the store columns instead of holding copies.
    */
-  vector <float> wvp;
+  SiteStore store;
 
   /**
-   * Wrf GHI/WrfTOA data array for all sites and all forecasts
-   */
-  vector <float> wrfKt2;
+   * Return the offset of a data variable with this site ID at forecast time
+   */ 
+  const int getArrayOffset( const int siteId, double fcstTime) ;
 
   /**
-   * Wrf TOA data array for all sites and all forecasts
+   * Value of a data array for a site at a forecast time, interpolated if
+   * the reader interpolates
    */
-  vector <float> wrfToa2;
+  const float columnValue(const SiteColumn &column, const int siteId,
+                          const double fcstTime);
 
   /**
-   * Total number of sites for which forecasts are made
+   * As columnValue() for irradiance, interpolating the clear sky index
    */
-  int numSites;
+  const float irradianceValue(const SiteColumn &column, const int siteId,
+                              const double fcstTime);
 
   /**
-   * Last forecast time in the file.
+   * Solar elevation, azimuth and TOA of a site at a forecast time from the
+   * site locations
    */
-  double lastFcstTime;
+  void solarAt(const int siteId, const double fcstTime, float &el, float &az,
+               float &ta) const;
 
   /**
-   * Time resolution of lead times
+   * Set up the data arrays from a site store file
+   * @return 0 if the store is successfully mapped
    */
-  int timeResolution;
+  int parseStore(void);
 
   /**
-   * String containing error message for failed file read
+   * True if a data variable is read from the input file rather than
+   * computed
    */
-  string error;
+  bool isRead(const Var var) const
+  {
+    return solarSites == NULL || !columns.has(var, SITE_VAR_SOLAR);
+  }
 
   /**
-   * String containing input file path 
+   * Compute the toa, elevation and azimuth arrays on first use
    */
-  string inputFile;
-
-  /**
-   *  Creation time of input file 
-   */ 
-  double creationTime;
-
-  /**
-   * Return the offset of a data variable with this site ID at forecast time
-   */ 
-  const int getArrayOffset( const int siteId, double fcstTime) ;
+  void deriveSolar(void);
 };
 
 #endif /* NWP_READER_HH */
@@ -97,13 +97,14 @@ const int ObsMgr::getObsFileIndex(const int siteId, const double obsTime) const
   }			  
 }
 
-const float ObsMgr::getAzimuth(const int siteId, const double obsTime)
+const float ObsMgr::get(const ObsReader::Var var, const int siteId,
+                         const double obsTime)
 {
   int i = getObsFileIndex(siteId, obsTime);
 
   if(i >= 0)
   {
-    return (_obsFiles[i]->getAzimuth(siteId, obsTime));
+    return (_obsFiles[i]->get(var, siteId, obsTime));
   }
   else
   {
@@ -111,131 +112,70 @@ const float ObsMgr::getAzimuth(const int siteId, const double obsTime)
   }
 }
 
-const float ObsMgr::getElevation(const int siteId, const double obsTime)
-{ 
-  int i = getObsFileIndex(siteId, obsTime);
-  
-  if(i >= 0)
-  { 
-    return (_obsFiles[i]->getElevation(siteId, obsTime));
-  }
-  else
-  { 
-    return  ObsReader::OBS_MISSING;
-  }
-}
-
-const float ObsMgr::getGHI(const int siteId, const double obsTime)
+void ObsMgr::gather(const ObsReader::Var *vars, const int numVars, const int siteId,
+                    const double obsTime, float *values)
 {
   int i = getObsFileIndex(siteId, obsTime);
 
   if(i >= 0)
   {
-    return (_obsFiles[i]->getGHI(siteId, obsTime));
+    _obsFiles[i]->gather(vars, numVars, siteId, obsTime, values);
   }
   else
   {
-    return  ObsReader::OBS_MISSING;
+    for (int j = 0; j < numVars; j++)
+    {
+      values[j] = ObsReader::OBS_MISSING;
+    }
   }
 }
 
-const float ObsMgr::getKt(const int siteId, const double obsTime)
+const float ObsMgr::getAzimuth(const int siteId, const double obsTime)
 {
-  int i = getObsFileIndex(siteId, obsTime);
-
-  if(i >= 0)
-  {
-    return (_obsFiles[i]->getKt(siteId, obsTime));
-  }
-  else
-  {
-    return  ObsReader::OBS_MISSING;
-  }
+  return get(ObsReader::AZIMUTH, siteId, obsTime);
 }
 
-const float ObsMgr::getPressure(const int siteId, const double obsTime)
+const float ObsMgr::getElevation(const int siteId, const double obsTime)
 {
-  int i = getObsFileIndex(siteId, obsTime);
-
-  if(i >= 0)
-  {
-    return (_obsFiles[i]->getPressure(siteId, obsTime));
-  }
-  else
-  {
-    return  ObsReader::OBS_MISSING;
-  }
+  return get(ObsReader::ELEVATION, siteId, obsTime);
 }
 
-const float ObsMgr::getRh(const int siteId, const double obsTime)
+const float ObsMgr::getGHI(const int siteId, const double obsTime)
 {
-  int i = getObsFileIndex(siteId, obsTime);
-
-  if(i >= 0)
-  {
-    return (_obsFiles[i]->getRh(siteId, obsTime));
-  }
-  else
-  {
-    return  ObsReader::OBS_MISSING;
-  }
+  return get(ObsReader::GHI, siteId, obsTime);
 }
 
+const float ObsMgr::getKt(const int siteId, const double obsTime)
+{
+  return get(ObsReader::KT, siteId, obsTime);
+}
 
-const float ObsMgr::getTemp(const int siteId, const double obsTime) 
+const float ObsMgr::getPressure(const int siteId, const double obsTime)
 {
-  int i = getObsFileIndex(siteId, obsTime);
+  return get(ObsReader::PRESSURE, siteId, obsTime);
+}
 
-  if(i >= 0)
-  {   
-    return (_obsFiles[i]->getTemp(siteId, obsTime));
-  }
-  else
-  {
-    return  ObsReader::OBS_MISSING;
-  }    
+const float ObsMgr::getRh(const int siteId, const double obsTime)
+{
+  return get(ObsReader::RH, siteId, obsTime);
 }
 
+const float ObsMgr::getTemp(const int siteId, const double obsTime)
+{
+  return get(ObsReader::TEMP, siteId, obsTime);
+}
 
 const float ObsMgr::getToa(const int siteId, const double obsTime)
 {
-  int i = getObsFileIndex(siteId, obsTime);
-
-  if(i >= 0)
-  {   
-    return (_obsFiles[i]->getToa(siteId, obsTime));
-  }
-  else
-  {
-    return  ObsReader::OBS_MISSING;
-  }    
+  return get(ObsReader::TOA, siteId, obsTime);
 }
 
 const float ObsMgr::getWindDir(const int siteId, const double obsTime)
 {
-  int i = getObsFileIndex(siteId, obsTime);
-
-  if(i >= 0)
-  {
-    return (_obsFiles[i]->getWindDir(siteId, obsTime));
-  }
-  else
-  {
-    return  ObsReader::OBS_MISSING;
-  }
+  return get(ObsReader::WIND_DIR, siteId, obsTime);
 }
 
-const float ObsMgr::getWindSpeed(const int siteId, const double obsTime) 
+const float ObsMgr::getWindSpeed(const int siteId, const double obsTime)
 {
-  int i = getObsFileIndex(siteId, obsTime);
-
-  if(i >= 0)
-  {   
-    return (_obsFiles[i]->getWindSpeed(siteId, obsTime));
-  }
-  else
-  {
-    return  ObsReader::OBS_MISSING;
-  }    
+  return get(ObsReader::WIND_SPEED, siteId, obsTime);
 }
-
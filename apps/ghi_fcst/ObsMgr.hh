@@ -59,6 +59,38 @@ public:
    */
   void add(ObsReader *obsFile);
 
+  /**
+   * Remove all ObsReader objects without deleting them, for readers owned
+   * elsewhere (e.g. by a ReaderCache)
+   */
+  void release() { _obsFiles.clear(); }
+
+  /**
+   * Number of readers held
+   */
+  int size() const { return (int)_obsFiles.size(); }
+
+  /**
+   * Get a data variable for site ID at observation time
+   * @param[in] var  Data variable
+   * @param[in] siteId  Integer site id for observation data
+   * @param[in] obsTime  Observation time in seconds.
+   * @return observed data value
+   */
+  const float get(const ObsReader::Var var, const int siteId, const double obsTime);
+
+  /**
+   * Get several data variables for site ID at observation time from the
+   * file having the time
+   * @param[in] vars  Data variables
+   * @param[in] numVars  Number of variables
+   * @param[in] siteId  Integer site id for observation data
+   * @param[in] obsTime  Observation time in seconds.
+   * @param[out] values  numVars observed data values, in the order of vars
+   */
+  void gather(const ObsReader::Var *vars, const int numVars, const int siteId,
+              const double obsTime, float *values);
+
   /**
    * Get solar azimuth data for site ID at observation time
    * @param[in] siteId  Integer site id for observation data
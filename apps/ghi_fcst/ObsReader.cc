@@ -30,6 +30,7 @@
 #include <log/log.hh>
 #include "ncfc/ncfc.hh"
 #include "ObsReader.hh"
+#include "SolarSites.hh"
 
 extern Log *Logg;
 extern int DebugLevel;
@@ -40,10 +41,15 @@ namespace fs = boost::filesystem;
 
 const float ObsReader::OBS_MISSING = NC_FILL_FLOAT;
 const float ObsReader::PI = 3.141592653589793;
+constexpr SiteVarDef ObsReader::VARS[];
 
 ObsReader::ObsReader(const string &obsFilePath, const int obsDataResolution):
   inputFile(obsFilePath),
-  obsDataResolutionSecs(obsDataResolution) 
+  obsDataResolutionSecs(obsDataResolution),
+  columns(VARS),
+  solarSites(NULL),
+  shadingMask(NULL),
+  siteMajor(false)
 {
   
 }
@@ -59,6 +65,14 @@ int ObsReader::parse()
       return 1;
     }
 
+  //
+  // Files converted by nc2site_store are mapped rather than read
+  //
+  if (SiteStore::is_store(inputFile))
+    {
+      return parseStore();
+    }
+
   //
   // NetCDF dimensions
   // 
@@ -73,16 +87,17 @@ int ObsReader::parse()
   //varNames.push_back("station_name");
   varNames.push_back("stationID");
   varNames.push_back("observationTime");
-  varNames.push_back("relative_humidity");
-  varNames.push_back("T_2");
-  varNames.push_back("solar_insolation");
-  varNames.push_back("pressure");
-  varNames.push_back("wind_speed");
-  varNames.push_back("wind_dir");
-  varNames.push_back("solar_elevation_angle");
-  varNames.push_back("solar_azimuth_angle");
-  varNames.push_back("TOA");
-  varNames.push_back("Kt");
+
+  //
+  // Solar geometry is read unless it is computed from site locations
+  //
+  for (int v = 0; v < NUM_VARS; v++)
+  {
+    if (isRead((Var)v))
+    {
+      varNames.push_back(VARS[v].name);
+    }
+  }
 
   //
   // Instantiate the netCDF input reader object
@@ -151,134 +166,149 @@ int ObsReader::parse()
   }
 
   //
-  // Copy rh to vector
+  // Copy the data variables to the data arrays
   //
-  ind = varIndexMap["relative_humidity"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  for (int v = 0; v < NUM_VARS; v++)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    rh.push_back(val);
-  }
+    if (isRead((Var)v))
+    {
+      ind = varIndexMap[VARS[v].name];
 
-  //
-  // Copy temp vector
-  //
-  ind = varIndexMap["T_2"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    temp.push_back(val);
-  }
+      numObs = inVarSizes[ind];
 
-  //
-  // Copy ghi data to vector
-  //
-  ind = varIndexMap["solar_insolation"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    if (val < 0)
-       ghi.push_back(0);
-    else
-       ghi.push_back(val);
+      columns.copy((Var)v, inVarPtrs[ind], numObs);
+    }
   }
 
   //
-  // Copy pressure data to vector
-  //
-  ind = varIndexMap["pressure"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    pres.push_back(val);
-  }
-  
-  //
-  // Copy wind speed data to vector
+  // Map siteIds to integer indices. This is used for calculating offsets of 
+  // variable values
   //
-  ind = varIndexMap["wind_speed"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  for (int i = 0; i < numSites; i++)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    windSpeed.push_back(val);
+    siteIdIndexMap[siteList[i]] = i;
   }
+  return 0;
+}
 
-  //
-  // Copy wind direction data to vector
-  //
-  ind = varIndexMap["wind_dir"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    windDir.push_back(val);
-  }
+int ObsReader::parseStore()
+{
+  if (store.open(inputFile) != 0)
+    {
+      error = string("Error: ") + store.error();
+      return 1;
+    }
 
   //
-  // Copy solar elevation data to vector
+  // The store is site major, unlike the observation netCDF file
   //
-  ind = varIndexMap["solar_elevation_angle"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    elevation.push_back(val);
-  }
+  siteMajor = true;
 
-  //
-  // Copy solar azimuth data to vector
-  //
-  ind = varIndexMap["solar_azimuth_angle"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    azimuth.push_back(val);
-  }
+  numSites = store.num_sites();
 
-  //
-  // Copy TOA data to vector
-  //
-  ind = varIndexMap["TOA"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
-  {
-    float val = ((float *)inVarPtrs[ind])[i];
-    toa.push_back(val);
-  }
+  numTimes = store.num_times();
+
+  numObs = numSites * numTimes;
+
+  if (numTimes == 0)
+    {
+      error = string("Error: Empty observationTime array for ") + inputFile;
+      return 1;
+    }
+
+  for (int i = 0; i < numSites; i++)
+    {
+      siteList.push_back(store.site_id(i));
+    }
+
+  for (int i = 0; i < numTimes; i++)
+    {
+      timesList.push_back(store.time(i));
+    }
 
   //
-  // Copy solar azimuth data to vector
+  // The store keeps the netCDF variable names. Negative insolation is set
+  // to zero as in parse(), so ghi is a copy.
   //
-  ind = varIndexMap["Kt"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  for (int v = 0; v < NUM_VARS; v++)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    kt.push_back(val);
+    if (isRead((Var)v) && columns.view((Var)v, store) != 0)
+    {
+      error = string("Error: ") + VARS[v].name + " is not in site store " + inputFile;
+      return 1;
+    }
   }
 
-  //
-  // Map siteIds to integer indices. This is used for calculating offsets of 
-  // variable values
-  //
   for (int i = 0; i < numSites; i++)
   {
     siteIdIndexMap[siteList[i]] = i;
   }
+
   return 0;
 }
 
+void ObsReader::deriveSolar()
+{
+  vector<float> el;
+
+  vector<float> az;
+
+  vector<float> ta;
+
+  solarSites->compute(siteList, timesList, OBS_MISSING, el, az, ta);
+
+  if (!siteMajor)
+  {
+    //
+    // Observation netCDF arrays are time major
+    //
+    vector<float> elT(el.size());
+
+    vector<float> azT(az.size());
+
+    vector<float> taT(ta.size());
+
+    for (int s = 0; s < numSites; s++)
+    {
+      for (int t = 0; t < numTimes; t++)
+      {
+        elT[t * numSites + s] = el[s * numTimes + t];
+
+        azT[t * numSites + s] = az[s * numTimes + t];
+
+        taT[t * numSites + s] = ta[s * numTimes + t];
+      }
+    }
+
+    el.swap(elT);
+
+    az.swap(azT);
+
+    ta.swap(taT);
+  }
+
+  columns[ELEVATION].take(el);
+
+  columns[AZIMUTH].take(az);
+
+  columns[TOA].take(ta);
+}
+
 ObsReader:: ~ObsReader()
 {
   
 }
 
+bool ObsReader::isShaded(const int siteId, const double obsTime) const
+{
+  if (shadingMask == NULL)
+  {
+    return false;
+  }
+
+  return shadingMask->num_shaded(siteId, (time_t)obsTime, obsDataResolutionSecs / 60) > 0;
+}
+
 const int ObsReader::getArrayOffset(const int siteId, const double obsTime) 
 {
  
@@ -293,6 +323,11 @@ const int ObsReader::getArrayOffset(const int siteId, const double obsTime)
     int timeIndex = (obsTime - timesList[0])/obsDataResolutionSecs;
 
     int siteIndex = siteIdIndexMap[siteId];
+
+    if (siteMajor)
+    {
+      return siteIndex * numTimes + timeIndex;
+    }
   
     return  timeIndex * numSites + siteIndex;
 
@@ -322,143 +357,99 @@ void  ObsReader::getStartEndTimes( double &start, double &end) const
   end = timesList[(int) timesList.size() -1];
 } 
 
-const float ObsReader::getAzimuth(const int siteId, const double obsTime)
+const float ObsReader::get(const Var var, const int siteId, const double obsTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, obsTime);
+  float value;
 
-  if ( arrayOffset >= 0)
-  {
-    return azimuth[arrayOffset];
-  }
-  else
-  {
-    return OBS_MISSING;
-  }
+  gather(&var, 1, siteId, obsTime, &value);
+
+  return value;
 }
 
-const float ObsReader::getElevation(const int siteId, const double obsTime)
+void ObsReader::gather(const Var *vars, const int numVars, const int siteId,
+                       const double obsTime, float *values)
 {
-  int arrayOffset =  getArrayOffset(siteId, obsTime);
+  bool solar = false;
 
-  if ( arrayOffset >= 0)
+  bool shaded = false;
+
+  for (int i = 0; i < numVars; i++)
   {
-    return elevation[arrayOffset];
+    solar = solar || columns.has(vars[i], SITE_VAR_SOLAR);
+
+    shaded = shaded || columns.has(vars[i], SITE_VAR_SHADED);
   }
-  else
+
+  if (solar && solarSites != NULL && columns[TOA].size() == 0)
   {
-    return OBS_MISSING;
+    deriveSolar();
   }
-}
 
-const float ObsReader::getGHI(const int siteId, const double obsTime)
-{
   int arrayOffset =  getArrayOffset(siteId, obsTime);
 
-  if ( arrayOffset >= 0)
-  {
-    return ghi[arrayOffset];
-  }
-  else
+  columns.gather(vars, numVars, arrayOffset, OBS_MISSING, values);
+
+  //
+  // Irradiance of a shaded sensor is missing
+  //
+  if (shaded && arrayOffset >= 0 && isShaded(siteId, obsTime))
   {
-    return OBS_MISSING;
+    for (int i = 0; i < numVars; i++)
+    {
+      if (columns.has(vars[i], SITE_VAR_SHADED))
+      {
+        values[i] = OBS_MISSING;
+      }
+    }
   }
 }
 
-const float ObsReader::getKt(const int siteId, const double obsTime)
+const float ObsReader::getAzimuth(const int siteId, const double obsTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, obsTime);
+  return get(AZIMUTH, siteId, obsTime);
+}
 
-  if ( arrayOffset >= 0)
-  {
-    return kt[arrayOffset];
-  }
-  else
-  {
-    return OBS_MISSING;
-  }
+const float ObsReader::getElevation(const int siteId, const double obsTime)
+{
+  return get(ELEVATION, siteId, obsTime);
 }
 
-const float ObsReader::getPressure(const int siteId, const double obsTime)
+const float ObsReader::getGHI(const int siteId, const double obsTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, obsTime);
+  return get(GHI, siteId, obsTime);
+}
 
-  if ( arrayOffset >= 0)
-  {
-    return pres[arrayOffset];
-  }
-  else
-  {
-    return OBS_MISSING;
-  }
+const float ObsReader::getKt(const int siteId, const double obsTime)
+{
+  return get(KT, siteId, obsTime);
 }
 
-const float ObsReader::getRh(const int siteId, const double obsTime)
+const float ObsReader::getPressure(const int siteId, const double obsTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, obsTime);
+  return get(PRESSURE, siteId, obsTime);
+}
 
-  if ( arrayOffset >= 0)
-  {
-    return rh[arrayOffset];
-  }
-  else
-  {
-    return OBS_MISSING;
-  }
+const float ObsReader::getRh(const int siteId, const double obsTime)
+{
+  return get(RH, siteId, obsTime);
 }
 
 const float ObsReader::getToa(const int siteId, const double obsTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, obsTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return toa[arrayOffset];
-  }
-  else
-  {
-    return OBS_MISSING;
-  }
+  return get(TOA, siteId, obsTime);
 }
 
 const float ObsReader::getTemp(const int siteId, const double obsTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, obsTime);
-  
-  if ( arrayOffset >= 0) 
-  {
-    return temp[arrayOffset];
-  }
-  else
-  {
-    return OBS_MISSING;
-  }
+  return get(TEMP, siteId, obsTime);
 }
 
 const float ObsReader::getWindDir(const int siteId, const double obsTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, obsTime);
-
-  if ( arrayOffset >= 0)
-  {
-    return windDir[arrayOffset];
-
-  }
-  else
-  {
-    return OBS_MISSING;
-  }
+  return get(WIND_DIR, siteId, obsTime);
 }
 
-const float ObsReader::getWindSpeed(const int siteId, const double obsTime) 
+const float ObsReader::getWindSpeed(const int siteId, const double obsTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, obsTime);
-  
-  if ( arrayOffset >= 0)
-  { 
-    return windSpeed[arrayOffset];
-  }
-  else
-  {
-    return OBS_MISSING;
-  }
+  return get(WIND_SPEED, siteId, obsTime);
 }
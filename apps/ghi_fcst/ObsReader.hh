@@ -26,11 +26,15 @@
 #include<vector>
 #include<string>
 #include<map>
+#include <shading_mask/shading_mask.hh>
+#include <site_store/site_store.hh>
 
 using std::string;
 using std::map;
 using std::vector;
 
+class SolarSites;
+
 /**
  * @class ObsReader
  */
@@ -41,6 +45,44 @@ public:
   const static float OBS_MISSING;
   const static float PI;
 
+  /**
+   * Data variables of the file, in the order of VARS
+   */
+  enum Var
+  {
+    AZIMUTH,
+    ELEVATION,
+    GHI,
+    KT,
+    PRESSURE,
+    RH,
+    TEMP,
+    TOA,
+    WIND_DIR,
+    WIND_SPEED,
+    NUM_VARS
+  };
+
+  /**
+   * netCDF name, type, layout and handling of each data variable. The
+   * solar geometry is computed instead of read when the reader has site
+   * locations; negative insolation is read as 0; GHI and Kt are missing
+   * while the site is shaded.
+   */
+  static constexpr SiteVarDef VARS[NUM_VARS] = {
+    { "solar_azimuth_angle", SITE_VAR_FLOAT, SITE_VAR_TIME_SITE, SITE_VAR_SOLAR },
+    { "solar_elevation_angle", SITE_VAR_FLOAT, SITE_VAR_TIME_SITE, SITE_VAR_SOLAR },
+    { "solar_insolation", SITE_VAR_FLOAT, SITE_VAR_TIME_SITE,
+      SITE_VAR_NON_NEGATIVE | SITE_VAR_SHADED },
+    { "Kt", SITE_VAR_FLOAT, SITE_VAR_TIME_SITE, SITE_VAR_SHADED },
+    { "pressure", SITE_VAR_FLOAT, SITE_VAR_TIME_SITE, 0 },
+    { "relative_humidity", SITE_VAR_FLOAT, SITE_VAR_TIME_SITE, 0 },
+    { "T_2", SITE_VAR_FLOAT, SITE_VAR_TIME_SITE, 0 },
+    { "TOA", SITE_VAR_FLOAT, SITE_VAR_TIME_SITE, SITE_VAR_SOLAR },
+    { "wind_dir", SITE_VAR_FLOAT, SITE_VAR_TIME_SITE, 0 },
+    { "wind_speed", SITE_VAR_FLOAT, SITE_VAR_TIME_SITE, 0 },
+  };
+
   /** 
    * Constructor
    * @param[in] obsFilepath  Path of netCDF input file
@@ -54,10 +96,32 @@ public:
   ~ObsReader();
   
   /**
-   * Read netCDF file
+   * Read netCDF file, or map the site store file written for it by
+   * nc2site_store
    * @return 0 if netCDF file is successfully read
    */
   int parse(void);
+
+  /**
+   * Compute TOA, solar elevation and azimuth from site locations instead
+   * of reading TOA, solar_elevation_angle and solar_azimuth_angle from the
+   * input file, which then need not have them. Call before parse().
+   * @param[in] solar  Site locations, owned by the caller
+   */
+  void setSolarSites(const SolarSites *solar)
+  {
+    solarSites = solar;
+  }
+
+  /**
+   * Mask GHI and Kt of periods with any minute in which the site's
+   * pyranometer is shaded, for input that has not been shading QC'd
+   * @param[in] mask  Shading mask, owned by the caller, or NULL
+   */
+  void setShadingMask(const ShadingMask *mask)
+  {
+    shadingMask = mask;
+  }
   
   /**
    * Return error string if file read fails
@@ -92,6 +156,27 @@ public:
    */
   const double getStartTime(void) const {return timesList[0];} 
 
+  /**
+   * Get a data variable for site ID at observation time
+   * @param[in] var  Data variable
+   * @param[in] siteId  Integer site id for observation data
+   * @param[in] obsTime  Observation time in seconds.
+   * @return observed data value
+   */
+  const float get(const Var var, const int siteId, const double obsTime);
+
+  /**
+   * Get several data variables for site ID at observation time, locating
+   * the site and time once
+   * @param[in] vars  Data variables
+   * @param[in] numVars  Number of variables
+   * @param[in] siteId  Integer site id for observation data
+   * @param[in] obsTime  Observation time in seconds.
+   * @param[out] values  numVars observed data values, in the order of vars
+   */
+  void gather(const Var *vars, const int numVars, const int siteId,
+              const double obsTime, float *values);
+
   /**
    * Get solar azimuth data for site ID at observation time
    * @param[in] siteId  Integer site id for observation data
@@ -244,65 +329,61 @@ private:
   int obsDataResolutionSecs;
 
   /**
-   *  Solar azimuth angle data array for all sites and all observations
+   * Data arrays of the VARS for all sites and all observations
    */
-  vector <float> azimuth;
+  SiteColumns<Var, NUM_VARS> columns;
 
   /**
-   *  Solar elevation angle data array for all sites and all observations
+   * Site locations for computing solar geometry, NULL to read it
    */
-  vector <float> elevation;
+  const SolarSites *solarSites;
 
   /**
-   *  GHI data array for all sites and all observations
+   * Shading mask applied to GHI and Kt, NULL for none
    */
-  vector<float> ghi;
+  const ShadingMask *shadingMask;
 
   /**
-   *  Clearness index, kt, data array for all sites and all observations
+   * Mapped site store when the input file is one. The data arrays then 
+   * view the store columns instead of holding copies.
    */
-  vector<float> kt;  
+  SiteStore store;
 
   /**
-   *  Precipitation rate data array for all sites and all observation times 
+   * True if data arrays are site major, as in a site store, rather than
+   * time major, as in the netCDF file
    */
-  vector<float> precip;
-  
-  /**
-   *  Pressure data for all sites and all observation times
-   */
-  vector <float> pres;
+  bool siteMajor;
 
   /**
-   *  Relative humidity data array for all sites and all observation times
-   */
-  vector<float> rh;
- 
+   * Get array or vector offset of observation for time and site id.
+   */ 
+  const int getArrayOffset( const int siteId, const double obsTime); 
+
   /**
-   * Temperature data array for all sites and all observations
+   * True if the site is shaded during the period ending at obsTime
    */
-  vector<float> temp;
+  bool isShaded(const int siteId, const double obsTime) const;
 
   /**
-   *  Top of the atmosphere irradiance data array for all sites and all 
-   *  observation times
+   * Set up the data arrays from a site store file
+   * @return 0 if the store is successfully mapped
    */
-  vector<float> toa;
+  int parseStore(void);
 
   /**
-   *  Wind direction data array for all sites and all observation times
+   * True if a data variable is read from the input file rather than
+   * computed
    */
-  vector<float> windDir;
+  bool isRead(const Var var) const
+  {
+    return solarSites == NULL || !columns.has(var, SITE_VAR_SOLAR);
+  }
 
   /**
-   * Wind speed data array for all sites and all observation times
+   * Compute the toa, elevation and azimuth arrays on first use
    */
-  vector<float> windSpeed; 
- 
-  /**
-   * Get array or vector offset of observation for time and site id.
-   */ 
-  const int getArrayOffset( const int siteId, const double obsTime); 
+  void deriveSolar(void);
 };
 
 #endif /* OBS_READER_HH */
@@ -0,0 +1,173 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: ReaderCache.hh,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/08/02 16:10:00 $
+//
+//==============================================================================
+
+/**
+ *
+ * @file ReaderCache.hh  ReaderCache keeps parsed NwpReader or ObsReader
+ *                       objects keyed by file path so that files shared by
+ *                       several issue times are read only once in range mode.
+ *
+ * @class ReaderCache  Least recently used cache of parsed file readers. The
+ *                     cache owns the readers. Readers handed out since the
+ *                     last call to beginBatch() are never evicted, so the
+ *                     cache may grow past its capacity while one issue time
+ *                     is being processed.
+ * @date 08/02/21
+ */
+
+#ifndef READER_CACHE_HH
+#define READER_CACHE_HH
+
+#include <list>
+#include <map>
+#include <string>
+
+using std::list;
+using std::map;
+using std::string;
+
+template <class Reader>
+class ReaderCache
+{
+public:
+
+  /**
+   * Function that creates and parses a reader, returning NULL and setting
+   * the error string on failure
+   */
+  typedef Reader *(*LoadFunc)(const string &path, string &error);
+
+  /**
+   * Constructor
+   * @param[in] capacity  Number of readers to keep
+   * @param[in] load  Function creating a parsed reader for a path
+   */
+  ReaderCache(const int capacity, LoadFunc load) :
+    _capacity(capacity), _load(load), _batch(0), _hits(0), _misses(0) {}
+
+  /**
+   * Destructor deletes the cached readers
+   */
+  ~ReaderCache()
+  {
+    typename list<Entry>::iterator it;
+
+    for (it = _lru.begin(); it != _lru.end(); ++it)
+    {
+      delete it->reader;
+    }
+  }
+
+  /**
+   * Start a new batch of requests. Readers handed out in earlier batches
+   * may be evicted from here on.
+   */
+  void beginBatch() { _batch++; }
+
+  /**
+   * Get the parsed reader for a path, reading the file if it is not cached.
+   * Failures are not cached, so a file that appears later is picked up.
+   * @param[in] path  File path
+   * @param[out] error  Error string if the file could not be read
+   * @return Reader owned by the cache, or NULL on failure
+   */
+  Reader *get(const string &path, string &error)
+  {
+    typename map<string, typename list<Entry>::iterator>::iterator found =
+      _index.find(path);
+
+    if (found != _index.end())
+    {
+      _hits++;
+
+      _lru.splice(_lru.begin(), _lru, found->second);
+
+      _lru.front().batch = _batch;
+
+      return _lru.front().reader;
+    }
+
+    _misses++;
+
+    Reader *reader = _load(path, error);
+
+    if (reader == NULL)
+    {
+      return NULL;
+    }
+
+    Entry entry;
+    entry.path = path;
+    entry.reader = reader;
+    entry.batch = _batch;
+
+    _lru.push_front(entry);
+
+    _index[path] = _lru.begin();
+
+    evict();
+
+    return reader;
+  }
+
+  /**
+   * Number of requests served from the cache
+   */
+  int getHits() const { return _hits; }
+
+  /**
+   * Number of requests that read a file
+   */
+  int getMisses() const { return _misses; }
+
+private:
+
+  struct Entry
+  {
+    string path;
+    Reader *reader;
+    int batch;
+  };
+
+  /**
+   * Remove least recently used readers over capacity that are not in use
+   * by the current batch
+   */
+  void evict()
+  {
+    while ((int)_lru.size() > _capacity && _lru.back().batch != _batch)
+    {
+      _index.erase(_lru.back().path);
+
+      delete _lru.back().reader;
+
+      _lru.pop_back();
+    }
+  }
+
+  int _capacity;
+
+  LoadFunc _load;
+
+  int _batch;
+
+  int _hits;
+
+  int _misses;
+
+  /**
+   * Readers, most recently used first
+   */
+  list<Entry> _lru;
+
+  map<string, typename list<Entry>::iterator> _index;
+};
+
+#endif /* READER_CACHE_HH */
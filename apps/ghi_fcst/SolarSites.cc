@@ -0,0 +1,256 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: SolarSites.cc,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/08/30 10:30:00 $
+//
+//==============================================================================
+
+/**
+ * @file SolarSites.cc
+ * @brief Source for SolarSites class
+ */
+
+// Include files
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <fstream>
+#include <log/log.hh>
+#include <solar_position/solar_position.hh>
+#include "SolarSites.hh"
+
+using std::ifstream;
+
+extern Log *Logg;
+extern int DebugLevel;
+
+// Constant and macros
+
+const int SolarSites::PERIOD_MINUTES = 15;
+
+static const char *ID_COLUMNS[] = {"int_id", "siteid", "grid_id", NULL};
+
+static const char *LAT_COLUMNS[] = {"lat [degrees]", "lat", NULL};
+
+static const char *LON_COLUMNS[] = {"lon [degrees]", "lon", NULL};
+
+// Functions
+
+//
+// Split a csv line, trimming white space and carriage returns
+//
+static void splitCsv(const string &line, vector<string> &fields)
+{
+  fields.clear();
+
+  size_t start = 0;
+
+  while (true)
+  {
+    size_t pos = line.find(',', start);
+
+    string field = line.substr(start, pos == string::npos ? string::npos : pos - start);
+
+    size_t first = field.find_first_not_of(" \t\r\"");
+
+    size_t last = field.find_last_not_of(" \t\r\"");
+
+    fields.push_back(first == string::npos ? string("") : field.substr(first, last - first + 1));
+
+    if (pos == string::npos)
+    {
+      break;
+    }
+
+    start = pos + 1;
+  }
+}
+
+//
+// Find a column by any of the given header names
+//
+static int findColumn(const vector<string> &header, const char **names)
+{
+  for (int c = 0; c < (int)header.size(); c++)
+  {
+    string lower = header[c];
+
+    for (int i = 0; i < (int)lower.size(); i++)
+    {
+      lower[i] = tolower(lower[i]);
+    }
+
+    for (int n = 0; names[n] != NULL; n++)
+    {
+      if (lower == names[n])
+      {
+        return c;
+      }
+    }
+  }
+
+  return -1;
+}
+
+SolarSites::SolarSites(const string &locationFileParam) :
+  locationFile(locationFileParam)
+{
+}
+
+int SolarSites::parse()
+{
+  ifstream infile(locationFile.c_str());
+
+  if (!infile.is_open())
+  {
+    Logg->write_time("Error: Cannot open site location file %s\n",
+                     locationFile.c_str());
+    return 1;
+  }
+
+  string line;
+
+  vector<string> fields;
+
+  if (!getline(infile, line))
+  {
+    Logg->write_time("Error: Site location file %s is empty\n",
+                     locationFile.c_str());
+    return 1;
+  }
+
+  splitCsv(line, fields);
+
+  int idCol = findColumn(fields, ID_COLUMNS);
+
+  int latCol = findColumn(fields, LAT_COLUMNS);
+
+  int lonCol = findColumn(fields, LON_COLUMNS);
+
+  if (idCol < 0 || latCol < 0 || lonCol < 0)
+  {
+    Logg->write_time("Error: Site location file %s needs site id, latitude "
+                     "and longitude columns\n", locationFile.c_str());
+    return 1;
+  }
+
+  while (getline(infile, line))
+  {
+    if (line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+
+    splitCsv(line, fields);
+
+    if ((int)fields.size() <= idCol || (int)fields.size() <= latCol ||
+        (int)fields.size() <= lonCol)
+    {
+      continue;
+    }
+
+    char *idEnd;
+
+    char *latEnd;
+
+    char *lonEnd;
+
+    long siteId = strtol(fields[idCol].c_str(), &idEnd, 10);
+
+    double lat = strtod(fields[latCol].c_str(), &latEnd);
+
+    double lon = strtod(fields[lonCol].c_str(), &lonEnd);
+
+    if (fields[idCol].empty() || *idEnd != '\0' || *latEnd != '\0' ||
+        *lonEnd != '\0' || lat < -90 || lat > 90)
+    {
+      continue;
+    }
+
+    location[(int)siteId] = std::make_pair((float)lat, (float)lon);
+  }
+
+  if (location.size() == 0)
+  {
+    Logg->write_time("Error: No site locations in %s\n", locationFile.c_str());
+    return 1;
+  }
+
+  if (DebugLevel > 0)
+  {
+    Logg->write_time("Info: Read %d site locations from %s\n",
+                     (int)location.size(), locationFile.c_str());
+  }
+
+  return 0;
+}
+
+void SolarSites::compute(const vector<int> &siteIds, const vector<double> &times,
+                         const float missing, vector<float> &elevation,
+                         vector<float> &azimuth, vector<float> &toa) const
+{
+  int numTimes = (int)times.size();
+
+  elevation.assign(siteIds.size() * numTimes, missing);
+
+  azimuth.assign(siteIds.size() * numTimes, missing);
+
+  toa.assign(siteIds.size() * numTimes, missing);
+
+  if (numTimes == 0)
+  {
+    return;
+  }
+
+  //
+  // Sites with locations, and where their values go
+  //
+  vector<float> lats;
+
+  vector<float> lons;
+
+  vector<int> rows;
+
+  for (int s = 0; s < (int)siteIds.size(); s++)
+  {
+    map<int, pair<float, float> >::const_iterator it = location.find(siteIds[s]);
+
+    if (it != location.end())
+    {
+      lats.push_back(it->second.first);
+
+      lons.push_back(it->second.second);
+
+      rows.push_back(s);
+    }
+  }
+
+  if (rows.size() == 0)
+  {
+    return;
+  }
+
+  vector<float> el(rows.size() * numTimes);
+
+  vector<float> az(rows.size() * numTimes);
+
+  vector<float> ta(rows.size() * numTimes);
+
+  solar_period_mean_grid((int)rows.size(), &lats[0], &lons[0], numTimes, &times[0],
+                         PERIOD_MINUTES, &el[0], &az[0], &ta[0]);
+
+  for (int r = 0; r < (int)rows.size(); r++)
+  {
+    for (int t = 0; t < numTimes; t++)
+    {
+      elevation[rows[r] * numTimes + t] = el[r * numTimes + t];
+
+      azimuth[rows[r] * numTimes + t] = az[r * numTimes + t];
+
+      toa[rows[r] * numTimes + t] = ta[r * numTimes + t];
+    }
+  }
+}
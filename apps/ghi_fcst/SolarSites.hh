@@ -0,0 +1,94 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: SolarSites.hh,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/08/30 10:30:00 $
+//
+//==============================================================================
+
+/**
+ *
+ *  @file SolarSites.hh
+ *  @class SolarSites
+ *  @brief Site locations and the solar geometry derived from them. When
+ *         given to NwpReader and ObsReader, the readers compute TOA, solar
+ *         elevation and azimuth on first use instead of reading them from
+ *         the input files. Values are 15 minute, time ending means of one
+ *         minute values, as computed by the python preprocessing.
+ *  @date 8/30/2021
+ */
+
+#ifndef SOLAR_SITES_HH
+#define SOLAR_SITES_HH
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+class SolarSites
+{
+public:
+
+  /**
+   * Minutes averaged into each value
+   */
+  const static int PERIOD_MINUTES;
+
+  /**
+   * Constructor
+   * @param[in] locationFile  Csv file with a header line and one line per
+   *                          site. Columns are found by header name: site
+   *                          id ("int_id", "siteId" or "grid_id"), latitude
+   *                          ("lat [degrees]", "lat") and longitude
+   *                          ("lon [degrees]", "lon"), case insensitive.
+   */
+  SolarSites(const string &locationFile);
+
+  /**
+   * Read the site location file
+   * @return 1 for failure, 0 for success
+   */
+  int parse();
+
+  /**
+   * Check for a site location
+   */
+  bool haveSite(const int siteId) const
+  {
+    return location.find(siteId) != location.end();
+  }
+
+  /**
+   * Compute mean apparent solar elevation, azimuth and TOA for sites and
+   * times, site major ([site][time]). Sites without a location get the
+   * missing value.
+   * @param[in] siteIds  Site ids
+   * @param[in] times  Period end times
+   * @param[in] missing  Missing data value
+   * @param[out] elevation  Apparent solar elevation, degrees
+   * @param[out] azimuth  Solar azimuth, degrees clockwise from north
+   * @param[out] toa  Top of atmosphere irradiance, W m-2
+   */
+  void compute(const vector<int> &siteIds, const vector<double> &times,
+               const float missing, vector<float> &elevation,
+               vector<float> &azimuth, vector<float> &toa) const;
+
+private:
+
+  string locationFile;
+
+  /**
+   * Latitude and longitude of each site id
+   */
+  map<int, pair<float, float> > location;
+};
+
+#endif /* SOLAR_SITES_HH */
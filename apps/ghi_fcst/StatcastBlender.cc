@@ -0,0 +1,1113 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: StatcastBlender.cc,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/09/20 10:00:00 $
+//
+//==============================================================================
+
+/**
+ * @file StatcastBlender.cc
+ * @brief Source for StatcastBlender class
+ */
+
+// Include files
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <netcdf.h>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <dmapf/grid_site_map.hh>
+#include <log/log.hh>
+#include <shading_mask/shading_mask.hh>
+#include <site_store/nc_lock.hh>
+#include "StatcastBlender.hh"
+
+namespace pt = boost::property_tree;
+
+using std::ifstream;
+
+extern Log *Logg;
+extern int DebugLevel;
+
+// Constant and macros
+
+const float StatcastBlender::BLEND_MISSING = -9999;
+
+//
+// Statcast GHI outside these bounds is treated as missing, as in
+// NWP_Statcast_blender.py
+//
+static const float MAX_STATCAST_GHI = 2000;
+
+//
+// Climate zone of grid points outside New York
+//
+static const int OUTSIDE_ZONE = -9;
+
+static const int NAME_STRLEN = 10;
+
+//
+// Variables of the NWP grid file that are not passed through
+//
+static const char *GRID_VARS[] = {"gen_time", "valid_time", "num_sites", "siteId",
+                                  "XLAT", "XLONG", NULL};
+
+// Functions
+
+//
+// Split a csv line, trimming white space and carriage returns
+//
+static void splitCsv(const string &line, vector<string> &fields)
+{
+  fields.clear();
+
+  size_t start = 0;
+
+  while (true)
+  {
+    size_t pos = line.find(',', start);
+
+    string field = line.substr(start, pos == string::npos ? string::npos : pos - start);
+
+    size_t first = field.find_first_not_of(" \t\r\"");
+
+    size_t last = field.find_last_not_of(" \t\r\"");
+
+    fields.push_back(first == string::npos ? string("") : field.substr(first, last - first + 1));
+
+    if (pos == string::npos)
+    {
+      break;
+    }
+
+    start = pos + 1;
+  }
+}
+
+static bool isGridVar(const char *name)
+{
+  for (int i = 0; GRID_VARS[i] != NULL; i++)
+  {
+    if (strcmp(name, GRID_VARS[i]) == 0)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//
+// Read a text attribute, "" if absent
+//
+static string getTextAtt(const int ncid, const int varId, const char *name)
+{
+  size_t len;
+
+  if (nc_inq_attlen(ncid, varId, name, &len) != NC_NOERR || len == 0)
+  {
+    return string("");
+  }
+
+  vector<char> text(len);
+
+  if (nc_get_att_text(ncid, varId, name, &text[0]) != NC_NOERR)
+  {
+    return string("");
+  }
+
+  return string(&text[0], len);
+}
+
+StatcastBlender::StatcastBlender(const string &confFileParam, const string &mapFileParam,
+                                 const string &siteListFileParam,
+                                 const string &climateZoneFileParam) :
+  confFile(confFileParam), mapFile(mapFileParam), siteListFile(siteListFileParam),
+  climateZoneFile(climateZoneFileParam)
+{
+}
+
+int StatcastBlender::load()
+{
+  if (readConf() || readClimateZones())
+  {
+    return 1;
+  }
+
+  map<string, int> stationIds;
+
+  string readError;
+
+  if (ShadingMask::read_station_ids(siteListFile, stationIds, readError))
+  {
+    error = readError;
+    return 1;
+  }
+
+  rowGridId.clear();
+
+  rowWeight.clear();
+
+  rowOffset.assign(1, 0);
+
+  column.clear();
+
+  idw.clear();
+
+  colSiteId.clear();
+
+  cachedGridIds.clear();
+
+  int ret;
+
+  if (mapFile.size() > 5 && mapFile.compare(mapFile.size() - 5, 5, ".json") == 0)
+  {
+    ret = readMapJson(stationIds);
+  }
+  else
+  {
+    ret = readMapBinary(stationIds);
+  }
+
+  if (ret == 0 && DebugLevel > 0)
+  {
+    Logg->write_time("Info: Compiled blend map %s: %d grid points, %d sites, "
+                     "%d links\n", mapFile.c_str(), (int)rowGridId.size(),
+                     (int)colSiteId.size(), (int)column.size());
+  }
+
+  return ret;
+}
+
+int StatcastBlender::readConf()
+{
+  pt::ptree conf;
+
+  try
+  {
+    pt::read_json(confFile, conf);
+
+    leadWeight.clear();
+
+    for (const pt::ptree::value_type &lead : conf.get_child("lead_time_blending_weights"))
+    {
+      vector<float> weights;
+
+      for (const pt::ptree::value_type &w : lead.second)
+      {
+        weights.push_back(w.second.get_value<float>());
+      }
+
+      if (weights.size() != 2 || fabs(weights[0] + weights[1] - 1) > 1e-4 ||
+          weights[1] < 0 || weights[1] > 1)
+      {
+        error = confFile + ": weights of lead time " + lead.first +
+                " must be two values adding up to 1";
+        return 1;
+      }
+
+      leadWeight[atoi(lead.first.c_str())] = weights[1];
+    }
+
+    ramp.clear();
+
+    for (const pt::ptree::value_type &point : conf.get_child("spatial_blending_weights"))
+    {
+      vector<float> values;
+
+      for (const pt::ptree::value_type &v : point.second)
+      {
+        values.push_back(v.second.get_value<float>());
+      }
+
+      if (values.size() != 2 || values[1] < 0 || values[1] > 1 ||
+          (ramp.size() > 0 && values[0] <= ramp.back().first))
+      {
+        error = confFile + ": spatial blending weights must be [distance, weight] "
+                "pairs with increasing distance and weights between 0 and 1";
+        return 1;
+      }
+
+      ramp.push_back(std::make_pair(values[0], values[1]));
+    }
+  }
+  catch (std::exception &e)
+  {
+    error = confFile + ": " + e.what();
+    return 1;
+  }
+
+  if (leadWeight.size() == 0 || ramp.size() == 0)
+  {
+    error = confFile + ": no lead time or spatial blending weights";
+    return 1;
+  }
+
+  return 0;
+}
+
+int StatcastBlender::readClimateZones()
+{
+  ifstream infile(climateZoneFile.c_str());
+
+  if (!infile.is_open())
+  {
+    error = string("Cannot open climate zone file ") + climateZoneFile;
+    return 1;
+  }
+
+  string line;
+
+  vector<string> fields;
+
+  int idCol = -1;
+
+  int zoneCol = -1;
+
+  if (getline(infile, line))
+  {
+    splitCsv(line, fields);
+
+    for (int c = 0; c < (int)fields.size(); c++)
+    {
+      if (fields[c] == "grid_id")
+      {
+        idCol = c;
+      }
+      else if (fields[c] == "climateZone")
+      {
+        zoneCol = c;
+      }
+    }
+  }
+
+  if (idCol < 0 || zoneCol < 0)
+  {
+    error = string("No grid_id and climateZone columns in ") + climateZoneFile;
+    return 1;
+  }
+
+  climateZone.clear();
+
+  while (getline(infile, line))
+  {
+    splitCsv(line, fields);
+
+    if ((int)fields.size() > idCol && (int)fields.size() > zoneCol &&
+        fields[idCol] != "" && fields[zoneCol] != "")
+    {
+      climateZone[atoi(fields[idCol].c_str())] = atoi(fields[zoneCol].c_str());
+    }
+  }
+
+  return 0;
+}
+
+int StatcastBlender::readMapJson(const map<string, int> &stationIds)
+{
+  pt::ptree gridMap;
+
+  try
+  {
+    pt::read_json(mapFile, gridMap);
+  }
+  catch (std::exception &e)
+  {
+    error = mapFile + ": " + e.what();
+    return 1;
+  }
+
+  //
+  // Rows in grid id order, as the binary map
+  //
+  map<int, const pt::ptree *> rows;
+
+  for (const pt::ptree::value_type &grid : gridMap)
+  {
+    rows[atoi(grid.first.c_str())] = &grid.second;
+  }
+
+  map<int, int> colIndex;
+
+  int numUnknown = 0;
+
+  try
+  {
+    for (map<int, const pt::ptree *>::const_iterator it = rows.begin(); it != rows.end(); ++it)
+    {
+      vector<string> names;
+
+      vector<float> dists;
+
+      for (const pt::ptree::value_type &site : it->second->get_child("ObsSites"))
+      {
+        names.push_back(site.second.get_value<string>());
+      }
+
+      for (const pt::ptree::value_type &dist : it->second->get_child("ObsDistance"))
+      {
+        dists.push_back(dist.second.get_value<float>());
+      }
+
+      if (names.size() != dists.size())
+      {
+        error = mapFile + ": ObsSites and ObsDistance differ in length";
+        return 1;
+      }
+
+      numUnknown += addRow(it->first, names, dists, stationIds, colIndex);
+    }
+  }
+  catch (std::exception &e)
+  {
+    error = mapFile + ": " + e.what();
+    return 1;
+  }
+
+  if (numUnknown > 0)
+  {
+    Logg->write_time("Warning: %d links of %s are to stations not in %s\n",
+                     numUnknown, mapFile.c_str(), siteListFile.c_str());
+  }
+
+  return 0;
+}
+
+int StatcastBlender::readMapBinary(const map<string, int> &stationIds)
+{
+  GridSiteMap gridMap;
+
+  if (gridMap.read(mapFile))
+  {
+    error = gridMap.error();
+    return 1;
+  }
+
+  map<int, int> colIndex;
+
+  int numUnknown = 0;
+
+  vector<string> names;
+
+  vector<float> dists;
+
+  for (int g = 0; g < gridMap.num_grid(); g++)
+  {
+    names.clear();
+
+    dists.clear();
+
+    for (int l = gridMap.row_begin(g); l < gridMap.row_end(g); l++)
+    {
+      names.push_back(gridMap.site_name(gridMap.site(l)));
+
+      dists.push_back(gridMap.dist(l));
+    }
+
+    numUnknown += addRow(gridMap.grid_id(g), names, dists, stationIds, colIndex);
+  }
+
+  if (numUnknown > 0)
+  {
+    Logg->write_time("Warning: %d links of %s are to stations not in %s\n",
+                     numUnknown, mapFile.c_str(), siteListFile.c_str());
+  }
+
+  return 0;
+}
+
+int StatcastBlender::addRow(const int gridId, const vector<string> &names,
+                            const vector<float> &dists,
+                            const map<string, int> &stationIds, map<int, int> &colIndex)
+{
+  int numUnknown = 0;
+
+  int begin = (int)column.size();
+
+  float minDist = -1;
+
+  for (int i = 0; i < (int)names.size(); i++)
+  {
+    map<string, int>::const_iterator st = stationIds.find(names[i]);
+
+    if (st == stationIds.end())
+    {
+      numUnknown++;
+      continue;
+    }
+
+    map<int, int>::iterator col = colIndex.find(st->second);
+
+    if (col == colIndex.end())
+    {
+      col = colIndex.insert(std::make_pair(st->second, (int)colSiteId.size())).first;
+
+      colSiteId.push_back(st->second);
+    }
+
+    column.push_back(col->second);
+
+    //
+    // Unnormalized inverse distance weights for now
+    //
+    idw.push_back(dists[i]);
+
+    if (minDist < 0 || dists[i] < minDist)
+    {
+      minDist = dists[i];
+    }
+  }
+
+  int end = (int)column.size();
+
+  if (end == begin)
+  {
+    return numUnknown;
+  }
+
+  //
+  // Weights proportional to 1 / distance summing to 1. A site at the grid
+  // point takes all the weight.
+  //
+  double sum = 0;
+
+  for (int l = begin; l < end; l++)
+  {
+    idw[l] = (minDist > 0) ? minDist / idw[l] : (idw[l] <= 0 ? 1 : 0);
+
+    sum += idw[l];
+  }
+
+  for (int l = begin; l < end; l++)
+  {
+    idw[l] = (float)(idw[l] / sum);
+  }
+
+  rowGridId.push_back(gridId);
+
+  rowWeight.push_back(spatialWeight(minDist));
+
+  rowOffset.push_back(end);
+
+  return numUnknown;
+}
+
+float StatcastBlender::spatialWeight(const float dist) const
+{
+  if (dist <= ramp[0].first)
+  {
+    return ramp[0].second;
+  }
+
+  for (int i = 1; i < (int)ramp.size(); i++)
+  {
+    if (dist <= ramp[i].first)
+    {
+      float slope = (ramp[i].second - ramp[i-1].second) / (ramp[i].first - ramp[i-1].first);
+
+      return ramp[i-1].second + (dist - ramp[i-1].first) * slope;
+    }
+  }
+
+  return ramp.back().second;
+}
+
+int StatcastBlender::blend(const string &nwpFile, const double genTime,
+                           const vector<int> &siteIds, const vector<double> &validTimes,
+                           const vector<float> &ghi, const float ghiMissing,
+                           Blend &out)
+{
+  int numTimes = (int)validTimes.size();
+
+  if (numTimes == 0 || ghi.size() != siteIds.size() * numTimes)
+  {
+    error = "Forecast is empty or inconsistent";
+    return 1;
+  }
+
+  //
+  // Statcast weight of each lead time
+  //
+  vector<float> timeWeight(numTimes);
+
+  for (int t = 0; t < numTimes; t++)
+  {
+    int lead = (int)lrint(validTimes[t] - genTime);
+
+    map<int, float>::const_iterator it = leadWeight.find(lead);
+
+    if (it == leadWeight.end())
+    {
+      char msg[128];
+
+      snprintf(msg, sizeof(msg), "Lead time %d s is not in ", lead);
+
+      error = string(msg) + confFile;
+      return 1;
+    }
+
+    timeWeight[t] = it->second;
+  }
+
+  NwpGrid grid;
+
+  if (readNwp(nwpFile, grid))
+  {
+    return 1;
+  }
+
+  int numGrid = (int)grid.siteId.size();
+
+  int nwpTimes = (int)grid.validTime.size();
+
+  int ghiVar = -1;
+
+  for (int v = 0; v < (int)grid.vars.size(); v++)
+  {
+    if (grid.vars[v].name == "ghi")
+    {
+      ghiVar = v;
+    }
+  }
+
+  if (ghiVar < 0)
+  {
+    error = nwpFile + ": no ghi variable";
+    return 1;
+  }
+
+  //
+  // NWP time of each forecast time, -1 where the NWP file has none
+  //
+  vector<int> nwpTime(numTimes, -1);
+
+  for (int t = 0; t < numTimes; t++)
+  {
+    for (int n = 0; n < nwpTimes; n++)
+    {
+      if (fabs(grid.validTime[n] - validTimes[t]) < 1)
+      {
+        nwpTime[t] = n;
+        break;
+      }
+    }
+  }
+
+  //
+  // NWP site of each map row, recomputed only when the grid changes
+  //
+  if (grid.siteId != cachedGridIds)
+  {
+    map<int, int> gridIndex;
+
+    for (int g = 0; g < numGrid; g++)
+    {
+      gridIndex[grid.siteId[g]] = g;
+    }
+
+    rowNwpIndex.assign(rowGridId.size(), -1);
+
+    for (int r = 0; r < (int)rowGridId.size(); r++)
+    {
+      map<int, int>::const_iterator it = gridIndex.find(rowGridId[r]);
+
+      if (it != gridIndex.end())
+      {
+        rowNwpIndex[r] = it->second;
+      }
+    }
+
+    cachedGridIds = grid.siteId;
+  }
+
+  //
+  // Forecast site of each column, -1 if the site was not forecast
+  //
+  map<int, int> siteIndex;
+
+  for (int s = 0; s < (int)siteIds.size(); s++)
+  {
+    siteIndex[siteIds[s]] = s;
+  }
+
+  vector<int> colSite(colSiteId.size(), -1);
+
+  for (int c = 0; c < (int)colSiteId.size(); c++)
+  {
+    map<int, int>::const_iterator it = siteIndex.find(colSiteId[c]);
+
+    if (it != siteIndex.end())
+    {
+      colSite[c] = it->second;
+    }
+  }
+
+  //
+  // Start from the NWP GHI at the forecast times, [grid][time]
+  //
+  const vector<float> &nwpGhi = grid.vars[ghiVar].data;
+
+  vector<float> ghiOut((size_t)numGrid * numTimes, BLEND_MISSING);
+
+  for (int g = 0; g < numGrid; g++)
+  {
+    for (int t = 0; t < numTimes; t++)
+    {
+      if (nwpTime[t] >= 0)
+      {
+        ghiOut[(size_t)g * numTimes + t] = nwpGhi[(size_t)g * nwpTimes + nwpTime[t]];
+      }
+    }
+  }
+
+  //
+  // One sparse matrix-vector product per lead time
+  //
+  vector<float> statcast(colSiteId.size());
+
+  for (int t = 0; t < numTimes; t++)
+  {
+    for (int c = 0; c < (int)colSite.size(); c++)
+    {
+      float value = (colSite[c] >= 0) ? ghi[(size_t)colSite[c] * numTimes + t] : ghiMissing;
+
+      if (value == ghiMissing || value < 0 || value > MAX_STATCAST_GHI)
+      {
+        value = BLEND_MISSING;
+      }
+
+      statcast[c] = value;
+    }
+
+    for (int r = 0; r < (int)rowGridId.size(); r++)
+    {
+      if (rowNwpIndex[r] < 0)
+      {
+        continue;
+      }
+
+      double sum = 0;
+
+      bool missing = false;
+
+      for (int l = rowOffset[r]; l < rowOffset[r+1]; l++)
+      {
+        if (statcast[column[l]] == BLEND_MISSING)
+        {
+          missing = true;
+          break;
+        }
+
+        sum += idw[l] * statcast[column[l]];
+      }
+
+      if (missing)
+      {
+        continue;
+      }
+
+      float &out = ghiOut[(size_t)rowNwpIndex[r] * numTimes + t];
+
+      float w = timeWeight[t] * rowWeight[r];
+
+      out = (out == BLEND_MISSING) ? (float)sum : (float)((1 - w) * out + w * sum);
+    }
+  }
+
+  //
+  // Output in grid id order, outside New York missing
+  //
+  vector<int> order(numGrid);
+
+  for (int g = 0; g < numGrid; g++)
+  {
+    order[g] = g;
+  }
+
+  std::stable_sort(order.begin(), order.end(),
+                   [&grid](int a, int b) { return grid.siteId[a] < grid.siteId[b]; });
+
+  vector<int> zones(numGrid, OUTSIDE_ZONE);
+
+  for (int g = 0; g < numGrid; g++)
+  {
+    map<int, int>::const_iterator it = climateZone.find(grid.siteId[g]);
+
+    if (it != climateZone.end())
+    {
+      zones[g] = it->second;
+    }
+
+    if (zones[g] == OUTSIDE_ZONE)
+    {
+      for (int t = 0; t < numTimes; t++)
+      {
+        ghiOut[(size_t)g * numTimes + t] = BLEND_MISSING;
+      }
+    }
+  }
+
+  //
+  // Other variables at the forecast times
+  //
+  vector<vector<float> > varsOut(grid.vars.size());
+
+  for (int v = 0; v < (int)grid.vars.size(); v++)
+  {
+    if (v == ghiVar)
+    {
+      continue;
+    }
+
+    varsOut[v].assign((size_t)numGrid * numTimes, BLEND_MISSING);
+
+    for (int g = 0; g < numGrid; g++)
+    {
+      for (int t = 0; t < numTimes; t++)
+      {
+        if (nwpTime[t] >= 0)
+        {
+          varsOut[v][(size_t)g * numTimes + t] =
+            grid.vars[v].data[(size_t)g * nwpTimes + nwpTime[t]];
+        }
+      }
+    }
+  }
+
+  varsOut[ghiVar].swap(ghiOut);
+
+  //
+  // Grid points in output order
+  //
+  out.genTime = genTime;
+
+  out.validTimes = validTimes;
+
+  out.gridId.resize(numGrid);
+
+  out.lat.resize(numGrid);
+
+  out.lon.resize(numGrid);
+
+  out.climateZone.resize(numGrid);
+
+  for (int i = 0; i < numGrid; i++)
+  {
+    out.gridId[i] = grid.siteId[order[i]];
+
+    out.lat[i] = grid.lat[order[i]];
+
+    out.lon[i] = grid.lon[order[i]];
+
+    out.climateZone[i] = zones[order[i]];
+  }
+
+  out.vars.resize(grid.vars.size());
+
+  for (int v = 0; v < (int)grid.vars.size(); v++)
+  {
+    out.vars[v].name = grid.vars[v].name;
+
+    out.vars[v].longName = grid.vars[v].longName;
+
+    out.vars[v].units = grid.vars[v].units;
+
+    out.vars[v].data.resize((size_t)numGrid * numTimes);
+
+    for (int i = 0; i < numGrid; i++)
+    {
+      std::copy(varsOut[v].begin() + (size_t)order[i] * numTimes,
+                varsOut[v].begin() + (size_t)(order[i] + 1) * numTimes,
+                out.vars[v].data.begin() + (size_t)i * numTimes);
+    }
+  }
+
+  return 0;
+}
+
+int StatcastBlender::readNwp(const string &nwpFile, NwpGrid &grid)
+{
+  int ncid;
+
+  int ret = nc_open(nwpFile.c_str(), NC_NOWRITE, &ncid);
+
+  if (ret != NC_NOERR)
+  {
+    error = string("Cannot open ") + nwpFile + ": " + nc_strerror(ret);
+    return 1;
+  }
+
+  int siteDim, timeDim;
+
+  size_t numGrid = 0, numTimes = 0;
+
+  int siteVar, timeVar, latVar, lonVar;
+
+  ret = nc_inq_dimid(ncid, "max_site_num", &siteDim);
+
+  if (ret == NC_NOERR)
+    ret = nc_inq_dimid(ncid, "fcst_times", &timeDim);
+
+  if (ret == NC_NOERR)
+    ret = nc_inq_dimlen(ncid, siteDim, &numGrid);
+
+  if (ret == NC_NOERR)
+    ret = nc_inq_dimlen(ncid, timeDim, &numTimes);
+
+  if (ret == NC_NOERR)
+    ret = nc_inq_varid(ncid, "siteId", &siteVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_inq_varid(ncid, "valid_time", &timeVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_inq_varid(ncid, "XLAT", &latVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_inq_varid(ncid, "XLONG", &lonVar);
+
+  grid.siteId.resize(numGrid);
+
+  grid.validTime.resize(numTimes);
+
+  grid.lat.resize(numGrid);
+
+  grid.lon.resize(numGrid);
+
+  if (ret == NC_NOERR && numGrid > 0)
+    ret = nc_get_var_int(ncid, siteVar, &grid.siteId[0]);
+
+  if (ret == NC_NOERR && numTimes > 0)
+    ret = nc_get_var_double(ncid, timeVar, &grid.validTime[0]);
+
+  if (ret == NC_NOERR && numGrid > 0)
+    ret = nc_get_var_float(ncid, latVar, &grid.lat[0]);
+
+  if (ret == NC_NOERR && numGrid > 0)
+    ret = nc_get_var_float(ncid, lonVar, &grid.lon[0]);
+
+  //
+  // Every other float [site][time] variable: ghi and those passed through
+  //
+  int numVars = 0;
+
+  if (ret == NC_NOERR)
+    ret = nc_inq_nvars(ncid, &numVars);
+
+  for (int v = 0; v < numVars && ret == NC_NOERR; v++)
+  {
+    char name[NC_MAX_NAME + 1];
+
+    nc_type type;
+
+    int numDims;
+
+    int dims[NC_MAX_VAR_DIMS];
+
+    ret = nc_inq_var(ncid, v, name, &type, &numDims, dims, NULL);
+
+    if (ret != NC_NOERR || isGridVar(name) || type != NC_FLOAT || numDims != 2 ||
+        dims[0] != siteDim || dims[1] != timeDim)
+    {
+      continue;
+    }
+
+    GridVar var;
+
+    var.name = name;
+
+    var.longName = getTextAtt(ncid, v, "long_name");
+
+    var.units = getTextAtt(ncid, v, "units");
+
+    var.data.resize(numGrid * numTimes);
+
+    if (var.data.size() > 0)
+      ret = nc_get_var_float(ncid, v, &var.data[0]);
+
+    float fill = NC_FILL_FLOAT;
+
+    nc_get_att_float(ncid, v, "_FillValue", &fill);
+
+    for (size_t i = 0; i < var.data.size(); i++)
+    {
+      float value = var.data[i];
+
+      if (value == fill || value == NC_FILL_FLOAT || value == BLEND_MISSING || isnan(value))
+      {
+        var.data[i] = BLEND_MISSING;
+      }
+    }
+
+    grid.vars.push_back(var);
+  }
+
+  if (ret != NC_NOERR)
+  {
+    error = string("Cannot read ") + nwpFile + ": " + nc_strerror(ret);
+    nc_close(ncid);
+    return 1;
+  }
+
+  nc_close(ncid);
+
+  return 0;
+}
+
+int StatcastBlender::write(const Blend &blend, const string &outputFile,
+                           string &writeError)
+{
+  int numGrid = (int)blend.gridId.size();
+
+  int numTimes = (int)blend.validTimes.size();
+
+  string tmpPath = outputFile + ".tmp";
+
+  std::lock_guard<std::mutex> lock(netcdf_lock());
+
+  int ncid;
+
+  int ret = nc_create(tmpPath.c_str(), NC_CLOBBER, &ncid);
+
+  if (ret != NC_NOERR)
+  {
+    writeError = string("Cannot create ") + tmpPath + ": " + nc_strerror(ret);
+    return 1;
+  }
+
+  int siteDim, timeDim, nameDim;
+
+  int genVar, timeVar, numVar, idVar, latVar, lonVar, zoneVar;
+
+  vector<int> varIds(blend.vars.size(), -1);
+
+  float fill = BLEND_MISSING;
+
+  int zoneFill = OUTSIDE_ZONE;
+
+  ret = nc_def_dim(ncid, "max_site_num", numGrid, &siteDim);
+
+  if (ret == NC_NOERR)
+    ret = nc_def_dim(ncid, "fcst_times", numTimes, &timeDim);
+
+  if (ret == NC_NOERR)
+    ret = nc_def_dim(ncid, "name_strlen", NAME_STRLEN, &nameDim);
+
+  if (ret == NC_NOERR)
+    ret = nc_def_var(ncid, "gen_time", NC_DOUBLE, 0, NULL, &genVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_att_text(ncid, genVar, "long_name", strlen("Generation time of fcst"),
+                          "Generation time of fcst");
+
+  if (ret == NC_NOERR)
+    ret = nc_put_att_text(ncid, genVar, "units", strlen("seconds since 1970-1-1 00:00:00"),
+                          "seconds since 1970-1-1 00:00:00");
+
+  if (ret == NC_NOERR)
+    ret = nc_def_var(ncid, "valid_time", NC_DOUBLE, 1, &timeDim, &timeVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_att_text(ncid, timeVar, "long_name", strlen("valid time of forecast"),
+                          "valid time of forecast");
+
+  if (ret == NC_NOERR)
+    ret = nc_put_att_text(ncid, timeVar, "units", strlen("seconds since 1970-1-1 00:00:00"),
+                          "seconds since 1970-1-1 00:00:00");
+
+  if (ret == NC_NOERR)
+    ret = nc_def_var(ncid, "num_sites", NC_INT, 0, NULL, &numVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_def_var(ncid, "siteId", NC_INT, 1, &siteDim, &idVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_att_text(ncid, idVar, "long_name", strlen("station Id"), "station Id");
+
+  if (ret == NC_NOERR)
+    ret = nc_def_var(ncid, "XLAT", NC_FLOAT, 1, &siteDim, &latVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_def_var(ncid, "XLONG", NC_FLOAT, 1, &siteDim, &lonVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_def_var(ncid, "ClimateZone", NC_INT, 1, &siteDim, &zoneVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_att_int(ncid, zoneVar, "_FillValue", NC_INT, 1, &zoneFill);
+
+  int dataDims[2] = {siteDim, timeDim};
+
+  for (int v = 0; v < (int)blend.vars.size() && ret == NC_NOERR; v++)
+  {
+    const GridVar &var = blend.vars[v];
+
+    ret = nc_def_var(ncid, var.name.c_str(), NC_FLOAT, 2, dataDims, &varIds[v]);
+
+    if (ret == NC_NOERR)
+      ret = nc_put_att_float(ncid, varIds[v], "_FillValue", NC_FLOAT, 1, &fill);
+
+    if (ret == NC_NOERR && var.longName != "")
+      ret = nc_put_att_text(ncid, varIds[v], "long_name", var.longName.size(),
+                            var.longName.c_str());
+
+    if (ret == NC_NOERR && var.units != "")
+      ret = nc_put_att_text(ncid, varIds[v], "units", var.units.size(), var.units.c_str());
+  }
+
+  if (ret == NC_NOERR)
+    ret = nc_enddef(ncid);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_var_double(ncid, genVar, &blend.genTime);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_var_double(ncid, timeVar, &blend.validTimes[0]);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_var_int(ncid, numVar, &numGrid);
+
+  if (ret == NC_NOERR && numGrid > 0)
+    ret = nc_put_var_int(ncid, idVar, &blend.gridId[0]);
+
+  if (ret == NC_NOERR && numGrid > 0)
+    ret = nc_put_var_float(ncid, latVar, &blend.lat[0]);
+
+  if (ret == NC_NOERR && numGrid > 0)
+    ret = nc_put_var_float(ncid, lonVar, &blend.lon[0]);
+
+  if (ret == NC_NOERR && numGrid > 0)
+    ret = nc_put_var_int(ncid, zoneVar, &blend.climateZone[0]);
+
+  for (int v = 0; v < (int)blend.vars.size() && ret == NC_NOERR && numGrid > 0 &&
+                  numTimes > 0; v++)
+  {
+    ret = nc_put_var_float(ncid, varIds[v], &blend.vars[v].data[0]);
+  }
+
+  int closeRet = nc_close(ncid);
+
+  if (ret == NC_NOERR)
+  {
+    ret = closeRet;
+  }
+
+  if (ret != NC_NOERR || rename(tmpPath.c_str(), outputFile.c_str()) != 0)
+  {
+    writeError = string("Cannot write ") + outputFile + ": " +
+            (ret != NC_NOERR ? nc_strerror(ret) : strerror(errno));
+    remove(tmpPath.c_str());
+    return 1;
+  }
+
+  return 0;
+}
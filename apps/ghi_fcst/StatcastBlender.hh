@@ -0,0 +1,250 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: StatcastBlender.hh,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/09/20 10:00:00 $
+//
+//==============================================================================
+
+/**
+ *
+ *  @file StatcastBlender.hh
+ *  @class StatcastBlender
+ *  @brief Blends the ghi_fcst site forecasts into the gridded NWP GHI
+ *         forecast, replacing NWP_Statcast_blender.py. The grid point to
+ *         site map is compiled once into a compressed sparse row matrix of
+ *         inverse distance weights, with the spatial (distance ramp) weight
+ *         of each grid point computed at load. Each forecast is then one
+ *         sparse matrix-vector product per lead time:
+ *
+ *           statcast = sum over the sites of a grid point of idw * ghi
+ *           w = leadWeight(lead) * spatialWeight(nearest site distance)
+ *           blend = (1 - w) * nwp + w * statcast
+ *
+ *         Where the NWP value is missing the statcast value is used, where
+ *         the statcast value is missing (a site without a forecast) the NWP
+ *         value is kept. Grid points outside New York (climate zone -9) are
+ *         missing. The output is the NWP_statcast_blend netCDF file read by
+ *         pct_power_fcst's BlendedModelReader.
+ *  @date 09/20/2021
+ */
+
+#ifndef STATCAST_BLENDER_HH
+#define STATCAST_BLENDER_HH
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+class StatcastBlender
+{
+public:
+
+  /**
+   * Missing value of the blended output, as written by the python blender
+   */
+  const static float BLEND_MISSING;
+
+  /**
+   * Float variable of the NWP grid file, [site][time]
+   */
+  struct GridVar
+  {
+    string name;
+    string longName;
+    string units;
+    vector<float> data;
+  };
+
+  /**
+   * A blended forecast as written to the blend file: grid points in grid
+   * id order and [grid][time] variables, ghi blended and the others
+   * passed through from the NWP file
+   */
+  struct Blend
+  {
+    double genTime;
+    vector<double> validTimes;
+    vector<int> gridId;
+    vector<float> lat;
+    vector<float> lon;
+    vector<int> climateZone;
+    vector<GridVar> vars;
+
+    /**
+     * Data of a variable, NULL if the blend does not have it
+     */
+    const vector<float> *find(const string &name) const
+    {
+      for (size_t v = 0; v < vars.size(); v++)
+      {
+        if (vars[v].name == name)
+        {
+          return &vars[v].data;
+        }
+      }
+      return NULL;
+    }
+  };
+
+  /**
+   * Constructor
+   * @param[in] confFile  Blend configuration json with
+   *                      "lead_time_blending_weights" {lead secs: [nwp,
+   *                      statcast]} and "spatial_blending_weights"
+   *                      [[km, weight], ...], e.g.
+   *                      NWP_Statcast_blend_conf_40km.json
+   * @param[in] mapFile  Grid point to site map, either json as
+   *                     grid_site_map_40km.json or a binary grid site map
+   *                     written by make_grid_site_map
+   * @param[in] siteListFile  Csv with "stid" and "int_id" columns mapping
+   *                          the map's station names to forecast site ids
+   * @param[in] climateZoneFile  Csv with "grid_id" and "climateZone" columns
+   */
+  StatcastBlender(const string &confFile, const string &mapFile,
+                  const string &siteListFile, const string &climateZoneFile);
+
+  /**
+   * Read the configuration, site list and climate zones and compile the map
+   * @return 1 for failure, 0 for success
+   */
+  int load();
+
+  /**
+   * Blend a forecast into an NWP grid file
+   * @param[in] nwpFile  Gridded NWP forecast, e.g. wrf_hrrr_blend.*.nc
+   * @param[in] genTime  Forecast generation time
+   * @param[in] siteIds  Forecast site ids
+   * @param[in] validTimes  Forecast valid times
+   * @param[in] ghi  Forecast GHI, site major ([site][time])
+   * @param[in] ghiMissing  Missing value of ghi
+   * @param[out] out  Blended forecast
+   * @return 1 for failure, 0 for success
+   */
+  int blend(const string &nwpFile, const double genTime, const vector<int> &siteIds,
+            const vector<double> &validTimes, const vector<float> &ghi,
+            const float ghiMissing, Blend &out);
+
+  /**
+   * Write a blended forecast to a netCDF file. Only reads the blender's
+   * state, so a blend may be written in another thread.
+   * @param[in] blend  Blended forecast
+   * @param[in] outputFile  Blended netCDF file to write
+   * @param[out] writeError  Error message on failure
+   * @return 1 for failure, 0 for success
+   */
+  static int write(const Blend &blend, const string &outputFile, string &writeError);
+
+  /**
+   * Error message of the last failure
+   */
+  const string &getError() const { return error; }
+
+private:
+
+  /**
+   * Contents of an NWP grid file, missing values set to BLEND_MISSING
+   */
+  struct NwpGrid
+  {
+    vector<int> siteId;
+    vector<double> validTime;
+    vector<float> lat;
+    vector<float> lon;
+    vector<GridVar> vars;
+  };
+
+  string confFile;
+
+  string mapFile;
+
+  string siteListFile;
+
+  string climateZoneFile;
+
+  string error;
+
+  /**
+   * Statcast weight of each lead time, seconds
+   */
+  map<int, float> leadWeight;
+
+  /**
+   * Spatial weight ramp, (km, weight) with increasing distance
+   */
+  vector<pair<float, float> > ramp;
+
+  /**
+   * Compiled map: row r is grid point rowGridId[r] with spatial weight
+   * rowWeight[r] and links rowOffset[r] .. rowOffset[r+1]-1 into column
+   * (index into colSiteId) and idw (inverse distance weights summing to 1)
+   */
+  vector<int> rowGridId;
+
+  vector<float> rowWeight;
+
+  vector<int> rowOffset;
+
+  vector<int> column;
+
+  vector<float> idw;
+
+  /**
+   * Forecast site id of each column
+   */
+  vector<int> colSiteId;
+
+  /**
+   * Climate zone of each grid id
+   */
+  map<int, int> climateZone;
+
+  /**
+   * Grid ids of the last NWP file and the NWP site index of each row,
+   * -1 if the grid point is not in the file. Kept while the grid does
+   * not change.
+   */
+  vector<int> cachedGridIds;
+
+  vector<int> rowNwpIndex;
+
+  int readConf();
+
+  int readClimateZones();
+
+  /**
+   * Compile the map from station names and distances of each grid point
+   */
+  int readMapJson(const map<string, int> &stationIds);
+
+  int readMapBinary(const map<string, int> &stationIds);
+
+  /**
+   * Add a row to the compiled map
+   * @param[in] gridId  Grid id
+   * @param[in] names  Station names of the sites of the grid point
+   * @param[in] dists  Distances of the sites, km
+   * @param[in] stationIds  Site id of each station name
+   * @param[in] colIndex  Column of each site id, extended as needed
+   * @return Number of stations without a site id
+   */
+  int addRow(const int gridId, const vector<string> &names, const vector<float> &dists,
+             const map<string, int> &stationIds, map<int, int> &colIndex);
+
+  /**
+   * Spatial weight at a distance: linear in the ramp, constant beyond it
+   */
+  float spatialWeight(const float dist) const;
+
+  int readNwp(const string &nwpFile, NwpGrid &grid);
+};
+
+#endif /* STATCAST_BLENDER_HH */
@@ -0,0 +1,108 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: TaskPool.cc,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/09/13 10:00:00 $
+//
+//==============================================================================
+
+/**
+ * @file TaskPool.cc
+ * @brief Source for TaskPool class
+ */
+
+// Include files
+
+#include <atomic>
+#include <thread>
+#include "TaskPool.hh"
+
+TaskPool::TaskPool(const int numThreadsParam) :
+  numThreads(numThreadsParam), threadsUsed(0)
+{
+}
+
+void TaskPool::add(const string &name, const Task &task)
+{
+  names.push_back(name);
+
+  tasks.push_back(task);
+}
+
+int TaskPool::run()
+{
+  int numTasks = (int)tasks.size();
+
+  threadsUsed = numThreads;
+
+  if (threadsUsed <= 0)
+  {
+    threadsUsed = (int)std::thread::hardware_concurrency();
+  }
+
+  if (threadsUsed <= 0 || threadsUsed > numTasks)
+  {
+    threadsUsed = numTasks;
+  }
+
+  //
+  // Each task writes only its own result slot
+  //
+  vector<string> results(numTasks);
+
+  std::atomic<int> nextTask(0);
+
+  auto worker = [&]()
+  {
+    int t;
+
+    while ((t = nextTask++) < numTasks)
+    {
+      try
+      {
+        results[t] = tasks[t]();
+      }
+      catch (std::exception &e)
+      {
+        results[t] = string("exception: ") + e.what();
+      }
+    }
+  };
+
+  if (threadsUsed == 1)
+  {
+    worker();
+  }
+  else
+  {
+    vector<std::thread> threads;
+
+    for (int i = 0; i < threadsUsed; i++)
+    {
+      threads.push_back(std::thread(worker));
+    }
+
+    for (int i = 0; i < (int)threads.size(); i++)
+    {
+      threads[i].join();
+    }
+  }
+
+  errors.clear();
+
+  for (int t = 0; t < numTasks; t++)
+  {
+    if (results[t] != "")
+    {
+      errors.push_back(names[t] + ": " + results[t]);
+    }
+  }
+
+  names.clear();
+
+  tasks.clear();
+
+  return (int)errors.size();
+}
@@ -0,0 +1,87 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: TaskPool.hh,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/09/13 10:00:00 $
+//
+//==============================================================================
+
+/**
+ *
+ *  @file TaskPool.hh
+ *  @class TaskPool
+ *  @brief Runs independent startup tasks (file parsing, model loading) on a
+ *         fixed number of threads. Tasks are started in the order they were
+ *         added. Each task returns an error message, empty for success, and
+ *         the messages are kept in task order so that all failures can be
+ *         reported together. Tasks store their results in slots of their
+ *         own, so callers consume them in a deterministic order.
+ *  @date 09/13/2021
+ */
+
+#ifndef TASK_POOL_HH
+#define TASK_POOL_HH
+
+#include <functional>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+class TaskPool
+{
+public:
+
+  /**
+   * A task, returning an error message or "" for success
+   */
+  typedef std::function<string ()> Task;
+
+  /**
+   * Constructor
+   * @param[in] numThreads  Number of threads, 0 for one per processor.
+   *                        Never more threads than tasks are started.
+   */
+  TaskPool(const int numThreads);
+
+  /**
+   * Add a task
+   * @param[in] name  Task name used in error messages, e.g. the file path
+   * @param[in] task  Task to run
+   */
+  void add(const string &name, const Task &task);
+
+  /**
+   * Run all tasks added since the last run and wait for them
+   * @return Number of failed tasks
+   */
+  int run();
+
+  /**
+   * Error messages of the failed tasks of the last run, in task order,
+   * each prefixed by the task name
+   */
+  const vector<string> &getErrors() const { return errors; }
+
+  /**
+   * Number of threads used by the last run
+   */
+  int getThreadsUsed() const { return threadsUsed; }
+
+private:
+
+  int numThreads;
+
+  int threadsUsed;
+
+  vector<string> names;
+
+  vector<Task> tasks;
+
+  vector<string> errors;
+};
+
+#endif /* TASK_POOL_HH */
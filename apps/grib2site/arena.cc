@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <string.h>
+#include "log/log.hh"
+#include "emalloc.h"
+#include "arena.h"
+
+extern Log *logFile;
+
+/* Allocations are aligned to this many bytes */
+#define ARENA_ALIGN 16
+
+/* Size of the arena before the first message is seen */
+#define ARENA_INITIAL_SIZE (1 << 20)
+
+/*
+ * Memory that did not fit in the arena is taken from the heap in overflow
+ * blocks until the next reset.
+ */
+typedef struct overflow {
+    struct overflow *next;
+    size_t size;
+    double align[1];		/* start of the block, aligned */
+} overflow;
+
+static char *base;		/* the arena */
+static size_t arena_size;
+static size_t used;		/* bytes handed out from the arena */
+static size_t spilled;		/* bytes handed out from overflow blocks */
+static overflow *spill;		/* overflow blocks */
+
+
+/*
+ * Returns size bytes from the arena, or from an overflow block if the
+ * arena is full. Exits, as emalloc() does, if memory runs out.
+ */
+void *
+arena_alloc (size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+
+    if (!base) {
+	arena_size = ARENA_INITIAL_SIZE;
+	base = (char *) emalloc(arena_size);
+    }
+
+    if (used + size <= arena_size) {
+	void *p = base + used;
+	used += size;
+	return p;
+    }
+
+    overflow *op = (overflow *) emalloc(offsetof(overflow, align) + size);
+    op->size = size;
+    op->next = spill;
+    spill = op;
+    spilled += size;
+    return op->align;
+}
+
+
+void *
+arena_calloc (size_t size)
+{
+    return memset(arena_alloc(size), 0, size);
+}
+
+
+char *
+arena_strdup (const char *str)
+{
+    return strcpy((char *) arena_alloc(strlen(str) + 1), str);
+}
+
+
+/*
+ * Returns 1 if ptr was handed out by arena_alloc() since the last reset.
+ */
+int
+arena_owns (const void *ptr)
+{
+    const char *p = (const char *) ptr;
+
+    if (base && p >= base && p < base + arena_size)
+	return 1;
+    for (overflow *op = spill; op; op = op->next)
+	if (p >= (const char *) op->align && p < (const char *) op->align + op->size)
+	    return 1;
+    return 0;
+}
+
+
+/*
+ * Frees heap memory; arena memory is left for arena_reset(). This lets
+ * the free functions of the decoded structures take either.
+ */
+void
+arena_free (void *ptr)
+{
+    if (ptr && !arena_owns(ptr))
+	free(ptr);
+}
+
+
+/*
+ * Releases everything allocated since the last reset. If the arena
+ * overflowed, it is replaced by one large enough for all of it.
+ */
+void
+arena_reset (void)
+{
+    size_t high = used + spilled;
+
+    while (spill) {
+	overflow *op = spill;
+	spill = op->next;
+	free(op);
+    }
+
+    if (high > arena_size) {
+	free(base);
+	arena_size = high + high / 8;
+	base = (char *) emalloc(arena_size);
+	logFile->write_time(2, "Info: message arena grown to %lu bytes\n",
+			    (unsigned long) arena_size);
+    }
+
+    used = 0;
+    spilled = 0;
+}
+
+
+void
+arena_release (void)
+{
+    arena_reset();
+    free(base);
+    base = 0;
+    arena_size = 0;
+}
@@ -0,0 +1,24 @@
+/*
+ * Arena for the memory of the GRIB message being decoded: the product_data
+ * of its fields and everything hanging off them (header, grid description,
+ * byte map, binary data parameters, unpacked grids) and the site values
+ * written from them. Allocation is a pointer bump. arena_reset(), called
+ * before each message, releases all of it at once and grows the arena to
+ * the high-water mark, so that once the largest message has been seen no
+ * further heap allocation is made.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+void *arena_alloc(size_t size);
+void *arena_calloc(size_t size);
+char *arena_strdup(const char *str);
+int arena_owns(const void *ptr);
+void arena_free(void *ptr);
+void arena_reset(void);
+void arena_release(void);
+
+#endif
@@ -0,0 +1,561 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <netcdf.h>
+#include "log/log.hh"
+#include "emalloc.h"
+#include "ncfloat.h"
+#include "stats.h"
+#include "derived.h"
+
+extern Log *logFile;
+
+#ifndef FILL_NAME
+#define FILL_NAME	"_FillValue"
+#endif
+
+#define RAD2DEG 57.29577951f
+
+
+//
+// Kernels. Each is a plain loop over the sites so that the compiler can
+// vectorize it; NaN inputs give NaN outputs.
+//
+
+// Wind speed (m/s) from the u and v components
+static void wind_speed(int n, float **in, float *out)
+{
+  const float *u = in[0], *v = in[1];
+
+  for (int i=0; i<n; i++)
+    out[i] = sqrtf(u[i]*u[i] + v[i]*v[i]);
+}
+
+
+// Direction the wind blows from (degrees clockwise from north, 0 if calm)
+// from the earth relative u and v components
+static void wind_dir(int n, float **in, float *out)
+{
+  const float *u = in[0], *v = in[1];
+
+  for (int i=0; i<n; i++)
+    {
+      float dir = 270.f - RAD2DEG * atan2f(v[i], u[i]);
+      if (dir >= 360.f)
+	dir -= 360.f;
+      out[i] = (u[i] == 0.f && v[i] == 0.f ? 0.f : dir);
+    }
+}
+
+
+// Relative humidity (percent, at most 100) from temperature (K), specific
+// humidity (kg/kg) and pressure (Pa), with Bolton's saturation vapor
+// pressure over water
+static void rel_humidity(int n, float **in, float *out)
+{
+  const float *t = in[0], *q = in[1], *p = in[2];
+
+  for (int i=0; i<n; i++)
+    {
+      float e = q[i] * p[i] / (0.622f + 0.378f * q[i]);
+      float es = 611.2f * expf(17.67f * (t[i] - 273.15f) / (t[i] - 29.65f));
+      float rh = 100.f * e / es;
+      out[i] = (rh > 100.f ? 100.f : (rh < 0.f ? 0.f : rh));
+    }
+}
+
+
+// Clearness index from the surface and top of atmosphere downward short
+// wave fluxes, missing at night
+static void clearness_index(int n, float **in, float *out)
+{
+  const float *sfc = in[0], *toa = in[1];
+
+  for (int i=0; i<n; i++)
+    out[i] = (toa[i] > 0.f ? sfc[i] / toa[i] : NAN);
+}
+
+
+//
+// The kernels a derive attribute may name. A new kernel only needs an
+// entry here. Wind speed does not depend on the direction of the axes, so
+// its components are not rotated.
+//
+static const derive_def derive_defs[] = {
+  { "wind_speed", 2, "m/s", wind_speed, 0 },
+  { "wind_dir", 2, "degree", wind_dir, 1 },
+  { "rh", 3, "percent", rel_humidity, 0 },
+  { "clearness_index", 2, "1", clearness_index, 0 },
+};
+
+
+static const derive_def *find_derive_def(const char *name)
+{
+  int n = sizeof(derive_defs)/sizeof(*derive_defs);
+
+  for (int i=0; i<n; i++)
+    if (strcmp(derive_defs[i].name, name) == 0)
+      return(&derive_defs[i]);
+  return(0);
+}
+
+
+//
+// Trims blanks from both ends of a string, in place
+//
+static char *trim(char *s)
+{
+  char *e;
+
+  while (*s == ' ' || *s == '\t')
+    s++;
+  e = s + strlen(s);
+  while (e > s && (e[-1] == ' ' || e[-1] == '\t'))
+    *--e = '\0';
+  return(s);
+}
+
+
+//
+// Sets up a derived variable from its formula, "kernel(input, ...)".
+// Returns 0 on success, -1 on failure.
+//
+static int make_derived_var(ncfile *nc, ncvar *var, char *formula,
+			    derived_var *dv)
+{
+  char *open = strchr(formula, '(');
+  char *close = strrchr(formula, ')');
+  char *arg, *next;
+  int ninputs = 0;
+
+  if (!open || !close || close < open || *trim(close + 1) != '\0')
+    {
+      logFile->write_time("Error: %s:%s \"%s\" is not of the form kernel(input, ...)\n",
+			  var->name, DERIVE_NAME, formula);
+      return(-1);
+    }
+  *open = *close = '\0';
+
+  dv->def = find_derive_def(trim(formula));
+  if (!dv->def)
+    {
+      logFile->write_time("Error: %s:%s: no kernel %s\n", var->name, DERIVE_NAME,
+			  trim(formula));
+      return(-1);
+    }
+
+  for (arg = open + 1; arg; arg = next)
+    {
+      int varid;
+
+      if ((next = strchr(arg, ',')) != 0)
+	*next++ = '\0';
+      arg = trim(arg);
+
+      if (ninputs == dv->def->ninputs)
+	{
+	  ninputs++;
+	  break;
+	}
+      if (nc_inq_varid(nc->ncid, arg, &varid) != NC_NOERR || !nc->vars[varid] ||
+	  varid == var->id)
+	{
+	  logFile->write_time("Error: %s:%s: no input variable %s\n",
+			      var->name, DERIVE_NAME, arg);
+	  return(-1);
+	}
+
+      ncvar *in = nc->vars[varid];
+      if (in->ndims != var->ndims ||
+	  memcmp(in->dims, var->dims, var->ndims * sizeof(int)) != 0)
+	{
+	  logFile->write_time("Error: %s:%s: input %s does not have the dimensions of %s\n",
+			      var->name, DERIVE_NAME, arg, var->name);
+	  return(-1);
+	}
+      dv->inputs[ninputs++] = varid;
+    }
+
+  if (ninputs != dv->def->ninputs)
+    {
+      logFile->write_time("Error: %s:%s: %s takes %d inputs\n", var->name,
+			  DERIVE_NAME, dv->def->name, dv->def->ninputs);
+      return(-1);
+    }
+
+  if (var->ndims > MAX_DERIVE_DIMS || var->dims[0] != nc->recid)
+    {
+      logFile->write_time("Error: %s: a derived variable needs the record dimension "
+			  "and at most %d dimensions\n", var->name, MAX_DERIVE_DIMS);
+      return(-1);
+    }
+
+  // Units conversion from the kernel's units to the variable's
+  dv->slope = 1.0;
+  dv->intercept = 0.0;
+  if (var->bunitp)
+    {
+      utUnit kunit;
+
+      memset(&kunit, 0, sizeof(utUnit));
+      if (utScan((char *) dv->def->units, &kunit) != 0 ||
+	  utConvert(&kunit, var->bunitp, &dv->slope, &dv->intercept) != 0)
+	{
+	  logFile->write_time("Error: %s: units of %s (%s) not conformable with %s:units\n",
+			      var->name, dv->def->name, dv->def->units, var->name);
+	  utFree(&kunit);
+	  return(-1);
+	}
+      utFree(&kunit);
+    }
+
+  if (nc_get_att_float(nc->ncid, var->id, FILL_NAME, &dv->fillval) != NC_NOERR)
+    dv->fillval = NC_FILL_FLOAT;
+
+  dv->varid = var->id;
+  dv->name = estrdup(var->name);
+  dv->ndims = var->ndims;
+
+  return(0);
+}
+
+
+//
+// Sets up nc->derived from the derive attributes of the variables of the
+// output file. Returns 0 on success, -1 on failure.
+//
+int make_derived_vars(ncfile *nc)
+{
+  char formula[NC_MAX_NAME * (MAX_DERIVE_INPUTS + 1)];
+  nc_type atttype;
+  size_t attlen;
+
+  nc->derived = 0;
+
+  for (int varid = nc->nvars - 1; varid >= 0; varid--)
+    {
+      ncvar *var = nc->vars[varid];
+
+      if (!var || nc_inq_att(nc->ncid, varid, DERIVE_NAME, &atttype, &attlen) != NC_NOERR)
+	continue;
+
+      if (atttype != NC_CHAR || attlen + 1 > sizeof(formula) ||
+	  nc_get_att_text(nc->ncid, varid, DERIVE_NAME, formula) != NC_NOERR)
+	{
+	  logFile->write_time("Error: %s:%s is not a text attribute\n", var->name,
+			      DERIVE_NAME);
+	  return(-1);
+	}
+      formula[attlen] = '\0';
+
+      derived_var *dv = (derived_var *) emalloc(sizeof(derived_var));
+      memset(dv, 0, sizeof(derived_var));
+      if (make_derived_var(nc, var, formula, dv) != 0)
+	{
+	  free(dv);
+	  return(-1);
+	}
+
+      dv->next = nc->derived;
+      nc->derived = dv;
+
+      logFile->write_time(1, "Info: %s is derived by %s\n", dv->name, dv->def->name);
+    }
+
+  return(0);
+}
+
+
+static void free_slot(derive_slot *slot)
+{
+  for (int i=0; i<MAX_DERIVE_INPUTS; i++)
+    free(slot->in[i]);
+  free(slot->rot);
+  free(slot);
+}
+
+
+void free_derived_vars(derived_var *dv)
+{
+  while (dv)
+    {
+      derived_var *next = dv->next;
+
+      while (dv->slots)
+	{
+	  derive_slot *slot = dv->slots;
+	  dv->slots = slot->next;
+	  free_slot(slot);
+	}
+      free(dv->written);
+      free(dv->name);
+      free(dv);
+      dv = next;
+    }
+}
+
+
+//
+// Returns the slot of a derived variable for the (record, level, member)
+// of start, adding it if need be, in which case *added is set
+//
+static derive_slot *get_slot(derived_var *dv, size_t *start, int *added)
+{
+  derive_slot *slot;
+  size_t nkey = (dv->ndims - 1) * sizeof(size_t);
+
+  *added = 0;
+  for (slot = dv->slots; slot; slot = slot->next)
+    if (memcmp(slot->start, start, nkey) == 0)
+      return(slot);
+
+  slot = (derive_slot *) emalloc(sizeof(derive_slot));
+  memset(slot, 0, sizeof(derive_slot));
+  memcpy(slot->start, start, nkey);
+  slot->next = dv->slots;
+  dv->slots = slot;
+  *added = 1;
+
+  return(slot);
+}
+
+
+//
+// Unlinks a slot once its derived variable is written, or given up on,
+// and frees it. If written, its (record, level, member) is remembered
+// for later tiles of its inputs.
+//
+static void drop_slot(derived_var *dv, derive_slot *slot, int written)
+{
+  size_t nkey = dv->ndims - 1;
+  derive_slot **sp;
+
+  for (sp = &dv->slots; *sp != slot; sp = &(*sp)->next)
+    ;
+  *sp = slot->next;
+
+  if (written)
+    {
+      if (dv->nwritten == dv->maxwritten)
+	{
+	  dv->maxwritten = (dv->maxwritten ? 2 * dv->maxwritten : 16);
+	  dv->written = (size_t *) erealloc(dv->written, dv->maxwritten * nkey * sizeof(size_t));
+	}
+      memcpy(dv->written + dv->nwritten * nkey, slot->start, nkey * sizeof(size_t));
+      dv->nwritten++;
+    }
+
+  free_slot(slot);
+}
+
+
+//
+// Returns 1 if the derived variable has been written at the (record,
+// level, member) of start
+//
+static int was_written(derived_var *dv, size_t *start)
+{
+  size_t nkey = dv->ndims - 1;
+
+  for (int w=0; w<dv->nwritten; w++)
+    if (memcmp(dv->written + w * nkey, start, nkey * sizeof(size_t)) == 0)
+      return(1);
+  return(0);
+}
+
+
+//
+// Reads input i of a slot back from the output file, in GRIB units, for a
+// slot started by a later tile of another input. Returns 0 on success, -1
+// on failure.
+//
+static int read_input(ncfile *nc, derived_var *dv, derive_slot *slot, int i)
+{
+  ncvar *var = nc->vars[dv->inputs[i]];
+  size_t count[MAX_DERIVE_DIMS];
+  double slope = 1.0, intercept = 0.0;
+  float fillval;
+  int d;
+
+  if (var->uc)
+    {
+      slope = var->uc->slope;
+      intercept = var->uc->intercept;
+    }
+  if (nc_get_att_float(nc->ncid, var->id, FILL_NAME, &fillval) != NC_NOERR)
+    fillval = NC_FILL_FLOAT;
+
+  for (d=0; d<dv->ndims-1; d++)
+    count[d] = 1;
+  count[d] = dv->num_sites;
+
+  if (!slot->in[i])
+    slot->in[i] = (float *) emalloc(dv->num_sites * sizeof(float));
+
+  float *in = slot->in[i];
+  if (nc_float(nc->ncid, var->id, slot->start, count, in, fillval, 1/slope, -intercept) == -1)
+    return(-1);
+
+  for (int s=0; s<dv->num_sites; s++)
+    if (in[s] == fillval)
+      in[s] = NAN;
+  slot->have |= 1 << i;
+
+  return(0);
+}
+
+
+//
+// Sets up the rotation of the vector inputs of a slot to earth relative,
+// from the grid of the field that started it
+//
+static void set_rotation(derived_var *dv, derive_slot *slot, product_data *pd,
+			 float *lat, float *lon)
+{
+  float *rot = (float *) emalloc(2 * dv->num_sites * sizeof(float));
+
+  slot->rotate = grid_vector_rotation(pd, lat, lon, dv->num_sites, rot,
+				      rot + dv->num_sites);
+  if (slot->rotate == 1)
+    slot->rot = rot;
+  else
+    free(rot);
+}
+
+
+//
+// Rotates the grid relative vector inputs of a slot to earth relative
+//
+static void rotate_inputs(derived_var *dv, derive_slot *slot)
+{
+  float *u = slot->in[0], *v = slot->in[1];
+  const float *cosa = slot->rot, *sina = slot->rot + dv->num_sites;
+
+  for (int s=0; s<dv->num_sites; s++)
+    {
+      float ue = u[s] * cosa[s] - v[s] * sina[s];
+      float vn = u[s] * sina[s] + v[s] * cosa[s];
+      u[s] = ue;
+      v[s] = vn;
+    }
+}
+
+
+//
+// Runs the kernel of a derived variable over a full slot and writes the
+// result. Returns 0 on success, -1 on failure.
+//
+static int write_derived(ncfile *nc, derived_var *dv, derive_slot *slot,
+			 char *header)
+{
+  size_t count[MAX_DERIVE_DIMS];
+  float *out = (float *) emalloc(dv->num_sites * sizeof(float));
+  int d;
+
+  if (slot->rotate == 1)
+    rotate_inputs(dv, slot);
+
+  dv->def->kernel(dv->num_sites, slot->in, out);
+
+  for (int s=0; s<dv->num_sites; s++)
+    if (isnan(out[s]))
+      out[s] = dv->fillval;
+
+  for (d=0; d<dv->ndims-1; d++)
+    count[d] = 1;
+  count[d] = dv->num_sites;
+  slot->start[d] = 0;
+
+  double t0 = stats_now();
+  int ret = float_nc(nc->ncid, dv->varid, slot->start, count, out,
+		     dv->slope, dv->intercept, dv->fillval);
+  stats_add_time(STAGE_NC_WRITE, t0);
+  free(out);
+
+  if (ret == -1)
+    {
+      logFile->write_time("Error: GRIB %s: writing derived %s in %s\n",
+			  header, dv->name, nc->ncname);
+      return(-1);
+    }
+
+  logFile->write_time(1, "Info: GRIB %s: derived %s(%ld,...) in %s\n",
+		      header, dv->name, (long) slot->start[0], nc->ncname);
+  return(0);
+}
+
+
+//
+// Keeps the site values of variable varid at start, in GRIB units, for
+// the derived variables they are an input of, and writes those derived
+// variables whose inputs are then all in hand. A later tile of an input
+// rewrites them. pd is the field the values are from and lat, lon the
+// site locations. Returns the number of derived variables written, or -1
+// on failure.
+//
+int derive_sites(ncfile *nc, int varid, size_t *start, int num_sites,
+		 float *site_data, float fillval, product_data *pd,
+		 float *lat, float *lon)
+{
+  int nwritten = 0;
+
+  for (derived_var *dv = nc->derived; dv; dv = dv->next)
+    for (int i=0; i<dv->def->ninputs; i++)
+      {
+	if (dv->inputs[i] != varid)
+	  continue;
+
+	if (dv->num_sites == 0)
+	  dv->num_sites = num_sites;
+	else if (dv->num_sites != num_sites)
+	  continue;
+
+	int added;
+	derive_slot *slot = get_slot(dv, start, &added);
+
+	if (added)
+	  {
+	    if (dv->def->vector)
+	      set_rotation(dv, slot, pd, lat, lon);
+
+	    // The other inputs of a later tile are in the file already
+	    if (was_written(dv, start))
+	      for (int j=0; j<dv->def->ninputs; j++)
+		if (j != i && read_input(nc, dv, slot, j) != 0)
+		  {
+		    logFile->write_time("Error: GRIB %s: reading input %d of %s in %s\n",
+					pd->header, j + 1, dv->name, nc->ncname);
+		    drop_slot(dv, slot, 0);
+		    return(-1);
+		  }
+	  }
+
+	if (!slot->in[i])
+	  slot->in[i] = (float *) emalloc(num_sites * sizeof(float));
+
+	float *in = slot->in[i];
+	for (int s=0; s<num_sites; s++)
+	  in[s] = (site_data[s] == fillval ? NAN : site_data[s]);
+	slot->have |= 1 << i;
+
+	if (slot->have != (1 << dv->def->ninputs) - 1)
+	  continue;
+
+	if (slot->rotate == -1)
+	  {
+	    logFile->write_time("Warning: GRIB %s: %s not derived, vector components "
+				"relative to a grid of type %d\n", pd->header, dv->name,
+				pd->gd->type);
+	    drop_slot(dv, slot, 0);
+	    continue;
+	  }
+
+	if (write_derived(nc, dv, slot, pd->header) != 0)
+	  return(-1);
+	drop_slot(dv, slot, 1);
+	nwritten++;
+      }
+
+  return(nwritten);
+}
@@ -0,0 +1,84 @@
+/*
+ * Derived output variables. A variable of the output file with a "derive"
+ * attribute, such as
+ *
+ *	float wspd_hag(record, level, max_site_num) ;
+ *		wspd_hag:derive = "wind_speed(U_hag, V_hag)" ;
+ *
+ * is computed from the site values of other variables of the file, its
+ * inputs, rather than decoded from GRIB. The site vectors of the inputs are
+ * kept for each (record, level, member) and a kernel is run over them
+ * once they are all in hand, in the same run, after which they are freed.
+ * A later tile of one of the inputs is combined with the others read back
+ * from the file. The inputs must have the dimensions of the derived
+ * variable.
+ *
+ * Kernels of vector inputs get them earth relative: components resolved
+ * relative to a projected grid are rotated by the grid convergence at the
+ * sites, and are not derived from on grids whose rotation is not handled.
+ */
+
+#ifndef DERIVED_H
+#define DERIVED_H
+
+#include "nc.h"
+
+#ifndef DERIVE_NAME
+#define DERIVE_NAME	"derive"	/* netCDF name of formula attribute */
+#endif
+
+#define MAX_DERIVE_INPUTS 4
+#define MAX_DERIVE_DIMS 4
+
+/*
+ * A kernel computes n output values from n values of each input, in GRIB
+ * (SI) units. Missing inputs are NaN, and a NaN output is written as the
+ * fill value.
+ */
+typedef void (*derive_kernel)(int n, float **in, float *out);
+
+typedef struct derive_def {
+    const char *name;		/* name used in the derive attribute */
+    int ninputs;		/* number of inputs */
+    const char *units;		/* units of the output */
+    derive_kernel kernel;
+    int vector;			/* 1 if the inputs are the u and v components
+				   of a vector, taken as earth relative */
+} derive_def;
+
+typedef struct derive_slot {	/* inputs for one (record, level, member) */
+    size_t start[MAX_DERIVE_DIMS];
+    int have;			/* bit mask of inputs received */
+    float *in[MAX_DERIVE_INPUTS];
+    int rotate;			/* vector inputs: 1 if grid relative, -1 if
+				   relative to a grid not handled */
+    float *rot;			/* if rotate is 1, cosines then sines of the
+				   grid convergence at the sites */
+    struct derive_slot *next;
+} derive_slot;
+
+typedef struct derived_var {
+    int varid;			/* netCDF variable id */
+    char *name;
+    const derive_def *def;	/* kernel */
+    int inputs[MAX_DERIVE_INPUTS]; /* variable ids of the inputs */
+    int ndims;
+    double slope;		/* kernel to variable units */
+    double intercept;
+    float fillval;
+    int num_sites;		/* length of the site vectors */
+    derive_slot *slots;
+    size_t *written;		/* (record, level, member) of the slots
+				   written, ndims - 1 values each */
+    int nwritten;
+    int maxwritten;
+    struct derived_var *next;
+} derived_var;
+
+int make_derived_vars(ncfile *nc);
+void free_derived_vars(derived_var *dv);
+int derive_sites(ncfile *nc, int varid, size_t *start, int num_sites,
+		 float *site_data, float fillval, product_data *pd,
+		 float *lat, float *lon);
+
+#endif
@@ -5,7 +5,7 @@
 
 #include <stdlib.h>			/* for free(), ... */
 #include <stdio.h>                      /* for printf().. */
-#include "emalloc.h"
+#include "arena.h"
 #include "gribtypes.h"
 #include "centers.h"
 #include "ens.h"
@@ -20,7 +20,7 @@
 ens*
 mkens_from_grib(int center, unsigned char *local)
 {
-    ens *ret = (ens *) emalloc(sizeof(ens));
+    ens *ret = (ens *) arena_alloc(sizeof(ens));
 
     int lcode = g1i(local[0]);
 
@@ -44,7 +44,7 @@ mkens_from_grib(int center, unsigned char *local)
 	      ret->is_control = 0;
 	    break;
 	  default:
-	    free(ret);
+	    arena_free(ret);
 	    ret = 0;
 	  }
 	break;
@@ -57,7 +57,7 @@ mkens_from_grib(int center, unsigned char *local)
 	ret->total_members = 0;  // can we determine total?
 	break;
       default:
-	free(ret);
+	arena_free(ret);
 	ret = 0;
       }
 
@@ -80,7 +80,7 @@ mkens_from_grib(int center, unsigned char *local)
 ens*
 mkens_from_grib2(GRIB2::g2int ipdtnum, GRIB2::g2int *igdtmpl)
 {
-    ens *ret = (ens *) emalloc(sizeof(ens));
+    ens *ret = (ens *) arena_alloc(sizeof(ens));
 
     switch (ipdtnum)
       {
@@ -94,7 +94,7 @@ mkens_from_grib2(GRIB2::g2int ipdtnum, GRIB2::g2int *igdtmpl)
 	  ret->is_control = 0;
 	break;
       default:
-	free(ret);
+	arena_free(ret);
 	ret = 0;
 	break;
       }
@@ -107,5 +107,5 @@ free_ens(		/* free ensemble data structure */
 	)
 {
     if(en)
-	free(en);
+	arena_free(en);
 }
@@ -0,0 +1,621 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "log/log.hh"
+#include "arena.h"
+#include "g2unpack.h"
+
+extern Log *logFile;
+
+/* Values unpacked at a time, which bounds the work buffer whatever the
+   group lengths are */
+#define CHUNK 1024
+
+/* Widest packed value handled; g2clib reads at most 32 bits at a time */
+#define MAX_WIDTH 32
+
+
+static uint32_t get4(const unsigned char *p)
+{
+  return(((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]);
+}
+
+
+//
+// Big endian 64 bit word starting at p
+//
+static inline uint64_t load64(const unsigned char *p)
+{
+  uint64_t w;
+
+  memcpy(&w, p, sizeof(w));
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return(__builtin_bswap64(w));
+#else
+  w = 0;
+  for (int i=0; i<8; i++)
+    w = (w << 8) | p[i];
+  return(w);
+#endif
+}
+
+
+//
+// As load64(), for the last bytes of a section: bytes at or past end read
+// as 0, so that the last values can be read with the same shifts
+//
+static uint64_t load64_tail(const unsigned char *p, const unsigned char *end)
+{
+  uint64_t w = 0;
+
+  for (int i=0; i<8; i++)
+    w = (w << 8) | (p + i < end ? p[i] : 0);
+  return(w);
+}
+
+
+//
+// Packed value reader over a data section, bit offsets as in g2clib's
+// gbits()
+//
+typedef struct bitbuf {
+    const unsigned char *buf;	/* start of the packed data */
+    const unsigned char *end;	/* end of the section */
+    uint64_t pos;		/* bit offset of the next value */
+} bitbuf;
+
+
+static inline GRIB2::g2int get_bits(bitbuf *b, int nbits)
+{
+  if (nbits == 0)
+    return(0);
+
+  uint64_t w = load64_tail(b->buf + (b->pos >> 3), b->end);
+  b->pos += nbits;
+  return((GRIB2::g2int)((w << ((b->pos - nbits) & 7)) >> (64 - nbits)));
+}
+
+
+//
+// Unpacks n values of W bits each, adding add to them. The width is a
+// template parameter so that the shifts are constants; unpack_fn[] holds
+// one per width.
+//
+template <int W>
+static void unpack_w(bitbuf *b, int n, GRIB2::g2int add, GRIB2::g2int *out)
+{
+  const unsigned char *buf = b->buf;
+  uint64_t pos = b->pos;
+  uint64_t last = (b->end - buf >= 8 ? (uint64_t)(b->end - buf - 8) * 8 : 0);
+  int i = 0;
+
+  // Whole words can be loaded up to the last 8 bytes of the section
+  if (b->end - buf >= 8)
+    for (; i<n && pos <= last; i++, pos += W)
+      out[i] = (GRIB2::g2int)((load64(buf + (pos >> 3)) << (pos & 7)) >> (64 - W)) + add;
+
+  for (; i<n; i++, pos += W)
+    out[i] = (GRIB2::g2int)((load64_tail(buf + (pos >> 3), b->end) << (pos & 7)) >> (64 - W)) + add;
+
+  b->pos = pos;
+}
+
+typedef void (*unpack_func)(bitbuf *b, int n, GRIB2::g2int add, GRIB2::g2int *out);
+
+#define UNPACK4(w) unpack_w<w>, unpack_w<w+1>, unpack_w<w+2>, unpack_w<w+3>
+
+static const unpack_func unpack_fn[MAX_WIDTH + 1] = {
+  0,
+  UNPACK4(1), UNPACK4(5), UNPACK4(9), UNPACK4(13),
+  UNPACK4(17), UNPACK4(21), UNPACK4(25), UNPACK4(29)
+};
+
+
+//
+// Unpacks one of the group descriptor arrays, n values of nbits bits (0
+// bits giving zeros), then skips to the next byte as g2clib does
+//
+static void unpack_descriptors(bitbuf *b, int nbits, GRIB2::g2int n, GRIB2::g2int *out)
+{
+  if (nbits == 0)
+    {
+      memset(out, 0, n * sizeof(GRIB2::g2int));
+      return;
+    }
+
+  unpack_fn[nbits](b, (int)n, 0, out);
+  b->pos = (b->pos + 7) & ~(uint64_t)7;
+}
+
+
+//
+// g2clib's int_power(), kept for identical scale factors
+//
+static double int_power(double x, GRIB2::g2int y)
+{
+  double value;
+
+  if (y < 0)
+    {
+      y = -y;
+      x = 1.0 / x;
+    }
+  value = 1.0;
+
+  while (y)
+    {
+      if (y & 1)
+	value *= x;
+      x = x * x;
+      y >>= 1;
+    }
+  return(value);
+}
+
+
+//
+// IEEE float of a template entry, as g2clib's rdieee() gives it: NaNs
+// become infinities
+//
+static GRIB2::g2float ieee_value(GRIB2::g2int ival)
+{
+  uint32_t u = (uint32_t)ival;
+  GRIB2::g2float val;
+
+  if (((u >> 23) & 0xff) == 0xff)
+    return((u >> 31) ? -INFINITY : INFINITY);
+
+  memcpy(&val, &u, sizeof(val));
+  return(val);
+}
+
+
+//
+// Scales n packed values back to the field. The expression and its
+// float evaluation are g2clib's.
+//
+static void scale_values(const GRIB2::g2int *ival, int n, GRIB2::g2float ref, GRIB2::g2float bscale,
+			 GRIB2::g2float dscale, GRIB2::g2float *fld)
+{
+  for (int i=0; i<n; i++)
+    fld[i] = (((GRIB2::g2float)ival[i] * bscale) + ref) * dscale;
+}
+
+
+//
+// Template 5.0, simple packing. Returns 0 on success.
+//
+static int simple_unpack(const unsigned char *data, GRIB2::g2int datalen, const GRIB2::g2int *drt,
+			 GRIB2::g2int ndpts, GRIB2::g2float *fld)
+{
+  GRIB2::g2float ref = ieee_value(drt[0]);
+  GRIB2::g2float bscale = (GRIB2::g2float)int_power(2.0, drt[1]);
+  GRIB2::g2float dscale = (GRIB2::g2float)int_power(10.0, -drt[2]);
+  int nbits = (int)drt[3];
+  GRIB2::g2int ival[CHUNK];
+  bitbuf b = {data, data + datalen, 0};
+
+  if (nbits < 0 || nbits > MAX_WIDTH || (double)nbits * ndpts > datalen * 8.)
+    return(1);
+
+  if (nbits == 0)
+    {
+      for (GRIB2::g2int n=0; n<ndpts; n++)
+	fld[n] = ref;
+      return(0);
+    }
+
+  for (GRIB2::g2int n=0; n<ndpts; n+=CHUNK)
+    {
+      int m = (int)(ndpts - n < CHUNK ? ndpts - n : CHUNK);
+      unpack_fn[nbits](&b, m, 0, ival);
+      scale_values(ival, m, ref, bscale, dscale, fld + n);
+    }
+  return(0);
+}
+
+
+//
+// Undoes the spatial differencing of a run of values that are not
+// missing. prev[0] and prev[1] are the last two values before the run and
+// *count the number of values before it, both carried from run to run.
+//
+static void undo_differencing(GRIB2::g2int *ival, int n, int order, GRIB2::g2int ival1, GRIB2::g2int ival2,
+			      GRIB2::g2int minsd, GRIB2::g2int *count, GRIB2::g2int prev[2])
+{
+  GRIB2::g2int p0 = prev[0], p1 = prev[1];
+  GRIB2::g2int k = *count;
+  int i = 0;
+
+  // The first values of the field are sent whole
+  for (; i < n && k < order; i++, k++)
+    {
+      p1 = p0;
+      p0 = (k == 0 ? ival1 : ival2);
+      ival[i] = p0;
+    }
+  int first = i;
+
+  if (order == 1)
+    for (; i < n; i++)
+      {
+	p0 = ival[i] + minsd + p0;
+	ival[i] = p0;
+      }
+  else
+    for (; i < n; i++)
+      {
+	GRIB2::g2int v = ival[i] + minsd + 2 * p0 - p1;
+	p1 = p0;
+	p0 = v;
+	ival[i] = v;
+      }
+
+  *count = k + (n - first);
+  prev[0] = p0;
+  prev[1] = p1;
+}
+
+
+//
+// Templates 5.2 and 5.3, complex packing with or without spatial
+// differencing, following g2clib's comunpack(). data is the packed data,
+// datalen its length in bytes and lensec the length of section 7.
+// Returns 0 on success.
+//
+static int complex_unpack(const unsigned char *data, GRIB2::g2int datalen, GRIB2::g2int lensec,
+			  GRIB2::g2int drtnum, const GRIB2::g2int *drt, GRIB2::g2int ndpts, GRIB2::g2float *fld)
+{
+  GRIB2::g2float ref = ieee_value(drt[0]);
+  GRIB2::g2float bscale = (GRIB2::g2float)int_power(2.0, drt[1]);
+  GRIB2::g2float dscale = (GRIB2::g2float)int_power(10.0, -drt[2]);
+  int nbitsgref = (int)drt[3];
+  GRIB2::g2int itype = drt[4];
+  GRIB2::g2int missmgmt = drt[6];
+  GRIB2::g2int ngroups = drt[9];
+  int nbitsgwidth = (int)drt[11];
+  int nbitsglen = (int)drt[15];
+  int order = 0, nbitsd = 0;
+  GRIB2::g2int ival1 = 0, ival2 = 0, minsd = 0, isign;
+  GRIB2::g2float rmiss1 = 0, rmiss2 = 0;
+  bitbuf b = {data, data + datalen, 0};
+  GRIB2::g2int j, n;
+
+  if (ngroups == 0)
+    {
+      for (n=0; n<ndpts; n++)
+	fld[n] = ref;
+      return(0);
+    }
+
+  if (ngroups < 0 || missmgmt < 0 || missmgmt > 2 || nbitsgref < 0 || nbitsgref > MAX_WIDTH ||
+      nbitsgwidth < 0 || nbitsgwidth > MAX_WIDTH || nbitsglen < 0 || nbitsglen > MAX_WIDTH)
+    return(1);
+
+  if (missmgmt == 1 || missmgmt == 2)
+    {
+      rmiss1 = (itype == 0 ? ieee_value(drt[7]) : (GRIB2::g2float)drt[7]);
+      rmiss2 = (itype == 0 ? ieee_value(drt[8]) : (GRIB2::g2float)drt[8]);
+    }
+
+  if (drtnum == 3)
+    {
+      nbitsd = (int)drt[17] * 8;
+      if (nbitsd < 0 || nbitsd > MAX_WIDTH + 1)
+	return(1);
+
+      if (drt[16] == 1 || drt[16] == 2)
+	order = (int)drt[16];
+
+      if (nbitsd != 0)
+	{
+	  isign = get_bits(&b, 1);
+	  ival1 = get_bits(&b, nbitsd - 1);
+	  if (isign == 1) ival1 = -ival1;
+
+	  if (drt[16] == 2)
+	    {
+	      isign = get_bits(&b, 1);
+	      ival2 = get_bits(&b, nbitsd - 1);
+	      if (isign == 1) ival2 = -ival2;
+	    }
+
+	  isign = get_bits(&b, 1);
+	  minsd = get_bits(&b, nbitsd - 1);
+	  if (isign == 1) minsd = -minsd;
+	}
+    }
+
+  // The group descriptors must fit in the section before they are read
+  uint64_t desc_bytes = ((uint64_t)nbitsgref * ngroups + 7) / 8 +
+    ((uint64_t)nbitsgwidth * ngroups + 7) / 8 + ((uint64_t)nbitsglen * ngroups + 7) / 8;
+  if (b.pos / 8 + desc_bytes > (uint64_t)datalen)
+    return(1);
+
+  GRIB2::g2int *gref = (GRIB2::g2int *)arena_alloc(3 * ngroups * sizeof(GRIB2::g2int));
+  GRIB2::g2int *gwidth = gref + ngroups;
+  GRIB2::g2int *glen = gwidth + ngroups;
+
+  unpack_descriptors(&b, nbitsgref, ngroups, gref);
+  unpack_descriptors(&b, nbitsgwidth, ngroups, gwidth);
+  unpack_descriptors(&b, nbitsglen, ngroups, glen);
+
+  // Check the groups against the number of values and the section length
+  // as g2clib does, and that every group can be read
+  GRIB2::g2int tot_bits = 0, tot_len = 0;
+  int bad = 0;
+
+  for (j=0; j<ngroups; j++)
+    {
+      gwidth[j] += drt[10];
+      glen[j] = glen[j] * drt[13] + drt[12];
+    }
+  glen[ngroups-1] = drt[14];
+
+  for (j=0; j<ngroups; j++)
+    {
+      if (gwidth[j] < 0 || gwidth[j] > MAX_WIDTH || glen[j] < 0)
+	bad = 1;
+      tot_bits += gwidth[j] * glen[j];
+      tot_len += glen[j];
+    }
+
+  if (bad || tot_len != ndpts || tot_bits / 8. > lensec ||
+      b.pos + (uint64_t)tot_bits > (uint64_t)datalen * 8)
+    {
+      arena_free(gref);
+      return(1);
+    }
+
+  GRIB2::g2int ival[CHUNK];
+  GRIB2::g2int count = 0;
+  GRIB2::g2int prev[2] = {0, 0};
+
+  n = 0;
+  if (missmgmt == 0)
+    {
+      //
+      // The groups are unpacked back to back into the work buffer, which
+      // is undifferenced and scaled each time it fills
+      //
+      int nbuf = 0;
+
+      for (j=0; j<ngroups; j++)
+	{
+	  int width = (int)gwidth[j];
+
+	  for (GRIB2::g2int k=0; k<glen[j]; )
+	    {
+	      int m = (int)(glen[j] - k < CHUNK - nbuf ? glen[j] - k : CHUNK - nbuf);
+
+	      if (width == 0)
+		for (int i=0; i<m; i++)
+		  ival[nbuf + i] = gref[j];
+	      else
+		unpack_fn[width](&b, m, gref[j], ival + nbuf);
+
+	      nbuf += m;
+	      k += m;
+
+	      if (nbuf == CHUNK || (j == ngroups - 1 && k == glen[j]))
+		{
+		  if (order)
+		    undo_differencing(ival, nbuf, order, ival1, ival2, minsd, &count, prev);
+
+		  scale_values(ival, nbuf, ref, bscale, dscale, fld + n);
+		  n += nbuf;
+		  nbuf = 0;
+		}
+	    }
+	}
+
+      arena_free(gref);
+      return(0);
+    }
+
+  GRIB2::g2int msng1g = (GRIB2::g2int)int_power(2.0, nbitsgref) - 1;
+
+  for (j=0; j<ngroups; j++)
+    {
+      int width = (int)gwidth[j];
+
+      // A constant group, of missing values or not
+      if (width == 0)
+	{
+	  if (gref[j] == msng1g || (missmgmt == 2 && gref[j] == msng1g - 1))
+	    {
+	      GRIB2::g2float miss = (gref[j] == msng1g ? rmiss1 : rmiss2);
+	      for (GRIB2::g2int k=0; k<glen[j]; k++)
+		fld[n++] = miss;
+	      continue;
+	    }
+
+	  for (GRIB2::g2int k=0; k<glen[j]; k+=CHUNK)
+	    {
+	      int m = (int)(glen[j] - k < CHUNK ? glen[j] - k : CHUNK);
+
+	      for (int i=0; i<m; i++)
+		ival[i] = gref[j];
+
+	      if (order)
+		undo_differencing(ival, m, order, ival1, ival2, minsd, &count, prev);
+
+	      scale_values(ival, m, ref, bscale, dscale, fld + n);
+	      n += m;
+	    }
+	  continue;
+	}
+
+      GRIB2::g2int msng1 = (GRIB2::g2int)int_power(2.0, width) - 1;
+      GRIB2::g2int msng2 = msng1 - 1;
+
+      for (GRIB2::g2int k=0; k<glen[j]; k+=CHUNK)
+	{
+	  int m = (int)(glen[j] - k < CHUNK ? glen[j] - k : CHUNK);
+
+	  unpack_fn[width](&b, m, 0, ival);
+
+	  // Missing values are skipped by the differencing, the runs of
+	  // values between them are handled as without missing values
+	  int i = 0;
+	  while (i < m)
+	    {
+	      if (ival[i] == msng1 || (missmgmt == 2 && ival[i] == msng2))
+		{
+		  fld[n++] = (ival[i] == msng1 ? rmiss1 : rmiss2);
+		  i++;
+		  continue;
+		}
+
+	      int i0 = i;
+	      while (i < m && ival[i] != msng1 && !(missmgmt == 2 && ival[i] == msng2))
+		{
+		  ival[i] += gref[j];
+		  i++;
+		}
+
+	      if (order)
+		undo_differencing(ival + i0, i - i0, order, ival1, ival2, minsd, &count, prev);
+
+	      scale_values(ival + i0, i - i0, ref, bscale, dscale, fld + n);
+	      n += i - i0;
+	    }
+	}
+    }
+
+  arena_free(gref);
+  return(0);
+}
+
+
+int g2_unpack_native(unsigned char *msg, unsigned int msglen, int field_num,
+		     GRIB2::gribfield *g2fld, int expand)
+{
+  const unsigned char *sec7 = 0, *bitmap = 0;
+  GRIB2::g2int sec7len = 0, bitmaplen = 0;
+  int nfield = 0;
+
+  if (g2fld->idrtnum != 0 && g2fld->idrtnum != 2 && g2fld->idrtnum != 3)
+    return(1);
+
+  // Predefined bit maps are left to g2clib
+  if (g2fld->ibmap != 0 && g2fld->ibmap != 254 && g2fld->ibmap != 255)
+    return(1);
+
+  if (msglen < 16 || memcmp(msg, "GRIB", 4) != 0 || msg[7] != 2 ||
+      get4(msg + 8) != 0 || get4(msg + 12) > msglen)
+    return(1);
+
+  //
+  // Find the data section of the field, and the last bit map sent with it
+  // or before it for fields that reuse one (indicator 254)
+  //
+  const unsigned char *end = msg + get4(msg + 12);
+  const unsigned char *p = msg + 16;
+
+  while (p + 4 <= end && memcmp(p, "7777", 4) != 0)
+    {
+      if (p + 5 > end)
+	return(1);
+
+      GRIB2::g2int len = get4(p);
+      if (len < 5 || len > end - p)
+	return(1);
+
+      if (p[4] == 4)
+	nfield++;
+      else if (p[4] == 6 && len > 6 && p[5] == 0 && nfield <= field_num)
+	{
+	  bitmap = p + 6;
+	  bitmaplen = len - 6;
+	}
+      else if (p[4] == 7 && nfield == field_num)
+	{
+	  sec7 = p;
+	  sec7len = len;
+	  break;
+	}
+      p += len;
+    }
+
+  if (!sec7)
+    return(1);
+
+  GRIB2::g2int ndpts = g2fld->ndpts;
+  GRIB2::g2int ngrdpts = g2fld->ngrdpts;
+  GRIB2::g2int *bmap = 0;
+
+  if (g2fld->ibmap != 255)
+    {
+      if (!bitmap || bitmaplen * 8 < ngrdpts)
+	return(1);
+
+      bmap = (GRIB2::g2int *)arena_alloc(ngrdpts * sizeof(GRIB2::g2int));
+
+      GRIB2::g2int nset = 0;
+      for (GRIB2::g2int i=0; i<ngrdpts; i++)
+	{
+	  bmap[i] = (bitmap[i >> 3] >> (7 - (i & 7))) & 1;
+	  nset += bmap[i];
+	}
+
+      if (nset != ndpts)
+	{
+	  arena_free(bmap);
+	  return(1);
+	}
+    }
+
+  GRIB2::g2float *fld = (GRIB2::g2float *)arena_alloc((ndpts > 0 ? ndpts : 1) * sizeof(GRIB2::g2float));
+
+  int ret;
+  if (g2fld->idrtnum == 0)
+    ret = simple_unpack(sec7 + 5, sec7len - 5, g2fld->idrtmpl, ndpts, fld);
+  else
+    ret = complex_unpack(sec7 + 5, sec7len - 5, sec7len, g2fld->idrtnum, g2fld->idrtmpl,
+			 ndpts, fld);
+
+  if (ret != 0)
+    {
+      logFile->write_time(2, "Info: field %d, DRT 5.%ld left to g2clib\n", field_num,
+			  (long)g2fld->idrtnum);
+      arena_free(bmap);
+      arena_free(fld);
+      return(1);
+    }
+
+  // Spread the values over the grid, as g2_getfld() does when expanding
+  if (expand && bmap)
+    {
+      GRIB2::g2float *full = (GRIB2::g2float *)arena_calloc(ngrdpts * sizeof(GRIB2::g2float));
+
+      for (GRIB2::g2int i=0, k=0; i<ngrdpts; i++)
+	if (bmap[i] == 1)
+	  full[i] = fld[k++];
+
+      arena_free(fld);
+      fld = full;
+    }
+
+  g2fld->fld = fld;
+  g2fld->bmap = bmap;
+  g2fld->unpacked = 1;
+  g2fld->expanded = (expand ? 1 : 0);
+
+  return(0);
+}
+
+
+//
+// g2_free() for a gribfield that g2_unpack_native() may have unpacked: the
+// field values and bit map are in the message arena and go with it.
+//
+void g2_free_native(GRIB2::gribfield *g2fld)
+{
+  if (arena_owns(g2fld->fld))
+    g2fld->fld = 0;
+  if (arena_owns(g2fld->bmap))
+    g2fld->bmap = 0;
+  GRIB2::g2_free(g2fld);
+}
@@ -0,0 +1,26 @@
+/*
+ * Native unpacking of the GRIB2 data section for the data representation
+ * templates grib2site sees most: 5.0 (simple packing) and 5.2/5.3
+ * (complex packing, with spatial differencing for 5.3). The field values
+ * are bit for bit those of g2clib's simunpack() and comunpack(); g2clib
+ * remains the decoder of every other template.
+ */
+
+#ifndef G2UNPACK_H
+#define G2UNPACK_H
+
+#include "product_data.h"
+
+/*
+ * Unpacks the data of field field_num of a GRIB2 message into g2fld, as
+ * returned by g2_getfld() without unpacking, just as g2_getfld() would
+ * with unpack (and expand, if asked) set. Returns 0 on success, non-zero
+ * with g2fld unchanged if the field is not one this decoder handles.
+ * The values and bit map are allocated in the message arena (arena.h),
+ * so g2fld must be freed with g2_free_native().
+ */
+int g2_unpack_native(unsigned char *msg, unsigned int msglen, int field_num,
+		     GRIB2::gribfield *g2fld, int expand);
+void g2_free_native(GRIB2::gribfield *g2fld);
+
+#endif
@@ -9,7 +9,7 @@
 #include <limits.h>
 #include <assert.h>
 #include "log/log.hh"
-#include "emalloc.h"
+#include "arena.h"
 #include "gbytem.h"
 #include "gbds.h"
 #include "grib1.h"
@@ -78,7 +78,7 @@ unpackbds(
 	)
 {
     double g10 = EXP10((double) -scale10); /* factor of 10 to scale data */
-    float *data = (float *)emalloc(npts * sizeof(float)) ;
+    float *data = (float *)arena_alloc(npts * sizeof(float)) ;
     unsigned char *pp = bd->packed;
     int offset = 0;
     int i;
@@ -120,7 +120,7 @@ unpackbds(
 gbds*
 make_gbds(bds *bdsp)
 {
-    gbds *ret = (gbds *) emalloc(sizeof(gbds));
+    gbds *ret = (gbds *) arena_alloc(sizeof(gbds));
 
     ret->bscale = g2si(bdsp->scale);
     ret->ref = g4f(bdsp->ref);
@@ -148,5 +148,5 @@ free_gbds(		/* free binary data structure */
 	)
 {
     if(gb)
-	free(gb);
+	arena_free(gb);
 }
@@ -7,7 +7,7 @@
 #include <stdlib.h>			/* for free(), ... */
 #include <assert.h>
 #include "log/log.hh"
-#include "emalloc.h"
+#include "arena.h"
 #include "gds.h"
 #include "gdes.h"
 #include "gbytem.h"
@@ -34,10 +34,10 @@ static gbytem*
 empty_gbytem(int nbytes)
                       /* number of bytes in byte map */
 {
-    gbytem* bp = (gbytem *) emalloc(sizeof(gbytem));
+    gbytem* bp = (gbytem *) arena_alloc(sizeof(gbytem));
     bp->nb = nbytes;
     bp->keep = 0;
-    bp->map = (char *)emalloc(bp->nb);
+    bp->map = (char *)arena_alloc(bp->nb);
     return bp;
 }
 
@@ -49,7 +49,7 @@ full_gbytem(
     int nbytes                  /* number of bytes in byte map */
 	)
 {
-    gbytem* bp = (gbytem *) emalloc(sizeof(gbytem));
+    gbytem* bp = (gbytem *) arena_alloc(sizeof(gbytem));
     bp->nb = nbytes;
     bp->keep = 0;
     bp->map = 0;		/* means all 1's */
@@ -614,7 +614,7 @@ free_gbytem(gbytem* gb)
         if(gb->keep)
             return;             /* auto-initialized in static, so don't free */
         if(gb->map)
-            free(gb->map);
-        free(gb);
+            arena_free(gb->map);
+        arena_free(gb);
     }
 }
@@ -8,7 +8,7 @@
 #include <stdio.h>
 
 #include "log/log.hh"
-#include "emalloc.h"
+#include "arena.h"
 #include "gdes.h"
 #include "gbytem.h"
 #include "grib1.h"
@@ -112,7 +112,7 @@ fill_rll(grid_rll *raw, gdes *gd)
     cooked->lo2 = g3si(raw->lo2)*.001;
     cooked->di = g2i(raw->di)*.001;
     cooked->dj = g2i(raw->dj)*.001;
-    cooked->rot=(rotated *)emalloc(sizeof(rotated));
+    cooked->rot=(rotated *)arena_alloc(sizeof(rotated));
     cooked->rot->lat = g3si(raw->lapole)*.001;
     cooked->rot->lon = g3si(raw->lopole)*.001;
     cooked->rot->angle = g4f(raw->angrot);
@@ -148,7 +148,7 @@ fill_sll(grid_sll *raw, gdes *gd)
     cooked->di = g2i(raw->di)*.001;
     cooked->dj = g2i(raw->dj)*.001;
     cooked->rot=0;
-    cooked->strch=(stretched *)emalloc(sizeof(stretched));
+    cooked->strch=(stretched *)arena_alloc(sizeof(stretched));
     cooked->strch->lat = g3si(raw->lastr)*.001;
     cooked->strch->lon = g3si(raw->lostr)*.001;
     cooked->strch->factor = g4f(raw->stretch);
@@ -182,11 +182,11 @@ fill_srll(grid_srll *raw, gdes *gd)
     cooked->lo2 = g3si(raw->lo2)*.001;
     cooked->di = g2i(raw->di)*.001;
     cooked->dj = g2i(raw->dj)*.001;
-    cooked->rot=(rotated *)emalloc(sizeof(rotated));
+    cooked->rot=(rotated *)arena_alloc(sizeof(rotated));
     cooked->rot->lat = g3si(raw->lapole)*.001;
     cooked->rot->lon = g3si(raw->lopole)*.001;
     cooked->rot->angle = g4f(raw->angrot);
-    cooked->strch=(stretched *)emalloc(sizeof(stretched));
+    cooked->strch=(stretched *)arena_alloc(sizeof(stretched));
     cooked->strch->lat = g3si(raw->lastr)*.001;
     cooked->strch->lon = g3si(raw->lostr)*.001;
     cooked->strch->factor = g4f(raw->stretch);
@@ -248,7 +248,7 @@ fill_rgau(grid_rgau *raw, gdes *gd)
     cooked->lo2 = g3si(raw->lo2)*.001;
     cooked->di = g2i(raw->di)*.001;
     cooked->n = g2i(raw->n);
-    cooked->rot=(rotated *)emalloc(sizeof(rotated));
+    cooked->rot=(rotated *)arena_alloc(sizeof(rotated));
     cooked->rot->lat = g3si(raw->lapole)*.001;
     cooked->rot->lon = g3si(raw->lopole)*.001;
     cooked->rot->angle = g4f(raw->angrot);
@@ -282,7 +282,7 @@ fill_sgau(
     cooked->di = g2i(raw->di)*.001;
     cooked->n = g2i(raw->n);
     cooked->rot=0;
-    cooked->strch=(stretched *)emalloc(sizeof(stretched));
+    cooked->strch=(stretched *)arena_alloc(sizeof(stretched));
     cooked->strch->lat = g3si(raw->lastr)*.001;
     cooked->strch->lon = g3si(raw->lostr)*.001;
     cooked->strch->factor = g4f(raw->stretch);
@@ -314,11 +314,11 @@ fill_srgau(
     cooked->lo2 = g3si(raw->lo2)*.001;
     cooked->di = g2i(raw->di)*.001;
     cooked->n = g2i(raw->n);
-    cooked->rot=(rotated *)emalloc(sizeof(rotated));
+    cooked->rot=(rotated *)arena_alloc(sizeof(rotated));
     cooked->rot->lat = g3si(raw->lapole)*.001;
     cooked->rot->lon = g3si(raw->lopole)*.001;
     cooked->rot->angle = g4f(raw->angrot);
-    cooked->strch=(stretched *)emalloc(sizeof(stretched));
+    cooked->strch=(stretched *)arena_alloc(sizeof(stretched));
     cooked->strch->lat = g3si(raw->lastr)*.001;
     cooked->strch->lon = g3si(raw->lostr)*.001;
     cooked->strch->factor = g4f(raw->stretch);
@@ -368,7 +368,7 @@ fill_rsph(
     cooked->m = g2i(raw->m);
     cooked->type = g1i(raw->type);
     cooked->mode = g1i(raw->mode);
-    cooked->rot=(rotated *)emalloc(sizeof(rotated));
+    cooked->rot=(rotated *)arena_alloc(sizeof(rotated));
     cooked->rot->lat = g3si(raw->lapole)*.001;
     cooked->rot->lon = g3si(raw->lopole)*.001;
     cooked->rot->angle = g4f(raw->angrot);
@@ -393,7 +393,7 @@ fill_ssph(
     cooked->type = g1i(raw->type);
     cooked->mode = g1i(raw->mode);
     cooked->rot=0;
-    cooked->strch=(stretched *)emalloc(sizeof(stretched));
+    cooked->strch=(stretched *)arena_alloc(sizeof(stretched));
     cooked->strch->lat = g3si(raw->lastr)*.001;
     cooked->strch->lon = g3si(raw->lostr)*.001;
     cooked->strch->factor = g4f(raw->stretch);
@@ -416,11 +416,11 @@ fill_srsph(
     cooked->m = g2i(raw->m);
     cooked->type = g1i(raw->type);
     cooked->mode = g1i(raw->mode);
-    cooked->rot=(rotated *)emalloc(sizeof(rotated));
+    cooked->rot=(rotated *)arena_alloc(sizeof(rotated));
     cooked->rot->lat = g3si(raw->lapole)*.001;
     cooked->rot->lon = g3si(raw->lopole)*.001;
     cooked->rot->angle = g4f(raw->angrot);
-    cooked->strch=(stretched *)emalloc(sizeof(stretched));
+    cooked->strch=(stretched *)arena_alloc(sizeof(stretched));
     cooked->strch->lat = g3si(raw->lastr)*.001;
     cooked->strch->lon = g3si(raw->lostr)*.001;
     cooked->strch->factor = g4f(raw->stretch);
@@ -619,7 +619,7 @@ gds_to_gdes(
     int pv = g1i(gdsp->pv);
     int type = g1i(gdsp->type);
     int nerrs = 0;
-    gdes *ret = (gdes *) emalloc(sizeof(gdes));
+    gdes *ret = (gdes *) arena_alloc(sizeof(gdes));
 
     ret->type = type;
     ret->quasi = QUASI_RECT;	/* ordinary rectangular grid is default */
@@ -632,7 +632,7 @@ gds_to_gdes(
         int i;
         
 	ret->nv = nv;
-        ret->vc = (float *) emalloc(ret->nv * sizeof(float));
+        ret->vc = (float *) arena_alloc(ret->nv * sizeof(float));
         /* unpack the vertical coords into floats */
         for (i = 0; i < ret->nv; i++) {
             ret->vc[i] = g4f(*fp++);
@@ -711,7 +711,7 @@ gds_to_gdes(
 
     if(ret->quasi == QUASI_ROWS) {
         ret->ncols = 1;
-	ret->lc = (int *)emalloc((1 + ret->nrows) * sizeof(int));
+	ret->lc = (int *)arena_alloc((1 + ret->nrows) * sizeof(int));
 	{	/* unpack list of row indexes */
 	    g2int *ip = (g2int *) ((char *)gdsp + g1i(gdsp->pv)-1 + 4*ret->nv);
 	    int i;
@@ -731,7 +731,7 @@ gds_to_gdes(
 	}
     } else if(ret->quasi == QUASI_COLS) {
         ret->nrows = 1;
-	ret->lc = (int *)emalloc((1 + ret->ncols) * sizeof(int));
+	ret->lc = (int *)arena_alloc((1 + ret->ncols) * sizeof(int));
 	{	/* unpack list of col indexes */
 	    g2int *ip = (g2int *) ((char *)gdsp + g1i(gdsp->pv)-1 + 4*ret->nv);
 	    int i;
@@ -1602,57 +1602,57 @@ free_gdes(
 	if(gd->keep)
 	    return;
 	if (gd->vc)
-	    free(gd->vc);
+	    arena_free(gd->vc);
 	if (gd->lc)
-	    free(gd->lc);
+	    arena_free(gd->lc);
 	switch(gd->type) {	/* free type-specific stuff */
 	case GRID_LL:
 	    break;
 	case GRID_RLL:
 	    if(gd->grid.ll.rot)
-		free(gd->grid.ll.rot);
+		arena_free(gd->grid.ll.rot);
 	    break;
 	case GRID_SLL:
 	    if(gd->grid.ll.strch)
-		free(gd->grid.ll.strch);
+		arena_free(gd->grid.ll.strch);
 	    break;
 	case GRID_SRLL:
 	    if(gd->grid.ll.rot)
-		free(gd->grid.ll.rot);
+		arena_free(gd->grid.ll.rot);
 	    if(gd->grid.ll.strch)
-		free(gd->grid.ll.strch);
+		arena_free(gd->grid.ll.strch);
 	    break;
 	case GRID_GAU:
 	    break;
 	case GRID_RGAU:
 	    if(gd->grid.gau.rot)
-		free(gd->grid.gau.rot);
+		arena_free(gd->grid.gau.rot);
 	    break;
 	case GRID_SGAU:
 	    if(gd->grid.gau.strch)
-		free(gd->grid.gau.strch);
+		arena_free(gd->grid.gau.strch);
 	    break;
 	case GRID_SRGAU:
 	    if(gd->grid.gau.rot)
-		free(gd->grid.gau.rot);
+		arena_free(gd->grid.gau.rot);
 	    if(gd->grid.gau.strch)
-		free(gd->grid.gau.strch);
+		arena_free(gd->grid.gau.strch);
 	    break;
 	case GRID_SPH:
 	    break;
 	case GRID_RSPH:
 	    if(gd->grid.sph.rot)
-		free(gd->grid.sph.rot);
+		arena_free(gd->grid.sph.rot);
 	    break;
 	case GRID_SSPH:
 	    if(gd->grid.sph.strch)
-		free(gd->grid.sph.strch);
+		arena_free(gd->grid.sph.strch);
 	    break;
 	case GRID_SRSPH:
 	    if(gd->grid.sph.rot)
-		free(gd->grid.sph.rot);
+		arena_free(gd->grid.sph.rot);
 	    if(gd->grid.sph.strch)
-		free(gd->grid.sph.strch);
+		arena_free(gd->grid.sph.strch);
 	    break;
 	case GRID_MERCAT:
 	case GRID_POLARS:
@@ -1667,7 +1667,7 @@ free_gdes(
 	default:
 	    break;
 	}
-	free(gd);
+	arena_free(gd);
     }
 }
 
@@ -1737,7 +1737,7 @@ gds_typename(int type)
 gdes *gdt_to_gdes(GRIB2::gribfield *g2fld)
 {
 
-  gdes *gd = (gdes *) emalloc(sizeof(gdes));
+  gdes *gd = (gdes *) arena_alloc(sizeof(gdes));
   
   // Set some defaults
   gd->nv = 0;
@@ -1803,7 +1803,7 @@ gdes *gdt_to_gdes(GRIB2::gribfield *g2fld)
     gd->grid.ll.lo2 = g2fld->igdtmpl[15]/1000000.;
     gd->grid.ll.di = g2fld->igdtmpl[16]/1000000.;
     gd->grid.ll.dj = g2fld->igdtmpl[17]/1000000.;
-    gd->grid.ll.rot = (rotated *)emalloc(sizeof(rotated));
+    gd->grid.ll.rot = (rotated *)arena_alloc(sizeof(rotated));
     gd->grid.ll.rot->lat = g2fld->igdtmpl[19]/1000000.;
     gd->grid.ll.rot->lon = g2fld->igdtmpl[20]/1000000.;
     gd->grid.ll.rot->angle = g2fld->igdtmpl[21]/1000000.;
@@ -1826,7 +1826,7 @@ gdes *gdt_to_gdes(GRIB2::gribfield *g2fld)
     // supported. (It needs to be added in make_site_data().)
     if (gd->grid.ll.rot->angle != 0.0) {
       logFile->write_time("Error: Cannot handle rotated lat-lon grid with non-zero angle (%d)\n", gd->grid.ll.rot->angle);
-      free(gd);
+      arena_free(gd);
       gd = 0;
     }
   }
@@ -1971,7 +1971,7 @@ gdes *gdt_to_gdes(GRIB2::gribfield *g2fld)
 				      
   else {
     logFile->write_time("Error: Cannot handle grid template %d\n", gtype);
-    free(gd);
+    arena_free(gd);
     gd = 0;
   }
 
@@ -1980,7 +1980,7 @@ gdes *gdt_to_gdes(GRIB2::gribfield *g2fld)
 
   gd->nv = g2fld->num_coord;
   if (gd->nv != 0) {
-    gd->vc = (float *) emalloc(gd->nv * sizeof(float));
+    gd->vc = (float *) arena_alloc(gd->nv * sizeof(float));
     for (int i=0; i<gd->nv; i++) {
       gd->vc[i] = g2fld->coord_list[i];
     }
@@ -1996,7 +1996,7 @@ gdes *gdt_to_gdes(GRIB2::gribfield *g2fld)
 
       gd->quasi = QUASI_ROWS;
       gd->ncols = 1;
-      gd->lc = (int *)emalloc((1 + gd->nrows) * sizeof(int));
+      gd->lc = (int *)arena_alloc((1 + gd->nrows) * sizeof(int));
 
       for (int r=0; r<g2fld->num_opt; r++ ) {
 	gd->lc[r] = g2fld->list_opt[r];
@@ -2010,7 +2010,7 @@ gdes *gdt_to_gdes(GRIB2::gribfield *g2fld)
       
       gd->quasi = QUASI_COLS;
       gd->nrows = 1;
-      gd->lc = (int *)emalloc((1 + gd->ncols) * sizeof(int));
+      gd->lc = (int *)arena_alloc((1 + gd->ncols) * sizeof(int));
 
       for (int c=0; c<g2fld->num_opt; c++ ) {
 	gd->lc[c] = g2fld->list_opt[c];
@@ -2020,7 +2020,7 @@ gdes *gdt_to_gdes(GRIB2::gribfield *g2fld)
     }
     else {
       logFile->write_time("Error: Irregular grid but nrows (%d) and ncols (%d) != -1\n", gd->nrows, gd->ncols);
-      free(gd);
+      arena_free(gd);
       gd = 0;      
     }
 
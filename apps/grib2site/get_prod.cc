@@ -35,6 +35,7 @@
 #include "grib1.h"		/* for MAX_GRIB_SIZE */
 #include "get_prod.h"
 #include "emalloc.h"
+#include "arena.h"
 #include "log/log.hh"
 
 
@@ -72,17 +73,17 @@ new_prod_id(
 	while (*r0 != 0xa && r0 > buf)	/* find header start */
 	    r0--;
 	if (r0 > buf) { /* header starts at r0+1 */
-	    ret = (char *)emalloc((r1-r0));
+	    ret = (char *)arena_alloc((r1-r0));
 	    strncpy(ret, (char *)r0 + 1, (r1-r0)-1);
 	    ret[(r1-r0)-1] = '\0';	/* null terminate */
 	} else {		/* didn't find start of header */
-	    ret = (char *)emalloc(strlen(WMO_HEADER_DEFAULT)+1);
+	    ret = (char *)arena_alloc(strlen(WMO_HEADER_DEFAULT)+1);
 	    strcpy(ret, WMO_HEADER_DEFAULT);
 	}
     } else {			/* manufacture a product ID for header */
 	char tmp[25];
 	sprintf(tmp, "%ld", seqno);
-	ret = (char *) emalloc(strlen(tmp)+1);
+	ret = (char *) arena_alloc(strlen(tmp)+1);
 	strcpy(ret, tmp);
     }
     return ret;
@@ -405,7 +406,7 @@ get_prod (
 			    } else { /* past where end should have been */
 				logFile->write_time("Error: GRIB message ended past expected point, discarding.\n");
 				if(prodp->id)
-				    free(prodp->id);
+				    arena_free(prodp->id);
 				in_product = 0;
 				//return 0;
 				return -1;
@@ -413,7 +414,7 @@ get_prod (
 			case NOT_FOUND:
 			    logFile->write_time("Error: Did not find end of GRIB message\n");
 			    if(prodp->id)
-			      free(prodp->id);
+			      arena_free(prodp->id);
 			    in_product = 0;
 			    //return 0;
 			    return -1;
@@ -423,7 +424,7 @@ get_prod (
 			default:
 			    logFile->write_time("Error: reading GRIB product\n");
 			    if(prodp->id)
-				free(prodp->id);
+				arena_free(prodp->id);
 			    in_product = 0;
 			    //return 0;
 			    return -1;
@@ -436,7 +437,7 @@ get_prod (
 
 		logFile->write_time("Error: Reached EOF without finding end of GRIB message\n");
 		if(prodp->id)
-		  free(prodp->id);
+		  arena_free(prodp->id);
 		in_product = 0;
 		return -1;
 	    }
@@ -448,7 +449,7 @@ get_prod (
 
 	logFile->write_time("Error: Timed-out without finding end of GRIB message\n");
 	if(prodp->id)
-	  free(prodp->id);
+	  arena_free(prodp->id);
 	in_product = 0;
 	return -1;
     }
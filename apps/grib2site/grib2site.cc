@@ -24,6 +24,8 @@
 #include <stdlib.h>
 #include <math.h>
 #include "mkdirs_open.h"
+#include "emalloc.h"
+#include "arena.h"
 
 #include "nc.h"
 #include "centers.h"
@@ -33,9 +35,12 @@
 #include "timeunits.h"
 #include "grib1.h"
 #include "product_data.h"
+#include "g2unpack.h"
+#include "grib_index.h"
 #include "quasi.h"
 #include "units.h"
 #include "site_list.h"
+#include "stats.h"
 #include "log/log.hh"
 
 #ifdef NO_ATEXIT
@@ -56,6 +61,8 @@ unsigned long num_degribbed;
 int listing;
 Log *logFile;         // log object
 int match_filetime;   // to force the data reftime to match the filename
+int g2clib_only;      // unpack all GRIB2 data with g2clib
+volatile sig_atomic_t stats_requested;  // SIGUSR1 seen, write statistics
 
 
 /*
@@ -68,6 +75,11 @@ int match_filetime;   // to force the data reftime to match the filename
 #define DEFAULT_PRECISION 7
 
 
+/* Default netCDF-4 chunk shape: records by sites */
+#define DEFAULT_CHUNK_RECS  24
+#define DEFAULT_CHUNK_SITES 512
+
+
 /*
  * Called at exit.
  * This callback routine registered by atexit().
@@ -78,6 +90,7 @@ cleanup()
 
     logFile->write_time("Info: %lu GRIB msgs, %lu fields unpacked, %lu written\n",
 	  num_wmo_messages, num_gribs_unpacked, num_gribs_written);
+    stats_write();
     //if (!listing)
     //nccleanup();		/* close open netCDF files, if any */
 
@@ -117,7 +130,8 @@ signal_handler(
 	logFile->write_time("Info: SIGTERM\n") ;
 	exit(0) ;
       case SIGUSR1 :
-	logFile->write_time("Info: SIGUSR1\n") ;
+	/* statistics are written from the main loop */
+	stats_requested = 1;
 	return ;
       case SIGUSR2 :
 	//if (toggleulogpri(LOG_INFO))
@@ -175,6 +189,10 @@ usage(
 	  "Options:\n");
   fprintf(stderr,
 	  "-b\t\twrite brief product information to stdout (no netcdf output)\n") ;
+  fprintf(stderr,
+	  "-i\t\twrite a .idx inventory of the GRIB file to stdout (no netcdf output)\n") ;
+  fprintf(stderr,
+	  "-x idxfile\tdecode only the fields of this .idx inventory of the GRIB file\n") ;
   fprintf(stderr,
 	  "-h\t\twrite header information to stdout (no netcdf output)\n") ;
   fprintf(stderr,
@@ -190,6 +208,20 @@ usage(
 	  DEFAULT_TIMEOUT) ;
   fprintf(stderr,
 	  "-e errfile\tappend bad GRIB products to this file\n") ;
+  fprintf(stderr,
+	  "-g\t\tunpack all GRIB2 data with g2clib, not the native decoder\n") ;
+  fprintf(stderr,
+	  "-4\t\tcreate new output files as netCDF-4 (classic model), chunked by site\n") ;
+  fprintf(stderr,
+	  "-c recs,sites\tnetCDF-4 chunk shape (default %d,%d)\n",
+	  DEFAULT_CHUNK_RECS, DEFAULT_CHUNK_SITES) ;
+  fprintf(stderr,
+	  "-z level\tnetCDF-4 deflate level 1-9 (implies -4)\n") ;
+  fprintf(stderr,
+	  "-S\t\tshuffle before deflating (with -z)\n") ;
+  fprintf(stderr,
+	  "-s statsfile\twrite ingest statistics to this file at exit and on SIGUSR1\n"
+	  "\t\t(Prometheus text format if it ends in .prom, else JSON)\n") ;
   fprintf(stderr,
 	  "CDL_file\tCDL template, when netCDF output file does not exist\n") ;
   fprintf(stderr,
@@ -197,7 +229,7 @@ usage(
   fprintf(stderr,
 	  "netCDF_file\tnetCDF output file\n") ;
   fprintf(stderr,
-	  "GRIB_file(s)\tGRIB data on standard input\n") ;
+	  "GRIB_file(s)\tGRIB data on standard input (a single file, not a pipe, for -i and -x)\n") ;
   fprintf(stderr,
 	  "\nThis application decodes GRIB version 1 or 2 messages supplied on stdin.\n");
   fprintf(stderr,
@@ -213,6 +245,12 @@ usage(
   fprintf(stderr,
 	  "decoded GRIB data are added to it and CDL_file and site_file are ignored.\n");
   fprintf(stderr, "Grid tiles are supported since only data for sites on the tile are updated.\n");
+  fprintf(stderr,
+	  "\nWhen standard input is a GRIB file, -b, -i and -x read the headers of the\n");
+  fprintf(stderr,
+	  "messages and seek past the data of those not wanted. The -x inventory may\n");
+  fprintf(stderr,
+	  "be that of -i or of wgrib2, filtered down to the fields wanted.\n");
 
   exit(2);
 }
@@ -246,6 +284,7 @@ grib_decode(
 {
 
   product_data *pdp = 0;
+  double t0 = stats_now();
 
   // Determine the GRIB edition so that we can handle them differently
   int grib_edition = *(prodp->bytes+7);
@@ -284,7 +323,19 @@ grib_decode(
 	  break;
 	}
 	expand = unpack;
-	ierr = GRIB2::g2_getfld(prodp->bytes, *field_num, unpack, expand, &g2fld);
+
+	// Unpack complex and simple packed data natively; g2clib unpacks
+	// the other templates
+	if (unpack && !g2clib_only) {
+	  ierr = GRIB2::g2_getfld(prodp->bytes, *field_num, 0, 0, &g2fld);
+	  if (ierr == 0 &&
+	      g2_unpack_native(prodp->bytes, prodp->len, *field_num, g2fld, expand) != 0) {
+	    GRIB2::g2_free(g2fld);
+	    ierr = GRIB2::g2_getfld(prodp->bytes, *field_num, unpack, expand, &g2fld);
+	  }
+	}
+	else
+	  ierr = GRIB2::g2_getfld(prodp->bytes, *field_num, unpack, expand, &g2fld);
 	if (ierr != 0) {
 	  *field_num = 0;
 	  break;
@@ -292,7 +343,7 @@ grib_decode(
 
 	pdp = new_grib2_pdata(prodp->id, g2fld);
 	
-	GRIB2::g2_free(g2fld);
+	g2_free_native(g2fld);
 	
 	if (*field_num == nfields)
 	  *field_num = 0;
@@ -300,11 +351,218 @@ grib_decode(
 	break;
       }
     }
+
+  stats_add_decode(pdp, unpack, t0);
   
   return pdp;
 }
 
 
+/*
+ * Returns the number of fields in a GRIB message.
+ */
+static int
+prod_nfields(
+     prod *prodp
+     )
+{
+  GRIB2::g2int sec0[3], sec1[13], nlocal, nfields;
+
+  if (*(prodp->bytes+7) != 2)
+    return 1;
+  if (GRIB2::g2_info(prodp->bytes, sec0, sec1, &nfields, &nlocal) != 0)
+    return 0;
+  return (int) nfields;
+}
+
+
+/*
+ * Returns 1 if field_num of a message is listed by any of the .idx
+ * entries idx[first] to idx[last-1], all for that message.
+ */
+static int
+idx_lists(
+     grib_idx *idx,
+     int first,
+     int last,
+     int field_num
+     )
+{
+  for (int i = first; i < last; i++)
+    if (idx[i].field == 0 || idx[i].field == field_num)
+      return 1;
+  return 0;
+}
+
+
+/*
+ * Decodes the GRIB file on stdin from the section headers of its
+ * messages, seeking past their data. If idxname is given, only the fields
+ * of that .idx inventory are visited. The inventory and brief listings
+ * need nothing more; otherwise a message is read whole, and its wanted
+ * fields unpacked, only if it is listed in full or nc_check() accepts any
+ * of its fields. Returns 0 on success, 1 on failure.
+ */
+static int
+do_indexed (
+    FILE *fp,			/* seekable GRIB input */
+    FILE *ep,			/* if non-null, where to append bad GRIBs */
+    quas *quasp,		/* if non-null, specification for how
+				   quasi-regular "grids" are to be expanded */
+    char *idxname,		/* if non-null, .idx inventory of fields */
+    ncfile *ncp,		/* netCDF output file, unless listing */
+    float *lat_arr,		/* site latitudes */
+    float *lon_arr,		/* site longitudes */
+    int num_sites,		/* number of sites */
+    site_index *sidx		/* bucket index over site locations */
+    )
+{
+    struct prod hdr;		/* section headers of a GRIB message */
+    struct prod the_prod;	/* the whole GRIB message */
+    struct product_data *gribp;	/* decoded GRIB product structure */
+    grib_idx *idx = 0;		/* .idx entries, if any */
+    int num_idx = 0;
+    int next = 0;		/* next .idx entry */
+    int msg = 0;		/* message number */
+    off_t offset = 0;		/* byte offset of message */
+    unsigned int msglen = 0;	/* length of message */
+    int *wanted = 0;		/* fields to unpack */
+    int wanted_size = 0;
+    int num_wanted;
+    int ret = 0;
+
+
+    if (idxname && !read_grib_idx(idxname, &idx, &num_idx))
+      return(1);
+
+    while (!idx || next < num_idx) {
+	double t0 = stats_now();
+	int first = next;
+	int bad = 0;
+
+	arena_reset();		/* the previous message is done with */
+
+	if (idx) {
+	  msg = idx[next].msg;
+	  offset = idx[next].offset;
+	}
+	else {
+	  msg++;
+	  offset += msglen;
+	}
+
+	int bytes = get_prod_headers(fp, msg, &offset, &hdr, &msglen);
+	stats_add_time(STAGE_GET_PROD, t0);
+	if (bytes == 0 && !idx)
+	  break;
+	else if (bytes <= 0) {
+	  if (bytes == 0)
+	    logFile->write_time("Error: %s: no GRIB message %d at byte %lld\n",
+				idxname, msg, (long long) idx[next].offset);
+	  ret = 1;
+	  break;
+	}
+	else if (idx && offset != idx[next].offset) {
+	  logFile->write_time("Error: %s: GRIB message %d is at byte %lld, not %lld\n",
+			      idxname, msg, (long long) offset,
+			      (long long) idx[next].offset);
+	  arena_free(hdr.id);
+	  ret = 1;
+	  break;
+	}
+	num_wmo_messages++;
+	stats_add_bytes(bytes);
+
+	/* The .idx entries for this message */
+	while (idx && next < num_idx && idx[next].offset == offset)
+	  next++;
+
+	int nfields = prod_nfields(&hdr);
+	if (nfields + 1 > wanted_size) {
+	  wanted_size = nfields + 1;
+	  wanted = (int *) erealloc(wanted, wanted_size * sizeof(int));
+	}
+	num_wanted = 0;
+
+	for (int field = 1; field <= nfields; field++) {
+	  int field_num = field;
+
+	  if (idx && !idx_lists(idx, first, next, field))
+	    continue;
+
+	  gribp = grib_decode(&hdr, quasp, &field_num, 0);
+
+	  if (gribp == 0)
+	    bad = 1;
+	  else if (listing == 4)
+	    print_idx_line(msg, field, nfields, offset, gribp);
+	  else if (listing == 1)
+	    print_grib_line(gribp);
+	  else if (listing != 0 || nc_check(gribp, ncp) == 0)
+	    wanted[num_wanted++] = field;
+
+	  free_product_data(gribp);
+	}
+
+	/* Read the whole message for the fields wanted, or to keep it */
+	if (num_wanted > 0 || (bad && ep)) {
+	  t0 = stats_now();
+	  bytes = get_prod_at(fp, offset, msglen, &the_prod);
+	  stats_add_time(STAGE_GET_PROD, t0);
+	  if (bytes < 0) {
+	    arena_free(hdr.id);
+	    ret = 1;
+	    break;
+	  }
+	  stats_add_bytes(bytes);
+	  the_prod.id = hdr.id;
+
+	  if (bad && ep && fwrite(the_prod.bytes, the_prod.len, 1, ep) == 0) {
+	    logFile->write_time(1, "Info: writing bad GRIB to error file\n");
+	  }
+
+	  for (int i = 0; i < num_wanted; i++) {
+	    int field_num = wanted[i];
+
+	    gribp = grib_decode(&the_prod, quasp, &field_num, 1);
+	    if (gribp == 0)
+	      continue;
+	    if (listing == 2)
+	      print_grib(gribp, -1);
+	    else if (listing == 3)
+	      print_grib(gribp, DEFAULT_PRECISION);
+	    else {
+	      int nw = nc_write(gribp, ncp, lat_arr, lon_arr, num_sites, sidx);
+	      if (nw < 0) {
+		free_product_data(gribp);
+		ret = 1;
+		break;
+	      }
+	      num_gribs_written = num_gribs_written + nw;
+	      num_gribs_unpacked++;
+	    }
+	    free_product_data(gribp);
+	  }
+	}
+
+	arena_free(hdr.id);
+	if (ret != 0)
+	  break;
+
+	if (stats_requested) {
+	  stats_requested = 0;
+	  logFile->write_time("Info: SIGUSR1\n") ;
+	  stats_write();
+	}
+    }
+
+    free(wanted);
+    free(idx);
+
+    return(ret);
+}
+
+
 static int
 do_nc (
     FILE *ep,			/* if non-null, where to append bad GRIBs */
@@ -313,13 +571,17 @@ do_nc (
 				   quasi-regular "grids" are to be expanded */
     char *cdlname,		/* Pathname of CDL template file to be used to
 				   create netCDF file, if it doesn't exist */
+    nc4opts *nc4p,		/* netCDF-4 options for a new file */
     char *sitename,		/* Pathname of site list file */
-    char *ncname		/* Pathname of netCDF output file */
+    char *ncname,		/* Pathname of netCDF output file */
+    char *idxname		/* if non-null, .idx inventory of the
+				   fields to decode */
     )
 {
     struct prod the_prod;	/* raw bits of GRIB message, length, id */
     struct product_data *gribp;	/* decoded GRIB product structure */
     float *lat_arr, *lon_arr;	/* arrays of lat/lon locations */
+    site_index *sidx = 0;	/* bucket index over site locations */
     FILE *fp = stdin;		/* input */
     ncfile *ncp = 0;
     int ncid = 0;
@@ -327,10 +589,11 @@ do_nc (
     int num_sites;
     int field_num, last_field;
     int unpack;
+    int indexed;
 
 
     if (!listing) {
-      ncid = cdl_netcdf(cdlname, ncname);	/* get netCDF file handle */
+      ncid = cdl_netcdf(cdlname, ncname, nc4p);	/* get netCDF file handle */
       if (ncid == -1) {
 	logFile->write_time("Error: can't create output netCDF file %s\n", 
 			    ncname);
@@ -356,7 +619,7 @@ do_nc (
       }
 
       /* Process site file */
-      if (!(process_sites(sitename, ncid, &lat_arr, &lon_arr, &num_sites))) {
+      if (!(process_sites(sitename, ncid, &lat_arr, &lon_arr, &num_sites, &sidx))) {
 	return(1);
       }
     }
@@ -364,14 +627,31 @@ do_nc (
       printf("grb cnt mdl grd prm    lvlf  lev1 lev2  trf tr0 tr1  pack bms gds   npts header\n");
     }
 
-    while(1) {			/* usual exit is timeout in get_prod() */
+    // A GRIB file, unlike a pipe, can be decoded from the headers of its
+    // messages. The inventory and .idx ingest need one.
+    indexed = (idxname || listing == 4 || listing == 1) && grib_seekable(fp);
+    if ((idxname || listing == 4) && !indexed) {
+	logFile->write_time("Error: -i and -x need a GRIB file on standard input, not a pipe\n");
+	return(1);
+    }
+
+    if (indexed) {
+	if (do_indexed(fp, ep, quasp, idxname, ncp, lat_arr, lon_arr, num_sites, sidx) != 0)
+	  return(1);
+    }
+    else while(1) {		/* usual exit is timeout in get_prod() */
+	double t0 = stats_now();
+	arena_reset();		/* the previous message is done with */
 	int bytes = get_prod(fp, timeout, &the_prod);
+	stats_add_time(STAGE_GET_PROD, t0);
 	if (bytes == 0)
 	  break;
 	else if (bytes < 0)
 	  return(1);	  
-	else
+	else {
 	  num_wmo_messages++;
+	  stats_add_bytes(bytes);
+	}
 	
 	field_num = 1;
 	while(field_num > 0) {
@@ -410,7 +690,7 @@ do_nc (
 	  else if (nc_check(gribp, ncp) == 0) {
 	      free_product_data(gribp);
 	      gribp = grib_decode(&the_prod, quasp, &last_field, 1);
-	      ret = nc_write(gribp, ncp, lat_arr, lon_arr, num_sites);
+	      ret = nc_write(gribp, ncp, lat_arr, lon_arr, num_sites, sidx);
 	      if (ret < 0)
 		return (1);
 	      num_gribs_written = num_gribs_written + ret;
@@ -427,13 +707,20 @@ do_nc (
 	}
 
 	if (the_prod.id)
-	  free(the_prod.id);
+	  arena_free(the_prod.id);
+
+	if (stats_requested) {
+	  stats_requested = 0;
+	  logFile->write_time("Info: SIGUSR1\n") ;
+	  stats_write();
+	}
 
     }
 
     if (!listing) {
       free(lat_arr);
       free(lon_arr);
+      free_site_index(sidx);
       if (ncp != 0)
 	free_ncfile(ncp);
       // close nc file
@@ -442,7 +729,11 @@ do_nc (
     }
 
     /* free the product buffer */
-    get_prod(0, timeout, &the_prod);
+    if (indexed)
+      free_prod_buffers();
+    else
+      get_prod(0, timeout, &the_prod);
+    arena_release();
 
     return(0);
 }
@@ -465,10 +756,12 @@ main(
     char *ofile = 0 ;		/* output netCDF file name */
     char *cdlfile = 0 ;		/* CDL template file name */
     char *sitefile = 0 ;	/* site list file name */
+    char *idxfile = 0 ;		/* .idx inventory file name */
     FILE *ep = 0;		/* file handle for bad GRIBS output, when
 				   -e badfname used */
     int timeo = DEFAULT_TIMEOUT ; /* timeout */
     quas *quasp = 0;		/* default, don't expand quasi-regular grids */
+    nc4opts nc4;		/* netCDF-4 output options */
 
     int debugLevel = 0;
     int ret;
@@ -483,10 +776,17 @@ main(
 
 	listing = 0;
 	match_filetime = 1;
+	g2clib_only = 0;
+
+	nc4.enabled = 0;
+	nc4.deflate = 0;
+	nc4.shuffle = 0;
+	nc4.chunk_recs = DEFAULT_CHUNK_RECS;
+	nc4.chunk_sites = DEFAULT_CHUNK_SITES;
 	
 	opterr = 1;
 	
-	while ((ch = getopt(ac, av, "bhfd:l:t:me:")) != EOF) {
+	while ((ch = getopt(ac, av, "bhfid:l:t:me:gs:4c:z:Sx:")) != EOF) {
 	    switch (ch) {
 	    case 'b':
 		listing = 1;
@@ -497,6 +797,12 @@ main(
 	    case 'f':
 		listing = 3;
 		break;
+	    case 'i':
+		listing = 4;
+		break;
+	    case 'x':
+		idxfile = optarg;
+		break;
 	    case 'd':
 		debugLevel = atoi(optarg);
 		break;
@@ -521,6 +827,33 @@ main(
 		    errflg++;
 		}
 		break;
+	    case 'g':
+		g2clib_only = 1;
+		break;
+	    case 's':
+		stats_set_file(optarg);
+		break;
+	    case '4':
+		nc4.enabled = 1;
+		break;
+	    case 'c':
+		if (sscanf(optarg, "%d,%d", &nc4.chunk_recs, &nc4.chunk_sites) != 2 ||
+		    nc4.chunk_recs < 1 || nc4.chunk_sites < 1) {
+		    fprintf(stderr, "%s: invalid chunk shape %s\n", av[0], optarg);
+		    errflg++;
+		}
+		break;
+	    case 'z':
+		nc4.enabled = 1;
+		nc4.deflate = atoi(optarg);
+		if (nc4.deflate < 1 || nc4.deflate > 9) {
+		    fprintf(stderr, "%s: invalid deflate level %s\n", av[0], optarg);
+		    errflg++;
+		}
+		break;
+	    case 'S':
+		nc4.shuffle = 1;
+		break;
 	    case 'q':
 		quasp = qmeth_parse(optarg);
 		if(!quasp) {
@@ -580,8 +913,9 @@ main(
     logFile->set_debug(debugLevel);
 
     logFile->write_time("Starting %s\n", av[0]) ;
+    stats_now();		/* start the elapsed time clock */
 
-    ret = do_nc(ep, timeo, quasp, cdlfile, sitefile, ofile);
+    ret = do_nc(ep, timeo, quasp, cdlfile, &nc4, sitefile, ofile, idxfile);
 
     exit(ret);
     
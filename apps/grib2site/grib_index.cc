@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include "log/log.hh"
+#include "emalloc.h"
+#include "arena.h"
+#include "gribtypes.h"
+#include "levels.h"
+#include "params.h"
+#include "timeunits.h"
+#include "grib_index.h"
+
+extern Log *logFile;
+
+/* Longest .idx line read; the rest of a longer line is ignored */
+#define IDX_LINE_LEN 1024
+
+
+/* Message headers, and whole messages, are read into these buffers */
+static unsigned char *hdr_buf;
+static unsigned int hdr_size;
+static unsigned char *msg_buf;
+static unsigned int msg_size;
+
+
+//
+// Grows a buffer to hold at least need bytes
+//
+
+static unsigned char *reserve(unsigned char **buf, unsigned int *size,
+			      unsigned int need)
+{
+  if (need > *size)
+    {
+      *size = need + need / 2;
+      *buf = (unsigned char *) erealloc(*buf, *size);
+    }
+  return(*buf);
+}
+
+
+static unsigned int get4(const unsigned char *p)
+{
+  return(((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16) |
+	 ((unsigned int) p[2] << 8) | p[3]);
+}
+
+
+static void put4(unsigned char *p, unsigned int val)
+{
+  p[0] = (val >> 24) & 255;
+  p[1] = (val >> 16) & 255;
+  p[2] = (val >> 8) & 255;
+  p[3] = val & 255;
+}
+
+
+static int read_bytes(FILE *fp, unsigned char *buf, unsigned int len, int msg)
+{
+  if (fread(buf, 1, len, fp) != len)
+    {
+      logFile->write_time("Error: GRIB message %d: %s\n", msg,
+			  feof(fp) ? "unexpected end of file" : strerror(errno));
+      return(0);
+    }
+  return(1);
+}
+
+
+//
+// Returns 1 if the input can be read at byte offsets, as a GRIB file
+// redirected to standard input can and a pipe cannot.
+//
+
+int grib_seekable(FILE *fp)
+{
+  return(fseeko(fp, 0, SEEK_CUR) == 0);
+}
+
+
+//
+// Reads the section headers of the GRIB message at or after *offset into a
+// skeleton message that g2_info() and g2_getfld() (without unpacking) take
+// for the original: every section is kept whole except the bit map and data
+// sections, which are cut to their headers, and the lengths are patched to
+// match. A GRIB1 message is read whole. On return *offset is the byte
+// offset of the message, *msglen its length in the file and prodp the
+// skeleton, with an id made from msg in the message arena.
+//
+// Returns the length of the skeleton, 0 if no message is found before the
+// end of the file and -1 on error.
+//
+
+int get_prod_headers(FILE *fp, int msg, off_t *offset, prod *prodp,
+		     unsigned int *msglen)
+{
+  const char *mark = "GRIB";
+  unsigned int pos, slen, lensec, keep;
+  int c, matched = 0;
+  long skipped = 0;
+  char id[25];
+
+  if (fseeko(fp, *offset, SEEK_SET) != 0)
+    {
+      logFile->write_time("Error: cannot seek to GRIB message %d at %lld: %s\n",
+			  msg, (long long) *offset, strerror(errno));
+      return(-1);
+    }
+
+  // Find the start of the message. Anything between messages, such as a
+  // WMO header, is skipped.
+  while (matched < 4 && (c = getc(fp)) != EOF)
+    {
+      if (c == mark[matched])
+	matched++;
+      else
+	{
+	  skipped += matched + (c != 'G');
+	  matched = (c == 'G');
+	}
+    }
+  if (matched < 4)
+    return(0);
+
+  *offset += skipped;
+  if (skipped)
+    logFile->write_time(2, "Info: skipped %ld bytes before GRIB message %d\n",
+			skipped, msg);
+
+  reserve(&hdr_buf, &hdr_size, 16);
+  memcpy(hdr_buf, mark, 4);
+  if (!read_bytes(fp, hdr_buf + 4, 4, msg))
+    return(-1);
+
+  switch (hdr_buf[7])
+    {
+    case 1:
+      *msglen = g3i(hdr_buf + 4);
+      if (*msglen < 12)
+	{
+	  logFile->write_time("Error: GRIB message %d: bad length %u\n", msg, *msglen);
+	  return(-1);
+	}
+      reserve(&hdr_buf, &hdr_size, *msglen);
+      if (!read_bytes(fp, hdr_buf + 8, *msglen - 8, msg))
+	return(-1);
+      slen = *msglen;
+      break;
+
+    case 2:
+      if (!read_bytes(fp, hdr_buf + 8, 8, msg))
+	return(-1);
+      *msglen = g8i(hdr_buf + 8);
+
+      for (pos = slen = 16; ; pos += lensec, slen += keep)
+	{
+	  reserve(&hdr_buf, &hdr_size, slen + 6);
+	  if (pos + 4 > *msglen || !read_bytes(fp, hdr_buf + slen, 4, msg))
+	    {
+	      logFile->write_time("Error: GRIB message %d: no end section\n", msg);
+	      return(-1);
+	    }
+	  if (memcmp(hdr_buf + slen, "7777", 4) == 0)
+	    break;
+
+	  lensec = get4(hdr_buf + slen);
+	  if (lensec < 5 || pos + lensec + 4 > *msglen ||
+	      !read_bytes(fp, hdr_buf + slen + 4, 1, msg))
+	    {
+	      logFile->write_time("Error: GRIB message %d: bad section at byte %u\n",
+				  msg, pos);
+	      return(-1);
+	    }
+
+	  // Keep the bit map indicator of section 6 and the header of
+	  // section 7
+	  keep = lensec;
+	  if (hdr_buf[slen + 4] == 6 && lensec > 6)
+	    keep = 6;
+	  else if (hdr_buf[slen + 4] == 7)
+	    keep = 5;
+
+	  reserve(&hdr_buf, &hdr_size, slen + keep + 4);
+	  if (!read_bytes(fp, hdr_buf + slen + 5, keep - 5, msg))
+	    return(-1);
+	  if (keep < lensec)
+	    {
+	      put4(hdr_buf + slen, keep);
+	      if (fseeko(fp, lensec - keep, SEEK_CUR) != 0)
+		{
+		  logFile->write_time("Error: GRIB message %d: %s\n", msg, strerror(errno));
+		  return(-1);
+		}
+	    }
+	}
+
+      if (pos + 4 != *msglen)
+	{
+	  logFile->write_time("Error: GRIB message %d: end section at byte %u, not %u\n",
+			      msg, pos, *msglen - 4);
+	  return(-1);
+	}
+      slen += 4;
+
+      // Total length of the skeleton, as the 8 byte length of section 0
+      put4(hdr_buf + 8, 0);
+      put4(hdr_buf + 12, slen);
+      break;
+
+    default:
+      logFile->write_time("Error: GRIB message %d: unsupported GRIB edition %d\n",
+			  msg, hdr_buf[7]);
+      return(-1);
+    }
+
+  sprintf(id, "%d", msg);
+  prodp->id = arena_strdup(id);
+  prodp->bytes = hdr_buf;
+  prodp->len = slen;
+
+  return(slen);
+}
+
+
+//
+// Reads the whole GRIB message of msglen bytes at offset, as located by
+// get_prod_headers(), into prodp. The id of prodp is left alone. The bytes
+// are good until the next call.
+//
+// Returns the length of the message, or -1 on error.
+//
+
+int get_prod_at(FILE *fp, off_t offset, unsigned int msglen, prod *prodp)
+{
+  reserve(&msg_buf, &msg_size, msglen);
+
+  if (fseeko(fp, offset, SEEK_SET) != 0 || fread(msg_buf, 1, msglen, fp) != msglen)
+    {
+      logFile->write_time("Error: cannot read %u byte GRIB message at %lld\n",
+			  msglen, (long long) offset);
+      return(-1);
+    }
+
+  if (msglen < 12 || memcmp(msg_buf, "GRIB", 4) != 0 ||
+      memcmp(msg_buf + msglen - 4, "7777", 4) != 0)
+    {
+      logFile->write_time("Error: no GRIB message of %u bytes at %lld\n",
+			  msglen, (long long) offset);
+      return(-1);
+    }
+
+  prodp->bytes = msg_buf;
+  prodp->len = msglen;
+
+  return(msglen);
+}
+
+
+void free_prod_buffers(void)
+{
+  free(hdr_buf);
+  free(msg_buf);
+  hdr_buf = msg_buf = 0;
+  hdr_size = msg_size = 0;
+}
+
+
+//
+// Reads a .idx inventory. Only the message number, field and byte offset
+// (the first two fields of each line) are used, so the inventories of
+// wgrib2 serve as well as grib2site's, and the lines may be filtered, with
+// grep say, down to the fields wanted. A line for message n, rather than
+// n.m, stands for all fields of the message.
+//
+// Returns 1 on success, 0 on failure.
+//
+
+int read_grib_idx(char *idxname, grib_idx **idx, int *num_idx)
+{
+  char line[IDX_LINE_LEN];
+  char *cp, *ep;
+  int size = 0, lineno = 0;
+  FILE *fp;
+
+  *idx = 0;
+  *num_idx = 0;
+
+  if ((fp = fopen(idxname, "r")) == NULL)
+    {
+      logFile->write_time("Error: cannot open index file %s\n", idxname);
+      return(0);
+    }
+
+  while (fgets(line, sizeof(line), fp))
+    {
+      int len = strlen(line);
+      int c;
+
+      lineno++;
+      if (len > 0 && line[len-1] != '\n')
+	while ((c = getc(fp)) != EOF && c != '\n')
+	  ;
+
+      for (cp = line; *cp == ' ' || *cp == '\t'; cp++)
+	;
+      if (*cp == '\n' || *cp == '\0')
+	continue;
+
+      if (*num_idx == size)
+	{
+	  size = (size ? 2 * size : 512);
+	  *idx = (grib_idx *) erealloc(*idx, size * sizeof(grib_idx));
+	}
+      grib_idx *ip = &(*idx)[*num_idx];
+
+      ip->msg = strtol(cp, &ep, 10);
+      ip->field = 0;
+      if (ep != cp && *ep == '.')
+	{
+	  cp = ep + 1;
+	  ip->field = strtol(cp, &ep, 10);
+	}
+      if (ep != cp && *ep == ':')
+	{
+	  cp = ep + 1;
+	  ip->offset = (off_t) strtoll(cp, &ep, 10);
+	}
+      if (ep == cp || *ep != ':' || ip->msg < 1 || ip->field < 0 || ip->offset < 0)
+	{
+	  logFile->write_time("Error: %s line %d is not an inventory line\n",
+			      idxname, lineno);
+	  fclose(fp);
+	  free(*idx);
+	  *idx = 0;
+	  *num_idx = 0;
+	  return(0);
+	}
+      (*num_idx)++;
+    }
+
+  fclose(fp);
+
+  logFile->write_time(1, "Info: %d fields listed in %s\n", *num_idx, idxname);
+
+  return(1);
+}
+
+
+//
+// Writes the .idx line of a field decoded from message headers:
+//
+//    msg[.field]:offset:d=YYYYMMDDHH:param:level:forecast time:
+//
+// as wgrib2 does, but with grib2site's parameter names and level suffixes.
+//
+
+void print_idx_line(int msg, int field, int nfields, off_t offset,
+		    product_data *gp)
+{
+  char *name = grib_pname(gp->param);
+  char *lev = levelsuffix(gp->level_flg);
+  char *tu = tunits(gp->tunit);
+  int lev1 = level1(gp->level_flg, gp->level);
+  int lev2 = level2(gp->level_flg, gp->level);
+  int tr0 = gp->tr[0];
+  int tr1 = gp->tr[1];
+
+  if (nfields > 1)
+    printf("%d.%d:", msg, field);
+  else
+    printf("%d:", msg);
+
+  printf("%lld:d=%04d%02d%02d%02d:", (long long) offset,
+	 (gp->century - 1) * 100 + gp->year, gp->month, gp->day, gp->hour);
+
+  if (name)
+    printf("%s:", name);
+  else
+    printf("var%d:", gp->param);
+
+  if (!lev)
+    printf("lev%d", gp->level_flg);
+  else
+    printf("%s", lev[0] == '\0' ? "isob" : lev);
+  if (lev2 != 0)
+    printf(" %d-%d:", lev1, lev2);
+  else if (lev1 != 0)
+    printf(" %d:", lev1);
+  else
+    printf(":");
+
+  if (gp->tr_flg == TRI_LP1)
+    {
+      tr0 = (tr0 << 8) | tr1;
+      tr1 = 0;
+    }
+
+  switch (gp->tr_flg)
+    {
+    case TRI_P1:
+    case TRI_LP1:
+      printf("%d %s fcst:\n", tr0, tu);
+      break;
+    case TRI_IAP:
+      if (tr0 == 0)
+	printf("anl:\n");
+      else
+	printf("%d %s fcst:\n", tr0, tu);
+      break;
+    case TRI_Acc:
+      printf("%d-%d %s acc fcst:\n", tr0, tr1, tu);
+      break;
+    case TRI_Ave:
+      printf("%d-%d %s ave fcst:\n", tr0, tr1, tu);
+      break;
+    default:
+      printf("%d-%d %s fcst:\n", tr0, tr1, tu);
+      break;
+    }
+}
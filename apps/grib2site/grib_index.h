@@ -0,0 +1,32 @@
+/*
+ * Byte-range inventory of a seekable GRIB file, in the style of wgrib2's
+ * .idx files: one line per field with the message number, the byte offset
+ * of the message and a short description of the field. The messages are
+ * located and described from their section headers alone, so only the
+ * data of the fields wanted need be read.
+ */
+
+#ifndef GRIB_INDEX_H
+#define GRIB_INDEX_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "get_prod.h"
+#include "product_data.h"
+
+typedef struct grib_idx {
+    int msg;			/* message number, from 1 */
+    int field;			/* field of the message, 0 for all */
+    off_t offset;		/* byte offset of "GRIB" in the file */
+} grib_idx;
+
+int grib_seekable(FILE *fp);
+int get_prod_headers(FILE *fp, int msg, off_t *offset, prod *prodp,
+		     unsigned int *msglen);
+int get_prod_at(FILE *fp, off_t offset, unsigned int msglen, prod *prodp);
+void free_prod_buffers(void);
+int read_grib_idx(char *idxname, grib_idx **idx, int *num_idx);
+void print_idx_line(int msg, int field, int nfields, off_t offset,
+		    product_data *gp);
+
+#endif
@@ -16,6 +16,7 @@
 #include "nc.h"
 #include "nuwg.h"
 #include "emalloc.h"
+#include "arena.h"
 #include "params.h"
 #include "units.h"
 #include "levels.h"
@@ -26,6 +27,8 @@
 #include "recs.h"
 #include "site_list.h"
 #include "ncfloat.h"
+#include "stats.h"
+#include "derived.h"
 #include "log/log.hh"
 
 #ifndef FILL_NAME
@@ -36,6 +39,10 @@
 #define INTERP_METHOD_NAME	"interpolation_method"
 #endif
 
+#ifndef AVERAGING_RADIUS_NAME
+#define AVERAGING_RADIUS_NAME	"averaging_radius"	/* km, for area_average */
+#endif
+
 extern Log *logFile;
 
 
@@ -239,15 +246,126 @@ free_dim(ncdim *dim)
  */
 #define LDM_ETCDIR	"LDM_ETCDIR"
 
+/* Largest chunk cache (bytes) given to one variable of a netCDF-4 file */
+#define MAX_VAR_CHUNK_CACHE	(64*1024*1024)
+
+extern const char *MAX_SITE_NUM_NAME;
+
+
+/*
+ * Converts the classic file made by ncgen into a netCDF-4 classic model
+ * file with nccopy. Variables dimensioned by sites are chunked site-major,
+ * chunk_recs records by chunk_sites sites (other dimensions whole), so a
+ * reader pulling the time series of a few sites touches few chunks.
+ * Returns 0 on success, -1 on error.
+ */
+static int
+nc4_convert(
+     char *classic,	/* classic format file from ncgen */
+     char *ncname,	/* netCDF-4 file to create */
+     nc4opts *opts
+     )
+{
+    char cmnd[3*_POSIX_PATH_MAX+200];
+    char recname[NC_MAX_NAME+1];
+    int id, recid, dimid;
+    size_t max_sites;
+
+    /* Chunk lengths are given by dimension name */
+    if (nc_open(classic, NC_NOWRITE, &id) != NC_NOERR) {
+	logFile->write_time("Error: can't open %s\n", classic);
+	return -1;
+    }
+    if (nc_inq_unlimdim(id, &recid) != NC_NOERR || recid == -1 ||
+	nc_inq_dimname(id, recid, recname) != NC_NOERR ||
+	nc_inq_dimid(id, MAX_SITE_NUM_NAME, &dimid) != NC_NOERR ||
+	nc_inq_dimlen(id, dimid, &max_sites) != NC_NOERR) {
+	logFile->write_time("Error: %s needs a record dimension and a %s dimension for netCDF-4 output\n",
+			    classic, MAX_SITE_NUM_NAME);
+	nc_close(id);
+	return -1;
+    }
+    nc_close(id);
+
+    if (opts->chunk_sites > 0 && (size_t) opts->chunk_sites < max_sites)
+	max_sites = opts->chunk_sites;
+
+    sprintf(cmnd, "nccopy -k nc7 -c %s/%d,%s/%lu", recname, opts->chunk_recs,
+	    MAX_SITE_NUM_NAME, (unsigned long) max_sites);
+    if (opts->deflate > 0)
+	sprintf(&cmnd[strlen(cmnd)], " -d %d%s", opts->deflate, (opts->shuffle ? " -s" : ""));
+    sprintf(&cmnd[strlen(cmnd)], " %s %s", classic, ncname);
+
+    logFile->write_time("Info: Executing: %s\n", cmnd);
+
+    if (system(cmnd) != 0) {
+	logFile->write_time("Error: can't run \"%s\"\n", cmnd);
+	return -1;
+    }
+    return 0;
+}
+
+
+/*
+ * Sizes the chunk cache of each chunked variable to hold the chunks
+ * covering one record, so that as grib2site fills in a record one field
+ * (or tile) at a time, chunks stay in memory until complete instead of
+ * being compressed, evicted and read back.
+ */
+static void
+set_chunk_caches(int id)
+{
+    int nvars, varid, storage, ndims, recid, d;
+    int dimids[NC_MAX_VAR_DIMS];
+    size_t chunks[NC_MAX_VAR_DIMS];
+    size_t len, typelen, nchunks, chunk_bytes;
+    nc_type type;
+
+    if (nc_inq(id, (int *)0, &nvars, (int *)0, &recid) != NC_NOERR)
+	return;
+
+    for (varid=0; varid<nvars; varid++) {
+	if (nc_inq_var_chunking(id, varid, &storage, chunks) != NC_NOERR ||
+	    storage != NC_CHUNKED)
+	    continue;
+	if (nc_inq_var(id, varid, 0, &type, &ndims, dimids, 0) != NC_NOERR ||
+	    nc_inq_type(id, type, 0, &typelen) != NC_NOERR)
+	    continue;
+
+	nchunks = 1;
+	chunk_bytes = typelen;
+	for (d=0; d<ndims; d++) {
+	    chunk_bytes *= chunks[d];
+	    if (dimids[d] == recid || nc_inq_dimlen(id, dimids[d], &len) != NC_NOERR)
+		continue;
+	    nchunks *= (len + chunks[d] - 1) / chunks[d];
+	}
+
+	len = nchunks * chunk_bytes;
+	if (len > MAX_VAR_CHUNK_CACHE)
+	    len = MAX_VAR_CHUNK_CACHE;
+
+	/* Hash table with a few slots per chunk */
+	if (nc_set_var_chunk_cache(id, varid, len, 4*nchunks+1, 0.75) != NC_NOERR)
+	    logFile->write_time(1, "Warning: can't set chunk cache for variable %d\n", varid);
+	else
+	    logFile->write_time(2, "Info: chunk cache for variable %d: %lu bytes, %lu chunks\n",
+				varid, (unsigned long) len, (unsigned long) nchunks);
+    }
+}
+
+
 /*
  * Checks to see if netCDF file with specified name exists.  If not,
- * makes netCDF file from CDL template file.
+ * makes netCDF file from CDL template file, as a netCDF-4 file if
+ * opts->enabled.
  * Returns netCDF file ID on success, or -1 on error.
  */
 int
 cdl_netcdf (
      char *cdlname,	/* CDL file specifying netCDF structure */
-     char *ncname	/* filename of netcdf file to be created */
+     char *ncname,	/* filename of netcdf file to be created */
+     nc4opts *opts	/* netCDF-4 output options, may be 0 */
      )
 {
     char cmnd[2*_POSIX_PATH_MAX+20];
@@ -302,10 +420,17 @@ cdl_netcdf (
 	    cdlfile = envcdl;
 	}
 	
+	/* netCDF-4 files are made from a classic file, then chunked */
+	char classic[_POSIX_PATH_MAX+8];
+	if (opts && opts->enabled)
+	    sprintf(classic, "%s.tmp", ncname);
+	else
+	    strcpy(classic, ncname);
+
 	(void) strcpy(cmnd, "ncgen");
 	(void) strcat(cmnd, " -b ");
 	(void) strcat(cmnd, " -o ");
-	(void) strcat(cmnd, ncname);
+	(void) strcat(cmnd, classic);
 	(void) strcat(cmnd , " ");
 	(void) strcat(cmnd, cdlfile);
 	
@@ -315,10 +440,21 @@ cdl_netcdf (
 	    logFile->write_time("Error: can't run \"%s\"\n", cmnd);
 	    return -1;
 	}
+
+	if (opts && opts->enabled) {
+	    int ret = nc4_convert(classic, ncname, opts);
+	    unlink(classic);
+	    if (ret != 0)
+		return -1;
+	}
     }
 
     int id;
     if (nc_open(ncname, NC_WRITE, &id) == NC_NOERR) {
+      int format;
+      if (nc_inq_format(id, &format) == NC_NOERR &&
+	  (format == NC_FORMAT_NETCDF4 || format == NC_FORMAT_NETCDF4_CLASSIC))
+	set_chunk_caches(id);
       return (id);
     }
     else {
@@ -1712,6 +1848,7 @@ make_ncfile(
 
     out->ncname = estrdup(ncname);
     out->ncid = ncid;
+    out->derived = 0;
 
     if (nc_inq(ncid, &ndims, &nvars, (int *)0, &recid) != NC_NOERR) {
 	logFile->write_time("Error: ncinquire() failed\n");
@@ -1776,6 +1913,12 @@ make_ncfile(
 
     out->levdims = 0;		/* only add level dimensions as needed */
     out->laydims = 0;		/* only add layer dimensions as needed */
+
+    /* variables computed from others, per their derive attributes */
+    if (make_derived_vars(out) == -1) {
+	logFile->write_time("Error: can't set up derived variables\n");
+	return -1;
+    }
     
     return 0;
 }
@@ -1808,6 +1951,9 @@ free_ncfile(
 	if(np->rt)
 	    free_recs(np->rt);
 
+	if(np->derived)
+	    free_derived_vars(np->derived);
+
 #ifdef DONT_NEED_FOR_SITE_DATA
 	if(np->models.vals)
 	  free(np->models.vals);
@@ -2177,6 +2323,7 @@ nc_check(
 
     if (!cp) {
 	logFile->write_time(1, "Warning: GRIB %s: unrecognized (param,level_flg) combination (%d,%d)\n", pp->header, pp->param, pp->level_flg);
+	stats_skip(SKIP_UNRECOGNIZED_PARAM);
 	return(-1);
     }
 
@@ -2186,12 +2333,14 @@ nc_check(
     if (ret != NC_NOERR) {
       logFile->write_time(1, "Warning: GRIB %s: no variable %s in %s\n",
 			  pp->header, cp, nc->ncname);
+      stats_skip(SKIP_MISSING_VAR);
       return(-1);
     }
     var = nc->vars[varid];
 
     if (!var) {
        logFile->write_time(1, "Warning: GRIB %s: could not handle %s\n", pp->header, cp);
+       stats_skip(SKIP_MISSING_VAR);
        return(-1);
     }
 
@@ -2199,6 +2348,7 @@ nc_check(
     if (getlev(pp, nc, var) == -1) {
       logFile->write_time(1, "Warning: GRIB %s: could not handle level for %s\n",
 			  pp->header, cp);
+      stats_skip(SKIP_BAD_LEVEL);
       return(-1);
     }
 
@@ -2218,7 +2368,8 @@ nc_write(
     ncfile *nc,		/* netCDF file to write */
     float *lat, 	/* site latitudes */
     float *lon,		/* site longitudes */
-    int num_sites      /* Number of sites (lat/lon pairs) */
+    int num_sites,     /* Number of sites (lat/lon pairs) */
+    site_index *sidx   /* bucket index over site locations */
     )
 {
     double reftime, valtime;
@@ -2258,6 +2409,7 @@ nc_write(
     int num_calc_types = sizeof(calc_types)/sizeof(*calc_types);
 
     char calc_type[NC_MAX_NAME];
+    float radius;		/* footprint radius (km) for area_average */
 
 
     /* Loop over the calculation type list */
@@ -2291,6 +2443,16 @@ nc_write(
 	  strcpy(calc_type, "bilinear");
       }
 
+      /* An area average is over the sites' footprints of the
+	 averaging_radius attribute */
+      radius = 0.;
+      if (strcmp(calc_type, "area_average") == 0 &&
+	  nc_get_att_float(ncid, varid, AVERAGING_RADIUS_NAME, &radius) != NC_NOERR) {
+	logFile->write_time("Error: GRIB %s: %s is an area_average with no %s\n",
+			    pp->header, varname, AVERAGING_RADIUS_NAME);
+	continue;
+      }
+
       var = nc->vars[varid];
 
       dim = 0;
@@ -2350,7 +2512,7 @@ nc_write(
       }
       
       /* Allocate space for the site_data */
-      site_data = (float*) emalloc(num_sites*sizeof(float));
+      site_data = (float*) arena_alloc(num_sites*sizeof(float));
       
       /* Get the fill value attribute. Use default if not there */
       if (nc_get_att_float(ncid, varid, FILL_NAME, &fillval) != NC_NOERR) {
@@ -2360,18 +2522,36 @@ nc_write(
       /* Read existing data from netcdf file. (This allows us to process
 	 grids in tiles.) Units are reverted back to the original units
 	 since we will convert them again on output. */
+      double t0 = stats_now();
       nc_float(ncid, varid, start, count, site_data, fillval, 1/slope, -intercept);
+      stats_add_time(STAGE_NC_READ, t0);
 
       /* Get data values at sites from the grid */
-      if (!make_site_data(pp, fillval, calc_type, lat, lon, num_sites, site_data)) {
-	free(site_data);
+      t0 = stats_now();
+      ret = make_site_data(pp, fillval, calc_type, radius, lat, lon, num_sites, sidx, site_data);
+      stats_add_time(STAGE_INTERP, t0);
+      if (!ret) {
+	arena_free(site_data);
 	continue;
       }
       
+      /* Keep the site values for the variables derived from this one,
+	 writing those whose inputs are all in hand */
+      ret = derive_sites(nc, varid, start, num_sites, site_data, fillval,
+			 pp, lat, lon);
+      if (ret == -1) {
+	arena_free(site_data);
+	return (-1);
+      }
+      nwritten += ret;
+
       /* Write the data */
-      if (float_nc(ncid, varid, start, count,
-		   site_data, slope, intercept, fillval) == -1) {
-	free(site_data);
+      t0 = stats_now();
+      ret = float_nc(ncid, varid, start, count,
+		     site_data, slope, intercept, fillval);
+      stats_add_time(STAGE_NC_WRITE, t0);
+      if (ret == -1) {
+	arena_free(site_data);
 	logFile->write_time("Error: GRIB %s: writing %s in %s\n",
 			    pp->header, varname, nc->ncname);
 	return (-1);
@@ -2406,7 +2586,7 @@ nc_write(
       sprintf(&log_str[strlen(log_str)], "*) to %s", nc->ncname);
       logFile->write_time(1, "%s\n", log_str);
 
-      free(site_data);
+      arena_free(site_data);
     }
 
     return(nwritten);
@@ -72,6 +72,15 @@ typedef struct navinfo {
 } navinfo;
 
 struct rectimes;		/* forward declaration */
+struct derived_var;		/* defined in derived.h */
+
+typedef struct nc4opts {	/* netCDF-4 output options */
+    int enabled;		/* 1 to create netCDF-4 (classic model) files */
+    int deflate;		/* deflate level 0-9, 0 for none */
+    int shuffle;		/* 1 to shuffle bytes before deflating */
+    int chunk_recs;		/* records per chunk */
+    int chunk_sites;		/* sites per chunk, 0 for all sites */
+} nc4opts;
 
 typedef struct ncfile {
     char *ncname;		/* file name */
@@ -90,35 +99,36 @@ typedef struct ncfile {
     int datetimeid;		/* datetime variable id, if any */
     int valoffsetid;		/* valoffset variable id, if any */
     struct rectimes *rt;	/* table of reftimes,valtimes,records */
+    struct derived_var *derived; /* list of derived variables */
 } ncfile;
 
 
 #ifdef __cplusplus
-extern "C" int cdl_netcdf(char *cdlname, char* ncname);
+extern "C" int cdl_netcdf(char *cdlname, char* ncname, nc4opts *opts);
 extern "C" void setncid(int ncid);
 extern "C" int getncid(void);
 extern "C" void nccleanup(void);
 extern "C" ncfile *new_ncfile(char *ncname);
 extern "C" void free_ncfile(ncfile *nc);
-extern "C" int nc_write(product_data *, ncfile *, float *, float *, int);
+extern "C" int nc_write(product_data *, ncfile *, float *, float *, int, site_index *);
 extern "C" int nc_check(product_data *, ncfile *);
 #elif defined(__STDC__)
-extern int cdl_netcdf(char *cdlname, char* ncname);
+extern int cdl_netcdf(char *cdlname, char* ncname, nc4opts *opts);
 extern void setncid(int ncid);
 extern int getncid(void);
 extern void nccleanup(void);
 extern ncfile *new_ncfile(char *ncname);
 extern void free_ncfile(ncfile *nc);
-extern int nc_write(product_data *, ncfile *, float *, float *, int ns);
+extern int nc_write(product_data *, ncfile *, float *, float *, int ns, site_index *);
 extern int nc_check(product_data *, ncfile *);
 #else
-extern int cdl_netcdf( /* char *cdlname, char* ncname */ );
+extern int cdl_netcdf( /* char *cdlname, char* ncname, nc4opts *opts */ );
 extern void setncid( /* int ncid */ );
 extern int getncid( /* */ );
 extern void nccleanup( /* */ );
 extern ncfile *new_ncfile( /* char *ncname */ );
 extern void free_ncfile( /*ncfile *nc */ );
-extern int nc_write( /* product_data *, ncfile *, float *, float *, int */);
+extern int nc_write( /* product_data *, ncfile *, float *, float *, int, site_index * */);
 extern int nc_write( /* product_data *, ncfile * */ );
 #endif
 
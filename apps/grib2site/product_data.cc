@@ -9,6 +9,7 @@
 #include "log/log.hh"
 #include <string.h>
 #include "emalloc.h"
+#include "arena.h"
 #include "product_data.h"
 #include "gbds.h"		/* for unpackbds() */
 #include "centers.h"
@@ -28,7 +29,7 @@ free_product_data(
 {
     if (pd) {
 	if(pd->header)
-	    free(pd->header);
+	    arena_free(pd->header);
 	if(pd->gd)
 	  free_gdes(pd->gd);
 	if (pd->bm)
@@ -36,10 +37,10 @@ free_product_data(
 	if (pd->bd)
 	  free_gbds(pd->bd);
 	if(pd->ensemble)
-	  free(pd->ensemble);
+	  arena_free(pd->ensemble);
 	if(pd->data)
-	    free(pd->data);
-	free(pd);	
+	    arena_free(pd->data);
+	arena_free(pd);	
     }
 }
 
@@ -81,7 +82,7 @@ make_grib1_pdata(
     out->delim[2] = 'I' ; 
     out->delim[3] = 'B' ; 
 
-    out->header = (char *)emalloc(strlen(gp->hdr)+1);
+    out->header = (char *)arena_alloc(strlen(gp->hdr)+1);
     strcpy(out->header, gp->hdr);
 
     out->edition = g1i(idsp->edition) ;
@@ -234,7 +235,7 @@ make_grib2_pdata(
   out->delim[2] = 'I' ; 
   out->delim[3] = 'B' ; 
 
-  out->header = (char *)emalloc(strlen(id)+1);
+  out->header = (char *)arena_alloc(strlen(id)+1);
   strcpy(out->header, id);
 
   out->edition = g2fld->version ;
@@ -395,10 +396,17 @@ make_grib2_pdata(
   out->npts = out->gd->npts;
 
   if (g2fld->unpacked) {
-    // Allocate space for the grid data and copy it over
+    // Take over the grid data if it is already in the arena and needs no
+    // reordering, else copy it over
     int len = sizeof(float) * out->npts;
-    out->data = (float *)emalloc(len);
-    out->data = (float *)memcpy(out->data, g2fld->fld, len);
+    if (arena_owns(g2fld->fld) && !(out->gd->scan_mode & 0x10)) {
+      out->data = g2fld->fld;
+      g2fld->fld = 0;
+    }
+    else {
+      out->data = (float *)arena_alloc(len);
+      out->data = (float *)memcpy(out->data, g2fld->fld, len);
+    }
 
     // Set 0 bit-map values to missing
     if (out->has_bms)
@@ -555,7 +563,7 @@ product_data *
 new_grib1_pdata(
     grib1 *gp, int unpack)
 {
-    product_data *out = (product_data *)emalloc(sizeof(product_data));
+    product_data *out = (product_data *)arena_alloc(sizeof(product_data));
 
     if (make_grib1_pdata(gp, unpack, out) != 0) {
 	free_product_data(out);
@@ -575,7 +583,7 @@ new_grib2_pdata(
 		char *id,
 		GRIB2::gribfield *g2fld)
 {
-    product_data *out = (product_data *)emalloc(sizeof(product_data));
+    product_data *out = (product_data *)arena_alloc(sizeof(product_data));
     if (make_grib2_pdata(id, g2fld, out) != 0) {
       free_product_data(out);
       return 0;
@@ -13,6 +13,7 @@
 #include "quasi.h"
 #include "gdes.h"
 #include "emalloc.h"
+#include "arena.h"
 
 extern Log *logFile;
 
@@ -162,8 +163,8 @@ qlin(
 {
     int i, j;
     float *outp;
-    double *c = (double *)emalloc(ni * sizeof(double));/* use scratch space? */
-    float *row2 = (float *)emalloc(ni * sizeof(float));
+    double *c = (double *)arena_alloc(ni * sizeof(double));/* use scratch space? */
+    float *row2 = (float *)arena_alloc(ni * sizeof(float));
     
 				/* precompute interpolation coefficients */
     for (i=0; i < ni; i++)
@@ -204,8 +205,8 @@ qlin(
 	    }
 	}
     }
-    free(row2);
-    free(c);
+    arena_free(row2);
+    arena_free(c);
 }
 
 static void
@@ -224,7 +225,7 @@ cspline(
     float qn;
     float sig;
     float un;
-    float *scratch = (float *)emalloc((n - 1) * sizeof(float));
+    float *scratch = (float *)arena_alloc((n - 1) * sizeof(float));
                                                            /* scratch vector */
 
     if (x1d > 0.99e30) 				/* lower boundary is natural */
@@ -257,7 +258,7 @@ cspline(
     for(i = n-2;i >= 0;i--)  			   /* back substitution loop */
 	y2d[i] = y2d[i] * y2d[i+1] + scratch[i];
 
-    free(scratch);
+    arena_free(scratch);
 }
 
 
@@ -329,7 +330,7 @@ qcub(
 	inrow = j * (nrows - 1) / (nj - 1); 	       /* set the row number */
 	npoints = ix[inrow+1] - ix[inrow];     /* set number of input points */
 
-	second_d = (float *)emalloc(npoints * sizeof(double));
+	second_d = (float *)arena_alloc(npoints * sizeof(double));
 	                      /* calculated second derivative of a given row */
 
 /* calculate the second derivatives of the input row */
@@ -355,7 +356,7 @@ qcub(
 		oput++); 	      /* where to put the interpolated value */
 	}
 
-	free(second_d);
+	arena_free(second_d);
     }
 }
 
@@ -426,7 +427,7 @@ expand_quasi (
 	    }
 	    npts = ni*nj;
 
-	    data = (float *)emalloc(npts * sizeof(float));
+	    data = (float *)arena_alloc(npts * sizeof(float));
 
 	    /* interpolate from pp->data to data */
 
@@ -450,14 +451,14 @@ expand_quasi (
 	    g->di = di;
 	    g->nj = nj;
 	    g->dj = dj;
-	    free(pp->data);	/* free old data block */
+	    arena_free(pp->data);	/* free old data block */
 	    pp->data = data;
 	    gdesp->ncols = ni;
 	    gdesp->nrows = nj;
 	    gdesp->npts = npts;
 	    gdesp->quasi = QUASI_RECT;
 	    if (gdesp->lc) {
-		free(gdesp->lc);
+		arena_free(gdesp->lc);
 		gdesp->lc = 0;
 	    }
 	    pp->npts = npts;
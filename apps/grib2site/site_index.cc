@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "log/log.hh"
+#include "emalloc.h"
+#include "site_index.h"
+
+extern Log *logFile;
+
+/* Aim for this many sites per bucket, on average */
+#define SITES_PER_BUCKET 4
+
+/* Smallest bucket size (degrees) and largest bucket grid dimension */
+#define MIN_BUCKET_DEG 0.05
+#define MAX_BUCKET_DIM 1024
+
+
+//
+// Puts a longitude in the range [-180,180)
+//
+static double norm_lon(double lon)
+{
+  lon = fmod(lon + 180.0, 360.0);
+  if (lon < 0.)
+    lon += 360.0;
+  return(lon - 180.0);
+}
+
+
+static int int_cmp(const void *a, const void *b)
+{
+  return(*(const int *)a - *(const int *)b);
+}
+
+
+//
+// Bucket row and column of a location, clamped to the bucket grid
+//
+static int bucket_row(site_index *sip, double lat)
+{
+  int i = (int) floor((lat - sip->lat0) / sip->dlat);
+  if (i < 0) i = 0;
+  if (i >= sip->nlat) i = sip->nlat - 1;
+  return(i);
+}
+
+
+static int bucket_col(site_index *sip, double lon)
+{
+  int j = (int) floor((lon - sip->lon0) / sip->dlon);
+  if (j < 0) j = 0;
+  if (j >= sip->nlon) j = sip->nlon - 1;
+  return(j);
+}
+
+
+//
+// Builds a bucket index over the site locations. The bucket grid covers
+// only the extent of the sites, with the bucket size chosen so that there
+// are a few sites per bucket on average. Returns 0 on failure.
+//
+site_index *new_site_index(float *lat, float *lon, int ns)
+{
+  site_index *sip;
+  double lat_min, lat_max, lon_min, lon_max;
+  double area, size;
+  int i, b, nbuckets;
+  int *fill;
+
+  if (ns <= 0)
+    return(0);
+
+  lat_min = lat_max = lat[0];
+  lon_min = lon_max = norm_lon(lon[0]);
+  for (i=1; i<ns; i++)
+    {
+      double ln = norm_lon(lon[i]);
+      if (lat[i] < lat_min) lat_min = lat[i];
+      if (lat[i] > lat_max) lat_max = lat[i];
+      if (ln < lon_min) lon_min = ln;
+      if (ln > lon_max) lon_max = ln;
+    }
+
+  // Bucket size such that nbuckets is about ns/SITES_PER_BUCKET
+  area = (lat_max - lat_min + MIN_BUCKET_DEG) * (lon_max - lon_min + MIN_BUCKET_DEG);
+  nbuckets = ns / SITES_PER_BUCKET;
+  if (nbuckets < 1) nbuckets = 1;
+  size = sqrt(area / nbuckets);
+  if (size < MIN_BUCKET_DEG) size = MIN_BUCKET_DEG;
+
+  sip = (site_index *) emalloc(sizeof(site_index));
+  sip->num_sites = ns;
+  sip->lat0 = lat_min;
+  sip->lon0 = lon_min;
+  sip->nlat = (int) ((lat_max - lat_min) / size) + 1;
+  sip->nlon = (int) ((lon_max - lon_min) / size) + 1;
+  if (sip->nlat > MAX_BUCKET_DIM) sip->nlat = MAX_BUCKET_DIM;
+  if (sip->nlon > MAX_BUCKET_DIM) sip->nlon = MAX_BUCKET_DIM;
+
+  // Make sure the last row and column include the extreme sites
+  sip->dlat = (lat_max - lat_min) / sip->nlat + MIN_BUCKET_DEG / sip->nlat;
+  sip->dlon = (lon_max - lon_min) / sip->nlon + MIN_BUCKET_DEG / sip->nlon;
+
+  nbuckets = sip->nlat * sip->nlon;
+  sip->start = (int *) emalloc((nbuckets+1) * sizeof(int));
+  sip->sites = (int *) emalloc(ns * sizeof(int));
+  sip->cand = (int *) emalloc(2 * ns * sizeof(int));
+  fill = (int *) emalloc(nbuckets * sizeof(int));
+
+  // Counting sort of site indices into buckets. Sites stay in ascending
+  // order within each bucket.
+  for (b=0; b<=nbuckets; b++)
+    sip->start[b] = 0;
+
+  for (i=0; i<ns; i++)
+    {
+      b = bucket_row(sip, lat[i]) * sip->nlon + bucket_col(sip, norm_lon(lon[i]));
+      sip->start[b+1]++;
+    }
+
+  for (b=0; b<nbuckets; b++)
+    {
+      sip->start[b+1] += sip->start[b];
+      fill[b] = sip->start[b];
+    }
+
+  for (i=0; i<ns; i++)
+    {
+      b = bucket_row(sip, lat[i]) * sip->nlon + bucket_col(sip, norm_lon(lon[i]));
+      sip->sites[fill[b]++] = i;
+    }
+
+  free(fill);
+
+  logFile->write_time(2, "Info: site index: %d sites in %d x %d buckets of %.3f x %.3f deg\n",
+		      ns, sip->nlat, sip->nlon, sip->dlat, sip->dlon);
+
+  return(sip);
+}
+
+
+void free_site_index(site_index *sip)
+{
+  if (!sip)
+    return;
+
+  free(sip->start);
+  free(sip->sites);
+  free(sip->cand);
+  free(sip);
+}
+
+
+//
+// Appends the sites in the buckets overlapping the given box to the
+// candidate buffer, starting at position n. Longitudes are already
+// normalized with lon_min <= lon_max. Returns the new candidate count.
+//
+static int query_box(site_index *sip, double lat_min, double lat_max,
+		     double lon_min, double lon_max, int n)
+{
+  int i, j, k, b;
+  int i0, i1, j0, j1;
+
+  if (lat_max < sip->lat0 || lat_min > sip->lat0 + sip->nlat * sip->dlat ||
+      lon_max < sip->lon0 || lon_min > sip->lon0 + sip->nlon * sip->dlon)
+    return(n);
+
+  i0 = bucket_row(sip, lat_min);
+  i1 = bucket_row(sip, lat_max);
+  j0 = bucket_col(sip, lon_min);
+  j1 = bucket_col(sip, lon_max);
+
+  for (i=i0; i<=i1; i++)
+    for (j=j0; j<=j1; j++)
+      {
+	b = i * sip->nlon + j;
+	for (k=sip->start[b]; k<sip->start[b+1]; k++)
+	  sip->cand[n++] = sip->sites[k];
+      }
+
+  return(n);
+}
+
+
+//
+// Finds the sites that may lie within a lat/lon box. The longitude range
+// may be given in any convention and may cross the dateline, as long as
+// lon_min <= lon_max. The candidates are a superset of the sites in the
+// box, in ascending site order. On return, *cand points at the candidate
+// list, which is owned by the index and overwritten by the next query.
+// Returns the number of candidates.
+//
+int site_index_query(site_index *sip, double lat_min, double lat_max,
+		     double lon_min, double lon_max, int **cand)
+{
+  int i, m, n = 0;
+
+  *cand = sip->cand;
+
+  if (lon_max - lon_min >= 360.)
+    {
+      n = query_box(sip, lat_min, lat_max, -180., 180., n);
+    }
+  else
+    {
+      double lo = norm_lon(lon_min);
+      double hi = lo + (lon_max - lon_min);
+
+      n = query_box(sip, lat_min, lat_max, lo, (hi < 180. ? hi : 180.), n);
+      if (hi >= 180.)
+	n = query_box(sip, lat_min, lat_max, -180., hi - 360., n);
+    }
+
+  // Buckets are visited row by row, so put the sites back in order. A
+  // box split at the dateline can visit a wide bucket twice.
+  qsort(sip->cand, n, sizeof(int), int_cmp);
+
+  m = 0;
+  for (i=0; i<n; i++)
+    if (m == 0 || sip->cand[i] != sip->cand[m-1])
+      sip->cand[m++] = sip->cand[i];
+
+  return(m);
+}
@@ -0,0 +1,28 @@
+/*
+ * Uniform lat/lon bucket index over the site list. Built once when the
+ * site list is read so that each grid (or grid tile) only visits the
+ * sites that can possibly fall on it.
+ */
+
+#ifndef SITE_INDEX_H
+#define SITE_INDEX_H
+
+typedef struct site_index {
+    int num_sites;		/* number of sites indexed */
+    int nlat;			/* number of bucket rows */
+    int nlon;			/* number of bucket columns */
+    double lat0;		/* latitude of southern edge of buckets */
+    double lon0;		/* longitude of western edge, [-180,180) */
+    double dlat;		/* bucket size in latitude (degrees) */
+    double dlon;		/* bucket size in longitude (degrees) */
+    int *start;			/* nlat*nlon+1 offsets into sites[] */
+    int *sites;			/* site indices, grouped by bucket */
+    int *cand;			/* candidate buffer, 2*num_sites long */
+} site_index;
+
+site_index *new_site_index(float *lat, float *lon, int ns);
+void free_site_index(site_index *sip);
+int site_index_query(site_index *sip, double lat_min, double lat_max,
+		     double lon_min, double lon_max, int **cand);
+
+#endif
@@ -38,10 +38,11 @@ int corner_missing(float vals[2][2], float fillval)
 //
 // Reads site list (ASCII) file, writes ID list and location info to 
 // output file, then returns lat and lon position arrays for subsequent
-// use. Returns 1 on success, 0 failure.
+// use, along with a bucket index over the site locations. Returns 1 on
+// success, 0 failure.
 // 
 
-int process_sites(char *sitefile, int ncid, float **lat_arr, float **lon_arr, int *ns)
+int process_sites(char *sitefile, int ncid, float **lat_arr, float **lon_arr, int *ns, site_index **sidx)
 {
   FILE *fp;
   const int MAX_LINE = 256;
@@ -110,6 +111,7 @@ int process_sites(char *sitefile, int ncid, float **lat_arr, float **lon_arr, in
       *lat_arr = lat;
       *lon_arr = lon;
       *ns = num_sites;
+      *sidx = new_site_index(lat, lon, num_sites);
       return(1);
     }
 
@@ -246,11 +248,270 @@ int process_sites(char *sitefile, int ncid, float **lat_arr, float **lon_arr, in
   *lat_arr = lat;
   *lon_arr = lon;
   *ns = num_sites;
+  *sidx = new_site_index(lat, lon, num_sites);
 
   return(1);
 }
 
 
+//
+// Sets up the dmapf map of a Lambert or polar stereographic grid, with
+// grid coordinates (0, 0) at its first point. Returns 0 for other grids.
+//
+static int proj_grid_map(gdes *gd, maparam *stcpm)
+{
+  float lo1, lov, delx;
+
+  switch (gd->type)
+    {
+    case GRID_LAMBERT:
+      lo1 = gd->grid.lambert.lo1;
+      lov = gd->grid.lambert.lov;
+      if (lo1 >= 180.) lo1 = lo1 - 360.;
+      if (lov >= 180.) lov = lov - 360.;
+      delx = gd->grid.lambert.dx;
+      delx = delx / 1000; // convert to km
+      stlmbr(stcpm, eqvlat(gd->grid.lambert.latin1, gd->grid.lambert.latin2), lov);
+      stcm1p(stcpm, 0.0, 0.0, gd->grid.lambert.la1, lo1, gd->grid.lambert.latin1, lov, delx, 0);
+      return(1);
+
+    case GRID_POLARS:
+      lo1 = gd->grid.polars.lo1;
+      lov = gd->grid.polars.lov;
+      if (lo1 >= 180.) lo1 = lo1 - 360.;
+      if (lov >= 180.) lov = lov - 360.;
+      delx = gd->grid.polars.dx;
+      delx = delx / 1000; // convert to km
+      sobstr(stcpm, 90., 0.);
+      // The NWS defines 60 degrees as their reference latitude
+      stcm1p(stcpm, 0.0, 0.0, gd->grid.polars.la1, lo1, 60.0, lov, delx, 0);
+      return(1);
+    }
+
+  return(0);
+}
+
+
+//
+// Computes a lat/lon box enclosing a projected nx by ny grid by walking
+// the perimeter of the grid, extended by one grid cell. Longitudes are
+// unwrapped along the walk so the box may cross the dateline. Returns 0
+// if the grid contains a pole, in which case no useful box exists.
+//
+#define BBOX_EDGE_SAMPLES 64	/* perimeter samples per grid edge */
+#define BBOX_PAD_DEG 0.5	/* padding for curvature between samples */
+
+static int proj_grid_bbox(maparam *stcpm, int nx, int ny, double *lat_min,
+			  double *lat_max, double *lon_min, double *lon_max)
+{
+  double x, y, lat, lon, prev_lon = 0.;
+  double px, py;
+  int e, k;
+
+  // A grid containing either pole spans all longitudes
+  cll2xy(stcpm, 90., 0., &px, &py);
+  if (px >= -1. && px <= nx && py >= -1. && py <= ny)
+    return(0);
+  cll2xy(stcpm, -90., 0., &px, &py);
+  if (px >= -1. && px <= nx && py >= -1. && py <= ny)
+    return(0);
+
+  for (e=0; e<4; e++)
+    for (k=0; k<BBOX_EDGE_SAMPLES; k++)
+      {
+	double f = (double) k / BBOX_EDGE_SAMPLES;
+
+	switch (e)
+	  {
+	  case 0:  x = -1. + f*(nx+1);  y = -1.;  break;
+	  case 1:  x = nx;  y = -1. + f*(ny+1);  break;
+	  case 2:  x = nx - f*(nx+1);  y = ny;  break;
+	  default: x = -1.;  y = ny - f*(ny+1);  break;
+	  }
+
+	cxy2ll(stcpm, x, y, &lat, &lon);
+
+	if (e == 0 && k == 0)
+	  {
+	    *lat_min = *lat_max = lat;
+	    *lon_min = *lon_max = prev_lon = lon;
+	    continue;
+	  }
+
+	while (lon - prev_lon > 180.) lon -= 360.;
+	while (lon - prev_lon < -180.) lon += 360.;
+	prev_lon = lon;
+
+	if (lat < *lat_min) *lat_min = lat;
+	if (lat > *lat_max) *lat_max = lat;
+	if (lon < *lon_min) *lon_min = lon;
+	if (lon > *lon_max) *lon_max = lon;
+      }
+
+  *lat_min -= BBOX_PAD_DEG;
+  *lat_max += BBOX_PAD_DEG;
+  *lon_min -= BBOX_PAD_DEG;
+  *lon_max += BBOX_PAD_DEG;
+
+  return(1);
+}
+
+
+//
+// Sparse remap matrix for area averages. Row ns lists the grid points
+// whose centres lie within the averaging radius of site ns, with their
+// weights. One is built per grid (or tile) and radius, the first time a
+// field on it is averaged, and is then applied to each field as a sparse
+// matrix-vector product.
+//
+#define REMAP_KEY_LEN 16	/* grid navigation and radius */
+
+typedef struct site_remap {
+  float key[REMAP_KEY_LEN];
+  int num_sites;
+  int *first;			/* per site, offset of row in pts[], wgt[] */
+  int *count;			/* per site, number of grid points in row */
+  int *pts;			/* grid point indices */
+  float *wgt;			/* weights */
+  int npts;			/* length of pts[] and wgt[] */
+  int size;			/* allocated length of pts[] and wgt[] */
+  int built;			/* 1 once the rows are complete */
+  struct site_remap *next;
+} site_remap;
+
+static site_remap *remaps;
+
+
+//
+// Returns the remap for a grid and radius, adding an empty one if there
+// is none
+//
+static site_remap *get_remap(float *key, int num_sites)
+{
+  site_remap *rm;
+
+  for (rm = remaps; rm; rm = rm->next)
+    if (rm->num_sites == num_sites &&
+	memcmp(rm->key, key, sizeof(rm->key)) == 0)
+      return(rm);
+
+  rm = (site_remap *)emalloc(sizeof(site_remap));
+  memset(rm, 0, sizeof(site_remap));
+  memcpy(rm->key, key, sizeof(rm->key));
+  rm->num_sites = num_sites;
+  rm->first = (int *)emalloc(num_sites * sizeof(int));
+  rm->count = (int *)emalloc(num_sites * sizeof(int));
+  memset(rm->first, 0, num_sites * sizeof(int));
+  memset(rm->count, 0, num_sites * sizeof(int));
+  rm->next = remaps;
+  remaps = rm;
+
+  return(rm);
+}
+
+
+static void add_remap_point(site_remap *rm, int ind, float wgt)
+{
+  if (rm->npts == rm->size)
+    {
+      rm->size = (rm->size ? 2 * rm->size : 4096);
+      rm->pts = (int *)erealloc(rm->pts, rm->size * sizeof(int));
+      rm->wgt = (float *)erealloc(rm->wgt, rm->size * sizeof(float));
+    }
+  rm->pts[rm->npts] = ind;
+  rm->wgt[rm->npts] = wgt;
+  rm->npts++;
+}
+
+
+//
+// Fills in the row of site ns, at grid coordinates x, y where the grid
+// spacing is dx by dy meters. Points of a lat/lon grid are weighted by the
+// cosine of their latitude, lat_j(j) = lat0 + j*dlat, for their area; those
+// of projected grids are equal. A site whose footprint holds no grid point
+// centre gets the nearest point.
+//
+static void add_remap_row(site_remap *rm, int ns, double x, double y,
+			  double dx, double dy, int nx, int ny, int wrap_flag,
+			  float radius, int ll, float lat0, float dlat)
+{
+  double rx = radius * 1000. / fabs(dx);
+  double ry = radius * 1000. / fabs(dy);
+  int i0 = (int) ceil(x - rx), i1 = (int) floor(x + rx);
+  int j0 = (int) ceil(y - ry), j1 = (int) floor(y + ry);
+  int i, j, ii;
+
+  if (j0 < 0) j0 = 0;
+  if (j1 > ny-1) j1 = ny-1;
+
+  rm->first[ns] = rm->npts;
+
+  for (j=j0; j<=j1; j++)
+    {
+      double dj = (j - y) / ry;
+      float wgt = (ll ? cos(RADPDEG * (lat0 + j * dlat)) : 1.);
+
+      for (i=i0; i<=i1; i++)
+	{
+	  double di = (i - x) / rx;
+
+	  if (di*di + dj*dj > 1.)
+	    continue;
+
+	  ii = i;
+	  if (wrap_flag)
+	    ii = ((ii % nx) + nx) % nx;
+	  else if (ii < 0 || ii > nx-1)
+	    continue;
+
+	  add_remap_point(rm, j * nx + ii, wgt);
+	}
+    }
+
+  if (rm->npts == rm->first[ns])
+    {
+      i = (int) floor(x + 0.5);
+      j = (int) floor(y + 0.5);
+      if (i > nx-1) i = (wrap_flag ? 0 : nx-1);
+      if (j > ny-1) j = ny-1;
+      add_remap_point(rm, j * nx + i, 1.);
+    }
+
+  rm->count[ns] = rm->npts - rm->first[ns];
+}
+
+
+//
+// Sets each site with a row to the weighted average of the non-missing
+// grid values of its row. Sites with no row, or no values, keep the
+// value they have.
+//
+static void apply_remap(site_remap *rm, float *data, float fillval,
+			float *site_data)
+{
+  for (int ns=0; ns<rm->num_sites; ns++)
+    {
+      const int *pts = rm->pts + rm->first[ns];
+      const float *wgt = rm->wgt + rm->first[ns];
+      int n = rm->count[ns];
+      double sum = 0., wsum = 0.;
+
+      for (int k=0; k<n; k++)
+	{
+	  float val = data[pts[k]];
+	  if (val != fillval)
+	    {
+	      sum += wgt[k] * val;
+	      wsum += wgt[k];
+	    }
+	}
+
+      if (wsum > 0.)
+	site_data[ns] = sum / wsum;
+    }
+}
+
+
 //
 // Takes a grid and lat/lon arrays and calculates values at each location.
 // What is calculated is governed by "calc_type". This can be a type of
@@ -259,16 +520,19 @@ int process_sites(char *sitefile, int ncid, float **lat_arr, float **lon_arr, in
 // The site_data array is already populated on input. Only sites that are in
 // the grid area are updated on output. This allows processing  of grid
 // "tiles". If tiles overlap (ie, a site is located on both grids), then data
-// from the final tile are output.
+// from the final tile are output. The site index, if given, limits the sites
+// visited to those that can fall within the lat/lon box of the grid.
+// For "area_average", a site gets the average of the grid points within
+// radius km of it, by way of a remap matrix built for the grid on first use.
 //
 // Returns 1 on success, 0 on failure.
 //
 
-int make_site_data(product_data *pd, float fillval, char *calc_type, float *lat_arr, float *lon_arr, int num_sites, float *site_data)
+int make_site_data(product_data *pd, float fillval, char *calc_type, float radius, float *lat_arr, float *lon_arr, int num_sites, site_index *sidx, float *site_data)
 {
   int nx, ny;
-  float la1, lo1, la2 = -9999, lo2, lov;
-  float latin1, latin2;
+  float la1, lo1, la2 = -9999, lo2 = 0, lov = 0;
+  float latin1 = 0, latin2 = 0;
   float iref, jref;
   float delx, dely;
   double x, y;
@@ -284,6 +548,11 @@ int make_site_data(product_data *pd, float fillval, char *calc_type, float *lat_
   float grad[2];
   double ival;
   int wrap_flag = 0;
+  int have_bbox = 0;
+  double bb_lat_min, bb_lat_max, bb_lon_min, bb_lon_max;
+  int *cand = 0;
+  int ncand, k;
+  site_remap *rm = 0;
 
 
   // Set up grid navigation details. Currently, we can handle lat/lon,
@@ -307,12 +576,24 @@ int make_site_data(product_data *pd, float fillval, char *calc_type, float *lat_
 
       // keep lo2 > lo1
       if (lo1 >= 180.) lo1 = lo1 - 360.;
+      if (lo2 >= 180.) lo2 = lo2 - 360.;
       if (lo2 < lo1) lo2 = lo2 + 360.;
 
       // check if grid wraps the globe longitudinally
       if ((360.0 - fabs(lo2-lo1)) <= delx)  
 	wrap_flag = 1;
 
+      // Sites are rotated before locating them on rotated grids, so only
+      // plain lat/lon grids get a bounding box
+      if (pd->gd->type == GRID_LL)
+	{
+	  have_bbox = 1;
+	  bb_lat_min = (la1 < la2 ? la1 : la2) - dely;
+	  bb_lat_max = (la1 < la2 ? la2 : la1) + dely;
+	  bb_lon_min = lo1 - delx;
+	  bb_lon_max = (wrap_flag ? lo1 + 360. : lo2 + delx);
+	}
+
       break;
 
     case GRID_GAU:
@@ -333,6 +614,7 @@ int make_site_data(product_data *pd, float fillval, char *calc_type, float *lat_
 
       // keep lo2 > lo1
       if (lo1 >= 180.) lo1 = lo1 - 360.;
+      if (lo2 >= 180.) lo2 = lo2 - 360.;
       if (lo2 < lo1) lo2 = lo2 + 360.;
 
       // Compute grid spacing using first and last points
@@ -343,6 +625,12 @@ int make_site_data(product_data *pd, float fillval, char *calc_type, float *lat_
       if ((360.0 - fabs(lo2-lo1)) <= delx)  
 	wrap_flag = 1;
 
+      have_bbox = 1;
+      bb_lat_min = (la1 < la2 ? la1 : la2) - dely;
+      bb_lat_max = (la1 < la2 ? la2 : la1) + dely;
+      bb_lon_min = lo1 - delx;
+      bb_lon_max = (wrap_flag ? lo1 + 360. : lo2 + delx);
+
       break;
 
     case GRID_LAMBERT:
@@ -359,8 +647,9 @@ int make_site_data(product_data *pd, float fillval, char *calc_type, float *lat_
       latin2 = pd->gd->grid.lambert.latin2;
       delx = delx / 1000; // convert to km
       dely = dely / 1000; // convert to km
-      stlmbr(&stcpm, eqvlat(latin1, latin2), lov);
-      stcm1p(&stcpm, 0.0, 0.0, la1, lo1, latin1, lov, delx, 0);
+      proj_grid_map(pd->gd, &stcpm);
+      have_bbox = proj_grid_bbox(&stcpm, nx, ny, &bb_lat_min, &bb_lat_max,
+				 &bb_lon_min, &bb_lon_max);
       break;
 
     case GRID_POLARS:
@@ -376,8 +665,9 @@ int make_site_data(product_data *pd, float fillval, char *calc_type, float *lat_
       latin1 = 60.0;  // The NWS defines this as their reference latitude
       delx = delx / 1000; // convert to km
       dely = dely / 1000; // convert to km
-      sobstr(&stcpm, 90., 0.);
-      stcm1p(&stcpm, 0.0, 0.0, la1, lo1, latin1, lov, delx, 0);
+      proj_grid_map(pd->gd, &stcpm);
+      have_bbox = proj_grid_bbox(&stcpm, nx, ny, &bb_lat_min, &bb_lat_max,
+				 &bb_lon_min, &bb_lon_max);
       break;
 
     default:
@@ -389,10 +679,55 @@ int make_site_data(product_data *pd, float fillval, char *calc_type, float *lat_
   iref = 0.;
   jref = 0.;
 
+  // Area averages come from the remap matrix of this grid, once built
+  if (strcmp(calc_type, "area_average") == 0)
+    {
+      // Projected grids are placed by their first point and spacing,
+      // rotated lat/lon grids also by their pole, and the scanning mode
+      // orders the points the remap indexes
+      float pole_lat = 0, pole_lon = 0;
+      if (pd->gd->type == GRID_RLL)
+	{
+	  pole_lat = pd->gd->grid.ll.rot->lat;
+	  pole_lon = pd->gd->grid.ll.rot->lon;
+	}
+      float key[REMAP_KEY_LEN] = { (float) pd->gd->type, (float) nx, (float) ny,
+				   la1, lo1, la2, lo2, delx, dely, lov, latin1, latin2,
+				   pole_lat, pole_lon, (float) pd->gd->scan_mode, radius };
+
+      if (radius <= 0.)
+	{
+	  logFile->write_time("Error: %s, area_average needs a radius\n", pd->header);
+	  return(0);
+	}
+
+      rm = get_remap(key, num_sites);
+      if (rm->built)
+	{
+	  apply_remap(rm, pd->data, fillval, site_data);
+	  return(1);
+	}
+      logFile->write_time(1, "Info: %s: building %.1f km area average remap\n",
+			  pd->header, radius);
+    }
+
+  // Limit the sites to those that may lie on this grid (or tile). Without
+  // an index or a bounding box, every site is checked.
+  ncand = num_sites;
+  if (sidx && have_bbox)
+    {
+      ncand = site_index_query(sidx, bb_lat_min, bb_lat_max, bb_lon_min,
+			       bb_lon_max, &cand);
+      logFile->write_time(2, "Info: %s: %d of %d sites within lat %.2f to %.2f, lon %.2f to %.2f\n",
+			  pd->header, ncand, num_sites, bb_lat_min, bb_lat_max,
+			  bb_lon_min, bb_lon_max);
+    }
+
   // Loop over sites, determine x, y grid coordinate and dx, dy from lat, lon
 
-  for (ns=0; ns<num_sites; ns++)
+  for (k=0; k<ncand; k++)
     {
+      ns = (cand ? cand[k] : k);
       //printf("ns: %d\n", ns);
 
       // Handle lat/lon and rotated lat/lon grids here
@@ -495,6 +830,14 @@ int make_site_data(product_data *pd, float fillval, char *calc_type, float *lat_
           continue;
         }
 
+      if (rm)
+	{
+	  int ll = (pd->gd->type == GRID_LL || pd->gd->type == GRID_GAU);
+	  add_remap_row(rm, ns, x, y, dx, dy, nx, ny, wrap_flag, radius, ll,
+			la1, (la1 < la2 ? dely : -dely));
+	  continue;
+	}
+
       // Find values at surrounding grid points.
       x_corners[0] = (int) floor(x);
       x_corners[1] = (int) ceil(x);
@@ -579,5 +922,62 @@ int make_site_data(product_data *pd, float fillval, char *calc_type, float *lat_
 
     }
 
+    if (rm)
+      {
+	rm->built = 1;
+	logFile->write_time(2, "Info: %s: remap of %d grid points\n", pd->header, rm->npts);
+	apply_remap(rm, pd->data, fillval, site_data);
+      }
+
     return(1);
 }
+
+
+//
+// For vector components resolved relative to the grid (RESCMP_UVRES) of
+// pd, sets cosa and sina at each site to the cosine and sine of the angle
+// from east to the grid's x axis, the grid convergence, so that
+//
+//	u_earth = u_grid * cosa - v_grid * sina
+//	v_earth = u_grid * sina + v_grid * cosa
+//
+// Returns 1 if the components need this rotation, 0 if they are earth
+// relative (as grid relative components are on lat/lon, Gaussian and
+// Mercator grids), -1 if they are relative to a grid whose rotation is
+// not handled.
+//
+int grid_vector_rotation(product_data *pd, float *lat_arr, float *lon_arr, int num_sites,
+			 float *cosa, float *sina)
+{
+  maparam stcpm;
+  double ue, vn;
+
+  if (!(pd->gd->res_flags & RESCMP_UVRES))
+    return(0);
+
+  switch (pd->gd->type)
+    {
+    case GRID_LL:
+    case GRID_GAU:
+    case GRID_MERCAT:
+      return(0);
+
+    case GRID_LAMBERT:
+    case GRID_POLARS:
+      proj_grid_map(pd->gd, &stcpm);
+      break;
+
+    default:
+      return(-1);
+    }
+
+  // The earth relative components of a unit vector along the grid's x axis
+  for (int ns=0; ns<num_sites; ns++)
+    {
+      cg2wll(&stcpm, lat_arr[ns], lon_arr[ns], 1., 0., &ue, &vn);
+      cosa[ns] = ue;
+      sina[ns] = vn;
+    }
+
+  return(1);
+}
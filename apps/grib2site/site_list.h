@@ -4,11 +4,13 @@
  */
 
 #include "product_data.h"
+#include "site_index.h"
 
 #ifndef SITE_LIST_H
 #define SITE_LIST_H
 
-int process_sites(char *sitename, int ncid, float **lat, float **lon, int *ns);
-int make_site_data(product_data *pp, float fillval, char *calc_type, float *lat, float *lon, int ns, float *site_data);
+int process_sites(char *sitename, int ncid, float **lat, float **lon, int *ns, site_index **sidx);
+int make_site_data(product_data *pp, float fillval, char *calc_type, float radius, float *lat, float *lon, int ns, site_index *sidx, float *site_data);
+int grid_vector_rotation(product_data *pp, float *lat, float *lon, int ns, float *cosa, float *sina);
 
 #endif
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "log/log.hh"
+#include "stats.h"
+
+extern Log *logFile;
+extern unsigned long num_wmo_messages;
+extern unsigned long num_gribs_unpacked;
+extern unsigned long num_gribs_written;
+
+/* Distinct (edition, packing, unpack) combinations kept */
+#define MAX_PACKINGS 32
+#define PACKING_LEN 16
+
+typedef struct decode_stats {
+    int edition;
+    char packing[PACKING_LEN];	/* GRIB1 packing, or GRIB2 data
+				   representation template "5.N" */
+    int unpack;			/* 1 if data were unpacked */
+    unsigned long count;
+    double seconds;
+} decode_stats;
+
+static const char *stage_names[NUM_STATS_STAGES] = {
+    "get_prod", "decode", "interp", "nc_read", "nc_write"
+};
+
+static const char *skip_names[NUM_STATS_SKIPS] = {
+    "unrecognized_param", "missing_variable", "bad_level", "decode_error"
+};
+
+static double start_time = -1;
+static double stage_seconds[NUM_STATS_STAGES];
+static unsigned long stage_count[NUM_STATS_STAGES];
+static unsigned long skip_count[NUM_STATS_SKIPS];
+static unsigned long bytes_read;
+static decode_stats decodes[MAX_PACKINGS];
+static int num_decodes;
+static char *stats_file;
+
+
+//
+// Monotonic time in seconds
+//
+double stats_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  if (start_time < 0)
+    start_time = ts.tv_sec + ts.tv_nsec * 1.e-9;
+  return(ts.tv_sec + ts.tv_nsec * 1.e-9);
+}
+
+
+void stats_add_bytes(long nbytes)
+{
+  bytes_read += nbytes;
+}
+
+
+//
+// Adds the time since start (from stats_now()) to a stage
+//
+void stats_add_time(enum stats_stage stage, double start)
+{
+  stage_seconds[stage] += stats_now() - start;
+  stage_count[stage]++;
+}
+
+
+//
+// Adds the time since start to the decode stage, and to the totals for
+// the packing of the decoded product. A null product counts as a decode
+// error.
+//
+void stats_add_decode(product_data *pd, int unpack, double start)
+{
+  double secs = stats_now() - start;
+  char packing[PACKING_LEN];
+  int edition = 0;
+  int i;
+
+  stage_seconds[STAGE_DECODE] += secs;
+  stage_count[STAGE_DECODE]++;
+
+  if (!pd)
+    {
+      skip_count[SKIP_DECODE_ERROR]++;
+      strcpy(packing, "failed");
+    }
+  else if (pd->edition == 2)
+    {
+      edition = 2;
+      snprintf(packing, PACKING_LEN, "5.%d", pd->bits);
+    }
+  else
+    {
+      edition = pd->edition;
+      if (!pd->bd)
+	strcpy(packing, "unknown");
+      else if (pd->bd->is_sph_har)
+	strcpy(packing, "spherical");
+      else if (pd->bd->is_not_simple)
+	strcpy(packing, "second_order");
+      else
+	strcpy(packing, "simple");
+    }
+
+  for (i=0; i<num_decodes; i++)
+    if (decodes[i].edition == edition && decodes[i].unpack == unpack &&
+	strcmp(decodes[i].packing, packing) == 0)
+      break;
+
+  if (i == num_decodes)
+    {
+      if (num_decodes == MAX_PACKINGS)
+	return;
+      decodes[i].edition = edition;
+      strcpy(decodes[i].packing, packing);
+      decodes[i].unpack = unpack;
+      decodes[i].count = 0;
+      decodes[i].seconds = 0;
+      num_decodes++;
+    }
+
+  decodes[i].count++;
+  decodes[i].seconds += secs;
+}
+
+
+void stats_skip(enum stats_skip reason)
+{
+  skip_count[reason]++;
+}
+
+
+void stats_set_file(char *path)
+{
+  stats_file = path;
+}
+
+
+static void write_json(FILE *fp, double elapsed)
+{
+  int i;
+
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"elapsed_seconds\": %.6f,\n", elapsed);
+  fprintf(fp, "  \"messages\": %lu,\n", num_wmo_messages);
+  fprintf(fp, "  \"bytes_read\": %lu,\n", bytes_read);
+  fprintf(fp, "  \"fields_unpacked\": %lu,\n", num_gribs_unpacked);
+  fprintf(fp, "  \"fields_written\": %lu,\n", num_gribs_written);
+
+  fprintf(fp, "  \"stages\": {\n");
+  for (i=0; i<NUM_STATS_STAGES; i++)
+    fprintf(fp, "    \"%s\": {\"seconds\": %.6f, \"count\": %lu}%s\n", stage_names[i],
+	    stage_seconds[i], stage_count[i], (i < NUM_STATS_STAGES-1 ? "," : ""));
+  fprintf(fp, "  },\n");
+
+  fprintf(fp, "  \"decode\": [\n");
+  for (i=0; i<num_decodes; i++)
+    fprintf(fp, "    {\"edition\": %d, \"packing\": \"%s\", \"unpacked\": %d, \"seconds\": %.6f, \"count\": %lu}%s\n",
+	    decodes[i].edition, decodes[i].packing, decodes[i].unpack,
+	    decodes[i].seconds, decodes[i].count, (i < num_decodes-1 ? "," : ""));
+  fprintf(fp, "  ],\n");
+
+  fprintf(fp, "  \"skipped\": {\n");
+  for (i=0; i<NUM_STATS_SKIPS; i++)
+    fprintf(fp, "    \"%s\": %lu%s\n", skip_names[i], skip_count[i],
+	    (i < NUM_STATS_SKIPS-1 ? "," : ""));
+  fprintf(fp, "  }\n");
+  fprintf(fp, "}\n");
+}
+
+
+static void write_prom(FILE *fp, double elapsed)
+{
+  int i;
+
+  fprintf(fp, "# TYPE grib2site_elapsed_seconds gauge\n");
+  fprintf(fp, "grib2site_elapsed_seconds %.6f\n", elapsed);
+  fprintf(fp, "# TYPE grib2site_messages_total counter\n");
+  fprintf(fp, "grib2site_messages_total %lu\n", num_wmo_messages);
+  fprintf(fp, "# TYPE grib2site_bytes_read_total counter\n");
+  fprintf(fp, "grib2site_bytes_read_total %lu\n", bytes_read);
+  fprintf(fp, "# TYPE grib2site_fields_unpacked_total counter\n");
+  fprintf(fp, "grib2site_fields_unpacked_total %lu\n", num_gribs_unpacked);
+  fprintf(fp, "# TYPE grib2site_fields_written_total counter\n");
+  fprintf(fp, "grib2site_fields_written_total %lu\n", num_gribs_written);
+
+  fprintf(fp, "# TYPE grib2site_stage_seconds_total counter\n");
+  for (i=0; i<NUM_STATS_STAGES; i++)
+    fprintf(fp, "grib2site_stage_seconds_total{stage=\"%s\"} %.6f\n", stage_names[i], stage_seconds[i]);
+  fprintf(fp, "# TYPE grib2site_stage_calls_total counter\n");
+  for (i=0; i<NUM_STATS_STAGES; i++)
+    fprintf(fp, "grib2site_stage_calls_total{stage=\"%s\"} %lu\n", stage_names[i], stage_count[i]);
+
+  fprintf(fp, "# TYPE grib2site_decode_seconds_total counter\n");
+  for (i=0; i<num_decodes; i++)
+    fprintf(fp, "grib2site_decode_seconds_total{edition=\"%d\",packing=\"%s\",unpacked=\"%d\"} %.6f\n",
+	    decodes[i].edition, decodes[i].packing, decodes[i].unpack, decodes[i].seconds);
+  fprintf(fp, "# TYPE grib2site_decode_total counter\n");
+  for (i=0; i<num_decodes; i++)
+    fprintf(fp, "grib2site_decode_total{edition=\"%d\",packing=\"%s\",unpacked=\"%d\"} %lu\n",
+	    decodes[i].edition, decodes[i].packing, decodes[i].unpack, decodes[i].count);
+
+  fprintf(fp, "# TYPE grib2site_fields_skipped_total counter\n");
+  for (i=0; i<NUM_STATS_SKIPS; i++)
+    fprintf(fp, "grib2site_fields_skipped_total{reason=\"%s\"} %lu\n", skip_names[i], skip_count[i]);
+}
+
+
+//
+// Writes the statistics to the file given with stats_set_file(). Files
+// ending in ".prom" are written in the Prometheus text format, others as
+// JSON. The file is written under a temporary name and renamed, so that
+// readers never see a partial report. Returns 0 on success, -1 on error,
+// and 0 if no file was given.
+//
+int stats_write(void)
+{
+  char tmp_path[1024];
+  double elapsed;
+  size_t len;
+  FILE *fp;
+
+  if (!stats_file)
+    return(0);
+
+  elapsed = stats_now() - start_time;
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", stats_file);
+  fp = fopen(tmp_path, "w");
+  if (!fp)
+    {
+      logFile->write_time("Error: can't open statistics file %s\n", tmp_path);
+      return(-1);
+    }
+
+  len = strlen(stats_file);
+  if (len > 5 && strcmp(stats_file + len - 5, ".prom") == 0)
+    write_prom(fp, elapsed);
+  else
+    write_json(fp, elapsed);
+
+  if (fclose(fp) != 0 || rename(tmp_path, stats_file) != 0)
+    {
+      logFile->write_time("Error: can't write statistics file %s\n", stats_file);
+      remove(tmp_path);
+      return(-1);
+    }
+
+  logFile->write_time(1, "Info: wrote statistics to %s\n", stats_file);
+  return(0);
+}
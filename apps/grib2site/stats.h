@@ -0,0 +1,38 @@
+/*
+ * Ingest statistics: per-stage monotonic timers and counters, reported
+ * as JSON or as a Prometheus textfile at exit and on SIGUSR1.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "product_data.h"
+
+/* Timed stages of ingest */
+enum stats_stage {
+    STAGE_GET_PROD,		/* waiting for and reading GRIB messages */
+    STAGE_DECODE,		/* GRIB1/GRIB2 decoding, also kept per packing */
+    STAGE_INTERP,		/* grid to site interpolation */
+    STAGE_NC_READ,		/* reading existing site values (tiles) */
+    STAGE_NC_WRITE,		/* writing site values */
+    NUM_STATS_STAGES
+};
+
+/* Reasons a decoded field is not written */
+enum stats_skip {
+    SKIP_UNRECOGNIZED_PARAM,	/* no variable name for (param,level_flg) */
+    SKIP_MISSING_VAR,		/* variable not in output file */
+    SKIP_BAD_LEVEL,		/* level not in output file */
+    SKIP_DECODE_ERROR,		/* message could not be decoded */
+    NUM_STATS_SKIPS
+};
+
+double stats_now(void);
+void stats_add_bytes(long nbytes);
+void stats_add_time(enum stats_stage stage, double start);
+void stats_add_decode(product_data *pd, int unpack, double start);
+void stats_skip(enum stats_skip reason);
+void stats_set_file(char *path);
+int stats_write(void);
+
+#endif
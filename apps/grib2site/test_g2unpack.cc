@@ -0,0 +1,286 @@
+//----------------------------------------------------------------------
+// Module: test_g2unpack.cc
+//
+// Description:
+//     Checks g2_unpack_native() against g2clib's g2_getfld(). Each
+//     message of the corpus in test_g2unpack_corpus.h is unpacked both
+//     ways, with and without expanding to the grid, and the values (and
+//     bit map) compared bit for bit, and with the values the message was
+//     packed from. Fields packed by g2clib itself with templates 5.0,
+//     5.2 and 5.3, large enough to span several of the decoder's chunks,
+//     are then compared the same way. Exits non-zero on failure.
+//----------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log/log.hh"
+#include "arena.h"
+#include "g2unpack.h"
+#include "test_g2unpack_corpus.h"
+
+Log *logFile;
+
+// Grid of the fields packed by g2clib
+#define NI 100
+#define NJ 37
+#define NPTS (NI * NJ)
+
+#define MISSING1 9999.0
+#define MISSING2 -9999.0
+
+
+static const char *field_name(const char *name, int expand)
+{
+  static char buf[80];
+
+  snprintf(buf, sizeof(buf), "%s%s", name, expand ? " (expanded)" : "");
+  return(buf);
+}
+
+
+//
+// Unpacks field 1 of msg with g2clib and natively and compares the two.
+// If expected is set, also compares the values with it, given for every
+// grid point. Returns the number of failures.
+//
+static int check_field(const char *name, unsigned char *msg, unsigned int len,
+		       const float *expected, int expand)
+{
+  GRIB2::gribfield *ref = 0, *fld = 0;
+  int nfail = 0;
+
+  arena_reset();
+
+  if (GRIB2::g2_getfld(msg, 1, 1, expand, &ref) != 0 ||
+      GRIB2::g2_getfld(msg, 1, 0, 0, &fld) != 0)
+    {
+      printf("%s: g2_getfld failed\n", field_name(name, expand));
+      if (ref)
+	GRIB2::g2_free(ref);
+      if (fld)
+	GRIB2::g2_free(fld);
+      return(1);
+    }
+
+  if (g2_unpack_native(msg, len, 1, fld, expand) != 0)
+    {
+      printf("%s: not unpacked natively\n", field_name(name, expand));
+      GRIB2::g2_free(ref);
+      GRIB2::g2_free(fld);
+      return(1);
+    }
+
+  GRIB2::g2int n = (expand && fld->ibmap != 255 ? fld->ngrdpts : fld->ndpts);
+
+  for (GRIB2::g2int i=0; i<n; i++)
+    if (memcmp(&fld->fld[i], &ref->fld[i], sizeof(GRIB2::g2float)) != 0)
+      {
+	if (nfail++ < 5)
+	  printf("%s: value %ld is %.9g, g2clib %.9g\n", field_name(name, expand), (long)i,
+		 fld->fld[i], ref->fld[i]);
+      }
+
+  if (fld->ibmap != 255)
+    for (GRIB2::g2int i=0; i<fld->ngrdpts; i++)
+      if (fld->bmap[i] != ref->bmap[i])
+	{
+	  if (nfail++ < 5)
+	    printf("%s: bit map %ld differs\n", field_name(name, expand), (long)i);
+	}
+
+  if (fld->expanded != ref->expanded || fld->unpacked != ref->unpacked)
+    {
+      printf("%s: unpacked/expanded flags differ\n", field_name(name, expand));
+      nfail++;
+    }
+
+  // The expected values are for every grid point; without expanding
+  // only the points in the bit map are unpacked
+  if (expected)
+    for (GRIB2::g2int i=0, k=0; i<fld->ngrdpts; i++)
+      {
+	if (!expand && fld->ibmap != 255 && fld->bmap[i] == 0)
+	  continue;
+
+	GRIB2::g2float val = expected[i];
+	if (memcmp(&fld->fld[k], &val, sizeof(GRIB2::g2float)) != 0)
+	  {
+	    if (nfail++ < 5)
+	      printf("%s: value %ld is %.9g, expected %.9g\n", field_name(name, expand), (long)k,
+		     fld->fld[k], val);
+	  }
+	k++;
+      }
+
+  GRIB2::g2_free(ref);
+  g2_free_native(fld);
+
+  if (nfail == 0)
+    printf("%s: ok\n", field_name(name, expand));
+  return(nfail);
+}
+
+
+static int check_message(const char *name, const unsigned char *msg, unsigned int len,
+			 const float *expected)
+{
+  // g2_getfld() takes a non-const message
+  unsigned char *buf = (unsigned char *)malloc(len);
+  int nfail;
+
+  memcpy(buf, msg, len);
+  nfail = check_field(name, buf, len, expected, 0);
+  nfail += check_field(name, buf, len, expected, 1);
+  free(buf);
+  return(nfail);
+}
+
+
+static GRIB2::g2int ieee_bits(GRIB2::g2float val)
+{
+  unsigned int u;
+
+  memcpy(&u, &val, sizeof(u));
+  return((GRIB2::g2int)u);
+}
+
+
+//
+// Packs fld, NPTS values, into a message with g2clib using data
+// representation template drtnum. Returns the message length, or -1.
+//
+static GRIB2::g2int encode(unsigned char *cgrib, GRIB2::g2int drtnum, const GRIB2::g2int *drt,
+			   int drtlen, GRIB2::g2float *fld, GRIB2::g2int ibmap, GRIB2::g2int *bmap)
+{
+  GRIB2::g2int listsec0[2] = {0, 2};
+  GRIB2::g2int listsec1[13] = {7, 0, 2, 1, 1, 2024, 6, 1, 12, 0, 0, 0, 1};
+  GRIB2::g2int igds[5] = {0, NPTS, 0, 0, 0};
+  GRIB2::g2int igdstmpl[19] = {6, 0, 0, 0, 0, 0, 0, NI, NJ, 0, 0, 40000000, 260000000, 48,
+			40000000 + (NJ - 1) * 250000, 260000000 + (NI - 1) * 250000, 250000, 250000, 64};
+  GRIB2::g2int ipdstmpl[15] = {0, 0, 2, 0, 96, 0, 0, 1, 0, 1, 0, 0, 255, 0, 0};
+  GRIB2::g2int idrstmpl[18];
+
+  // g2_addfield() fills in the template, so each field gets a copy
+  memcpy(idrstmpl, drt, drtlen * sizeof(GRIB2::g2int));
+
+  if (GRIB2::g2_create(cgrib, listsec0, listsec1) < 0 ||
+      GRIB2::g2_addgrid(cgrib, igds, igdstmpl, 0, 0) < 0 ||
+      GRIB2::g2_addfield(cgrib, 0, ipdstmpl, 0, 0, drtnum, idrstmpl, fld, NPTS, ibmap, bmap) < 0)
+    return(-1);
+
+  return(GRIB2::g2_gribend(cgrib));
+}
+
+
+//
+// A temperature-like field in hundredths, with noise so that the groups
+// of the complex packing vary in width
+//
+static void make_field(GRIB2::g2float *fld, int nmissing, GRIB2::g2int missmgmt)
+{
+  for (int j=0; j<NJ; j++)
+    for (int i=0; i<NI; i++)
+      {
+	double val = 280. + 15. * sin(i * 0.07) + 8. * cos(j * 0.3) + (rand() % 200) * 0.01;
+	fld[j * NI + i] = (GRIB2::g2float)(floor(val * 100. + 0.5) / 100.);
+      }
+
+  // Missing values singly and in runs, alternately primary and
+  // secondary for missing value management 2
+  for (int n=0; n<nmissing; n++)
+    {
+      int start = rand() % NPTS;
+      int run = (n % 3 == 0 ? 40 : 1);
+      for (int k=start; k<start+run && k<NPTS; k++)
+	fld[k] = (missmgmt == 2 && n % 2 == 1 ? MISSING2 : MISSING1);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+  int nfail = 0;
+
+  logFile = new Log();
+
+  //
+  // The corpus
+  //
+  nfail += check_message("simple", simple_msg, sizeof(simple_msg), simple_values);
+  nfail += check_message("constant", constant_msg, sizeof(constant_msg), constant_values);
+  nfail += check_message("bitmap", bitmap_msg, sizeof(bitmap_msg), bitmap_values);
+  nfail += check_message("complex", complex_msg, sizeof(complex_msg), complex_values);
+  nfail += check_message("complex_missing", complex_missing_msg, sizeof(complex_missing_msg),
+			 complex_missing_values);
+  nfail += check_message("diff1", diff1_msg, sizeof(diff1_msg), diff1_values);
+  nfail += check_message("diff2_missing", diff2_missing_msg, sizeof(diff2_missing_msg),
+			 diff2_missing_values);
+
+  //
+  // Fields packed by g2clib: reference value, binary and decimal scale
+  // factors, number of bits and the rest are filled in by the encoder
+  // apart from the decimal scale, missing value management and order
+  // of spatial differencing set here
+  //
+  struct {
+    const char *name;
+    GRIB2::g2int drtnum;
+    GRIB2::g2int drt[18];
+    int drtlen;
+    int nmissing;
+    int bitmap;
+  } encoded[] = {
+    {"g2clib 5.0", 0, {0, 0, 2, 0, 0}, 5, 0, 0},
+    {"g2clib 5.0 bitmap", 0, {0, 0, 2, 0, 0}, 5, 0, 1},
+    {"g2clib 5.2", 2, {0, 0, 2, 0, 0, 1, 0, 0, 0}, 16, 0, 0},
+    {"g2clib 5.2 missing", 2, {0, 0, 2, 0, 0, 1, 1, ieee_bits(MISSING1), 0}, 16, 30, 0},
+    {"g2clib 5.3 order 1", 3, {0, 0, 2, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0}, 18, 0, 0},
+    {"g2clib 5.3 order 2 missing", 3,
+     {0, 0, 2, 0, 0, 1, 2, ieee_bits(MISSING1), ieee_bits(MISSING2), 0, 0, 0, 0, 0, 0, 0, 2, 0},
+     18, 30, 0},
+    {"g2clib 5.3 order 2 bitmap", 3, {0, 0, 2, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0}, 18, 0, 1},
+  };
+
+  GRIB2::g2float *fld = (GRIB2::g2float *)malloc(NPTS * sizeof(GRIB2::g2float));
+  GRIB2::g2int *bmap = (GRIB2::g2int *)malloc(NPTS * sizeof(GRIB2::g2int));
+  unsigned char *cgrib = (unsigned char *)malloc(NPTS * sizeof(GRIB2::g2float) + 4096);
+
+  srand(1);
+  for (size_t e=0; e<sizeof(encoded)/sizeof(encoded[0]); e++)
+    {
+      make_field(fld, encoded[e].nmissing, encoded[e].drtlen > 6 ? encoded[e].drt[6] : 0);
+
+      // Every seventh point and a block of rows left out of the bit map
+      for (GRIB2::g2int i=0; i<NPTS; i++)
+	bmap[i] = !(encoded[e].bitmap && (i % 7 == 3 || (i / NI >= 10 && i / NI < 14)));
+
+      GRIB2::g2int len = encode(cgrib, encoded[e].drtnum, encoded[e].drt, encoded[e].drtlen,
+				fld, encoded[e].bitmap ? 0 : 255, bmap);
+      if (len < 0)
+	{
+	  printf("%s: g2clib could not pack the field\n", encoded[e].name);
+	  nfail++;
+	  continue;
+	}
+
+      nfail += check_field(encoded[e].name, cgrib, (unsigned int)len, 0, 0);
+      nfail += check_field(encoded[e].name, cgrib, (unsigned int)len, 0, 1);
+    }
+
+  free(fld);
+  free(bmap);
+  free(cgrib);
+  arena_release();
+  delete logFile;
+
+  if (nfail)
+    {
+      printf("test_g2unpack: %d failures\n", nfail);
+      return(1);
+    }
+
+  printf("test_g2unpack: all fields match\n");
+  return(0);
+}
@@ -0,0 +1,202 @@
+/*
+ * Corpus of GRIB2 messages for test_g2unpack, one field each on a small
+ * latitude-longitude grid (template 3.0, product template 4.0), with the
+ * values each was packed from. The values are exact in float so that
+ * both decoders must give them bit for bit.
+ */
+
+#ifndef TEST_G2UNPACK_CORPUS_H
+#define TEST_G2UNPACK_CORPUS_H
+
+/* Template 5.0, 4 x 3 grid, 6 bit values, binary scale -1 */
+static const unsigned char simple_msg[] = {
+  0x47, 0x52, 0x49, 0x42, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0xbb, 0x00, 0x00, 0x00, 0x15, 0x01, 0x00, 0x07, 0x00,
+  0x00, 0x02, 0x01, 0x01, 0x07, 0xe8, 0x06, 0x01, 0x0c, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x00,
+  0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+  0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+  0x62, 0x5a, 0x00, 0x0f, 0x7f, 0x49, 0x00, 0x30, 0x02, 0x80, 0xde, 0x80,
+  0x0f, 0xad, 0x0f, 0xc0, 0x00, 0x0f, 0x42, 0x40, 0x00, 0x0f, 0x42, 0x40,
+  0x40, 0x00, 0x00, 0x00, 0x21, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x02, 0x00, 0x60, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x15, 0x05, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x43, 0x7a, 0x00,
+  0x00, 0x80, 0x01, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x06, 0x06,
+  0xff, 0x00, 0x00, 0x00, 0x0e, 0x07, 0x00, 0x11, 0x51, 0x87, 0xf0, 0xa8,
+  0x30, 0x7f, 0x19, 0x37, 0x37, 0x37, 0x37,
+};
+
+static const float simple_values[] = {
+  250.0, 250.5, 252.5, 258.5, 266.5, 281.5, 251.0, 270.0,
+  256.0, 253.5, 280.0, 262.5,
+};
+
+/* Template 5.0, constant field sent with 0 bits */
+static const unsigned char constant_msg[] = {
+  0x47, 0x52, 0x49, 0x42, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0xb2, 0x00, 0x00, 0x00, 0x15, 0x01, 0x00, 0x07, 0x00,
+  0x00, 0x02, 0x01, 0x01, 0x07, 0xe8, 0x06, 0x01, 0x0c, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x00,
+  0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+  0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+  0x62, 0x5a, 0x00, 0x0f, 0x7f, 0x49, 0x00, 0x30, 0x02, 0x80, 0xde, 0x80,
+  0x0f, 0xad, 0x0f, 0xc0, 0x00, 0x0f, 0x42, 0x40, 0x00, 0x0f, 0x42, 0x40,
+  0x40, 0x00, 0x00, 0x00, 0x21, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x02, 0x00, 0x60, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x15, 0x05, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x40, 0x60, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x06,
+  0xff, 0x00, 0x00, 0x00, 0x05, 0x07, 0x37, 0x37, 0x37, 0x37,
+};
+
+static const float constant_values[] = {
+  3.5, 3.5, 3.5, 3.5, 3.5, 3.5, 3.5, 3.5,
+  3.5, 3.5, 3.5, 3.5,
+};
+
+/* Template 5.0 with a bit map, 8 of 12 points present; values
+   expanded to the grid, 0 where the bit map is not set */
+static const unsigned char bitmap_msg[] = {
+  0x47, 0x52, 0x49, 0x42, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0xb9, 0x00, 0x00, 0x00, 0x15, 0x01, 0x00, 0x07, 0x00,
+  0x00, 0x02, 0x01, 0x01, 0x07, 0xe8, 0x06, 0x01, 0x0c, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x00,
+  0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+  0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+  0x62, 0x5a, 0x00, 0x0f, 0x7f, 0x49, 0x00, 0x30, 0x02, 0x80, 0xde, 0x80,
+  0x0f, 0xad, 0x0f, 0xc0, 0x00, 0x0f, 0x42, 0x40, 0x00, 0x0f, 0x42, 0x40,
+  0x40, 0x00, 0x00, 0x00, 0x21, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x02, 0x00, 0x60, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x15, 0x05, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0xc1, 0x20, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x08, 0x06,
+  0x00, 0xdb, 0x60, 0x00, 0x00, 0x00, 0x0a, 0x07, 0x1f, 0xc1, 0x14, 0xf8,
+  0x36, 0x37, 0x37, 0x37, 0x37,
+};
+
+static const float bitmap_values[] = {
+  -7.0, 21.0, 0.0, -10.0, 7.0, 0.0, -1.0, 20.0,
+  0.0, -9.0, 12.0, 0.0,
+};
+
+/* Template 5.2, no missing values, groups of widths 0, 3 and 4 */
+static const unsigned char complex_msg[] = {
+  0x47, 0x52, 0x49, 0x42, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0xd9, 0x00, 0x00, 0x00, 0x15, 0x01, 0x00, 0x07, 0x00,
+  0x00, 0x02, 0x01, 0x01, 0x07, 0xe8, 0x06, 0x01, 0x0c, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00, 0x00, 0x00, 0x14, 0x00,
+  0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00,
+  0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+  0x62, 0x5a, 0x00, 0x0f, 0x7f, 0x49, 0x00, 0x30, 0x02, 0x90, 0x20, 0xc0,
+  0x0f, 0xbc, 0x52, 0x00, 0x00, 0x0f, 0x42, 0x40, 0x00, 0x0f, 0x42, 0x40,
+  0x40, 0x00, 0x00, 0x00, 0x21, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x02, 0x00, 0x60, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x2f, 0x05, 0x00, 0x00, 0x00, 0x14, 0x00, 0x02, 0x42, 0xc8, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x03, 0x00,
+  0x00, 0x00, 0x05, 0x01, 0x00, 0x00, 0x00, 0x07, 0x02, 0x00, 0x00, 0x00,
+  0x06, 0x06, 0xff, 0x00, 0x00, 0x00, 0x12, 0x07, 0x00, 0xaa, 0x00, 0x0e,
+  0x00, 0x30, 0x1d, 0xd3, 0x94, 0xf0, 0x83, 0xc1, 0x90, 0x37, 0x37, 0x37,
+  0x37,
+};
+
+static const float complex_values[] = {
+  100.0, 100.0, 100.0, 100.0, 100.0, 110.0, 117.0, 113.0,
+  115.0, 111.0, 116.0, 112.0, 114.0, 155.0, 140.0, 148.0,
+  143.0, 152.0, 141.0, 149.0,
+};
+
+/* Template 5.2, primary (9999) and secondary (-9999) missing values,
+   in constant groups and within groups */
+static const unsigned char complex_missing_msg[] = {
+  0x47, 0x52, 0x49, 0x42, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0xd5, 0x00, 0x00, 0x00, 0x15, 0x01, 0x00, 0x07, 0x00,
+  0x00, 0x02, 0x01, 0x01, 0x07, 0xe8, 0x06, 0x01, 0x0c, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+  0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+  0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+  0x62, 0x5a, 0x00, 0x0f, 0x7f, 0x49, 0x00, 0x30, 0x02, 0x90, 0x20, 0xc0,
+  0x0f, 0xad, 0x0f, 0xc0, 0x00, 0x0f, 0x42, 0x40, 0x00, 0x0f, 0x42, 0x40,
+  0x40, 0x00, 0x00, 0x00, 0x21, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x02, 0x00, 0x60, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x2f, 0x05, 0x00, 0x00, 0x00, 0x10, 0x00, 0x02, 0xc0, 0xa0, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x01, 0x02, 0x46, 0x1c, 0x3c,
+  0x00, 0xc6, 0x1c, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x02, 0x00,
+  0x00, 0x00, 0x02, 0x01, 0x00, 0x00, 0x00, 0x06, 0x03, 0x00, 0x00, 0x00,
+  0x06, 0x06, 0xff, 0x00, 0x00, 0x00, 0x0e, 0x07, 0xf2, 0xe4, 0x32, 0x2c,
+  0x00, 0x1e, 0xe2, 0xe4, 0x80, 0x37, 0x37, 0x37, 0x37,
+};
+
+static const float complex_missing_values[] = {
+  9999.0, 9999.0, 9999.0, -3.0, 9999.0, 2.0, -9999.0, -2.0,
+  -9999.0, -9999.0, 0.0, 9999.0, -1.0, -9999.0, 0.0, -1.0,
+};
+
+/* Template 5.3, first order spatial differencing with a negative
+   minimum difference and 2 octet extra descriptors */
+static const unsigned char diff1_msg[] = {
+  0x47, 0x52, 0x49, 0x42, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0xdf, 0x00, 0x00, 0x00, 0x15, 0x01, 0x00, 0x07, 0x00,
+  0x00, 0x02, 0x01, 0x01, 0x07, 0xe8, 0x06, 0x01, 0x0c, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00, 0x00, 0x00, 0x0f, 0x00,
+  0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00,
+  0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+  0x62, 0x5a, 0x00, 0x0f, 0x7f, 0x49, 0x00, 0x30, 0x02, 0x80, 0xde, 0x80,
+  0x0f, 0xbc, 0x52, 0x00, 0x00, 0x0f, 0x42, 0x40, 0x00, 0x0f, 0x42, 0x40,
+  0x40, 0x00, 0x00, 0x00, 0x21, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x02, 0x00, 0x60, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x31, 0x05, 0x00, 0x00, 0x00, 0x0f, 0x00, 0x03, 0x43, 0x48, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x03, 0x00,
+  0x00, 0x00, 0x03, 0x01, 0x00, 0x00, 0x00, 0x04, 0x03, 0x01, 0x02, 0x00,
+  0x00, 0x00, 0x06, 0x06, 0xff, 0x00, 0x00, 0x00, 0x16, 0x07, 0x00, 0x0c,
+  0x80, 0x03, 0x10, 0x72, 0x00, 0x14, 0x00, 0x19, 0x44, 0x08, 0x49, 0x95,
+  0x88, 0x25, 0x80, 0x37, 0x37, 0x37, 0x37,
+};
+
+static const float diff1_values[] = {
+  212.0, 215.0, 214.0, 220.0, 226.0, 225.0, 223.0, 230.0,
+  231.0, 231.0, 240.0, 238.0, 235.0, 236.0, 244.0,
+};
+
+/* Template 5.3, second order spatial differencing with missing
+   values (1e20), negative first values, 0 bit group widths and binary
+   scale -2 */
+static const unsigned char diff2_missing_msg[] = {
+  0x47, 0x52, 0x49, 0x42, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0xda, 0x00, 0x00, 0x00, 0x15, 0x01, 0x00, 0x07, 0x00,
+  0x00, 0x02, 0x01, 0x01, 0x07, 0xe8, 0x06, 0x01, 0x0c, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x48, 0x03, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x00,
+  0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00,
+  0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+  0x62, 0x5a, 0x00, 0x0f, 0x7f, 0x49, 0x00, 0x30, 0x02, 0x71, 0x9c, 0x40,
+  0x0f, 0xda, 0xd6, 0x80, 0x00, 0x0f, 0x42, 0x40, 0x00, 0x0f, 0x42, 0x40,
+  0x40, 0x00, 0x00, 0x00, 0x21, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x02, 0x00, 0x60, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x31, 0x05, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x03, 0x3f, 0x80, 0x00,
+  0x00, 0x80, 0x02, 0x00, 0x00, 0x02, 0x00, 0x01, 0x01, 0x60, 0xad, 0x78,
+  0xec, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x04, 0x00, 0x00,
+  0x00, 0x00, 0x04, 0x01, 0x00, 0x00, 0x00, 0x05, 0x01, 0x02, 0x01, 0x00,
+  0x00, 0x00, 0x06, 0x06, 0xff, 0x00, 0x00, 0x00, 0x11, 0x07, 0xa8, 0xa5,
+  0x85, 0x04, 0x80, 0x00, 0xf9, 0x29, 0xff, 0x0a, 0x11, 0xb0, 0x37, 0x37,
+  0x37, 0x37,
+};
+
+static const float diff2_missing_values[] = {
+  -9.0, -8.25, 1e+20, -6.5, -5.5, -3.5, 1e+20, 1e+20,
+  -2.75, -0.5, 1.0, 1.75, 4.25, 5.75,
+};
+
+#endif
@@ -0,0 +1,81 @@
+#!/bin/sh
+#----------------------------------------------------------------------
+# Module: test_grib_index.sh
+#
+# Description:
+#     Checks grib2site's indexed ingest against its streaming one on
+#     test_grib_index.grb2: two GRIB2 messages in WMO envelopes, so with
+#     bytes before, between and after them, the second holding two
+#     fields. The -i inventory must give the byte offset of each message,
+#     and the brief and full listings of the file, whole and through .idx
+#     files of all and of one of its fields, must match those of the same
+#     bytes read through a pipe. Exits non-zero on failure.
+#
+# Usage: test_grib_index.sh grib2site test_grib_index.grb2
+#----------------------------------------------------------------------
+
+prog=$1
+grib=$2
+tmp=${TMPDIR:-/tmp}/test_grib_index.$$
+nfail=0
+
+mkdir -p $tmp || exit 1
+trap 'rm -rf $tmp' 0
+
+# The indexed ingest names a message by its number, the stream by its WMO
+# header, so the header, the last column of the brief listing, is left out
+# of the listings compared
+brief() {
+    cut -c1-72
+}
+
+full() {
+    grep -v ' Header : '
+}
+
+check() {
+    if cmp -s $tmp/$2 $tmp/$3; then
+	printf "%-24s ok\n" "$1"
+    else
+	printf "%-24s FAILED\n" "$1"
+	diff $tmp/$2 $tmp/$3 | head -10
+	nfail=`expr $nfail + 1`
+    fi
+}
+
+# The GRIB messages start at bytes 32 and 255
+$prog -l $tmp/log -i < $grib > $tmp/all.idx
+cut -d: -f1,2 $tmp/all.idx > $tmp/offsets
+printf "1:32\n2.1:255\n2.2:255\n" > $tmp/offsets.expected
+check "inventory offsets" offsets offsets.expected
+
+cat $grib | $prog -l $tmp/log -b | brief > $tmp/b.stream
+$prog -l $tmp/log -b < $grib | brief > $tmp/b.indexed
+check "brief listing" b.stream b.indexed
+
+$prog -l $tmp/log -b -x $tmp/all.idx < $grib | brief > $tmp/b.all
+check "brief, all fields" b.stream b.all
+
+cat $grib | $prog -l $tmp/log -f | full > $tmp/f.stream
+$prog -l $tmp/log -f -x $tmp/all.idx < $grib | full > $tmp/f.all
+check "full, all fields" f.stream f.all
+
+# The second field of the second message only: the column titles and last
+# line of the stream's brief listing, and its full listing from the last
+# separator
+grep '^2\.2:' $tmp/all.idx > $tmp/one.idx
+sed -n '1p;$p' $tmp/b.stream > $tmp/b.stream1
+$prog -l $tmp/log -b -x $tmp/one.idx < $grib | brief > $tmp/b.one
+check "brief, one field" b.stream1 b.one
+
+awk '/^-----/ { n++ } n == 3' $tmp/f.stream > $tmp/f.stream1
+$prog -l $tmp/log -f -x $tmp/one.idx < $grib | full > $tmp/f.one
+check "full, one field" f.stream1 f.one
+
+if [ $nfail -ne 0 ]; then
+    echo "test_grib_index: $nfail failures"
+    exit 1
+fi
+
+echo "test_grib_index: indexed and streamed listings match"
+exit 0
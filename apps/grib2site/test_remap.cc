@@ -0,0 +1,301 @@
+//----------------------------------------------------------------------
+// Module: test_remap.cc
+//
+// Description:
+//     Checks make_site_data()'s area_average, which builds a remap matrix
+//     for a grid on first use and applies the cached one after, against a
+//     brute force average over every point of the grid. Each grid is
+//     averaged with two fields, so the second goes through the cached
+//     remap, on a regional and a global, wrapping lat/lon grid and on two
+//     rotated lat/lon grids that differ only in their pole. Exits
+//     non-zero on failure.
+//----------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dmapf/cmapf.h"
+#include "log/log.hh"
+#include "gds.h"
+#include "site_list.h"
+#include "site_index.h"
+
+Log *logFile;
+
+#define FILLVAL -9999.
+#define NSITES 400
+
+// A site's value before averaging, kept by sites off the grid or with
+// only missing grid values in their footprint
+#define UNSET -1.
+
+// Grid points nearer than this to the edge of a site's footprint, km,
+// may fall either side of it
+#define EDGE_KM 0.01
+
+
+static double rand_range(double lo, double hi)
+{
+  return lo + (hi - lo) * rand() / (double)RAND_MAX;
+}
+
+
+//
+// Smooth field with noise, and some missing values singly and in a block
+//
+static void make_field(float *data, int nx, int ny, int seed)
+{
+  srand(seed);
+  for (int j=0; j<ny; j++)
+    for (int i=0; i<nx; i++)
+      data[j * nx + i] = 280. + 10. * sin(i * 0.11 + seed) + 5. * cos(j * 0.07) + rand_range(-1., 1.);
+
+  for (int n=0; n<nx*ny/50; n++)
+    data[rand() % (nx * ny)] = FILLVAL;
+  for (int j=ny/3; j<ny/3+4 && j<ny; j++)
+    for (int i=nx/2; i<nx/2+6 && i<nx; i++)
+      data[j * nx + i] = FILLVAL;
+}
+
+
+//
+// Rotates geographic lat/lon to the lat/lon of a rotated grid whose
+// southern pole is at pole_lat, pole_lon, by turning the point's unit
+// vector about the polar axis and then about the y axis
+//
+static void rotate(double pole_lat, double pole_lon, double lat, double lon,
+		   double *rlat, double *rlon)
+{
+  double a = RADPDEG * (90. + pole_lat);
+  double vx = cos(RADPDEG * lat) * cos(RADPDEG * (lon - pole_lon));
+  double vy = cos(RADPDEG * lat) * sin(RADPDEG * (lon - pole_lon));
+  double vz = sin(RADPDEG * lat);
+  double x = cos(a) * vx + sin(a) * vz;
+  double z = -sin(a) * vx + cos(a) * vz;
+
+  *rlat = DEGPRAD * asin(z);
+  *rlon = DEGPRAD * atan2(vy, x);
+}
+
+
+//
+// Brute force area average at a site at lat, lon in the grid's (rotated)
+// coordinates: the mean of the non-missing values of every grid point
+// within radius km, by the local flat earth distance at the site, lat/lon
+// points weighted by the cosine of their latitude. Returns 0, leaving
+// val, if no point is within radius or all such points are missing, and
+// -1 if a point lies so near the edge of the footprint that rounding
+// (sites on rotated grids are rotated in single precision) may decide it.
+//
+static int brute_average(gdes *gd, const float *data, float radius, double lat,
+			 double lon, float *val)
+{
+  int nx = gd->grid.ll.ni, ny = gd->grid.ll.nj;
+  double dlat = (gd->grid.ll.la2 > gd->grid.ll.la1 ? gd->grid.ll.dj : -gd->grid.ll.dj);
+  double km = REARTH * RADPDEG;
+  double sum = 0., wsum = 0.;
+  int npts = 0;
+
+  for (int j=0; j<ny; j++)
+    for (int i=0; i<nx; i++)
+      {
+	double glat = gd->grid.ll.la1 + j * dlat;
+	double glon = gd->grid.ll.lo1 + i * gd->grid.ll.di;
+	double dlon = fmod(glon - lon + 540., 360.) - 180.;
+	double ex = dlon * km * cos(RADPDEG * lat);
+	double ey = (glat - lat) * km;
+
+	if (fabs(sqrt(ex*ex + ey*ey) - radius) < EDGE_KM)
+	  return(-1);
+	if (ex*ex + ey*ey > radius*radius)
+	  continue;
+	npts++;
+
+	if (data[j * nx + i] != FILLVAL)
+	  {
+	    double w = (gd->type == GRID_LL ? cos(RADPDEG * glat) : 1.);
+	    sum += w * data[j * nx + i];
+	    wsum += w;
+	  }
+      }
+
+  if (npts == 0)
+    {
+      printf("site at %.3f, %.3f: no grid point within %.1f km\n", lat, lon, radius);
+      return(0);
+    }
+  if (wsum == 0.)
+    return(0);
+
+  *val = sum / wsum;
+  return(1);
+}
+
+
+//
+// Averages two fields on gd with make_site_data() and compares each site
+// with the brute force average. Sites are at lat, lon; rlat, rlon are
+// the same sites in the grid's coordinates, and on_grid marks those on
+// the grid. Sites with a grid point on the edge of their footprint are
+// not compared. Returns the number of failures.
+//
+static int check_grid(const char *name, gdes *gd, float radius, float *lat, float *lon,
+		      double *rlat, double *rlon, int *on_grid, site_index *sidx)
+{
+  int nx = gd->grid.ll.ni, ny = gd->grid.ll.nj;
+  float *data = (float *)malloc(nx * ny * sizeof(float));
+  float site_data[NSITES];
+  char calc_type[] = "area_average";
+  char header[] = "test_remap";
+  product_data pd;
+  int nfail = 0, nsites = 0;
+
+  memset(&pd, 0, sizeof(pd));
+  pd.header = header;
+  pd.gd = gd;
+  pd.data = data;
+
+  for (int f=0; f<2; f++)
+    {
+      make_field(data, nx, ny, f + 1);
+      for (int ns=0; ns<NSITES; ns++)
+	site_data[ns] = UNSET;
+
+      if (!make_site_data(&pd, FILLVAL, calc_type, radius, lat, lon, NSITES, sidx, site_data))
+	{
+	  printf("%s: make_site_data failed\n", name);
+	  free(data);
+	  return(1);
+	}
+
+      for (int ns=0; ns<NSITES; ns++)
+	{
+	  float expected = UNSET;
+
+	  if (on_grid[ns] &&
+	      brute_average(gd, data, radius, rlat[ns], rlon[ns], &expected) < 0)
+	    continue;
+	  if (fabs(site_data[ns] - expected) > 1.e-4 * (1. + fabs(expected)))
+	    {
+	      if (nfail++ < 5)
+		printf("%s field %d: site %d at %.3f, %.3f is %.6f, brute force %.6f\n", name, f + 1,
+		       ns, lat[ns], lon[ns], site_data[ns], expected);
+	    }
+	  else if (f == 0 && expected != UNSET)
+	    nsites++;
+	}
+    }
+
+  printf("%-24s %3d sites averaged  %s\n", name, nsites, nfail ? "FAILED" : "ok");
+  free(data);
+  return(nfail);
+}
+
+
+static void set_ll(gdes *gd, int type, int ni, int nj, float la1, float lo1, float d)
+{
+  memset(gd, 0, sizeof(gdes));
+  gd->type = type;
+  gd->grid.ll.ni = ni;
+  gd->grid.ll.nj = nj;
+  gd->grid.ll.la1 = la1;
+  gd->grid.ll.lo1 = lo1;
+  gd->grid.ll.la2 = la1 + (nj - 1) * d;
+  gd->grid.ll.lo2 = lo1 + (ni - 1) * d;
+  gd->grid.ll.di = d;
+  gd->grid.ll.dj = d;
+  gd->scan_mode = 0x40;
+}
+
+
+int main(int argc, char **argv)
+{
+  float lat[NSITES], lon[NSITES];
+  double rlat[NSITES], rlon[NSITES];
+  int on_grid[NSITES];
+  gdes gd;
+  rotated rot;
+  int nfail = 0;
+
+  // Errors only
+  logFile = new Log();
+  logFile->set_debug(0);
+
+  //
+  // Regional lat/lon grid, sites through the site index, some of them
+  // off the grid
+  //
+  srand(7);
+  for (int ns=0; ns<NSITES; ns++)
+    {
+      lat[ns] = rand_range(33., 47.);
+      lon[ns] = rand_range(-107., -93.);
+      rlat[ns] = lat[ns];
+      rlon[ns] = lon[ns];
+      on_grid[ns] = (lat[ns] >= 35. && lat[ns] <= 45. && lon[ns] >= -105. && lon[ns] <= -95.);
+    }
+  site_index *sidx = new_site_index(lat, lon, NSITES);
+
+  set_ll(&gd, GRID_LL, 81, 81, 35., 255., 0.125);
+  nfail += check_grid("lat/lon", &gd, 25., lat, lon, rlat, rlon, on_grid, sidx);
+
+  // North to south, a different remap on the same area
+  gd.grid.ll.la1 = 45.;
+  gd.grid.ll.la2 = 35.;
+  gd.scan_mode = 0;
+  nfail += check_grid("lat/lon north to south", &gd, 25., lat, lon, rlat, rlon, on_grid, sidx);
+  free_site_index(sidx);
+
+  //
+  // Global grid wrapping at 0 longitude, sites on either side of it and
+  // near the poles
+  //
+  for (int ns=0; ns<NSITES; ns++)
+    {
+      lat[ns] = (ns % 4 == 0 ? rand_range(80., 89.) : rand_range(-80., 80.));
+      lon[ns] = (ns % 2 ? rand_range(-3., 3.) : rand_range(-180., 180.));
+      rlat[ns] = lat[ns];
+      rlon[ns] = lon[ns];
+      on_grid[ns] = 1;
+    }
+  set_ll(&gd, GRID_LL, 360, 181, -90., 0., 1.);
+  nfail += check_grid("global lat/lon", &gd, 150., lat, lon, rlat, rlon, on_grid, 0);
+
+  //
+  // Rotated grids whose equator passes through the sites, the same but
+  // for the pole, so they need their own remaps
+  //
+  for (int ns=0; ns<NSITES; ns++)
+    {
+      lat[ns] = rand_range(46., 54.);
+      lon[ns] = rand_range(4., 16.);
+    }
+  for (int p=0; p<2; p++)
+    {
+      rot.lat = (p == 0 ? -40. : -42.);
+      rot.lon = 10.;
+      rot.angle = 0.;
+      for (int ns=0; ns<NSITES; ns++)
+	{
+	  rotate(rot.lat, rot.lon, lat[ns], lon[ns], &rlat[ns], &rlon[ns]);
+	  on_grid[ns] = (fabs(rlat[ns]) <= 5. && fabs(rlon[ns]) <= 5.);
+	}
+
+      set_ll(&gd, GRID_RLL, 101, 101, -5., -5., 0.1);
+      gd.grid.ll.rot = &rot;
+      nfail += check_grid(p == 0 ? "rotated lat/lon" : "rotated lat/lon, new pole", &gd, 20.,
+			  lat, lon, rlat, rlon, on_grid, 0);
+    }
+
+  delete logFile;
+
+  if (nfail)
+    {
+      printf("test_remap: %d failures\n", nfail);
+      return(1);
+    }
+
+  printf("test_remap: all sites match\n");
+  return(0);
+}
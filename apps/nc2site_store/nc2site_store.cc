@@ -0,0 +1,240 @@
+/*
+ * Converts a netCDF site time series file (NWP site forecast, observation
+ * or blended forecast file) into a site store file, so that the forecast
+ * programs map the data instead of decoding the netCDF file each run.
+ * Meant to be run once, when the netCDF file arrives.
+ *
+ * The site id variable and the time variable name the site and time
+ * dimensions. Every numeric variable dimensioned (site, time) or
+ * (time, site) is converted, as is every one dimensional variable of
+ * length num_times * num_sites (time major, as in the observation files).
+ * Per site variables, dimensioned (site), are repeated over all times.
+ * Values are stored site major, with the variable's _FillValue as its
+ * missing value.
+ *
+ *   NWP:      nc2site_store -g creation_time -n num_sites StationID valid_time in.nc out.sst
+ *   obs:      nc2site_store stationID observationTime in.nc out.sst
+ *   blended:  nc2site_store -g gen_time -n num_sites siteId valid_time in.nc out.sst
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netcdf.h>
+#include <string>
+#include <vector>
+#include "site_store/site_store.hh"
+
+using namespace std;
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-g gen_time_var] [-n num_sites_var] [-v var,var,...] site_id_var time_var nc_file store_file\n", prog);
+  fprintf(stderr, "  -g  scalar variable holding the generation time\n");
+  fprintf(stderr, "  -n  scalar variable holding the number of valid sites\n");
+  fprintf(stderr, "  -v  convert only these variables\n");
+  exit(2);
+}
+
+static int nc_fail(int status, const char *what, const char *name)
+{
+  fprintf(stderr, "Error: %s %s: %s\n", what, name, nc_strerror(status));
+  return 1;
+}
+
+int main(int argc, char **argv)
+{
+  const char *gen_var = NULL;
+  const char *num_sites_var = NULL;
+  vector<string> only_vars;
+  int c;
+
+  while ((c = getopt(argc, argv, "g:n:v:")) != -1)
+    {
+      switch (c)
+	{
+	case 'g':
+	  gen_var = optarg;
+	  break;
+	case 'n':
+	  num_sites_var = optarg;
+	  break;
+	case 'v':
+	  {
+	    char *list = strdup(optarg);
+	    for (char *tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ","))
+	      only_vars.push_back(tok);
+	    free(list);
+	  }
+	  break;
+	default:
+	  usage(argv[0]);
+	}
+    }
+
+  if (argc - optind != 4)
+    usage(argv[0]);
+
+  const char *site_var = argv[optind];
+  const char *time_var = argv[optind + 1];
+  const char *in_file = argv[optind + 2];
+  const char *out_file = argv[optind + 3];
+
+  int ncid, status;
+  if ((status = nc_open(in_file, NC_NOWRITE, &ncid)) != NC_NOERR)
+    return nc_fail(status, "could not open", in_file);
+
+  // Sites and their dimension
+  int site_varid, site_dimid, ndims;
+  size_t file_sites;
+  if ((status = nc_inq_varid(ncid, site_var, &site_varid)) != NC_NOERR)
+    return nc_fail(status, "no site id variable", site_var);
+  if (nc_inq_varndims(ncid, site_varid, &ndims) != NC_NOERR || ndims != 1)
+    {
+      fprintf(stderr, "Error: site id variable %s is not one dimensional\n", site_var);
+      return 1;
+    }
+  nc_inq_vardimid(ncid, site_varid, &site_dimid);
+  nc_inq_dimlen(ncid, site_dimid, &file_sites);
+
+  vector<int> site_ids(file_sites);
+  if (file_sites > 0 && (status = nc_get_var_int(ncid, site_varid, &site_ids[0])) != NC_NOERR)
+    return nc_fail(status, "could not read", site_var);
+
+  // Only the first num_sites entries of the site dimension are used
+  size_t nsites = file_sites;
+  if (num_sites_var != NULL)
+    {
+      int varid, n;
+      if ((status = nc_inq_varid(ncid, num_sites_var, &varid)) != NC_NOERR ||
+	  (status = nc_get_var_int(ncid, varid, &n)) != NC_NOERR)
+	return nc_fail(status, "could not read", num_sites_var);
+      if (n >= 0 && (size_t)n < nsites)
+	nsites = n;
+    }
+  site_ids.resize(nsites);
+
+  // Times and their dimension
+  int time_varid, time_dimid;
+  size_t ntimes;
+  if ((status = nc_inq_varid(ncid, time_var, &time_varid)) != NC_NOERR)
+    return nc_fail(status, "no time variable", time_var);
+  if (nc_inq_varndims(ncid, time_varid, &ndims) != NC_NOERR || ndims != 1)
+    {
+      fprintf(stderr, "Error: time variable %s is not one dimensional\n", time_var);
+      return 1;
+    }
+  nc_inq_vardimid(ncid, time_varid, &time_dimid);
+  nc_inq_dimlen(ncid, time_dimid, &ntimes);
+
+  vector<double> times(ntimes);
+  if (ntimes > 0 && (status = nc_get_var_double(ncid, time_varid, &times[0])) != NC_NOERR)
+    return nc_fail(status, "could not read", time_var);
+
+  SiteStoreWriter writer;
+  writer.set_sites(site_ids);
+  writer.set_times(times);
+
+  if (gen_var != NULL)
+    {
+      int varid;
+      double gen_time;
+      if ((status = nc_inq_varid(ncid, gen_var, &varid)) != NC_NOERR ||
+	  (status = nc_get_var_double(ncid, varid, &gen_time)) != NC_NOERR)
+	return nc_fail(status, "could not read", gen_var);
+      writer.set_gen_time(gen_time);
+    }
+
+  int nvars;
+  nc_inq_nvars(ncid, &nvars);
+
+  int nconverted = 0;
+  for (int varid = 0; varid < nvars; varid++)
+    {
+      char name[NC_MAX_NAME + 1];
+      nc_type type;
+      int dimids[NC_MAX_VAR_DIMS];
+
+      nc_inq_var(ncid, varid, name, &type, &ndims, dimids, NULL);
+      if (varid == site_varid || varid == time_varid || type == NC_CHAR)
+	continue;
+
+      bool wanted = only_vars.empty();
+      for (size_t i = 0; i < only_vars.size(); i++)
+	if (only_vars[i] == name)
+	  wanted = true;
+      if (!wanted)
+	continue;
+
+      // Offset of (site, time) in the variable, as a site stride and a time stride
+      size_t site_stride, time_stride, len = 1;
+      for (int d = 0; d < ndims; d++)
+	{
+	  size_t dim_len;
+	  nc_inq_dimlen(ncid, dimids[d], &dim_len);
+	  len *= dim_len;
+	}
+
+      if (ndims == 2 && dimids[0] == site_dimid && dimids[1] == time_dimid)
+	{
+	  site_stride = ntimes;
+	  time_stride = 1;
+	}
+      else if (ndims == 2 && dimids[0] == time_dimid && dimids[1] == site_dimid)
+	{
+	  site_stride = 1;
+	  time_stride = file_sites;
+	}
+      else if (ndims == 1 && dimids[0] == site_dimid)
+	{
+	  site_stride = 1;
+	  time_stride = 0;
+	}
+      else if (ndims == 1 && len == ntimes * file_sites && len > 0)
+	{
+	  site_stride = 1;
+	  time_stride = file_sites;
+	}
+      else
+	{
+	  if (!only_vars.empty())
+	    {
+	      fprintf(stderr, "Error: %s is not dimensioned by site and time\n", name);
+	      return 1;
+	    }
+	  continue;
+	}
+
+      vector<float> in(len);
+      if (len > 0 && (status = nc_get_var_float(ncid, varid, &in[0])) != NC_NOERR)
+	return nc_fail(status, "could not read", name);
+
+      float missing = NC_FILL_FLOAT;
+      nc_get_att_float(ncid, varid, "_FillValue", &missing);
+
+      vector<float> values(nsites * ntimes);
+      for (size_t s = 0; s < nsites; s++)
+	for (size_t t = 0; t < ntimes; t++)
+	  values[s * ntimes + t] = in[s * site_stride + t * time_stride];
+
+      if (writer.add_var(name, values, missing) != 0)
+	{
+	  fprintf(stderr, "Error: %s\n", writer.error().c_str());
+	  return 1;
+	}
+      nconverted++;
+    }
+
+  nc_close(ncid);
+
+  if (writer.write(out_file) != 0)
+    {
+      fprintf(stderr, "Error: %s\n", writer.error().c_str());
+      return 1;
+    }
+
+  printf("%s: %d variables, %lu sites, %lu times\n", out_file, nconverted,
+	 (unsigned long)nsites, (unsigned long)ntimes);
+  return 0;
+}
@@ -0,0 +1,180 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: Arguments.cc,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/09/06 10:00:00 $
+//
+//==============================================================================
+
+/**
+ * @file Arguments.cc
+ *   Implementation of class that parses command line arguments.
+ */
+
+// Include files
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "Arguments.hh"
+
+// Constant and macros
+
+//
+// The python averaging drops means of fewer than two records
+//
+const int DEFAULT_MIN_COUNT = 2;
+
+// Functions
+
+static void get_command_string(int argc, char **argv, string &command_string)
+{
+  for (int i=0; i<argc-1; i++)
+    {
+      command_string += string(argv[i]) + string(" ");
+    }
+
+  command_string += string(argv[argc-1]);
+}
+
+Arguments::Arguments(int argc, char **argv)
+{
+  //
+  // Output "help" comments if no command line args
+  //
+  if  (argc == 1)
+  {
+    usage(argv[0]);
+
+    exit(1);
+  }
+
+  //
+  // Set some default variable values
+  //
+  error = "";
+
+  logDir = "";
+
+  debugLevel = 0;
+
+  pollSecs = 0;
+
+  minCount = DEFAULT_MIN_COUNT;
+
+  bool errflg = false;
+
+  int c;
+
+  while ((c = getopt(argc, argv, "d:hl:n:s:S:w:")) != EOF)
+    switch (c)
+      {
+      case 'd':
+	debugLevel = atoi(optarg);
+	break;
+
+      case 'h':
+	usage(argv[0]);
+	exit(2);
+
+      case 'l':
+	logDir = optarg;
+	break;
+
+      case 'n':
+	minCount = atoi(optarg);
+	break;
+
+      case 's':
+	stateFile = optarg;
+	break;
+
+      case 'S':
+	shadingDir = optarg;
+	break;
+
+      case 'w':
+	pollSecs = atoi(optarg);
+	break;
+
+      case '?':
+	errflg = 1;
+	break;
+      }
+
+  if (errflg)
+    {
+      error = "options error";
+
+      return;
+    }
+
+  if (argc - optind < 3)
+  {
+    error = "There are not enough arguments. Arguments include: siteListFile "
+            "outputDir input [input ...]";
+    return;
+  }
+
+  if (pollSecs < 0 || minCount < 1)
+  {
+    error = "Invalid poll interval or minimum record count.";
+    return;
+  }
+
+  programName = string(argv[0]);
+
+  siteListFile = string(argv[optind++]);
+
+  outputDir = string(argv[optind++]);
+
+  while (optind < argc)
+  {
+    inputs.push_back(string(argv[optind++]));
+  }
+
+  get_command_string(argc, argv, commandString);
+}
+
+void Arguments::usage(char *programName)
+{
+  fprintf(stderr, "\n\nusage:  %s [options] "
+                  "<siteListFile> "
+                  "<outputDir> "
+                  "<input csv file or directory> [...]\n\n", programName);
+  fprintf(stderr, "Aggregates one minute New York mesonet records into the 15 minute,\n"
+                  "time ending observation netCDF files read by ghi_fcst.\n\n");
+  fprintf(stderr, "%s options:\n", programName);
+  fprintf(stderr, "\t-d  <debug level>\n");
+  fprintf(stderr, "\t-h  help\n");
+  fprintf(stderr, "\t-l  <log directory>\n");
+  fprintf(stderr, "\t-n  <minimum records in a 15 minute mean> (default %d)\n",
+                  DEFAULT_MIN_COUNT);
+  fprintf(stderr, "\t-s  <state file> keep the one minute records between runs\n");
+  fprintf(stderr, "\t-S  <shading directory> mask shaded solar insolation\n");
+  fprintf(stderr, "\t-w  <seconds> keep running, polling the inputs for new records\n");
+}
+
+void Arguments::print()
+{
+  fprintf(stderr, "  siteListFile: %s\n", siteListFile.c_str());
+  fprintf(stderr, "  outputDir:  %s\n", outputDir.c_str());
+
+  for (int i = 0; i < (int) inputs.size(); i++)
+  {
+    fprintf(stderr, "    Input %d: %s\n", i, inputs[i].c_str());
+  }
+
+  if (shadingDir != "")
+    fprintf(stderr,"  shadingDir: %s\n", shadingDir.c_str());
+
+  if (stateFile != "")
+    fprintf(stderr,"  stateFile: %s\n", stateFile.c_str());
+
+  if (pollSecs > 0)
+    fprintf(stderr,"  poll interval: %d\n", pollSecs);
+
+  if (logDir != "")
+    fprintf(stderr,"  logDir: %s\n", logDir.c_str());
+}
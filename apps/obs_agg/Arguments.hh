@@ -0,0 +1,114 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: Arguments.hh,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/09/06 10:00:00 $
+//
+//==============================================================================
+
+/**
+ *
+ *  @file Arguments.hh
+ *  @class Arguments
+ *  @brief Class for parsing obs_agg command line arguments.
+ *  @date 09/06/2021
+ */
+
+#ifndef ARGUMENTS_HH
+#define ARGUMENTS_HH
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/**
+ * Arguments class
+ */
+class Arguments
+{
+public:
+  /**
+   * Constructor
+   */
+  Arguments(int argc, char **argv);
+
+  /**
+   * Print values of command line arguments
+   */
+  void print();
+
+  /**
+   * Command line string
+   */
+  string commandString;
+
+  /**
+   * Name of program
+   */
+  string programName;
+
+  /**
+   * Csv site list with station name ("stid"), latitude ("lat [degrees]"),
+   * longitude ("lon [degrees]") and integer site id ("int_id") columns,
+   * e.g. static/site_list/nymeso_match_wrf.csv
+   */
+  string siteListFile;
+
+  /**
+   * Directory under which the 15 minute netCDF files are published as
+   * YYYYMMDD/nymeso_15min_obs.YYYYMMDD.HHMM.nc
+   */
+  string outputDir;
+
+  /**
+   * One minute mesonet csv files, or directories of them
+   */
+  vector<string> inputs;
+
+  /**
+   * Directory of the shading tables, empty for no shading QC
+   */
+  string shadingDir;
+
+  /**
+   * File holding the one minute records between runs, empty for none
+   */
+  string stateFile;
+
+  /**
+   * Seconds between polls of the inputs for new records; 0 to read the
+   * inputs once and exit
+   */
+  int pollSecs;
+
+  /**
+   * Minimum number of one minute records in a published 15 minute mean
+   */
+  int minCount;
+
+  /**
+   * Log filepath
+   */
+  string logDir;
+
+  /**
+   * Debug level indicator
+   */
+  int debugLevel;
+
+  /**
+   * Error string
+   */
+  string error;
+
+  /**
+   * Print usage
+   */
+  void usage(char *prog_name);
+};
+
+#endif /* ARGUMENTS_HH */
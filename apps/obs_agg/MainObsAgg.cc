@@ -0,0 +1,82 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: MainObsAgg.cc,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/09/06 10:00:00 $
+//
+//==============================================================================
+
+/**
+ *
+ * @file MainObsAgg.cc
+ *
+ * Main program for the mesonet observation aggregator
+ *
+ */
+
+// Include files
+#include <log/log.hh>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "Arguments.hh"
+#include "ObsAggregator.hh"
+
+//
+// Global variables for debugging and logging
+//
+int DebugLevel = 0;
+
+Log *Logg;
+
+int main(int argc, char **argv)
+{
+  //
+  // Get command line arguments and store in args
+  //
+  Arguments args(argc, argv);
+
+  if (args.error != string(""))
+  {
+     fprintf(stderr, "Error: command line arguments problem: %s\n",
+             args.error.c_str());
+
+     return 2;
+  }
+
+  //
+  // Set global Debug_level from args
+  //
+  DebugLevel = args.debugLevel;
+
+  //
+  // Set up logging global Logg
+  //
+  Logg = new Log(args.logDir.c_str());
+
+  Logg->write_time_starting(args.programName.c_str());
+
+  Logg->write_time("Info: executed: %s\n", args.commandString.c_str());
+
+  //
+  // Aggregate until done, or until killed when polling
+  //
+  ObsAggregator aggregator(args);
+
+  if (aggregator.run() != 0)
+  {
+     Logg->write_time("Error: %s\n", aggregator.error.c_str());
+
+     Logg->write_time_ending(1);
+
+     return 1;
+  }
+
+  Logg->write_time_ending(0);
+
+  delete Logg;
+
+  return 0;
+}
@@ -0,0 +1,1092 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: ObsAggregator.cc,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/09/06 10:00:00 $
+//
+//==============================================================================
+
+/**
+ * @file ObsAggregator.cc
+ * @brief Source for ObsAggregator class
+ */
+
+// Include files
+
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <netcdf.h>
+#include <boost/filesystem/operations.hpp>
+#include <log/log.hh>
+#include <solar_position/solar_position.hh>
+#include "ObsAggregator.hh"
+
+using std::ifstream;
+namespace fs = boost::filesystem;
+
+extern Log *Logg;
+extern int DebugLevel;
+
+// Constant and macros
+
+const int ObsAggregator::RING_MINUTES = 120;
+
+const int ObsAggregator::PERIOD_SECS = 900;
+
+const float ObsAggregator::OBS_MISSING = NC_FILL_FLOAT;
+
+//
+// Enough periods that every minute in the ring has its period
+//
+static const int RING_PERIODS = ObsAggregator::RING_MINUTES * 60 / ObsAggregator::PERIOD_SECS + 1;
+
+static const float GHI_MIN = 0;
+
+static const float GHI_MAX = 1300;
+
+static const double DEG_TO_RAD = M_PI / 180.0;
+
+static const char STATE_MAGIC[4] = {'O', 'A', 'G', 'S'};
+
+static const int STATE_VERSION = 1;
+
+static const int NAME_LEN = 4;
+
+//
+// Input columns, in the order of the values passed to addRecord(). The
+// u, v and solar values are derived.
+//
+static const char *VALUE_COLUMNS[] =
+{
+  "solar_insolation [watt/m**2]",
+  "relative_humidity [%]",
+  "temperature_2m [degC]",
+  "station_pressure [mbar]",
+  "wind_speed [m/s]",
+  "wind_direction [degrees]",
+  NULL
+};
+
+static const int NUM_VALUE_COLUMNS = 6;
+
+static const int STATION_COLUMN = NUM_VALUE_COLUMNS;
+
+static const int TIME_COLUMN = NUM_VALUE_COLUMNS + 1;
+
+//
+// Published variables, as written by csv2madis_t.py with
+// nymeso_csv_to_nc.json
+//
+struct OutputVar
+{
+  const char *name;
+  const char *longName;
+  const char *units;
+};
+
+enum
+{
+  OUT_RH,
+  OUT_TEMP,
+  OUT_GHI,
+  OUT_PRES,
+  OUT_WSPD,
+  OUT_WDIR,
+  OUT_ELEV,
+  OUT_AZIM,
+  OUT_TOA,
+  OUT_KT,
+  NUM_OUTPUT_VARS
+};
+
+static const OutputVar OUTPUT_VARS[NUM_OUTPUT_VARS] =
+{
+  {"relative_humidity", "Relative Humidity", "%"},
+  {"T_2", "Temperature at 2m", "C"},
+  {"solar_insolation", "Solar insolation (GHI)", "W/m^2"},
+  {"pressure", "Station pressure", "mbar"},
+  {"wind_speed", "Wind speed", "m/s"},
+  {"wind_dir", "Wind direction", "degrees"},
+  {"solar_elevation_angle", "Apparent solar elevation angle", "degrees"},
+  {"solar_azimuth_angle", "Solar azimuth angle", "degrees"},
+  {"TOA", "Top of atmosphere irradiance", "W/m^2"},
+  {"Kt", "Clearness index", ""}
+};
+
+// Functions
+
+//
+// Split a csv line, trimming white space, quotes and carriage returns
+//
+static void splitCsv(const string &line, vector<string> &fields)
+{
+  fields.clear();
+
+  size_t start = 0;
+
+  while (true)
+  {
+    size_t pos = line.find(',', start);
+
+    string field = line.substr(start, pos == string::npos ? string::npos : pos - start);
+
+    size_t first = field.find_first_not_of(" \t\r\n\"");
+
+    size_t last = field.find_last_not_of(" \t\r\n\"");
+
+    fields.push_back(first == string::npos ? string("") : field.substr(first, last - first + 1));
+
+    if (pos == string::npos)
+    {
+      break;
+    }
+
+    start = pos + 1;
+  }
+}
+
+static int findColumn(const vector<string> &header, const char *name)
+{
+  for (int c = 0; c < (int)header.size(); c++)
+  {
+    if (header[c] == name)
+    {
+      return c;
+    }
+  }
+
+  return -1;
+}
+
+//
+// Parse a value, NaN if empty or not a number
+//
+static float parseValue(const string &field)
+{
+  if (field.empty())
+  {
+    return NAN;
+  }
+
+  char *end;
+
+  double val = strtod(field.c_str(), &end);
+
+  return (*end == '\0') ? (float)val : NAN;
+}
+
+//
+// Parse the mesonet time, 20210906T141500, or 2021-09-06 14:15:00
+//
+static time_t parseTime(const string &field)
+{
+  struct tm tms;
+
+  memset(&tms, 0, sizeof(tms));
+
+  if (sscanf(field.c_str(), "%4d%2d%2dT%2d%2d%2d", &tms.tm_year, &tms.tm_mon,
+             &tms.tm_mday, &tms.tm_hour, &tms.tm_min, &tms.tm_sec) != 6 &&
+      sscanf(field.c_str(), "%d-%d-%d %d:%d:%d", &tms.tm_year, &tms.tm_mon,
+             &tms.tm_mday, &tms.tm_hour, &tms.tm_min, &tms.tm_sec) != 6)
+  {
+    return -1;
+  }
+
+  tms.tm_year -= 1900;
+
+  tms.tm_mon -= 1;
+
+  return timegm(&tms);
+}
+
+static float mean(const double sum, const int num)
+{
+  return num > 0 ? (float)(sum / num) : ObsAggregator::OBS_MISSING;
+}
+
+ObsAggregator::ObsAggregator(const Arguments &argsParam) :
+  args(argsParam),
+  shading(NULL),
+  latestTime(0)
+{
+}
+
+ObsAggregator::~ObsAggregator()
+{
+  delete shading;
+}
+
+int ObsAggregator::readSiteList()
+{
+  ifstream infile(args.siteListFile.c_str());
+
+  if (!infile.is_open())
+  {
+    error = string("Cannot open site list ") + args.siteListFile;
+    return 1;
+  }
+
+  string line;
+
+  vector<string> fields;
+
+  if (!getline(infile, line))
+  {
+    error = string("Site list is empty: ") + args.siteListFile;
+    return 1;
+  }
+
+  splitCsv(line, fields);
+
+  int nameCol = findColumn(fields, "stid");
+
+  int idCol = findColumn(fields, "int_id");
+
+  int latCol = findColumn(fields, "lat [degrees]");
+
+  int lonCol = findColumn(fields, "lon [degrees]");
+
+  if (nameCol < 0 || idCol < 0)
+  {
+    error = string("Site list needs stid and int_id columns: ") + args.siteListFile;
+    return 1;
+  }
+
+  while (getline(infile, line))
+  {
+    splitCsv(line, fields);
+
+    if ((int)fields.size() <= std::max(nameCol, idCol) || fields[nameCol].empty())
+    {
+      continue;
+    }
+
+    Station station;
+
+    station.name = fields[nameCol];
+
+    station.siteId = atoi(fields[idCol].c_str());
+
+    station.lat = (latCol >= 0 && latCol < (int)fields.size()) ? parseValue(fields[latCol]) : NAN;
+
+    station.lon = (lonCol >= 0 && lonCol < (int)fields.size()) ? parseValue(fields[lonCol]) : NAN;
+
+    station.haveLocation = !isnan(station.lat) && !isnan(station.lon);
+
+    station.latestMinute = 0;
+
+    MinuteObs emptyObs;
+
+    memset(&emptyObs, 0, sizeof(emptyObs));
+
+    emptyObs.minute = -1;
+
+    station.ring.assign(RING_MINUTES, emptyObs);
+
+    PeriodSum emptySum;
+
+    memset(&emptySum, 0, sizeof(emptySum));
+
+    emptySum.end = -1;
+
+    station.periods.assign(RING_PERIODS, emptySum);
+
+    stationIndex[station.name] = (int)stations.size();
+
+    stations.push_back(station);
+  }
+
+  if (stations.size() == 0)
+  {
+    error = string("No stations in ") + args.siteListFile;
+    return 1;
+  }
+
+  if (DebugLevel > 0)
+  {
+    Logg->write_time("Info: Read %d stations from %s\n", (int)stations.size(),
+                     args.siteListFile.c_str());
+  }
+
+  return 0;
+}
+
+int ObsAggregator::run()
+{
+  if (readSiteList() != 0)
+  {
+    return 1;
+  }
+
+  if (args.shadingDir != "")
+  {
+    map<string, int> stationIds;
+
+    for (int s = 0; s < (int)stations.size(); s++)
+    {
+      stationIds[stations[s].name] = stations[s].siteId;
+    }
+
+    shading = new ShadingMask();
+
+    if (shading->compile(args.shadingDir, stationIds) != 0)
+    {
+      error = string("Compiling shading tables failed: ") + shading->error();
+      return 1;
+    }
+
+    if (DebugLevel > 0)
+    {
+      Logg->write_time("Info: Shading tables for %d stations from %s\n",
+                       shading->num_sites(), args.shadingDir.c_str());
+    }
+  }
+
+  if (args.stateFile != "" && loadState() != 0)
+  {
+    return 1;
+  }
+
+  while (true)
+  {
+    int numRecords = 0;
+
+    if (scanInputs(numRecords) != 0)
+    {
+      return 1;
+    }
+
+    if (numRecords > 0)
+    {
+      if (DebugLevel > 0)
+      {
+        Logg->write_time("Info: Aggregated %d new records\n", numRecords);
+      }
+
+      if (publish() != 0)
+      {
+        return 1;
+      }
+
+      if (args.stateFile != "" && saveState() != 0)
+      {
+        return 1;
+      }
+    }
+
+    if (args.pollSecs == 0)
+    {
+      break;
+    }
+
+    sleep(args.pollSecs);
+  }
+
+  return 0;
+}
+
+int ObsAggregator::scanInputs(int &numRecords)
+{
+  //
+  // Input files, directories expanded to the csv files in them
+  //
+  vector<string> paths;
+
+  for (int i = 0; i < (int)args.inputs.size(); i++)
+  {
+    fs::path input(args.inputs[i]);
+
+    if (!fs::is_directory(input))
+    {
+      paths.push_back(args.inputs[i]);
+      continue;
+    }
+
+    vector<string> dirPaths;
+
+    for (fs::directory_iterator it(input); it != fs::directory_iterator(); ++it)
+    {
+      if (fs::is_regular_file(it->status()) && it->path().extension() == ".csv")
+      {
+        dirPaths.push_back(it->path().string());
+      }
+    }
+
+    //
+    // File names carry their time, so name order is time order
+    //
+    sort(dirPaths.begin(), dirPaths.end());
+
+    paths.insert(paths.end(), dirPaths.begin(), dirPaths.end());
+  }
+
+  map<string, InputFile> scanned;
+
+  for (int i = 0; i < (int)paths.size(); i++)
+  {
+    InputFile &input = scanned[paths[i]];
+
+    map<string, InputFile>::iterator it = inputFiles.find(paths[i]);
+
+    if (it != inputFiles.end())
+    {
+      input = it->second;
+    }
+    else
+    {
+      input.offset = 0;
+    }
+
+    if (ingestFile(paths[i], input, numRecords) != 0)
+    {
+      return 1;
+    }
+  }
+
+  //
+  // Forget files that have gone away
+  //
+  inputFiles.swap(scanned);
+
+  return 0;
+}
+
+int ObsAggregator::ingestFile(const string &path, InputFile &input, int &numRecords)
+{
+  FILE *fp = fopen(path.c_str(), "r");
+
+  if (fp == NULL)
+  {
+    Logg->write_time("Warning: Cannot open %s\n", path.c_str());
+    return 0;
+  }
+
+  fseek(fp, 0, SEEK_END);
+
+  long size = ftell(fp);
+
+  //
+  // A file that shrank was replaced; read it again
+  //
+  if (size < input.offset)
+  {
+    input.offset = 0;
+  }
+
+  if (size == input.offset)
+  {
+    fclose(fp);
+    return 0;
+  }
+
+  fseek(fp, input.offset, SEEK_SET);
+
+  char *buf = NULL;
+
+  size_t bufSize = 0;
+
+  ssize_t len;
+
+  vector<string> fields;
+
+  vector<float> value(NUM_VARS);
+
+  int numUnknown = 0;
+
+  while ((len = getline(&buf, &bufSize, fp)) > 0)
+  {
+    //
+    // Leave a partly written last line for the next scan
+    //
+    if (buf[len - 1] != '\n')
+    {
+      break;
+    }
+
+    input.offset += len;
+
+    splitCsv(string(buf, len), fields);
+
+    if (input.columns.size() == 0)
+    {
+      for (int c = 0; VALUE_COLUMNS[c] != NULL; c++)
+      {
+        input.columns.push_back(findColumn(fields, VALUE_COLUMNS[c]));
+      }
+
+      input.columns.push_back(findColumn(fields, "station"));
+
+      input.columns.push_back(findColumn(fields, "datetime"));
+
+      if (input.columns[STATION_COLUMN] < 0 || input.columns[TIME_COLUMN] < 0)
+      {
+        Logg->write_time("Warning: No station or datetime column in %s, skipping\n",
+                         path.c_str());
+        input.offset = size;
+        break;
+      }
+
+      continue;
+    }
+
+    int stationCol = input.columns[STATION_COLUMN];
+
+    int timeCol = input.columns[TIME_COLUMN];
+
+    if ((int)fields.size() <= std::max(stationCol, timeCol))
+    {
+      continue;
+    }
+
+    map<string, int>::iterator it = stationIndex.find(fields[stationCol]);
+
+    if (it == stationIndex.end())
+    {
+      numUnknown++;
+      continue;
+    }
+
+    time_t obsTime = parseTime(fields[timeCol]);
+
+    if (obsTime < 0)
+    {
+      continue;
+    }
+
+    for (int c = 0; c < NUM_VALUE_COLUMNS; c++)
+    {
+      int col = input.columns[c];
+
+      value[c] = (col >= 0 && col < (int)fields.size()) ? parseValue(fields[col]) : NAN;
+    }
+
+    if (addRecord(stations[it->second], obsTime, &value[0]))
+    {
+      numRecords++;
+    }
+  }
+
+  free(buf);
+
+  fclose(fp);
+
+  if (numUnknown > 0 && DebugLevel > 0)
+  {
+    Logg->write_time("Info: %d records of stations not in the site list in %s\n",
+                     numUnknown, path.c_str());
+  }
+
+  return 0;
+}
+
+bool ObsAggregator::addRecord(Station &station, const time_t obsTime, float *value)
+{
+  int minute = (int)(obsTime / 60);
+
+  if (minute <= station.latestMinute - RING_MINUTES)
+  {
+    return false;
+  }
+
+  //
+  // The columns hold insolation, rh, temperature, pressure, wind speed
+  // and direction; replace the direction by u and v, as avgObs.py does
+  //
+  MinuteObs obs;
+
+  obs.minute = minute;
+
+  obs.value[GHI] = value[0];
+
+  obs.value[RH] = value[1];
+
+  obs.value[TEMP] = value[2];
+
+  obs.value[PRES] = value[3];
+
+  obs.value[WSPD] = value[4];
+
+  float dir = value[5];
+
+  obs.value[U] = -obs.value[WSPD] * sin(dir * DEG_TO_RAD);
+
+  obs.value[V] = -obs.value[WSPD] * cos(dir * DEG_TO_RAD);
+
+  //
+  // Bounds check and shading QC of the insolation
+  //
+  if (obs.value[GHI] < GHI_MIN || obs.value[GHI] > GHI_MAX ||
+      (shading != NULL && shading->is_shaded(station.siteId, obsTime)))
+  {
+    obs.value[GHI] = NAN;
+  }
+
+  if (station.haveLocation)
+  {
+    double t = (double)minute * 60;
+
+    solar_position_grid(1, &station.lat, &station.lon, 1, &t, &obs.value[ELEV],
+                        &obs.value[AZIM]);
+
+    obs.value[TOA] = (float)solar_toa(t, obs.value[ELEV]);
+  }
+  else
+  {
+    obs.value[ELEV] = obs.value[AZIM] = obs.value[TOA] = NAN;
+  }
+
+  //
+  // A minute sent again replaces the earlier record
+  //
+  MinuteObs &slot = station.ring[minute % RING_MINUTES];
+
+  if (slot.minute == minute)
+  {
+    bool same = true;
+
+    for (int v = 0; v < NUM_VARS; v++)
+    {
+      if (!(slot.value[v] == obs.value[v] || (isnan(slot.value[v]) && isnan(obs.value[v]))))
+      {
+        same = false;
+      }
+    }
+
+    if (same)
+    {
+      return false;
+    }
+
+    addToPeriod(station, slot, -1);
+  }
+
+  slot = obs;
+
+  addToPeriod(station, slot, 1);
+
+  if (minute > station.latestMinute)
+  {
+    station.latestMinute = minute;
+  }
+
+  if (obsTime > latestTime)
+  {
+    latestTime = obsTime;
+  }
+
+  return true;
+}
+
+void ObsAggregator::addToPeriod(Station &station, const MinuteObs &obs, const int sign)
+{
+  //
+  // Time ending periods: a record at the period end belongs to it
+  //
+  time_t obsTime = (time_t)obs.minute * 60;
+
+  time_t end = ((obsTime + PERIOD_SECS - 1) / PERIOD_SECS) * PERIOD_SECS;
+
+  PeriodSum &period = station.periods[(end / PERIOD_SECS) % RING_PERIODS];
+
+  if (period.end != end)
+  {
+    if (period.end > end)
+    {
+      return;
+    }
+
+    memset(&period, 0, sizeof(period));
+
+    period.end = end;
+  }
+
+  period.count += sign;
+
+  for (int v = 0; v < NUM_VARS; v++)
+  {
+    if (!isnan(obs.value[v]))
+    {
+      period.sum[v] += sign * obs.value[v];
+
+      period.num[v] += sign;
+    }
+  }
+
+  period.dirty = true;
+}
+
+int ObsAggregator::publish()
+{
+  //
+  // Complete periods with changes
+  //
+  vector<time_t> ends;
+
+  for (int s = 0; s < (int)stations.size(); s++)
+  {
+    for (int p = 0; p < RING_PERIODS; p++)
+    {
+      const PeriodSum &period = stations[s].periods[p];
+
+      if (period.dirty && period.end <= latestTime)
+      {
+        ends.push_back(period.end);
+      }
+    }
+  }
+
+  sort(ends.begin(), ends.end());
+
+  ends.erase(unique(ends.begin(), ends.end()), ends.end());
+
+  for (int e = 0; e < (int)ends.size(); e++)
+  {
+    vector<const PeriodSum *> sums;
+
+    vector<int> rows;
+
+    for (int s = 0; s < (int)stations.size(); s++)
+    {
+      PeriodSum &period = stations[s].periods[(ends[e] / PERIOD_SECS) % RING_PERIODS];
+
+      if (period.end != ends[e])
+      {
+        continue;
+      }
+
+      period.dirty = false;
+
+      if (period.count >= args.minCount)
+      {
+        sums.push_back(&period);
+
+        rows.push_back(s);
+      }
+    }
+
+    if (rows.size() > 0 && writeNetcdf(ends[e], sums, rows) != 0)
+    {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int ObsAggregator::writeNetcdf(const time_t periodEnd, const vector<const PeriodSum *> &sums,
+                               const vector<int> &rows)
+{
+  char dayStr[16];
+
+  char timeStr[32];
+
+  struct tm tms;
+
+  gmtime_r(&periodEnd, &tms);
+
+  strftime(dayStr, sizeof(dayStr), "%Y%m%d", &tms);
+
+  strftime(timeStr, sizeof(timeStr), "%Y%m%d.%H%M", &tms);
+
+  fs::path dayDir = fs::path(args.outputDir) / dayStr;
+
+  boost::system::error_code ec;
+
+  fs::create_directories(dayDir, ec);
+
+  string path = (dayDir / (string("nymeso_15min_obs.") + timeStr + ".nc")).string();
+
+  string tmpPath = path + ".tmp";
+
+  int numRows = (int)rows.size();
+
+  //
+  // Means, time major with a single time
+  //
+  vector<vector<float> > data(NUM_OUTPUT_VARS, vector<float>(numRows, OBS_MISSING));
+
+  vector<int> ids(numRows);
+
+  vector<char> names(numRows * NAME_LEN, '\0');
+
+  for (int r = 0; r < numRows; r++)
+  {
+    const PeriodSum &p = *sums[r];
+
+    const Station &station = stations[rows[r]];
+
+    ids[r] = station.siteId;
+
+    strncpy(&names[r * NAME_LEN], station.name.c_str(), NAME_LEN);
+
+    data[OUT_RH][r] = mean(p.sum[RH], p.num[RH]);
+
+    data[OUT_TEMP][r] = mean(p.sum[TEMP], p.num[TEMP]);
+
+    data[OUT_GHI][r] = mean(p.sum[GHI], p.num[GHI]);
+
+    data[OUT_PRES][r] = mean(p.sum[PRES], p.num[PRES]);
+
+    data[OUT_WSPD][r] = mean(p.sum[WSPD], p.num[WSPD]);
+
+    data[OUT_ELEV][r] = mean(p.sum[ELEV], p.num[ELEV]);
+
+    data[OUT_AZIM][r] = mean(p.sum[AZIM], p.num[AZIM]);
+
+    data[OUT_TOA][r] = mean(p.sum[TOA], p.num[TOA]);
+
+    if (p.num[U] > 0 && p.num[V] > 0)
+    {
+      data[OUT_WDIR][r] = (float)(atan2(p.sum[U] / p.num[U], p.sum[V] / p.num[V]) / DEG_TO_RAD + 180);
+    }
+
+    //
+    // Kt from the means, missing without sun, at most 1, as avgObs.py -k
+    //
+    float ghi = data[OUT_GHI][r];
+
+    float toa = data[OUT_TOA][r];
+
+    if (ghi != OBS_MISSING && toa != OBS_MISSING && toa > 0)
+    {
+      data[OUT_KT][r] = std::min(ghi / toa, 1.0f);
+    }
+  }
+
+  int ncid;
+
+  int ret = nc_create(tmpPath.c_str(), NC_CLOBBER, &ncid);
+
+  if (ret != NC_NOERR)
+  {
+    error = string("Cannot create ") + tmpPath + ": " + nc_strerror(ret);
+    return 1;
+  }
+
+  int recDim, stationDim, nameDim;
+
+  int timeVar, idVar, nameVar;
+
+  int varIds[NUM_OUTPUT_VARS];
+
+  float fill = OBS_MISSING;
+
+  ret = nc_def_dim(ncid, "rec_num", NC_UNLIMITED, &recDim);
+
+  if (ret == NC_NOERR)
+    ret = nc_def_dim(ncid, "station_name_dim", numRows, &stationDim);
+
+  if (ret == NC_NOERR)
+    ret = nc_def_dim(ncid, "name_len", NAME_LEN, &nameDim);
+
+  if (ret == NC_NOERR)
+    ret = nc_def_var(ncid, "observationTime", NC_DOUBLE, 1, &recDim, &timeVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_att_text(ncid, timeVar, "long_name", strlen("UTC Observation Time"),
+                          "UTC Observation Time");
+
+  if (ret == NC_NOERR)
+    ret = nc_put_att_text(ncid, timeVar, "units", strlen("Seconds since epoch"),
+                          "Seconds since epoch");
+
+  if (ret == NC_NOERR)
+    ret = nc_def_var(ncid, "stationID", NC_INT, 1, &stationDim, &idVar);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_att_text(ncid, idVar, "long_name", strlen("integer station id"),
+                          "integer station id");
+
+  int nameDims[2] = {stationDim, nameDim};
+
+  if (ret == NC_NOERR)
+    ret = nc_def_var(ncid, "station_name", NC_CHAR, 2, nameDims, &nameVar);
+
+  int dataDims[2] = {recDim, stationDim};
+
+  for (int v = 0; v < NUM_OUTPUT_VARS && ret == NC_NOERR; v++)
+  {
+    ret = nc_def_var(ncid, OUTPUT_VARS[v].name, NC_FLOAT, 2, dataDims, &varIds[v]);
+
+    if (ret == NC_NOERR)
+      ret = nc_put_att_float(ncid, varIds[v], "_FillValue", NC_FLOAT, 1, &fill);
+
+    if (ret == NC_NOERR)
+      ret = nc_put_att_text(ncid, varIds[v], "long_name", strlen(OUTPUT_VARS[v].longName),
+                            OUTPUT_VARS[v].longName);
+
+    if (ret == NC_NOERR && OUTPUT_VARS[v].units[0] != '\0')
+      ret = nc_put_att_text(ncid, varIds[v], "units", strlen(OUTPUT_VARS[v].units),
+                            OUTPUT_VARS[v].units);
+  }
+
+  if (ret == NC_NOERR)
+    ret = nc_enddef(ncid);
+
+  size_t start[2] = {0, 0};
+
+  size_t count[2] = {1, (size_t)numRows};
+
+  double obsTime = (double)periodEnd;
+
+  if (ret == NC_NOERR)
+    ret = nc_put_vara_double(ncid, timeVar, start, count, &obsTime);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_var_int(ncid, idVar, &ids[0]);
+
+  if (ret == NC_NOERR)
+    ret = nc_put_var_text(ncid, nameVar, &names[0]);
+
+  for (int v = 0; v < NUM_OUTPUT_VARS && ret == NC_NOERR; v++)
+  {
+    ret = nc_put_vara_float(ncid, varIds[v], start, count, &data[v][0]);
+  }
+
+  int closeRet = nc_close(ncid);
+
+  if (ret == NC_NOERR)
+  {
+    ret = closeRet;
+  }
+
+  if (ret != NC_NOERR || rename(tmpPath.c_str(), path.c_str()) != 0)
+  {
+    error = string("Writing ") + path + " failed" +
+      (ret != NC_NOERR ? string(": ") + nc_strerror(ret) : string(""));
+    unlink(tmpPath.c_str());
+    return 1;
+  }
+
+  if (DebugLevel > 0)
+  {
+    Logg->write_time("Info: Published %d stations to %s\n", numRows, path.c_str());
+  }
+
+  return 0;
+}
+
+int ObsAggregator::loadState()
+{
+  FILE *fp = fopen(args.stateFile.c_str(), "rb");
+
+  if (fp == NULL)
+  {
+    Logg->write_time("Info: No state file %s, starting empty\n", args.stateFile.c_str());
+    return 0;
+  }
+
+  char magic[4];
+
+  int version = 0;
+
+  int numStations = 0;
+
+  int ringMinutes = 0;
+
+  int ringPeriods = 0;
+
+  bool ok = (fread(magic, 1, 4, fp) == 4 && memcmp(magic, STATE_MAGIC, 4) == 0 &&
+             fread(&version, sizeof(int), 1, fp) == 1 && version == STATE_VERSION &&
+             fread(&ringMinutes, sizeof(int), 1, fp) == 1 && ringMinutes == RING_MINUTES &&
+             fread(&ringPeriods, sizeof(int), 1, fp) == 1 && ringPeriods == RING_PERIODS &&
+             fread(&numStations, sizeof(int), 1, fp) == 1 &&
+             fread(&latestTime, sizeof(time_t), 1, fp) == 1);
+
+  //
+  // Stations are matched by site id; ones dropped from the site list are
+  // skipped
+  //
+  map<int, int> idIndex;
+
+  for (int s = 0; s < (int)stations.size(); s++)
+  {
+    idIndex[stations[s].siteId] = s;
+  }
+
+  Station read;
+
+  read.ring.resize(RING_MINUTES);
+
+  read.periods.resize(RING_PERIODS);
+
+  for (int s = 0; ok && s < numStations; s++)
+  {
+    ok = (fread(&read.siteId, sizeof(int), 1, fp) == 1 &&
+          fread(&read.latestMinute, sizeof(int), 1, fp) == 1 &&
+          fread(&read.ring[0], sizeof(MinuteObs), RING_MINUTES, fp) == (size_t)RING_MINUTES &&
+          fread(&read.periods[0], sizeof(PeriodSum), RING_PERIODS, fp) == (size_t)RING_PERIODS);
+
+    map<int, int>::iterator it = idIndex.find(read.siteId);
+
+    if (ok && it != idIndex.end())
+    {
+      Station &station = stations[it->second];
+
+      station.latestMinute = read.latestMinute;
+
+      station.ring = read.ring;
+
+      station.periods = read.periods;
+    }
+  }
+
+  fclose(fp);
+
+  if (!ok)
+  {
+    error = string("Invalid state file ") + args.stateFile;
+    return 1;
+  }
+
+  return 0;
+}
+
+int ObsAggregator::saveState()
+{
+  string tmpPath = args.stateFile + ".tmp";
+
+  FILE *fp = fopen(tmpPath.c_str(), "wb");
+
+  if (fp == NULL)
+  {
+    error = string("Cannot write state file ") + tmpPath;
+    return 1;
+  }
+
+  int numStations = (int)stations.size();
+
+  bool ok = (fwrite(STATE_MAGIC, 1, 4, fp) == 4 &&
+             fwrite(&STATE_VERSION, sizeof(int), 1, fp) == 1 &&
+             fwrite(&RING_MINUTES, sizeof(int), 1, fp) == 1 &&
+             fwrite(&RING_PERIODS, sizeof(int), 1, fp) == 1 &&
+             fwrite(&numStations, sizeof(int), 1, fp) == 1 &&
+             fwrite(&latestTime, sizeof(time_t), 1, fp) == 1);
+
+  for (int s = 0; ok && s < numStations; s++)
+  {
+    const Station &station = stations[s];
+
+    ok = (fwrite(&station.siteId, sizeof(int), 1, fp) == 1 &&
+          fwrite(&station.latestMinute, sizeof(int), 1, fp) == 1 &&
+          fwrite(&station.ring[0], sizeof(MinuteObs), RING_MINUTES, fp) == (size_t)RING_MINUTES &&
+          fwrite(&station.periods[0], sizeof(PeriodSum), RING_PERIODS, fp) == (size_t)RING_PERIODS);
+  }
+
+  if (fclose(fp) != 0 || !ok || rename(tmpPath.c_str(), args.stateFile.c_str()) != 0)
+  {
+    error = string("Writing state file ") + args.stateFile + " failed";
+    unlink(tmpPath.c_str());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: ObsAggregator.hh,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/09/06 10:00:00 $
+//
+//==============================================================================
+
+/**
+ *
+ *  @file ObsAggregator.hh
+ *  @class ObsAggregator
+ *  @brief Incremental replacement for the download -> shading QC -> avgObs
+ *         -> csv2madis chain. One minute mesonet records are kept in a
+ *         ring buffer per station, and a running sum per 15 minute, time
+ *         ending period is updated as each record arrives. Solar geometry
+ *         and TOA are computed for each minute, the insolation is bounds
+ *         checked and masked where shaded, and wind is averaged as u and v
+ *         components. When a period is complete, or changes after it was
+ *         published, the netCDF file read by ObsReader is (re)written.
+ *  @date 09/06/2021
+ */
+
+#ifndef OBS_AGGREGATOR_HH
+#define OBS_AGGREGATOR_HH
+
+#include <map>
+#include <string>
+#include <time.h>
+#include <vector>
+#include <shading_mask/shading_mask.hh>
+#include "Arguments.hh"
+
+using std::map;
+using std::string;
+using std::vector;
+
+class ObsAggregator
+{
+public:
+
+  /**
+   * Minutes of records kept per station. Records older than this, relative
+   * to the station's newest record, are dropped.
+   */
+  const static int RING_MINUTES;
+
+  /**
+   * Seconds averaged into each published value
+   */
+  const static int PERIOD_SECS;
+
+  /**
+   * Missing value in the published files
+   */
+  const static float OBS_MISSING;
+
+  /**
+   * Constructor
+   * @param[in] args  Command line arguments
+   */
+  ObsAggregator(const Arguments &args);
+
+  /**
+   * Destructor
+   */
+  ~ObsAggregator();
+
+  /**
+   * Read the site list, shading tables and state, then aggregate the
+   * inputs once or, when polling, until killed
+   * @return 1 for failure, 0 for success
+   */
+  int run();
+
+  /**
+   * Error string
+   */
+  string error;
+
+private:
+
+  /**
+   * Variables summed per minute. Wind direction is derived from the u
+   * and v means, Kt from the insolation and TOA means.
+   */
+  enum
+  {
+    GHI,
+    RH,
+    TEMP,
+    PRES,
+    WSPD,
+    U,
+    V,
+    ELEV,
+    AZIM,
+    TOA,
+    NUM_VARS
+  };
+
+  /**
+   * One minute record; missing values are NaN
+   */
+  struct MinuteObs
+  {
+    int minute;
+    float value[NUM_VARS];
+  };
+
+  /**
+   * Running sums of a 15 minute period
+   */
+  struct PeriodSum
+  {
+    time_t end;
+    int count;
+    double sum[NUM_VARS];
+    int num[NUM_VARS];
+    bool dirty;
+  };
+
+  struct Station
+  {
+    string name;
+    int siteId;
+    float lat;
+    float lon;
+    bool haveLocation;
+    int latestMinute;
+    vector<MinuteObs> ring;
+    vector<PeriodSum> periods;
+  };
+
+  /**
+   * Columns of an input file and the bytes of it already aggregated
+   */
+  struct InputFile
+  {
+    long offset;
+    vector<int> columns;
+  };
+
+  const Arguments &args;
+
+  vector<Station> stations;
+
+  map<string, int> stationIndex;
+
+  ShadingMask *shading;
+
+  map<string, InputFile> inputFiles;
+
+  /**
+   * Newest record time over all stations. Periods ending after it are
+   * not yet complete and are not published.
+   */
+  time_t latestTime;
+
+  int readSiteList();
+
+  /**
+   * Aggregate new records from all inputs
+   * @param[out] numRecords  Number of records aggregated
+   */
+  int scanInputs(int &numRecords);
+
+  /**
+   * Aggregate the records of a file beyond its offset
+   */
+  int ingestFile(const string &path, InputFile &input, int &numRecords);
+
+  /**
+   * QC a parsed record, add solar geometry and aggregate it
+   * @return true if the record was new or changed
+   */
+  bool addRecord(Station &station, const time_t obsTime, float *value);
+
+  /**
+   * Add (sign 1) or remove (sign -1) a minute from its period
+   */
+  void addToPeriod(Station &station, const MinuteObs &obs, const int sign);
+
+  /**
+   * Write the files of complete periods that changed
+   */
+  int publish();
+
+  /**
+   * Write the file of one period
+   */
+  int writeNetcdf(const time_t periodEnd, const vector<const PeriodSum *> &sums,
+                  const vector<int> &rows);
+
+  int loadState();
+
+  int saveState();
+};
+
+#endif /* OBS_AGGREGATOR_HH */
@@ -24,12 +24,16 @@
 #include <fstream>
 #include <unistd.h>
 #include <iostream>
+#include <run_profile/run_profile.hh>
 
 using std::ifstream;
 using std::cerr;
 using std::endl;
 #include "Arguments.hh"
 
+namespace pct_power
+{
+
 // Constant and macros
 
 // Types, structures and classes
@@ -69,6 +73,12 @@ Arguments::Arguments(int argc, char **argv)
 
   debugLevel = 0;
 
+  numThreads = 0;
+
+  profile = false;
+
+  interpGap = 0;
+
   bool errflg = false;
 
   int c; 
@@ -76,13 +86,30 @@ Arguments::Arguments(int argc, char **argv)
   //
   // parse the command line options, set members where appropriate
   //
-  while ((c = getopt(argc, argv, "d:hl:m:s:t:")) != EOF)
+  while ((c = getopt(argc, argv, "b:d:f:hi:j:l:m:pr:s:t:")) != EOF)
     switch (c)
       {
+      case 'b':
+        latencyBudget = optarg;
+        profile = true;
+        break;
+
       case 'd':
 	debugLevel = atoi(optarg);
 	break;
 
+      case 'f':
+        farmManifest = optarg;
+        break;
+
+      case 'i':
+        interpGap = atoi(optarg);
+        break;
+
+      case 'j':
+        numThreads = atoi(optarg);
+        break;
+
       case 'm':
          modelFilesStr =  optarg;
          parseCommaDelimStr(modelFilesStr, modelFiles);	
@@ -96,6 +123,14 @@ Arguments::Arguments(int argc, char **argv)
 	logDir = optarg;
 	break;
 
+      case 'p':
+        profile = true;
+        break;
+
+      case 'r':
+        regionTable = optarg;
+        break;
+
       case 's':
         subsetFcst = true; 
         fcstLeadTimesMinsStr = optarg;
@@ -117,7 +152,20 @@ Arguments::Arguments(int argc, char **argv)
       return;
     }
 
-  if (argc - optind < 6)
+  //
+  // In multi-farm mode the site-ID file, Cubist model, CDL file and output
+  // directory come from the farm manifest
+  //
+  if (farmManifest != "")
+  {
+    if (argc - optind < 2)
+    {
+      error = "There are not enough arguments. Arguments in multi-farm mode "
+              "include: fcstLeadsDelta fcstLeadsNum";
+      return;
+    }
+  }
+  else if (argc - optind < 6)
   {
     error = "There are not enough arguments. Arguments include: siteIdFile "
             " fcstLeadsDelta fcstLeadsNum cubistModelBaseName outputCdlFile "
@@ -125,11 +173,28 @@ Arguments::Arguments(int argc, char **argv)
     return;
   }
 
+  if (interpGap < 0)
+  {
+    error = "-i must not be negative.";
+    return;
+  }
+
   if ( (int)modelFiles.size() == 0)
   {
      error = "Input is empty for blended forecast files. ";
      return;
   }
+
+  if (latencyBudget != "")
+  {
+     RunProfile budgetCheck("pct_power_fcst");
+
+     if (budgetCheck.parse_budgets(latencyBudget))
+     {
+        error = budgetCheck.error() + ".";
+        return;
+     }
+  }
  
   //
   // Required args
@@ -140,13 +205,16 @@ Arguments::Arguments(int argc, char **argv)
 
   fcstLeadsNum = atoi(argv[optind++]);
 
-  siteIdFile = string(argv[optind++]);
+  if (farmManifest == "")
+  {
+    siteIdFile = string(argv[optind++]);
  
-  cubistModel = string(argv[optind++]);
+    cubistModel = string(argv[optind++]);
 
-  cdlFile = string(argv[optind++]);
+    cdlFile = string(argv[optind++]);
 
-  outputDir = string(argv[optind++]);
+    outputDir = string(argv[optind++]);
+  }
 
   get_command_string(argc, argv, commandString);
 }
@@ -161,10 +229,24 @@ void Arguments::usage(char *programName)
                   "<outputCdlFile> "
                   "<outputDir>\n\n", programName);
   fprintf(stderr, "%s options:\n", programName);
+  fprintf(stderr, "\t-b  <latency budget> warn when a stage takes longer than its budget,\n"
+                  "\t    seconds for all stages or stage=secs,...[,default secs], stages\n"
+                  "\t    parse_models, load_model, predict, write_netcdf, rollup; implies -p\n");
   fprintf(stderr, "\t-d  <debug level>\n");
+  fprintf(stderr, "\t-f  <farm manifest> multi-farm mode: one line per farm with\n"
+                  "\t    farmName siteIdFile cubistModelBaseName outputCdlFile outputDir,\n"
+                  "\t    replacing the last four arguments\n");
+  fprintf(stderr, "\t-i  <seconds> interpolate blended model files whose valid times are\n"
+                  "\t    up to this far apart, e.g. 3600 for an hourly blend, to the\n"
+                  "\t    forecast times\n");
+  fprintf(stderr, "\t-j  <number of threads evaluating farms in multi-farm mode>\n");
   fprintf(stderr, "\t-m <blended model forecast files> (a comma delimited list)\n"); 
   fprintf(stderr, "\t-h  help\n");
   fprintf(stderr, "\t-l  <log direcotry>\n");
+  fprintf(stderr, "\t-p  write the time, CPU time and bytes read of each stage and missing\n"
+                  "\t    predictor counts to <output>.profile.json\n");
+  fprintf(stderr, "\t-r  <capacity and region table> also write total power and regional\n"
+                  "\t    sums; csv with siteId, capacity_kW and region columns\n");
   fprintf(stderr, "\t-s  <single forecast lead in minutes>\n");
   fprintf(stderr, "\t-t  <unix time of first forecast>\n"); 
 }
@@ -174,9 +256,16 @@ void Arguments::print()
   fprintf(stderr, "  forecast leads delta %d\n", fcstLeadsDelta);
   fprintf(stderr, "  number of forecasts leads to be processed: %d\n", 
                      fcstLeadsNum);
-  fprintf(stderr, "  statistical model base: %s\n",cubistModel.c_str());
-  fprintf(stderr, "  cdlFile: %s\n", cdlFile.c_str());
-  fprintf(stderr, "  outputDir:  %s\n", outputDir.c_str()); 
+  if (farmManifest != "")
+  {
+    fprintf(stderr, "  farm manifest: %s\n", farmManifest.c_str());
+  }
+  else
+  {
+    fprintf(stderr, "  statistical model base: %s\n",cubistModel.c_str());
+    fprintf(stderr, "  cdlFile: %s\n", cdlFile.c_str());
+    fprintf(stderr, "  outputDir:  %s\n", outputDir.c_str()); 
+  }
   
   if ((int) modelFiles.size() > 0)
   {
@@ -188,6 +277,9 @@ void Arguments::print()
 
   }
 
+  if (regionTable != "")
+    fprintf(stderr,"  regionTable: %s\n", regionTable.c_str());
+
   if (logDir != "")
     fprintf(stderr,"  logDir: %s\n", logDir.c_str());
 
@@ -228,3 +320,5 @@ void Arguments::parseCommaDelimStr(string &commaStr, vector <int> &vec)
   // last file
   vec.push_back(atoi(commaStr.c_str()));
 }
+
+} // namespace pct_power
@@ -16,8 +16,8 @@
  *  @date 6/8/2021
  */
 
-#ifndef ARGUMENTS_HH
-#define ARGUMENTS_HH
+#ifndef PCT_ARGUMENTS_HH
+#define PCT_ARGUMENTS_HH
 
 #include <string>
 #include <time.h>
@@ -26,6 +26,9 @@
 using std::string;
 using std::vector;
 
+namespace pct_power
+{
+
 /** 
  * Arguments class 
  */
@@ -130,6 +133,41 @@ public:
    */
   int fcstLeadsNum;
 
+  /**
+   * Farm manifest file for multi-farm mode. Each line holds a farm name,
+   * site-ID file, Cubist model basename, CDL file and output directory.
+   * Empty for a single forecast from the command line arguments.
+   */
+  string farmManifest;
+
+  /**
+   * Capacity and region membership table for the total power and regional
+   * rollup output, empty for no rollup
+   */
+  string regionTable;
+
+  /**
+   * Number of threads evaluating farms in multi-farm mode, 0 for one
+   * per farm up to the number of processors
+   */
+  int numThreads;
+
+  /**
+   * Largest time in seconds between blended model valid times that is
+   * interpolated to the forecast times, 0 for none
+   */
+  int interpGap;
+
+  /**
+   * Flag indicating that a run profile is written next to the output
+   */
+  bool profile;
+
+  /**
+   * Latency budgets of the run profile stages, empty if none
+   */
+  string latencyBudget;
+
   /** 
    * @param[in] commaStr  Comma delimited list of file strings
    * @param[out] vec  Vector containing individual file string elements 
@@ -152,4 +190,6 @@ public:
   
 };
 
-#endif /* ARGUMENTS_HH */
+} // namespace pct_power
+
+#endif /* PCT_ARGUMENTS_HH */
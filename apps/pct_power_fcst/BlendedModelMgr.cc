@@ -105,6 +105,24 @@ const int BlendedModelMgr::getClimateZone( const int siteId)
   return _modelFiles[0]->getClimateZone(siteId);
 }
 
+void BlendedModelMgr::gather(const BlendedModelReader::Var *vars, const int numVars,
+                             const int siteId, const double fcstTime, float *values)
+{
+  int i = getBlendedModelFileIndex(fcstTime);
+
+  if(i >= 0)
+  {
+    _modelFiles[i]->gather(vars, numVars, siteId, fcstTime, values);
+  }
+  else
+  {
+    for (int j = 0; j < numVars; j++)
+    {
+      values[j] = BlendedModelReader::MISSING;
+    }
+  }
+}
+
 const float BlendedModelMgr::getGHI( const int siteId, const double fcstTime)    
 {
   int i = getBlendedModelFileIndex(fcstTime);
@@ -83,6 +83,18 @@ public:
    */
   const int getClimateZone(const int siteId);
 
+  /**
+   * Get several data variables for given site ID at given forecast time
+   * from the most recent forecast having the time
+   * @param[in] vars  Data variables
+   * @param[in] numVars  Number of variables
+   * @param[in] siteId  Integer site id for forecast data
+   * @param[in] fcstTime  forecast data time in seconds.
+   * @param[out] values  numVars forecasted data values, in the order of vars
+   */
+  void gather(const BlendedModelReader::Var *vars, const int numVars,
+              const int siteId, const double fcstTime, float *values);
+
   /**
    * Get GHI for given site ID at given forecast time
    * @param[in] siteId  Integer site id for forecast data
@@ -33,8 +33,11 @@ using std::cerr;
 using std::endl;
 
 const float BlendedModelReader::MISSING = NC_FILL_FLOAT;
+constexpr SiteVarDef BlendedModelReader::VARS[];
 
 BlendedModelReader::BlendedModelReader(string &dicastFile): 
+  columns(VARS),
+  interpMaxGap(0),
   inputFile(dicastFile)
 {
 }
@@ -49,6 +52,14 @@ int BlendedModelReader::parse()
       error = string("Error: cdf file") + inputFile +  "does not exist";
       return 1;
     }
+
+  //
+  // Files converted by nc2site_store are mapped rather than read
+  //
+  if (SiteStore::is_store(inputFile))
+    {
+      return parseStore();
+    }
     
   //
   // NetCDF file dimensions
@@ -66,10 +77,11 @@ int BlendedModelReader::parse()
   varNames.push_back("valid_time");
   varNames.push_back("num_sites");
   varNames.push_back("siteId");
-  varNames.push_back("ClimateZone");
-  varNames.push_back("ghi");
-  varNames.push_back("RH");
-  varNames.push_back("T2");
+
+  for (int v = 0; v < NUM_VARS; v++)
+  {
+    varNames.push_back(VARS[v].name);
+  }
 
   //
   // Create a netCDF reader object
@@ -174,72 +186,177 @@ int BlendedModelReader::parse()
         return 1;
      } 
   }
+
+  timeInterp.set_times(validTime, MISSING, interpMaxGap);
   
   //
-  // Copy climateZone to vector
+  // Copy the data variables to the data arrays
   //
-  ind = varIndexMap["ClimateZone"];
-  int numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  for (int v = 0; v < NUM_VARS; v++)
   {
-    int val = ((int *)inVarPtrs[ind])[i];
-    climateZone.push_back(val);
+    ind = varIndexMap[VARS[v].name];
+
+    columns.copy((Var)v, inVarPtrs[ind], inVarSizes[ind]);
   }
 
-  //
-  // Copy GHI to vector
-  //
-  ind = varIndexMap["ghi"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  mapSites();
+
+  return 0;
+}
+
+int BlendedModelReader::parseStore()
+{
+  if (store.open(inputFile) != 0)
+    {
+      error = string("Error: ") + store.error();
+      return 1;
+    }
+
+  numSites = store.num_sites();
+
+  for (int i = 0; i < numSites; i++)
+    {
+      siteList.push_back(store.site_id(i));
+    }
+
+  for (int i = 0; i < store.num_times(); i++)
+    {
+      validTime.push_back(store.time(i));
+    }
+
+  if ( (int) validTime.size() > 0)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    ghi.push_back(val);
+    creationTime = validTime[0];
+
+    lastFcstTime = validTime[ (int) validTime.size() - 1];
   }
+  else
+  {
+     error = string("Error: Empty valid_time array for ") + inputFile;
 
-  //
-  // Copy relative humidity to vector
-  //
-  ind = varIndexMap["RH"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+     return 1;
+  }
+
+  if ( (int) validTime.size() > 1)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    rh.push_back(val);
+     fcst_time_resolution = validTime[1] - validTime[0];
+
+     if (fcst_time_resolution <= 0)
+     {
+        error = string("Error: expecting valid time resolution > 0");
+      
+        return 1;
+     } 
   }
-  
+
+  timeInterp.set_times(validTime, MISSING, interpMaxGap);
+
   //
-  // Copy temperature to vector
+  // nc2site_store repeats per site variables such as the climate zone 
+  // over all times
   //
-  ind = varIndexMap["T2"];
-  numObs = inVarSizes[ind];
-  for (int i=0; i<numObs; i++)
+  for (int v = 0; v < NUM_VARS; v++)
   {
-    float val = ((float *)inVarPtrs[ind])[i];
-    temp.push_back(val);
+    if (columns.view((Var)v, store) != 0)
+    {
+      error = string("Error: ") + VARS[v].name + " is not in site store " + inputFile;
+      return 1;
+    }
   }
 
-  //
-  // Map siteIds to integer indices
-  //
-  for (int i = 0; i < numSites; i++)
+  mapSites();
+
+  return 0;
+}
+
+int BlendedModelReader::setArrays(const vector<int> &siteIds,
+                                  const vector<double> &validTimes,
+                                  const vector<int> &climateZones,
+                                  const float *ghiData, const float *rhData,
+                                  const float *tempData)
+{
+  error = string("");
+
+  if (climateZones.size() != siteIds.size() || !ghiData || !rhData || !tempData)
   {
-    siteIdIndexMap[siteList[i]] = i;
+     error = string("Error: incomplete forecast arrays for ") + inputFile;
+
+     return 1;
   }
 
-  //
-  // Map climate zone to sites 
-  //
-  for (int i = 0; i < numSites; i++)
+  numSites = (int) siteIds.size();
+
+  siteList = siteIds;
+
+  validTime = validTimes;
+
+  if ( (int) validTime.size() > 0)
+  {
+    creationTime = validTime[0];
+
+    lastFcstTime = validTime[ (int) validTime.size() - 1];
+  }
+  else
+  {
+     error = string("Error: Empty valid_time array for ") + inputFile;
+
+     return 1;
+  }
+
+  if ( (int) validTime.size() > 1)
   {
-    siteClimateZoneMap[siteList[i]] = climateZone[i];
+     fcst_time_resolution = validTime[1] - validTime[0];
+
+     if (fcst_time_resolution <= 0)
+     {
+        error = string("Error: expecting valid time resolution > 0");
+      
+        return 1;
+     } 
   }
 
+  timeInterp.set_times(validTime, MISSING, interpMaxGap);
+
+  size_t numValues = (size_t) numSites * validTime.size();
+
+  columns[GHI].view(ghiData, numValues);
+
+  columns[RH].view(rhData, numValues);
+
+  columns[TEMP].view(tempData, numValues);
+
+  columns.copy(CLIMATE_ZONE, climateZones.data(), climateZones.size());
+
+  mapSites();
+
   return 0;
 }
 
+void BlendedModelReader::mapSites()
+{
+  for (int i = 0; i < (int) siteList.size(); i++)
+  {
+    siteIdIndexMap[siteList[i]] = i;
+
+    siteClimateZoneMap[siteList[i]] = (int)columns[CLIMATE_ZONE][i];
+  }
+}
+
 const bool BlendedModelReader::haveData(double fcstTime) const
 {
+  //
+  // When interpolating, any forecast time between valid times close
+  // enough together
+  //
+  if (interpMaxGap > 0)
+  {
+    int i0, i1;
+
+    float w;
+
+    return timeInterp.bracket(fcstTime, i0, i1, w);
+  }
+
   //
   // Check to see if fcstTime is in [firstFcstTime,lastFcstTime] 
   //
@@ -297,47 +414,69 @@ const int BlendedModelReader::getArrayOffset( const int siteId, double fcstTime)
 const int BlendedModelReader::getClimateZone( const int siteId)
 {
 
-  return siteClimateZoneMap[siteId];
-}
-
-const float BlendedModelReader::getGHI( const int siteId, const double fcstTime)
-{
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
+  //
+  // Look up without inserting so that farms evaluated in parallel threads
+  // can share the reader
+  //
+  map < int, int >::const_iterator it = siteClimateZoneMap.find(siteId);
 
-  if ( arrayOffset >= 0)
+  if (it != siteClimateZoneMap.end())
   {
-    return ghi[arrayOffset];
+    return it->second;
   }
   else
   {
-    return MISSING;
+    return 0;
   }
 }
 
-const float BlendedModelReader::getRh( const int siteId, const double fcstTime)
+const float BlendedModelReader::get(const Var var, const int siteId,
+                                    const double fcstTime)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
+  float value;
 
-  if ( arrayOffset >= 0)
-  {
-    return rh[arrayOffset];
-  }
-  else
-  {
-    return MISSING;
-  }
+  gather(&var, 1, siteId, fcstTime, &value);
+
+  return value;
 }
 
-const float BlendedModelReader::getTemp( const int siteId, const double fcstTime)
+void BlendedModelReader::gather(const Var *vars, const int numVars, const int siteId,
+                                const double fcstTime, float *values)
 {
-  int arrayOffset =  getArrayOffset(siteId, fcstTime);
+  int siteIndex = getSiteIndex(siteId);
 
-  if ( arrayOffset >= 0)
-  {
-    return temp[arrayOffset];
-  }
-  else
+  int arrayOffset = (interpMaxGap > 0) ? -1 : getArrayOffset(siteId, fcstTime);
+
+  for (int i = 0; i < numVars; i++)
   {
-    return MISSING;
+    const SiteColumn &column = columns[vars[i]];
+
+    if (columns.def(vars[i]).layout == SITE_VAR_SITE)
+    {
+      values[i] = (siteIndex >= 0) ? column[siteIndex] : MISSING;
+    }
+    else if (interpMaxGap > 0)
+    {
+      values[i] = timeInterp.value(column, siteIndex, fcstTime);
+    }
+    else
+    {
+      values[i] = (arrayOffset >= 0) ? column[arrayOffset] : MISSING;
+    }
   }
 }
+
+const float BlendedModelReader::getGHI( const int siteId, const double fcstTime)
+{
+  return get(GHI, siteId, fcstTime);
+}
+
+const float BlendedModelReader::getRh( const int siteId, const double fcstTime)
+{
+  return get(RH, siteId, fcstTime);
+}
+
+const float BlendedModelReader::getTemp( const int siteId, const double fcstTime)
+{
+  return get(TEMP, siteId, fcstTime);
+}
@@ -28,6 +28,7 @@
 #include<string>
 #include<map>
 #include<algorithm>
+#include <site_store/site_store.hh>
 
 using std::vector;
 using std::map;
@@ -46,6 +47,28 @@ public:
    */
   const static float MISSING;
 
+  /**
+   * Data variables of the file, in the order of VARS
+   */
+  enum Var
+  {
+    CLIMATE_ZONE,
+    GHI,
+    RH,
+    TEMP,
+    NUM_VARS
+  };
+
+  /**
+   * netCDF name, type and layout of each data variable
+   */
+  static constexpr SiteVarDef VARS[NUM_VARS] = {
+    { "ClimateZone", SITE_VAR_INT, SITE_VAR_SITE, 0 },
+    { "ghi", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "RH", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+    { "T2", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+  };
+
   /**
    * Forecast lead time resolution
    */
@@ -63,11 +86,42 @@ public:
   ~BlendedModelReader() {};
  
   /**
-   * Read netCDF file
+   * Read netCDF file, or map the site store file written for it by
+   * nc2site_store
    * @return 0 if netCDF file is successfully read
    */
   int parse(void);
+
+  /**
+   * Set up the reader from forecast arrays held in memory instead of a
+   * file, as a blended model file would hold them (the fused solar
+   * pipeline hands the blend of ghi_fcst over this way). The data arrays
+   * view the caller's arrays, which must outlive the reader. Call instead
+   * of parse(), after setInterpolation().
+   * @param[in] siteIds  Site ids, the order of the data
+   * @param[in] validTimes  Forecast valid times
+   * @param[in] climateZones  Climate zone of each site
+   * @param[in] ghiData  GHI, [site][time]
+   * @param[in] rhData  Relative humidity, [site][time]
+   * @param[in] tempData  Temperature, [site][time]
+   * @return 0 if the arrays are usable
+   */
+  int setArrays(const vector<int> &siteIds, const vector<double> &validTimes,
+                const vector<int> &climateZones, const float *ghiData,
+                const float *rhData, const float *tempData);
   
+  /**
+   * Serve forecast times between the valid times of the file, e.g. 15
+   * minute times from an hourly blend, by linear interpolation in time.
+   * Call before parse().
+   * @param[in] maxGap  Largest time in seconds between valid times that is
+   *                    interpolated, 0 for no interpolation
+   */
+  void setInterpolation(const int maxGap)
+  {
+    interpMaxGap = maxGap;
+  }
+
   /**
    * Error string if file read fails
    */
@@ -107,6 +161,27 @@ public:
    */
   const int getClimateZone(const int siteId);
 
+  /**
+   * Get a data variable for given site ID at given forecast time
+   * @param[in] var  Data variable
+   * @param[in] siteId  Integer site id for forecast data
+   * @param[in] fcstTime  forecast data time in seconds.
+   * @return forecasted data value
+   */
+  const float get(const Var var, const int siteId, const double fcstTime);
+
+  /**
+   * Get several data variables for given site ID at given forecast time,
+   * locating the site and time once
+   * @param[in] vars  Data variables
+   * @param[in] numVars  Number of variables
+   * @param[in] siteId  Integer site id for forecast data
+   * @param[in] fcstTime  forecast data time in seconds.
+   * @param[out] values  numVars forecasted data values, in the order of vars
+   */
+  void gather(const Var *vars, const int numVars, const int siteId,
+              const double fcstTime, float *values);
+
   /**
    * Get GHI for given site ID at given forecast time
    * @param[in] siteId  Integer site id for forecast data
@@ -184,34 +259,30 @@ private:
   vector <double> validTime;
 
   /**
-   * climate zone for all sites 
+   * Data arrays of the VARS for all sites and all forecasts, site major
    */
-  vector <int> climateZone;
+  SiteColumns<Var, NUM_VARS> columns;
 
   /**
-   *  GHI array for all sites and all forecasts 
-   */
-  vector <float> ghi;
- 
-  /**
-   *  Relative humidity for all sites and all forecasts
+   * Total number of sites for which forecasts are made
    */
-  vector <float> rh;
+  int numSites;
 
   /**
-   *  Temperature data array for all sites and all forecasts
+   * Last forecast time in the file.
    */
-  vector <float> temp;
+  double lastFcstTime;
 
   /**
-   * Total number of sites for which forecasts are made
+   * Largest time between valid times that is interpolated, 0 if the
+   * reader does not interpolate
    */
-  int numSites;
+  int interpMaxGap;
 
   /**
-   * Last forecast time in the file.
+   * Interpolating view of the data arrays at the valid times
    */
-  double lastFcstTime;
+  SiteInterp timeInterp;
 
   /**
    * String containing error message for failed file read
@@ -228,10 +299,27 @@ private:
    */ 
   double creationTime;
 
+  /**
+   * Mapped site store when the input file is one. The data arrays then 
+   * view the store columns instead of holding copies.
+   */
+  SiteStore store;
+
   /**
    * Get the offset of a data variable with this site ID at forecast time
    */ 
   const int getArrayOffset( const int siteId, double fcstTime) ;
+
+  /**
+   * Set up the data arrays from a site store file
+   * @return 0 if the store is successfully mapped
+   */
+  int parseStore(void);
+
+  /**
+   * Map the site ids to their index and climate zone
+   */
+  void mapSites(void);
 };
 
 #endif /* BLENDED_MODEL_READER_HH */
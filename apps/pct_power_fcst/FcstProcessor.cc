@@ -23,7 +23,9 @@
 #include <string>
 #include <vector>
 #include <string>
+#include <mutex>
 #include <log/log.hh>
+#include <site_store/nc_lock.hh>
 #include "Arguments.hh"
 #include "FcstProcessor.hh"
 #include "cdf_field_writer.hh"
@@ -34,12 +36,47 @@ using std::vector;
 extern Log *Logg;
 extern int DebugLevel;
 
+namespace pct_power
+{
+
 const float FcstProcessor::FCST_MISSING = NC_FILL_FLOAT;
 
+//
+// The Cubist library reads models and evaluates cases through global
+// state, so farms evaluated in parallel threads (multi-farm mode) take
+// this lock when loading models and predicting
+//
+static std::mutex cubistMutex;
+
+//
+// Run profile names of the predictors, in loadPredictors() order. NULL
+// entries are not model values and are not counted when missing.
+//
+static const char *PREDICTOR_NAMES[] =
+{
+  NULL, "T2", "RH", "climate_zone", "GHI", NULL
+};
+
+static const int NUM_PREDICTOR_NAMES = sizeof(PREDICTOR_NAMES) / sizeof(PREDICTOR_NAMES[0]);
+
 FcstProcessor::FcstProcessor(const Arguments &argsParam):
-  args(argsParam)
+  args(argsParam), siteMgr(NULL), cubistModel(NULL), regionAggregator(NULL),
+  runProfile(NULL)
 { 
   error = string("");
+
+  if (args.profile)
+  {
+     runProfile = new RunProfile("pct_power_fcst");
+
+     //
+     // Checked by Arguments
+     //
+     if (args.latencyBudget != "")
+     {
+        runProfile->parse_budgets(args.latencyBudget);
+     }
+  }
 }
 
 FcstProcessor::~FcstProcessor()
@@ -55,6 +92,14 @@ FcstProcessor::~FcstProcessor()
   {
      delete cubistModel;
   }
+  if (regionAggregator)
+  {
+     delete regionAggregator;
+  }
+  if (runProfile)
+  {
+     delete runProfile;
+  }
 }
 
 int FcstProcessor::run()
@@ -71,25 +116,44 @@ int FcstProcessor::run()
   //  
   BlendedModelMgr modelMgr;
 
-  if ((int) args.modelFiles.size() == 0)
+  ScopedTimer parseTimer(runProfile, "parse_models");
+
+  if (loadModelFiles(args.modelFiles, args.interpGap, modelMgr))
+  {
+     return 1;
+  }
+
+  parseTimer.stop();
+
+  return runShared(modelMgr);
+}
+
+int FcstProcessor::loadModelFiles(const vector <string> &modelFiles,
+                                  const int interpGap, BlendedModelMgr &modelMgr)
+{
+  if ((int) modelFiles.size() == 0)
   {
      Logg->write_time("ERROR: No NWP data available. fcst cannot run.\n");
      
      return 1;
   }
 
-  for (int i = 0; i < (int) args.modelFiles.size(); i++)
+  for (int i = 0; i < (int) modelFiles.size(); i++)
   {
     if (DebugLevel > 1)
     {
       Logg->write_time("Info: Reading blended model file %s\n", 
-		       args.modelFiles[i].c_str());
+		       modelFiles[i].c_str());
     }
 
     //
     // Create a reader object for each NWP file
     //
-    BlendedModelReader *modelReader = new BlendedModelReader(args.modelFiles[i]);  
+    string modelFile = modelFiles[i];
+
+    BlendedModelReader *modelReader = new BlendedModelReader(modelFile);  
+
+    modelReader->setInterpolation(interpGap);
 
     //
     // parse file and store reader if successful, return error otherwise 
@@ -101,7 +165,9 @@ int FcstProcessor::run()
     if ( strcmp(modelError.c_str(),"") != 0 )
     {
       Logg->write_time("ERROR: Failure to reading blended model file %s: %s\n", 
-		       args.modelFiles[i].c_str(), modelError.c_str());
+		       modelFiles[i].c_str(), modelError.c_str());
+
+      delete modelReader;
 
       return 1;
     }
@@ -111,16 +177,25 @@ int FcstProcessor::run()
     }
   }
 
+  return 0;
+}
+
+int FcstProcessor::runShared(BlendedModelMgr &modelMgr)
+{
   //
   // Create cubist interface objects for each lead time
   // Cubist is the machine learning algorithm
   //
+  ScopedTimer modelTimer(runProfile, "load_model");
+
   if( loadCubistModel())
   {
      Logg->write_time("Error: Cubist interface did not initialize properly ");
      return 1;
   }
 
+  modelTimer.stop();
+
   //
   // Instantiate siteMgr for integer siteIDs
   // 
@@ -132,6 +207,29 @@ int FcstProcessor::run()
                        args.siteIdFile.c_str());
       return 1;
   }
+
+  //
+  // Read the capacity and region table and build the site to region
+  // weights for the forecast sites
+  //
+  if (args.regionTable != "")
+  {
+     vector <int> forecastSiteIds;
+
+     for (int s = 0; s < siteMgr->getNumSites(); s++)
+     {
+        forecastSiteIds.push_back(siteMgr->getSiteId(s));
+     }
+
+     regionAggregator = new RegionAggregator(args.regionTable);
+
+     if (regionAggregator->parse() || regionAggregator->build(forecastSiteIds))
+     {
+        Logg->write_time("Error: Failure to set up rollup from %s\n",
+                         args.regionTable.c_str());
+        return 1;
+     }
+  }
  
   //
   // Get predictors and use cubist_interface object to calculate 
@@ -139,6 +237,8 @@ int FcstProcessor::run()
   //
   double fcstGenTime;
 
+  ScopedTimer predictTimer(runProfile, "predict");
+
   if ( predict(modelMgr, fcstGenTime))
   {
     Logg->write_time("Error: Prediction failure.");
@@ -146,11 +246,32 @@ int FcstProcessor::run()
     return 1;
   }
 
+  predictTimer.stop();
+
   //
   // Write netCDF output file
   //
+  ScopedTimer writeTimer(runProfile, "write_netcdf");
+
   writeNetcdf(args.cdlFile, args.outputDir, fcstGenTime);
 
+  writeTimer.stop();
+
+  //
+  // Write total power and regional sums
+  //
+  if (regionAggregator)
+  {
+    ScopedTimer rollupTimer(runProfile, "rollup");
+
+    if (writeRollup(args.outputDir, fcstGenTime))
+    {
+      return 1;
+    }
+  }
+
+  writeProfile();
+
   return 0;
 }
 
@@ -262,6 +383,11 @@ int FcstProcessor::predict( BlendedModelMgr &modelMgr, double &fcstGenTime)
          //
          loadPredictors(fcstTime, fcstGenTime, siteId, predictorVals, modelMgr);
 
+         if (runProfile)
+         {
+            countMissingPredictors(predictorVals);
+         }
+
          //
          // Convert vector of input predictor values to a string to satsify 
          //   cubist interface API
@@ -273,7 +399,11 @@ int FcstProcessor::predict( BlendedModelMgr &modelMgr, double &fcstGenTime)
          //
          // Get the prediction using the cubist interface 
          //
-         float prediction = cubistModel->predict(cubistInputStr);
+         float prediction;
+         {
+            std::lock_guard<std::mutex> lock(cubistMutex);
+            prediction = cubistModel->predict(cubistInputStr);
+         }
 
          //
          // Record in container that has predictions for all siteIds and all 
@@ -305,11 +435,13 @@ int FcstProcessor::predict( BlendedModelMgr &modelMgr, double &fcstGenTime)
                                  cubistInputStr.c_str());
             }
 
+            struct tm tms;
+
             struct tm * tmPtr;
 
             time_t t = fcstTime;
 
-            tmPtr = gmtime ( &t );
+            tmPtr = gmtime_r ( &t, &tms );
 
             int year = tmPtr->tm_year + 1900;
 
@@ -350,7 +482,9 @@ void FcstProcessor::writeNetcdf(const string cdlFile, const string outputDir,
   //
   time_t gTime = genTime;
 
-  tm *timePtr = gmtime(&gTime);
+  tm tms;
+
+  tm *timePtr = gmtime_r(&gTime, &tms);
 
   char timeStr[16];
 
@@ -368,6 +502,10 @@ void FcstProcessor::writeNetcdf(const string cdlFile, const string outputDir,
   string outfile = outputDir + "/" +  "power_pct_cap." + modelBase + "." + timeStr + ".nc";
       
   Logg->write_time("Info: Writing output to %s\n", outfile.c_str());  
+
+  outputFile = outfile;
+
+  std::lock_guard<std::mutex> lock(netcdf_lock());
       
   //  
   // Create output netCDF file 
@@ -401,10 +539,48 @@ void FcstProcessor::writeNetcdf(const string cdlFile, const string outputDir,
   cdf_file.put_field(string("power_percent_capacity"), pctCap, errorStr);
 }
 
+int FcstProcessor::writeRollup(const string outputDir, const double genTime)
+{
+  regionAggregator->aggregate(pctCap, (int)validTimes.size(), FCST_MISSING);
+
+  time_t gTime = genTime;
+
+  tm tms;
+
+  tm *timePtr = gmtime_r(&gTime, &tms);
+
+  char timeStr[16];
+
+  strftime(timeStr,16, "%Y%m%d.%H%M00",timePtr);
+
+  std::size_t found = args.cubistModel.find_last_of("/");
+
+  string modelBase = args.cubistModel.substr(found + 1);
+
+  string outfile = outputDir + "/" + "power_rollup." + modelBase + "." + timeStr + ".nc";
+
+  Logg->write_time("Info: Writing total and regional power to %s\n", outfile.c_str());
+
+  std::lock_guard<std::mutex> lock(netcdf_lock());
+
+  string errorStr;
+
+  if (regionAggregator->writeNetcdf(outfile, validTimes, FCST_MISSING, errorStr))
+  {
+    Logg->write_time("Error: Failure to write %s: %s\n", outfile.c_str(),
+                     errorStr.c_str());
+    return 1;
+  }
+
+  return 0;
+}
+
 int FcstProcessor::loadCubistModel( )
 {
    string modelStr = args.cubistModel;
 
+   std::lock_guard<std::mutex> lock(cubistMutex);
+
    //
    // Instantiate the interface to the Cubist model
    //
@@ -441,16 +617,30 @@ void FcstProcessor::loadPredictors(const double fcstTime, const double fcstGenTi
    //
    
    int monthOfYear;
+   struct tm tms;
    struct tm * tmPtr;
    time_t t = fcstTime;
-   tmPtr = gmtime ( &t );
+   tmPtr = gmtime_r ( &t, &tms );
    monthOfYear = tmPtr->tm_mon +1;
    predictorVals.push_back(monthOfYear);
 
-   float tFcst = modelMgr.getTemp(siteId, fcstTime);
+   //
+   // Temperature, relative humidity and GHI read in one lookup of the site
+   // and time
+   //
+   static const BlendedModelReader::Var FCST_VARS[] =
+   {
+      BlendedModelReader::TEMP, BlendedModelReader::RH, BlendedModelReader::GHI
+   };
+
+   float fcstVals[3];
+
+   modelMgr.gather(FCST_VARS, 3, siteId, fcstTime, fcstVals);
+
+   float tFcst = fcstVals[0];
    predictorVals.push_back(tFcst);
 
-   float rhFcst = modelMgr.getRh(siteId, fcstTime);
+   float rhFcst = fcstVals[1];
    predictorVals.push_back(rhFcst);
 
    // climate zone 
@@ -460,7 +650,7 @@ void FcstProcessor::loadPredictors(const double fcstTime, const double fcstGenTi
    //
    // Get GHI 
    //
-   float ghiFcst = modelMgr.getGHI(siteId, fcstTime);
+   float ghiFcst = fcstVals[2];
    predictorVals.push_back(ghiFcst);
 
    //
@@ -501,6 +691,54 @@ void FcstProcessor::loadPredictors(const double fcstTime, const double fcstGenTi
    }
 }
 
+void FcstProcessor::countMissingPredictors(const vector <float> &predictorVals)
+{
+  for (int i = 0; i < (int)predictorVals.size() && i < NUM_PREDICTOR_NAMES; i++)
+  {
+    //
+    // The missing values of createCubistInputStr()
+    //
+    if (PREDICTOR_NAMES[i] != NULL &&
+        (fabs(predictorVals[i] - FCST_MISSING) <= .00000001 ||
+         fabs(predictorVals[i] + 9999.0) <= .00000001 ||
+         fabs(predictorVals[i] + 999.0) <= .00000001 ||
+         fabs(predictorVals[i] + 9.0) <= .00000001))
+    {
+      runProfile->count_missing(PREDICTOR_NAMES[i]);
+    }
+  }
+}
+
+void FcstProcessor::writeProfile()
+{
+  if (runProfile == NULL || outputFile == "")
+  {
+    return;
+  }
+
+  vector<string> overBudget;
+
+  runProfile->over_budget(overBudget);
+
+  for (int i = 0; i < (int)overBudget.size(); i++)
+  {
+    Logg->write_time("Warning: Latency budget of %s: %s\n", outputFile.c_str(),
+                     overBudget[i].c_str());
+  }
+
+  string profileFile = RunProfile::profile_path(outputFile);
+
+  if (runProfile->write_json(profileFile))
+  {
+    Logg->write_time("Warning: Failure to write run profile: %s\n",
+                     runProfile->error().c_str());
+  }
+  else if (DebugLevel > 0)
+  {
+    Logg->write_time("Info: Wrote run profile %s\n", profileFile.c_str());
+  }
+}
+
 void FcstProcessor::createCubistInputStr(const vector <float> predictorVals, 
                                    string &cubistInputStr)
 {
@@ -560,3 +798,5 @@ void FcstProcessor::createCubistInputStr(const vector <float> predictorVals,
    //
    cubistInputStr.erase( cubistInputStr.end() -1);
 }
+
+} // namespace pct_power
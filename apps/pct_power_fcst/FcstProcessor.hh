@@ -19,21 +19,26 @@
  * @class FcstProcessor
  */
 
-#ifndef FCST_PROCESSOR_HH
-#define FCST_PROCESSOR_HH
+#ifndef PCT_FCST_PROCESSOR_HH
+#define PCT_FCST_PROCESSOR_HH
 
 #include <string>
 #include <vector>
 #include <utility>
 #include <cubist_interface/cubist_interface.hh>
+#include <run_profile/run_profile.hh>
 #include "BlendedModelReader.hh"
 #include "Arguments.hh"
 #include "BlendedModelMgr.hh"
 #include "SiteMgr.hh"
+#include "RegionAggregator.hh"
 
 using std::string;
 using std::vector;
 
+namespace pct_power
+{
+
 /**
  * @class FcstProcessor
  */
@@ -61,6 +66,26 @@ public:
    */
   int run();
 
+  /**
+   * Make and write the forecast from blended model files already parsed
+   * into a manager, which may be shared with other FcstProcessor objects
+   * running in other threads (multi-farm mode). The manager is only read.
+   * @param[in] modelMgr  Blended forecast file manager
+   * @return 1 for failure, 0 for success.
+   */
+  int runShared(BlendedModelMgr &modelMgr);
+
+  /**
+   * Parse blended model files into a manager
+   * @param[in] modelFiles  Blended model file paths
+   * @param[in] interpGap  Largest time between valid times interpolated
+   *                       by the readers, 0 for none
+   * @param[out] modelMgr  Manager taking ownership of the readers
+   * @return 1 for failure, 0 for success.
+   */
+  static int loadModelFiles(const vector <string> &modelFiles,
+                            const int interpGap, BlendedModelMgr &modelMgr);
+
   string error;
 
   /**
@@ -105,6 +130,21 @@ private:
    */
   vector <float> pctCap;
 
+  /**
+   * Total power and regional rollup, NULL if not requested
+   */
+  RegionAggregator *regionAggregator;
+
+  /**
+   * Per stage run profile, NULL if not profiling
+   */
+  RunProfile *runProfile;
+
+  /**
+   * Path of the percent capacity file written
+   */
+  string outputFile;
+
   /**
    * Integer indicator of the level of debug messaging
    */
@@ -130,6 +170,16 @@ private:
   void writeNetcdf(const string cdlFile, const string outputDir, 
 		   const double genTime) ;
 
+  /**
+   * Aggregate the percent capacity forecasts to total and regional power
+   * and write them next to the percent capacity file
+   * @param[in] outputDir  Output directory
+   * @param[in] genTime  Generation time of the forecast. Used in output
+   *                     filename
+   * @return 1 for failure, 0 for success
+   */
+  int writeRollup(const string outputDir, const double genTime);
+
   /**
    * Instantiate the cubist interface 
    * @return 1 for failure, 0 for success
@@ -149,6 +199,18 @@ private:
   void loadPredictors(const double fcstTime, const double fcstGenTime,
                       const int siteID, vector <float> & predictorVals, 
                       BlendedModelMgr &modelMgr);
+  /**
+   * Count the missing model values in the run profile
+   * @param[in] predictorVals  Predictors in loadPredictors() order
+   */
+  void countMissingPredictors(const vector <float> &predictorVals);
+
+  /**
+   * Write the run profile next to the percent capacity file and warn
+   * about stages over their latency budget
+   */
+  void writeProfile();
+
   /**
    * Interface to the statistical learning model takes a csv string as input. 
    * Create that string from the predictors.
@@ -161,4 +223,6 @@ private:
                             string &cubistInputStr);
 };
 
-#endif /* FCST_PROCESSOR_HH */
+} // namespace pct_power
+
+#endif /* PCT_FCST_PROCESSOR_HH */
@@ -24,6 +24,9 @@
 #include <iostream>
 #include "Arguments.hh"
 #include "FcstProcessor.hh"
+#include "MultiFarmProcessor.hh"
+
+using namespace pct_power;
 
 //
 // Global variables for debugging and logging
@@ -82,6 +85,28 @@ int main(int argc, char **argv)
   
      return 1;
   }
+
+  //
+  // Multi-farm mode: all farms of the manifest from one read of the
+  // blended model files
+  //
+  if (args.farmManifest != "")
+  {
+     MultiFarmProcessor multiFarmProcessor(args);
+
+     int ret = multiFarmProcessor.run();
+
+     if (ret)
+     {
+        Logg->write_time("Error: processing failed for one or more farms\n");
+     }
+
+     Logg->write_time_ending(ret);
+
+     delete Logg;
+
+     return ret;
+  }
   
   //
   // Initialize forecast processing object
@@ -0,0 +1,268 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: MultiFarmProcessor.cc,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/08/16 15:05:00 $
+//
+//==============================================================================
+
+/**
+ * @file MultiFarmProcessor.cc
+ * @brief Source for MultiFarmProcessor class
+ */
+
+// Include files
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <log/log.hh>
+#include "MultiFarmProcessor.hh"
+#include "FcstProcessor.hh"
+
+using std::ifstream;
+using std::string;
+using std::stringstream;
+using std::vector;
+
+extern Log *Logg;
+extern int DebugLevel;
+
+namespace pct_power
+{
+
+MultiFarmProcessor::MultiFarmProcessor(const Arguments &argsParam):
+  args(argsParam)
+{
+  error = string("");
+}
+
+MultiFarmProcessor::~MultiFarmProcessor()
+{
+}
+
+int MultiFarmProcessor::run()
+{
+  Logg->write_time("Info: Running multi-farm process.\n");
+
+  if (DebugLevel > 0)
+  {
+     args.print();
+  }
+
+  if (parseManifest())
+  {
+     return 1;
+  }
+
+  //
+  // Parse the blended model files once for all farms
+  //
+  BlendedModelMgr modelMgr;
+
+  double parseStart = RunProfile::wall_clock();
+
+  if (FcstProcessor::loadModelFiles(args.modelFiles, args.interpGap, modelMgr))
+  {
+     return 1;
+  }
+
+  //
+  // Shared by all farms, so logged here rather than in the farm profiles
+  //
+  if (args.profile)
+  {
+     Logg->write_time("Info: Stage parse_models took %.3f s\n",
+                      RunProfile::wall_clock() - parseStart);
+  }
+
+  return runFarms(modelMgr);
+}
+
+int MultiFarmProcessor::runShared(BlendedModelMgr &modelMgr)
+{
+  Logg->write_time("Info: Running multi-farm process on shared blended models.\n");
+
+  if (DebugLevel > 0)
+  {
+     args.print();
+  }
+
+  if (parseManifest())
+  {
+     return 1;
+  }
+
+  return runFarms(modelMgr);
+}
+
+int MultiFarmProcessor::runFarms(BlendedModelMgr &modelMgr)
+{
+  int numThreads = args.numThreads;
+
+  if (numThreads <= 0)
+  {
+     numThreads = (int) std::thread::hardware_concurrency();
+  }
+
+  if (numThreads <= 0 || numThreads > (int) farms.size())
+  {
+     numThreads = (int) farms.size();
+  }
+
+  Logg->write_time("Info: Running %d farms on %d threads\n",
+                   (int) farms.size(), numThreads);
+
+  //
+  // Threads take the next farm until none are left. Failures are recorded
+  // per farm so that every farm is attempted.
+  //
+  vector <int> farmStatus(farms.size(), 0);
+
+  std::atomic<int> nextFarm(0);
+
+  vector <std::thread> threads;
+
+  for (int t = 0; t < numThreads; t++)
+  {
+     threads.push_back(std::thread([&]()
+     {
+        int f;
+
+        while ((f = nextFarm++) < (int) farms.size())
+        {
+           farmStatus[f] = runFarm(f, modelMgr);
+        }
+     }));
+  }
+
+  for (int t = 0; t < (int) threads.size(); t++)
+  {
+     threads[t].join();
+  }
+
+  int numFailed = 0;
+
+  for (int f = 0; f < (int) farms.size(); f++)
+  {
+     if (farmStatus[f])
+     {
+        Logg->write_time("Error: Forecast failed for farm %s\n",
+                         farms[f].name.c_str());
+
+        numFailed++;
+     }
+  }
+
+  Logg->write_time("Info: %d of %d farm forecasts succeeded\n",
+                   (int) farms.size() - numFailed, (int) farms.size());
+
+  return (numFailed > 0);
+}
+
+int MultiFarmProcessor::runFarm(const int farm, BlendedModelMgr &modelMgr)
+{
+  //
+  // Each farm gets its own copy of the arguments with the farm inputs and
+  // outputs filled in
+  //
+  Arguments farmArgs = args;
+
+  farmArgs.siteIdFile = farms[farm].siteIdFile;
+
+  farmArgs.cubistModel = farms[farm].cubistModel;
+
+  farmArgs.cdlFile = farms[farm].cdlFile;
+
+  farmArgs.outputDir = farms[farm].outputDir;
+
+  if (DebugLevel > 0)
+  {
+     Logg->write_time("Info: Starting farm %s\n", farms[farm].name.c_str());
+  }
+
+  FcstProcessor fcstProcessor(farmArgs);
+
+  if (fcstProcessor.error != string(""))
+  {
+     Logg->write_time("Error: farm %s initialization failed, %s\n",
+                      farms[farm].name.c_str(), fcstProcessor.error.c_str());
+
+     return 1;
+  }
+
+  return fcstProcessor.runShared(modelMgr);
+}
+
+int MultiFarmProcessor::parseManifest()
+{
+  ifstream infile(args.farmManifest.c_str());
+
+  if (!infile.is_open())
+  {
+     Logg->write_time("Error: Cannot open farm manifest %s\n",
+                      args.farmManifest.c_str());
+     return 1;
+  }
+
+  string line;
+
+  int lineNum = 0;
+
+  while (getline(infile, line))
+  {
+     lineNum++;
+
+     //
+     // Skip comment lines or empty lines, allow comma separators
+     //
+     if (line.empty() || line[0] == '#')
+     {
+        continue;
+     }
+
+     for (int i = 0; i < (int) line.size(); i++)
+     {
+        if (line[i] == ',')
+        {
+           line[i] = ' ';
+        }
+     }
+
+     stringstream fields(line);
+
+     Farm farm;
+
+     if (!(fields >> farm.name))
+     {
+        continue;
+     }
+
+     if (!(fields >> farm.siteIdFile >> farm.cubistModel >> farm.cdlFile
+                  >> farm.outputDir))
+     {
+        Logg->write_time("Error: Line %d of farm manifest %s needs farmName "
+                         "siteIdFile cubistModelBaseName outputCdlFile "
+                         "outputDir\n", lineNum, args.farmManifest.c_str());
+        return 1;
+     }
+
+     farms.push_back(farm);
+  }
+
+  if (farms.size() == 0)
+  {
+     Logg->write_time("Error: No farms in farm manifest %s\n",
+                      args.farmManifest.c_str());
+     return 1;
+  }
+
+  return 0;
+}
+
+} // namespace pct_power
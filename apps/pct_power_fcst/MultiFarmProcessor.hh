@@ -0,0 +1,119 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: MultiFarmProcessor.hh,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/08/16 15:05:00 $
+//
+//==============================================================================
+
+/**
+ * @file MultiFarmProcessor.hh
+ * @brief The MultiFarmProcessor class makes the percent capacity forecasts
+ *        for every farm in a manifest in one process: the blended model
+ *        files are parsed once into a shared BlendedModelMgr, and each farm
+ *        is run by its own FcstProcessor on a pool of threads.
+ * @class MultiFarmProcessor
+ */
+
+#ifndef MULTI_FARM_PROCESSOR_HH
+#define MULTI_FARM_PROCESSOR_HH
+
+#include <string>
+#include <vector>
+#include "Arguments.hh"
+#include "BlendedModelMgr.hh"
+
+using std::string;
+using std::vector;
+
+namespace pct_power
+{
+
+/**
+ * @class MultiFarmProcessor
+ */
+class MultiFarmProcessor
+{
+public:
+
+  /**
+   * Constructor
+   * @param[in] argsParam  Command line arguments, with args.farmManifest set
+   */
+  MultiFarmProcessor(const Arguments &argsParam);
+
+  /**
+   * Destructor
+   */
+  ~MultiFarmProcessor();
+
+  /**
+   * Read the farm manifest and blended model files, then run the forecast
+   * of every farm. A farm that fails is logged and does not stop the others.
+   * @return 1 if any farm failed, 0 for success.
+   */
+  int run();
+
+  /**
+   * Read the farm manifest and run the forecast of every farm from blended
+   * model readers already in a manager (the fused solar pipeline).
+   * @param[in] modelMgr  Blended forecast file manager, only read
+   * @return 1 if any farm failed, 0 for success.
+   */
+  int runShared(BlendedModelMgr &modelMgr);
+
+  string error;
+
+private:
+
+  /**
+   * Inputs and outputs of one farm, from one line of the manifest
+   */
+  struct Farm
+  {
+    string name;
+    string siteIdFile;
+    string cubistModel;
+    string cdlFile;
+    string outputDir;
+  };
+
+  /**
+   * Object containing command line arguments
+   */
+  Arguments args;
+
+  /**
+   * Farms from the manifest
+   */
+  vector <Farm> farms;
+
+  /**
+   * Read the farm manifest. Lines hold the farm name, site-ID file, Cubist
+   * model basename, CDL file and output directory, separated by white
+   * space or commas. Empty lines and lines starting with '#' are skipped.
+   * @return 1 for failure, 0 for success.
+   */
+  int parseManifest();
+
+  /**
+   * Run the forecasts of the farms in the manifest on a pool of threads
+   * @param[in] modelMgr  Shared blended forecast file manager
+   * @return 1 if any farm failed, 0 for success.
+   */
+  int runFarms(BlendedModelMgr &modelMgr);
+
+  /**
+   * Run the forecast of one farm
+   * @param[in] farm  Farm index
+   * @param[in] modelMgr  Shared blended forecast file manager
+   * @return 1 for failure, 0 for success.
+   */
+  int runFarm(const int farm, BlendedModelMgr &modelMgr);
+};
+
+} // namespace pct_power
+
+#endif /* MULTI_FARM_PROCESSOR_HH */
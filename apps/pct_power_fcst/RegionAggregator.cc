@@ -0,0 +1,507 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: RegionAggregator.cc,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/08/23 10:30:00 $
+//
+//==============================================================================
+
+/**
+ * @file RegionAggregator.cc
+ * @brief Source for RegionAggregator class
+ */
+
+// Include files
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <log/log.hh>
+#include "RegionAggregator.hh"
+#include "cdf_field_writer.hh"
+
+using std::ifstream;
+using std::map;
+
+extern Log *Logg;
+extern int DebugLevel;
+
+// Constant and macros
+
+const int RegionAggregator::REGION_NAME_LEN = 15;
+
+static const char *SITE_COLUMNS[] = {"siteid", "closest_wrf_grid", NULL};
+
+static const char *CAPACITY_COLUMNS[] = {"capacity_kw", NULL};
+
+static const char *REGION_COLUMNS[] = {"region", "regional_zip", NULL};
+
+// Functions
+
+//
+// Split a csv line, trimming white space and carriage returns
+//
+static void splitCsv(const string &line, vector<string> &fields)
+{
+  fields.clear();
+
+  size_t start = 0;
+
+  while (true)
+  {
+    size_t pos = line.find(',', start);
+
+    string field = line.substr(start, pos == string::npos ? string::npos : pos - start);
+
+    size_t first = field.find_first_not_of(" \t\r\"");
+
+    size_t last = field.find_last_not_of(" \t\r\"");
+
+    fields.push_back(first == string::npos ? string("") : field.substr(first, last - first + 1));
+
+    if (pos == string::npos)
+    {
+      break;
+    }
+
+    start = pos + 1;
+  }
+}
+
+RegionAggregator::RegionAggregator(const string &tableFileParam) :
+  tableFile(tableFileParam), totalCapacity(0), numSites(0), numUnmatched(0)
+{
+}
+
+int RegionAggregator::findColumn(const vector<string> &header, const char **names)
+{
+  for (int c = 0; c < (int)header.size(); c++)
+  {
+    string lower = header[c];
+
+    for (int i = 0; i < (int)lower.size(); i++)
+    {
+      lower[i] = tolower(lower[i]);
+    }
+
+    for (int n = 0; names[n] != NULL; n++)
+    {
+      if (lower == names[n])
+      {
+        return c;
+      }
+    }
+  }
+
+  return -1;
+}
+
+int RegionAggregator::parse()
+{
+  ifstream infile(tableFile.c_str());
+
+  if (!infile.is_open())
+  {
+    Logg->write_time("Error: Cannot open capacity and region table %s\n",
+                     tableFile.c_str());
+    return 1;
+  }
+
+  string line;
+
+  vector<string> fields;
+
+  if (!getline(infile, line))
+  {
+    Logg->write_time("Error: Capacity and region table %s is empty\n",
+                     tableFile.c_str());
+    return 1;
+  }
+
+  splitCsv(line, fields);
+
+  int siteCol = findColumn(fields, SITE_COLUMNS);
+
+  int capCol = findColumn(fields, CAPACITY_COLUMNS);
+
+  int regionCol = findColumn(fields, REGION_COLUMNS);
+
+  if (siteCol < 0 || capCol < 0 || regionCol < 0)
+  {
+    Logg->write_time("Error: Capacity and region table %s needs siteId, "
+                     "capacity_kW and region columns\n", tableFile.c_str());
+    return 1;
+  }
+
+  map<string, int> regionIndex;
+
+  int lineNum = 1;
+
+  while (getline(infile, line))
+  {
+    lineNum++;
+
+    if (line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+
+    splitCsv(line, fields);
+
+    if ((int)fields.size() <= siteCol || (int)fields.size() <= capCol ||
+        (int)fields.size() <= regionCol)
+    {
+      Logg->write_time("Warning: Skipping short line %d of %s\n", lineNum,
+                       tableFile.c_str());
+      continue;
+    }
+
+    char *siteEnd;
+
+    char *capEnd;
+
+    long siteId = strtol(fields[siteCol].c_str(), &siteEnd, 10);
+
+    double capacity = strtod(fields[capCol].c_str(), &capEnd);
+
+    if (fields[siteCol].empty() || *siteEnd != '\0' || fields[capCol].empty() ||
+        *capEnd != '\0' || capacity < 0)
+    {
+      Logg->write_time("Warning: Skipping bad site or capacity on line %d "
+                       "of %s\n", lineNum, tableFile.c_str());
+      continue;
+    }
+
+    const string &region = fields[regionCol];
+
+    map<string, int>::iterator it = regionIndex.find(region);
+
+    if (it == regionIndex.end())
+    {
+      it = regionIndex.insert(std::make_pair(region, (int)regionNames.size())).first;
+
+      regionNames.push_back(region);
+    }
+
+    instSiteIds.push_back((int)siteId);
+
+    instCapacity.push_back((float)capacity);
+
+    instRegion.push_back(it->second);
+  }
+
+  if (instSiteIds.size() == 0)
+  {
+    Logg->write_time("Error: No installations in %s\n", tableFile.c_str());
+    return 1;
+  }
+
+  if (DebugLevel > 0)
+  {
+    Logg->write_time("Info: Read %d installations in %d regions from %s\n",
+                     (int)instSiteIds.size(), (int)regionNames.size(),
+                     tableFile.c_str());
+  }
+
+  return 0;
+}
+
+int RegionAggregator::build(const vector<int> &siteIds)
+{
+  numSites = (int)siteIds.size();
+
+  map<int, int> siteIdIndex;
+
+  for (int s = 0; s < numSites; s++)
+  {
+    siteIdIndex[siteIds[s]] = s;
+  }
+
+  //
+  // Sum installation capacity by (region, site)
+  //
+  int numRegions = (int)regionNames.size();
+
+  vector< map<int, float> > rows(numRegions);
+
+  regionCapacity.assign(numRegions, 0);
+
+  siteCapacity.assign(numSites, 0);
+
+  totalCapacity = 0;
+
+  numUnmatched = 0;
+
+  for (int i = 0; i < (int)instSiteIds.size(); i++)
+  {
+    map<int, int>::iterator it = siteIdIndex.find(instSiteIds[i]);
+
+    if (it == siteIdIndex.end())
+    {
+      numUnmatched++;
+      continue;
+    }
+
+    rows[instRegion[i]][it->second] += instCapacity[i];
+
+    regionCapacity[instRegion[i]] += instCapacity[i];
+
+    siteCapacity[it->second] += instCapacity[i];
+
+    totalCapacity += instCapacity[i];
+  }
+
+  rowBegin.assign(1, 0);
+
+  siteIndex.clear();
+
+  weight.clear();
+
+  for (int r = 0; r < numRegions; r++)
+  {
+    for (map<int, float>::iterator it = rows[r].begin(); it != rows[r].end(); ++it)
+    {
+      siteIndex.push_back(it->first);
+
+      weight.push_back(it->second);
+    }
+
+    rowBegin.push_back((int)siteIndex.size());
+  }
+
+  if (numUnmatched > 0)
+  {
+    Logg->write_time("Warning: %d of %d installations in %s are at sites "
+                     "without forecasts\n", numUnmatched,
+                     (int)instSiteIds.size(), tableFile.c_str());
+  }
+
+  if (siteIndex.size() == 0)
+  {
+    Logg->write_time("Error: No installations in %s are at forecast sites\n",
+                     tableFile.c_str());
+    return 1;
+  }
+
+  return 0;
+}
+
+void RegionAggregator::aggregate(const vector<float> &pctCap,
+                                 const int numTimes, const float missing)
+{
+  int numRegions = (int)regionNames.size();
+
+  //
+  // Fraction of capacity at each site and lead, missing as NAN
+  //
+  vector<float> frac(pctCap.size());
+
+  for (int i = 0; i < (int)pctCap.size(); i++)
+  {
+    float p = pctCap[i];
+
+    if (p == missing || p < 0 || p > 100)
+    {
+      frac[i] = NAN;
+    }
+    else
+    {
+      frac[i] = p / 100;
+    }
+  }
+
+  sitePower.assign((size_t)numSites * numTimes, missing);
+
+  for (int s = 0; s < numSites; s++)
+  {
+    if (siteCapacity[s] <= 0)
+    {
+      continue;
+    }
+
+    for (int t = 0; t < numTimes; t++)
+    {
+      float f = frac[(size_t)s * numTimes + t];
+
+      if (!isnan(f))
+      {
+        sitePower[(size_t)s * numTimes + t] = f * siteCapacity[s];
+      }
+    }
+  }
+
+  //
+  // Sparse matrix-vector product for each lead, summing only available
+  // forecasts
+  //
+  regionPower.assign((size_t)numRegions * numTimes, missing);
+
+  regionPctCap.assign((size_t)numRegions * numTimes, missing);
+
+  totalPower.assign(numTimes, missing);
+
+  vector<double> sum(numTimes);
+
+  vector<int> count(numTimes);
+
+  vector<double> total(numTimes, 0);
+
+  vector<int> totalCount(numTimes, 0);
+
+  for (int r = 0; r < numRegions; r++)
+  {
+    sum.assign(numTimes, 0);
+
+    count.assign(numTimes, 0);
+
+    for (int k = rowBegin[r]; k < rowBegin[r + 1]; k++)
+    {
+      const float *f = &frac[(size_t)siteIndex[k] * numTimes];
+
+      for (int t = 0; t < numTimes; t++)
+      {
+        if (!isnan(f[t]))
+        {
+          sum[t] += weight[k] * f[t];
+
+          count[t]++;
+        }
+      }
+    }
+
+    for (int t = 0; t < numTimes; t++)
+    {
+      if (count[t] == 0)
+      {
+        continue;
+      }
+
+      regionPower[(size_t)r * numTimes + t] = (float)sum[t];
+
+      if (regionCapacity[r] > 0)
+      {
+        regionPctCap[(size_t)r * numTimes + t] = (float)(100 * sum[t] / regionCapacity[r]);
+      }
+
+      total[t] += sum[t];
+
+      totalCount[t] += count[t];
+    }
+  }
+
+  for (int t = 0; t < numTimes; t++)
+  {
+    if (totalCount[t] > 0)
+    {
+      totalPower[t] = (float)total[t];
+    }
+  }
+}
+
+int RegionAggregator::writeNetcdf(const string &outfile,
+                                  const vector<double> &validTimes,
+                                  const float missing, string &errorStr)
+{
+  int numRegions = (int)regionNames.size();
+
+  std::unordered_map<string, size_t> dims;
+
+  dims["scaler_dim"] = 1;
+
+  dims["fcst_num"] = validTimes.size();
+
+  dims["num_regions"] = numRegions;
+
+  dims["region_len"] = REGION_NAME_LEN;
+
+  dims["num_sites"] = numSites;
+
+  cdf_field_writer cdf_file(outfile, dims);
+
+  if (cdf_file.error() != "")
+  {
+    errorStr = cdf_file.error();
+    return 1;
+  }
+
+  vector<string> scalerDim(1, "scaler_dim");
+
+  vector<string> timeDim(1, "fcst_num");
+
+  vector<string> regionDim(1, "num_regions");
+
+  vector<string> regionNameDims;
+  regionNameDims.push_back("num_regions");
+  regionNameDims.push_back("region_len");
+
+  vector<string> regionTimeDims;
+  regionTimeDims.push_back("num_regions");
+  regionTimeDims.push_back("fcst_num");
+
+  vector<string> siteTimeDims;
+  siteTimeDims.push_back("num_sites");
+  siteTimeDims.push_back("fcst_num");
+
+  if (cdf_file.add_field("creation_time", netCDF::ncDouble, scalerDim,
+                         "time at which forecast file was created",
+                         "seconds since 1970-1-1 00:00:00", missing, errorStr) ||
+      cdf_file.add_field("valid_time", netCDF::ncDouble, timeDim,
+                         "forecast valid time",
+                         "seconds since 1970-1-1 00:00:00", missing, errorStr) ||
+      cdf_file.add_field("total_capacity", netCDF::ncFloat, scalerDim,
+                         "Total capacity of PV installations at forecast sites",
+                         "kW", missing, errorStr) ||
+      cdf_file.add_field("total_power", netCDF::ncFloat, timeDim,
+                         "Total forecasted power", "kW", missing, errorStr) ||
+      cdf_file.add_field("region", netCDF::ncChar, regionNameDims,
+                         "Region name", "none", 0, errorStr) ||
+      cdf_file.add_field("region_capacity", netCDF::ncFloat, regionDim,
+                         "Total capacity of PV installations within the region",
+                         "kW", missing, errorStr) ||
+      cdf_file.add_field("region_power", netCDF::ncFloat, regionTimeDims,
+                         "Total forecasted power within the region", "kW",
+                         missing, errorStr) ||
+      cdf_file.add_field("region_pct_capacity", netCDF::ncFloat, regionTimeDims,
+                         "Percent capacity fcst for the entire region",
+                         "Percent", missing, errorStr) ||
+      cdf_file.add_field("site_power", netCDF::ncFloat, siteTimeDims,
+                         "Forecasted power of the installations at the site",
+                         "kW", missing, errorStr))
+  {
+    return 1;
+  }
+
+  vector<double> ctime(1, (double)time(0));
+
+  vector<float> totalCap(1, totalCapacity);
+
+  vector<char> names((size_t)numRegions * REGION_NAME_LEN, '\0');
+
+  for (int r = 0; r < numRegions; r++)
+  {
+    strncpy(&names[(size_t)r * REGION_NAME_LEN], regionNames[r].c_str(),
+            REGION_NAME_LEN);
+  }
+
+  if (cdf_file.put_field("creation_time", ctime, errorStr) ||
+      cdf_file.put_field("valid_time", validTimes, errorStr) ||
+      cdf_file.put_field("total_capacity", totalCap, errorStr) ||
+      cdf_file.put_field("total_power", totalPower, errorStr) ||
+      (numRegions > 0 && cdf_file.put_field("region", names, errorStr)) ||
+      cdf_file.put_field("region_capacity", regionCapacity, errorStr) ||
+      cdf_file.put_field("region_power", regionPower, errorStr) ||
+      cdf_file.put_field("region_pct_capacity", regionPctCap, errorStr) ||
+      cdf_file.put_field("site_power", sitePower, errorStr))
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,157 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: RegionAggregator.hh,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/08/23 10:30:00 $
+//
+//==============================================================================
+
+/**
+ *
+ *  @file RegionAggregator.hh
+ *  @class RegionAggregator
+ *  @brief Turns percent capacity forecasts into power: total power over all
+ *         installations and power summed by region, replacing the
+ *         pct_power_to_total_power, pct_power_rollup and
+ *         pct_power_region_rollup scripts. Installations are read from a
+ *         capacity and region membership table and collapsed into a sparse
+ *         region by forecast site matrix of installed capacity, so a rollup
+ *         is one sparse matrix-vector product per lead time.
+ *  @date 8/23/2021
+ */
+
+#ifndef REGION_AGGREGATOR_HH
+#define REGION_AGGREGATOR_HH
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+class RegionAggregator
+{
+public:
+
+  /**
+   * Constructor
+   * @param[in] tableFile  Csv file with a header line and one line per
+   *                       installation. Columns are found by header name:
+   *                       forecast site id ("siteId" or "Closest_WRF_grid"),
+   *                       capacity in kW ("capacity_kW") and region
+   *                       ("region" or "regional_zip"), case insensitive.
+   */
+  RegionAggregator(const string &tableFile);
+
+  /**
+   * Read the capacity and region membership table
+   * @return 1 for failure, 0 for success
+   */
+  int parse();
+
+  /**
+   * Build the sparse region by site capacity matrix for the forecast sites.
+   * Installations at sites not in the forecast are left out and counted.
+   * @param[in] siteIds  Forecast site ids, in the order of the forecasts
+   * @return 1 if no installation is at a forecast site, 0 for success
+   */
+  int build(const vector<int> &siteIds);
+
+  /**
+   * Compute total, regional and site power from percent capacity forecasts.
+   * Missing or out of range forecasts are left out of the sums; a sum with
+   * no forecasts is missing.
+   * @param[in] pctCap  Percent capacity, site major ([site][lead])
+   * @param[in] numTimes  Number of lead times
+   * @param[in] missing  Missing data value of pctCap and of the outputs
+   */
+  void aggregate(const vector<float> &pctCap, const int numTimes,
+                 const float missing);
+
+  /**
+   * Write the rollup netCDF file
+   * @param[in] outfile  Output file path
+   * @param[in] validTimes  Forecast valid times
+   * @param[in] missing  Missing data value
+   * @param[out] errorStr  Error message
+   * @return 1 for failure, 0 for success
+   */
+  int writeNetcdf(const string &outfile, const vector<double> &validTimes,
+                  const float missing, string &errorStr);
+
+  /**
+   * Number of table lines at sites without forecasts
+   */
+  int getNumUnmatched() const { return numUnmatched; }
+
+  const int getNumRegions() const { return (int)regionNames.size(); }
+
+private:
+
+  /**
+   * Length of region name strings in the output file
+   */
+  const static int REGION_NAME_LEN;
+
+  string tableFile;
+
+  /**
+   * Installations from the table
+   */
+  vector <int> instSiteIds;
+
+  vector <float> instCapacity;
+
+  vector <int> instRegion;
+
+  /**
+   * Region names, in order of first appearance in the table
+   */
+  vector <string> regionNames;
+
+  /**
+   * Sparse region by site matrix in compressed row form: the entries of
+   * region r are rowBegin[r] to rowBegin[r+1]-1, each a forecast site
+   * index and the capacity of the region's installations at that site
+   */
+  vector <int> rowBegin;
+
+  vector <int> siteIndex;
+
+  vector <float> weight;
+
+  /**
+   * Installed capacity of each region, of each forecast site, and in total
+   */
+  vector <float> regionCapacity;
+
+  vector <float> siteCapacity;
+
+  float totalCapacity;
+
+  int numSites;
+
+  int numUnmatched;
+
+  /**
+   * Outputs: total power [lead], region power and percent capacity
+   * [region][lead], site power [site][lead]
+   */
+  vector <float> totalPower;
+
+  vector <float> regionPower;
+
+  vector <float> regionPctCap;
+
+  vector <float> sitePower;
+
+  /**
+   * Find a column by any of the given header names
+   * @return column index, or -1
+   */
+  int findColumn(const vector<string> &header, const char **names);
+};
+
+#endif /* REGION_AGGREGATOR_HH */
@@ -25,6 +25,9 @@ using std::stringstream;
 
 #include "SiteMgr.hh"
 
+namespace pct_power
+{
+
 // Constant and macros
    
 // Types, structures and classes
@@ -115,3 +118,5 @@ int SiteMgr::parse()
       return 1;
    }
 }
+
+} // namespace pct_power
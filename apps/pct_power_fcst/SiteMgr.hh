@@ -5,8 +5,8 @@
  *  @brief Class for parsing site ID configuration file. 
  */
 
-#ifndef SITEMGR_HH
-#define SITEMGR_HH
+#ifndef PCT_SITEMGR_HH
+#define PCT_SITEMGR_HH
 
 #include <string>
 #include <vector>
@@ -15,6 +15,9 @@
 using std::string;
 using std::vector;
 using std::pair;
+namespace pct_power
+{
+
 /** 
  * SiteMgrclass 
  */
@@ -57,4 +60,6 @@ private:
   vector<int> siteIds;
 };
 
-#endif /* SITEMGR_HH */
+} // namespace pct_power
+
+#endif /* PCT_SITEMGR_HH */
@@ -0,0 +1,330 @@
+//==============================================================================
+//
+//   (c) Copyright, 2021 University Corporation for Atmospheric Research (UCAR).
+//       All rights reserved.
+//
+//       File: $RCSfile: MainSolarPipeline.cc,v $
+//       Version: $Revision: 1.1 $  Dated: $Date: 2021/09/20 14:30:00 $
+//
+//==============================================================================
+
+/**
+ *
+ * @file MainSolarPipeline.cc
+ *
+ * Main program for solar_pipeline: ghi_fcst, the NWP/statcast blend and
+ * pct_power_fcst in one process. The blend made by the ghi_fcst
+ * FcstProcessor is handed to the pct_power_fcst processors in memory;
+ * the ghi forecast and blend netCDF files are still written, for the
+ * archive, in a background thread while the percent capacity forecasts
+ * are made.
+ *
+ * usage: solar_pipeline <ghi_fcst arguments> -- <pct_power_fcst arguments>
+ *
+ * The ghi_fcst arguments must configure the blend. The pct_power_fcst -m
+ * list is read as in pct_power_fcst, except that the blend file being
+ * made by this run, and files that do not exist, are skipped.
+ *
+ */
+
+// Include files
+#include <log/log.hh>
+#include <boost/filesystem.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include "../ghi_fcst/Arguments.hh"
+#include "../ghi_fcst/FcstProcessor.hh"
+#include "../pct_power_fcst/Arguments.hh"
+#include "../pct_power_fcst/BlendedModelMgr.hh"
+#include "../pct_power_fcst/BlendedModelReader.hh"
+#include "../pct_power_fcst/FcstProcessor.hh"
+#include "../pct_power_fcst/MultiFarmProcessor.hh"
+
+using std::string;
+using std::vector;
+
+//
+// Global variables for debugging and logging
+//
+int DebugLevel = 0;
+
+Log *Logg;
+
+//
+// Called when new fails
+//
+void out_of_store()
+{
+  int exit_status = 1;
+
+  Logg->write_time("Error: out of store.\n");
+
+  Logg->write_time_ending(exit_status);
+
+  exit(exit_status);
+}
+
+static void usage(char *programName)
+{
+  fprintf(stderr, "\n\nusage:  %s <ghi_fcst arguments> -- <pct_power_fcst arguments>\n\n"
+          "Runs ghi_fcst, the NWP/statcast blend and pct_power_fcst in one process,\n"
+          "handing the blend to pct_power_fcst in memory. See ghi_fcst -h and\n"
+          "pct_power_fcst -h for the arguments. The ghi_fcst arguments must set\n"
+          "up the blend; pct_power_fcst -m may list older blend files.\n\n",
+          programName);
+}
+
+//
+// Make the percent capacity forecasts from the blend of ghiProcessor and
+// the older blend files of the pct_power_fcst arguments. The archive netCDF
+// files of ghiProcessor are written in a background thread.
+//
+static int runPctPower(FcstProcessor &ghiProcessor, const pct_power::Arguments &pctArgs)
+{
+  const StatcastBlender::Blend *blend = ghiProcessor.getBlend();
+
+  if (blend == NULL)
+  {
+     Logg->write_time("Error: ghi_fcst made no blend\n");
+
+     return 1;
+  }
+
+  const vector<float> *ghi = blend->find("ghi");
+
+  const vector<float> *rh = blend->find("RH");
+
+  const vector<float> *temp = blend->find("T2");
+
+  if (ghi == NULL || rh == NULL || temp == NULL)
+  {
+     Logg->write_time("Error: the blend is missing ghi, RH or T2\n");
+
+     return 1;
+  }
+
+  //
+  // The older blend files are parsed before the archive thread starts,
+  // since the netCDF library is not thread safe
+  //
+  vector <string> olderFiles;
+
+  for (int i = 0; i < (int) pctArgs.modelFiles.size(); i++)
+  {
+     const string &modelFile = pctArgs.modelFiles[i];
+
+     if (modelFile == ghiProcessor.getBlendFile() || !boost::filesystem::exists(modelFile))
+     {
+        if (DebugLevel > 0)
+        {
+           Logg->write_time("Info: Skipping blended model file %s\n", modelFile.c_str());
+        }
+
+        continue;
+     }
+
+     olderFiles.push_back(modelFile);
+  }
+
+  BlendedModelMgr modelMgr;
+
+  if ((int) olderFiles.size() > 0 &&
+      pct_power::FcstProcessor::loadModelFiles(olderFiles, pctArgs.interpGap, modelMgr))
+  {
+     return 1;
+  }
+
+  string blendName = string("memory:") + ghiProcessor.getBlendFile();
+
+  BlendedModelReader *blendReader = new BlendedModelReader(blendName);
+
+  blendReader->setInterpolation(pctArgs.interpGap);
+
+  if (blendReader->setArrays(blend->gridId, blend->validTimes, blend->climateZone,
+                             &(*ghi)[0], &(*rh)[0], &(*temp)[0]))
+  {
+     Logg->write_time("Error: %s\n", blendReader->getError().c_str());
+
+     delete blendReader;
+
+     return 1;
+  }
+
+  modelMgr.add(blendReader);
+
+  //
+  // Archive the ghi forecast and the blend while pct_power_fcst predicts.
+  // The archive and the pct_power_fcst output files are written under the
+  // one netCDF library lock (site_store/nc_lock.hh). Prediction reads only
+  // memory and text files, converts times with gmtime_r and logs through
+  // the locked Logg.
+  //
+  std::future<int> archive =
+    std::async(std::launch::async, [&ghiProcessor]() { return ghiProcessor.writeDeferred(); });
+
+  int ret;
+
+  if (pctArgs.farmManifest != "")
+  {
+     pct_power::MultiFarmProcessor multiFarmProcessor(pctArgs);
+
+     ret = multiFarmProcessor.runShared(modelMgr);
+  }
+  else
+  {
+     pct_power::FcstProcessor pctProcessor(pctArgs);
+
+     if (pctProcessor.error != string(""))
+     {
+        Logg->write_time("Error: pct_power_fcst initialization failed, %s\n",
+                         pctProcessor.error.c_str());
+
+        ret = 1;
+     }
+     else
+     {
+        ret = pctProcessor.runShared(modelMgr);
+     }
+  }
+
+  if (archive.get())
+  {
+     Logg->write_time("Error: archive of the ghi forecast or blend failed\n");
+
+     ret = 1;
+  }
+
+  return ret;
+}
+
+int main(int argc, char **argv)
+{
+  //
+  // Split the command line at "--" into the arguments of each program
+  //
+  vector <char *> ghiArgv(1, argv[0]);
+
+  vector <char *> pctArgv(1, argv[0]);
+
+  int i = 1;
+
+  while (i < argc && strcmp(argv[i], "--") != 0)
+  {
+     ghiArgv.push_back(argv[i++]);
+  }
+
+  if (i == argc || ghiArgv.size() == 1 || i == argc - 1)
+  {
+     usage(argv[0]);
+
+     return 2;
+  }
+
+  for (i++; i < argc; i++)
+  {
+     pctArgv.push_back(argv[i]);
+  }
+
+  ghiArgv.push_back(NULL);
+
+  pctArgv.push_back(NULL);
+
+  Arguments ghiArgs((int) ghiArgv.size() - 1, &ghiArgv[0]);
+
+  if (ghiArgs.error != string(""))
+  {
+     fprintf(stderr, "Error: ghi_fcst arguments problem: %s\n",
+             ghiArgs.error.c_str());
+
+     return 2;
+  }
+
+  //
+  // Both argument parsers use getopt
+  //
+  optind = 1;
+
+  pct_power::Arguments pctArgs((int) pctArgv.size() - 1, &pctArgv[0]);
+
+  if (pctArgs.error != string(""))
+  {
+     fprintf(stderr, "Error: pct_power_fcst arguments problem: %s\n",
+             pctArgs.error.c_str());
+
+     return 2;
+  }
+
+  if (ghiArgs.rangeMode || ghiArgs.blendConfFile == "")
+  {
+     fprintf(stderr, "Error: ghi_fcst arguments must set up the blend and not "
+             "a range of issue times\n");
+
+     return 2;
+  }
+
+  //
+  // Set global Debug_level from args
+  //
+  DebugLevel = ghiArgs.debugLevel;
+
+  //
+  // Set up logging global Logg
+  //
+  Logg = new Log(ghiArgs.logDir.c_str());
+
+  Logg->write_time_starting("solar_pipeline");
+
+  Logg->write_time("Info: executed: %s -- %s\n", ghiArgs.commandString.c_str(),
+                   pctArgs.commandString.c_str());
+
+  //
+  // Make the ghi forecast and blend, leaving their netCDF files for later
+  //
+  FcstProcessor ghiProcessor(ghiArgs);
+
+  if (ghiProcessor.error != string(""))
+  {
+     Logg->write_time("Error: ghi_fcst initialization failed, %s\n",
+                       ghiProcessor.error.c_str());
+
+     Logg->write_time_ending(1);
+
+     delete Logg;
+
+     return 1;
+  }
+
+  ghiProcessor.setDeferWrites(true);
+
+  if (ghiProcessor.run() > 0)
+  {
+     Logg->write_time("Error: ghi_fcst processing failed\n");
+
+     Logg->write_time_ending(1);
+
+     delete Logg;
+
+     return 1;
+  }
+
+  if (runPctPower(ghiProcessor, pctArgs))
+  {
+     Logg->write_time("Error: pct_power_fcst processing failed\n");
+
+     Logg->write_time_ending(1);
+
+     delete Logg;
+
+     return 1;
+  }
+
+  Logg->write_time_ending(0);
+
+  delete Logg;
+
+  return 0;
+}
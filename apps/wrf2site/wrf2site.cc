@@ -0,0 +1,886 @@
+/*
+ * Extracts WRF forecasts at mesonet sites into the StatCast-format site
+ * netCDF file read by ghi_fcst's NwpReader. This is a native version of
+ * WrfNetCDF2StatcastNetCDF.py and takes the same arguments:
+ *
+ *   wrf2site [options] wrf_dir YYYYmmdd.HHMM site_list var,var,... output_file
+ *
+ * The wrfout files of the 15 minute lead times from 15 minutes to 6 hours
+ * are read from wrf_dir/YYYY-mm-dd_HH/wrfout, falling back to the 06 UTC
+ * day-ahead run if no nowcast file is found. The sites are located on the
+ * WRF grid once, from the map projection of the first file (see
+ * wrf_grid.h), and each variable is read only over the grid box that holds
+ * the site stencils. Files are processed by a pool of threads; the netCDF
+ * library is not thread safe, so the reads are serialized while the
+ * stencils, derived variables and solar geometry run in parallel.
+ *
+ * Derived variables, as in the python script:
+ *   TOA                  SWDOWN / CLRNIDX
+ *   WSPD10, WDIR10       from U10 and V10
+ *   custom_TOA, apparent_elevation, azimuth
+ *                        15 minute time ending means of one minute values
+ *   custom_KT            SWDOWN / custom_TOA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <netcdf.h>
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "log/log.hh"
+#include "solar_position/solar_position.hh"
+#include "wrf_grid.h"
+
+using namespace std;
+
+Log *logFile;			// log object
+
+#define DEFAULT_THREADS 4
+#define DEFAULT_CALC_TYPE "nearest_neighbor"
+#define LEAD_STEP 900		/* seconds between wrfout files */
+#define MAX_LEAD 21600		/* last lead time, seconds */
+#define MIN_FILE_SIZE 4000	/* smaller files are incomplete */
+#define NAME_STRLEN 10		/* StationName length */
+#define SOLAR_MINUTES 15	/* minutes in the solar means */
+
+
+// Mesonet sites of the site list, sorted by station name as the python
+// script writes them
+struct site_list
+{
+  vector<string> stid;
+  vector<int> id;
+  vector<float> lat;
+  vector<float> lon;
+};
+
+
+// Site values of one wrfout file, [var][site]
+struct file_result
+{
+  int ok;
+  double valid_time;
+  vector<float> data;
+};
+
+
+// Serializes netCDF calls and logging of the worker threads
+static mutex io_mutex;
+
+
+static void
+usage(
+      char *av0  /* arg list */
+      )
+{
+  fprintf(stderr,
+	  "Usage: %s [options] wrf_dir YYYYmmdd.HHMM site_list var,var,... output_file\n", av0);
+  fprintf(stderr,
+	  "Options:\n");
+  fprintf(stderr,
+	  "-c calc_type\tbilinear or nearest_neighbor (default %s)\n", DEFAULT_CALC_TYPE);
+  fprintf(stderr,
+	  "-d day_ahead\tday-ahead WRF directory to fall back on\n");
+  fprintf(stderr,
+	  "-l logbase\tbase name of log file to use (default = stdout)\n");
+  fprintf(stderr,
+	  "-t threads\tnumber of threads (default %d)\n", DEFAULT_THREADS);
+  fprintf(stderr,
+	  "-v debug_level\tlog at a higher debug level\n");
+  exit(2);
+}
+
+
+//
+// Splits a csv line. Quoting is not handled; the site lists do not use it.
+//
+
+static vector<string> split_csv(const string &line)
+{
+  vector<string> fields;
+  string field;
+  istringstream ss(line);
+
+  while (getline(ss, field, ','))
+    {
+      if (!field.empty() && field[field.size()-1] == '\r')
+	field.erase(field.size()-1);
+      fields.push_back(field);
+    }
+  return(fields);
+}
+
+
+//
+// Reads the site list csv, with columns stid, "lat [degrees]",
+// "lon [degrees]" and int_id among others.
+//
+// Returns 1 on success, 0 on failure.
+//
+
+static int read_site_list(const char *path, site_list *sites)
+{
+  ifstream in(path);
+  string line;
+
+  if (!in || !getline(in, line))
+    {
+      logFile->write_time("Error: cannot read site list %s\n", path);
+      return(0);
+    }
+
+  vector<string> header = split_csv(line);
+  const char *names[4] = {"stid", "lat [degrees]", "lon [degrees]", "int_id"};
+  int col[4];
+
+  for (int c=0; c<4; c++)
+    {
+      vector<string>::iterator it = find(header.begin(), header.end(), names[c]);
+      if (it == header.end())
+	{
+	  logFile->write_time("Error: site list %s has no '%s' column\n", path, names[c]);
+	  return(0);
+	}
+      col[c] = it - header.begin();
+    }
+
+  vector<pair<string, int> > order;
+  site_list in_sites;
+
+  while (getline(in, line))
+    {
+      vector<string> fields = split_csv(line);
+      if (fields.size() < header.size())
+	continue;
+
+      order.push_back(make_pair(fields[col[0]], (int) order.size()));
+      in_sites.stid.push_back(fields[col[0]]);
+      in_sites.lat.push_back(atof(fields[col[1]].c_str()));
+      in_sites.lon.push_back(atof(fields[col[2]].c_str()));
+      in_sites.id.push_back(atoi(fields[col[3]].c_str()));
+    }
+
+  sort(order.begin(), order.end());
+
+  for (size_t i=0; i<order.size(); i++)
+    {
+      int k = order[i].second;
+      sites->stid.push_back(in_sites.stid[k]);
+      sites->lat.push_back(in_sites.lat[k]);
+      sites->lon.push_back(in_sites.lon[k]);
+      sites->id.push_back(in_sites.id[k]);
+    }
+
+  logFile->write_time("Info: read %d sites from %s\n", (int) sites->stid.size(), path);
+  return(sites->stid.size() > 0);
+}
+
+
+//
+// Lists the wrfout files of a run that exist and are complete.
+//
+
+static vector<string> list_wrf_files(const string &run_dir, time_t init_time)
+{
+  vector<string> files;
+  struct stat sbuf;
+  char name[64];
+
+  if (stat(run_dir.c_str(), &sbuf) != 0)
+    {
+      logFile->write_time("Error: %s doesn't exist.\n", run_dir.c_str());
+      return(files);
+    }
+
+  for (time_t t = init_time + LEAD_STEP; t <= init_time + MAX_LEAD; t += LEAD_STEP)
+    {
+      struct tm tms;
+      gmtime_r(&t, &tms);
+      strftime(name, sizeof(name), "wrfout_d01_%Y-%m-%d_%H:%M:%S", &tms);
+
+      string path = run_dir + "/" + name;
+      if (stat(path.c_str(), &sbuf) != 0)
+	{
+	  logFile->write_time("Warning: %s doesn't exist.\n", path.c_str());
+	  continue;
+	}
+      if (sbuf.st_size < MIN_FILE_SIZE)
+	{
+	  logFile->write_time("Warning: %s is incomplete.  Ignoring\n", path.c_str());
+	  continue;
+	}
+      files.push_back(path);
+    }
+
+  return(files);
+}
+
+
+//
+// Reads the single WRF time of an open file. Returns 1 on success, 0 on
+// failure.
+//
+
+static int read_wrf_time(int ncid, const char *path, double *valid_time)
+{
+  int varid, dimids[2], ndims;
+  size_t ntimes, len;
+  char str[32];
+  struct tm tms;
+
+  if (nc_inq_varid(ncid, "Times", &varid) != NC_NOERR ||
+      nc_inq_varndims(ncid, varid, &ndims) != NC_NOERR || ndims != 2)
+    {
+      logFile->write_time("Error: no Times variable in %s\n", path);
+      return(0);
+    }
+
+  nc_inq_vardimid(ncid, varid, dimids);
+  nc_inq_dimlen(ncid, dimids[0], &ntimes);
+  nc_inq_dimlen(ncid, dimids[1], &len);
+  if (ntimes != 1)
+    {
+      logFile->write_time("Error: Num of times in %s != 1\n", path);
+      return(0);
+    }
+  if (len >= sizeof(str))
+    len = sizeof(str) - 1;
+
+  size_t start[2] = {0, 0};
+  size_t count[2] = {1, len};
+  memset(str, 0, sizeof(str));
+  memset(&tms, 0, sizeof(tms));
+  if (nc_get_vara_text(ncid, varid, start, count, str) != NC_NOERR ||
+      strptime(str, "%Y-%m-%d_%H:%M:%S", &tms) == NULL)
+    {
+      logFile->write_time("Error: cannot read Times in %s\n", path);
+      return(0);
+    }
+
+  *valid_time = (double) timegm(&tms);
+  return(1);
+}
+
+
+//
+// Extracts the site values of the variables from one wrfout file. The
+// lock is held for the netCDF calls only, so one thread's stencils run
+// while another reads.
+//
+
+static void process_file(const string &path, const vector<string> &variables,
+			 const wrf_grid *ref_grid, const vector<site_stencil> &stencils,
+			 const stencil_box &box, file_result *result)
+{
+  int num_sites = stencils.size();
+  int ncid, status;
+  wrf_grid grid;
+
+  result->ok = 0;
+  result->data.assign(variables.size() * num_sites, WRF_MISSING);
+
+  unique_lock<mutex> lock(io_mutex);
+
+  logFile->write_time("Reading: %s\n", path.c_str());
+
+  if ((status = nc_open(path.c_str(), NC_NOWRITE, &ncid)) != NC_NOERR)
+    {
+      logFile->write_time("Error: could not open %s: %s\n", path.c_str(), nc_strerror(status));
+      return;
+    }
+
+  if (!read_wrf_time(ncid, path.c_str(), &result->valid_time))
+    {
+      nc_close(ncid);
+      return;
+    }
+
+  if (!wrf_grid_nav(ncid, &grid) || !wrf_grid_same(&grid, ref_grid))
+    {
+      logFile->write_time("Error: the grid of %s differs from the site stencils\n", path.c_str());
+      nc_close(ncid);
+      return;
+    }
+
+  vector<float> box_data((size_t) box.nx * box.ny);
+
+  for (size_t v=0; v<variables.size(); v++)
+    {
+      const char *name = variables[v].c_str();
+      int varid, ndims, dimids[3], have_fill = 0;
+      size_t ny, nx;
+      float fillval = 0.;
+
+      if (nc_inq_varid(ncid, name, &varid) != NC_NOERR ||
+	  nc_inq_varndims(ncid, varid, &ndims) != NC_NOERR || ndims != 3)
+	{
+	  logFile->write_time("Warning: no (Time, south_north, west_east) variable %s in %s\n",
+			      name, path.c_str());
+	  continue;
+	}
+
+      nc_inq_vardimid(ncid, varid, dimids);
+      nc_inq_dimlen(ncid, dimids[1], &ny);
+      nc_inq_dimlen(ncid, dimids[2], &nx);
+      if ((int) nx != grid.nx || (int) ny != grid.ny)
+	{
+	  logFile->write_time("Warning: %s in %s is not on the mass grid\n", name, path.c_str());
+	  continue;
+	}
+
+      if (nc_get_att_float(ncid, varid, "_FillValue", &fillval) == NC_NOERR)
+	have_fill = 1;
+
+      size_t start[3] = {0, (size_t) box.y0, (size_t) box.x0};
+      size_t count[3] = {1, (size_t) box.ny, (size_t) box.nx};
+      if ((status = nc_get_vara_float(ncid, varid, start, count, &box_data[0])) != NC_NOERR)
+	{
+	  logFile->write_time("Error: could not read %s from %s: %s\n", name, path.c_str(),
+			      nc_strerror(status));
+	  continue;
+	}
+
+      lock.unlock();
+      apply_site_stencils(&stencils[0], num_sites, &box, &box_data[0], have_fill, fillval,
+			  &result->data[v * num_sites]);
+      lock.lock();
+    }
+
+  nc_close(ncid);
+  result->ok = 1;
+}
+
+
+//
+// Reads every file of a run with nthreads threads. Each thread takes the
+// next unclaimed file.
+//
+
+static void process_files(const vector<string> &files, const vector<string> &variables,
+			  const wrf_grid *grid, const vector<site_stencil> &stencils,
+			  const stencil_box &box, int nthreads, vector<file_result> &results)
+{
+  size_t next = 0;
+  vector<thread> workers;
+
+  results.resize(files.size());
+
+  if (nthreads > (int) files.size())
+    nthreads = files.size();
+
+  for (int t=0; t<nthreads; t++)
+    workers.push_back(thread([&]()
+      {
+	for (;;)
+	  {
+	    size_t f;
+	    {
+	      lock_guard<mutex> guard(io_mutex);
+	      if (next >= files.size())
+		return;
+	      f = next++;
+	    }
+	    process_file(files[f], variables, grid, stencils, box, &results[f]);
+	  }
+      }));
+
+  for (size_t t=0; t<workers.size(); t++)
+    workers[t].join();
+}
+
+
+//
+// Sets up the grid and site stencils from the first readable file of a
+// run. Returns 1 on success, 0 on failure.
+//
+
+static int make_stencils(const vector<string> &files, const char *calc_type,
+			 const site_list &sites, wrf_grid *grid,
+			 vector<site_stencil> &stencils, stencil_box *box,
+			 string *nav_file)
+{
+  int ncid, ok = 0;
+
+  for (size_t f=0; f<files.size() && !ok; f++)
+    {
+      if (nc_open(files[f].c_str(), NC_NOWRITE, &ncid) != NC_NOERR)
+	continue;
+      ok = wrf_grid_nav(ncid, grid);
+      nc_close(ncid);
+      if (ok)
+	*nav_file = files[f];
+    }
+
+  if (!ok)
+    return(0);
+
+  int num_sites = sites.stid.size();
+  stencils.resize(num_sites);
+  if (!make_site_stencils(grid, calc_type, num_sites, &sites.lat[0], &sites.lon[0], &stencils[0]))
+    return(0);
+
+  make_stencil_box(&stencils[0], num_sites, box);
+  if (box->nx <= 0)
+    {
+      logFile->write_time("Error: no site is on the WRF grid\n");
+      return(0);
+    }
+
+  int off = 0;
+  for (int ns=0; ns<num_sites; ns++)
+    if (!stencils[ns].on_grid)
+      {
+	logFile->write_time("Warning: site %s is off the WRF grid\n", sites.stid[ns].c_str());
+	off++;
+      }
+
+  logFile->write_time("Info: %d of %d sites on the grid, reading box x %d-%d, y %d-%d of %d x %d\n",
+		      num_sites - off, num_sites, box->x0, box->x0 + box->nx - 1,
+		      box->y0, box->y0 + box->ny - 1, grid->nx, grid->ny);
+  return(1);
+}
+
+
+//
+// Output variables, [site][time]
+//
+
+struct out_var
+{
+  string name;
+  int from_wrf;			// copy the attributes of the WRF variable
+  const char *description;
+  const char *units;
+  int have_fill;
+  vector<float> data;
+};
+
+
+static out_var *find_var(vector<out_var> &vars, const char *name)
+{
+  for (size_t v=0; v<vars.size(); v++)
+    if (vars[v].name == name)
+      return(&vars[v]);
+  return(NULL);
+}
+
+
+static void add_derived(vector<out_var> &vars, const char *name, const char *description,
+			const char *units, int have_fill, size_t size)
+{
+  out_var var;
+
+  var.name = name;
+  var.from_wrf = 0;
+  var.description = description;
+  var.units = units;
+  var.have_fill = have_fill;
+  var.data.assign(size, WRF_MISSING);
+  vars.push_back(var);
+}
+
+
+//
+// Adds the derived variables whose inputs were extracted.
+//
+
+static void derive_vars(vector<out_var> &vars, const site_list &sites,
+			const vector<double> &times)
+{
+  size_t num_sites = sites.stid.size();
+  size_t num_times = times.size();
+  size_t size = num_sites * num_times;
+
+  if (find_var(vars, "SWDOWN") && find_var(vars, "CLRNIDX"))
+    {
+      add_derived(vars, "TOA", "Top of Atmospher Irradiance (SWDOWN/CLRNIDX)", "W m-2", 1, size);
+      const vector<float> &sw = find_var(vars, "SWDOWN")->data;
+      const vector<float> &clr = find_var(vars, "CLRNIDX")->data;
+      vector<float> &toa = vars.back().data;
+      for (size_t i=0; i<size; i++)
+	if (sw[i] != WRF_MISSING && clr[i] != WRF_MISSING && clr[i] != 0.)
+	  toa[i] = sw[i] / clr[i];
+    }
+  else
+    logFile->write_time("Warning: TOA needs SWDOWN and CLRNIDX\n");
+
+  if (find_var(vars, "U10") && find_var(vars, "V10"))
+    {
+      add_derived(vars, "WSPD10", "Wind Speed calculated from U10/V10", "m s-1", 0, size);
+      add_derived(vars, "WDIR10", "Wind Dir calculated from U10/V10", "degrees", 0, size);
+      const vector<float> &u = find_var(vars, "U10")->data;
+      const vector<float> &v = find_var(vars, "V10")->data;
+      vector<float> &spd = vars[vars.size()-2].data;
+      vector<float> &dir = vars.back().data;
+      for (size_t i=0; i<size; i++)
+	{
+	  if (u[i] == WRF_MISSING || v[i] == WRF_MISSING)
+	    continue;
+	  spd[i] = sqrt(u[i]*u[i] + v[i]*v[i]);
+	  // Direction is undefined (NaN, as the python script writes) in calm
+	  dir[i] = (spd[i] == 0. ? NAN : (180 / M_PI) * atan2(u[i], v[i]) + 180);
+	}
+    }
+  else
+    logFile->write_time("Warning: WSPD10 and WDIR10 need U10 and V10\n");
+
+  add_derived(vars, "custom_TOA", "TOA using custom calculation", "W m-2", 1, size);
+  add_derived(vars, "apparent_elevation", "Apparent solar elevation at meso site", "degrees", 0, size);
+  add_derived(vars, "azimuth", "Azimuth at meso site", "degrees", 0, size);
+  size_t nv = vars.size();
+  solar_period_mean_grid(num_sites, &sites.lat[0], &sites.lon[0], num_times, &times[0],
+			 SOLAR_MINUTES, &vars[nv-2].data[0], &vars[nv-1].data[0],
+			 &vars[nv-3].data[0]);
+
+  if (find_var(vars, "SWDOWN"))
+    {
+      add_derived(vars, "custom_KT", "KT calculated using SWDOWN/custom_TOA", "percent", 1, size);
+      const vector<float> &sw = find_var(vars, "SWDOWN")->data;
+      const vector<float> &ctoa = find_var(vars, "custom_TOA")->data;
+      vector<float> &kt = vars.back().data;
+      for (size_t i=0; i<size; i++)
+	if (sw[i] != WRF_MISSING && sw[i] != 0. && ctoa[i] > 0.)
+	  kt[i] = sw[i] / ctoa[i];
+    }
+}
+
+
+static int nc_fail(int status, const char *what, const char *name)
+{
+  logFile->write_time("Error: %s %s: %s\n", what, name, nc_strerror(status));
+  return(0);
+}
+
+
+static int def_var(int ncid, const char *name, nc_type type, int ndims, const int *dimids,
+		   const char *long_name, const char *units, int *varid)
+{
+  int status = nc_def_var(ncid, name, type, ndims, dimids, varid);
+
+  if (status != NC_NOERR)
+    return(nc_fail(status, "could not define", name));
+  if (long_name)
+    nc_put_att_text(ncid, *varid, "long_name", strlen(long_name), long_name);
+  if (units)
+    nc_put_att_text(ncid, *varid, "units", strlen(units), units);
+  return(1);
+}
+
+
+//
+// Writes the StatCast-format site file, to a temporary file that is
+// renamed when complete. Variable attributes of the WRF variables are
+// copied from nav_file.
+//
+// Returns 1 on success, 0 on failure.
+//
+
+static int write_site_file(const char *out_file, const char *nav_file, const site_list &sites,
+			   const vector<float> &wrf_lat, const vector<float> &wrf_lon,
+			   const vector<double> &times, const vector<out_var> &vars)
+{
+  string tmp_file = string(out_file) + ".tmp";
+  int ncid, in_ncid = -1, status;
+  int site_dim, time_dim, str_dim, dims[2];
+  int ctime_id, vtime_id, nsites_id, wlon_id, wlat_id, slon_id, slat_id, name_id, sid_id;
+  vector<int> var_ids(vars.size());
+  int num_sites = sites.stid.size();
+
+  logFile->write_time("Creating: %s\n", out_file);
+
+  if ((status = nc_create(tmp_file.c_str(), NC_NETCDF4 | NC_CLOBBER, &ncid)) != NC_NOERR)
+    return(nc_fail(status, "could not create", tmp_file.c_str()));
+
+  if (nc_open(nav_file, NC_NOWRITE, &in_ncid) != NC_NOERR)
+    in_ncid = -1;
+
+  nc_def_dim(ncid, "max_site_num", num_sites, &site_dim);
+  nc_def_dim(ncid, "fcst_times", times.size(), &time_dim);
+  nc_def_dim(ncid, "name_strlen", NAME_STRLEN, &str_dim);
+
+  int ok = def_var(ncid, "creation_time", NC_DOUBLE, 0, NULL,
+		   "time at which forecast file was created", "seconds since 1970-1-1 00:00:00", &ctime_id) &&
+    def_var(ncid, "valid_time", NC_DOUBLE, 1, &time_dim,
+	    "valid time of forecast", "seconds since 1970-1-1 00:00:00", &vtime_id) &&
+    def_var(ncid, "num_sites", NC_INT, 0, NULL, "Number of forecast sites", NULL, &nsites_id) &&
+    def_var(ncid, "wrf_lon", NC_FLOAT, 1, &site_dim,
+	    "longitude associated with closest wrf grid point", "degrees_east", &wlon_id) &&
+    def_var(ncid, "wrf_lat", NC_FLOAT, 1, &site_dim,
+	    "latitude associated with closest wrf grid point", "degrees_north", &wlat_id) &&
+    def_var(ncid, "site_lon", NC_FLOAT, 1, &site_dim,
+	    "longitude associated with mesonet site", "degrees_east", &slon_id) &&
+    def_var(ncid, "site_lat", NC_FLOAT, 1, &site_dim,
+	    "latitude associated with mesonet site", "degrees_north", &slat_id);
+
+  dims[0] = site_dim;
+  dims[1] = str_dim;
+  ok = ok && def_var(ncid, "StationName", NC_CHAR, 2, dims, "Mesonet Station Name", NULL, &name_id) &&
+    def_var(ncid, "StationID", NC_INT, 1, &site_dim, "Mesonet integer id", NULL, &sid_id);
+
+  if (ok)
+    {
+      double time_missing = -999.9;
+      nc_put_att_double(ncid, vtime_id, "missing_value", NC_DOUBLE, 1, &time_missing);
+      nc_put_att_text(ncid, name_id, "standard_name", 4, "stid");
+      nc_put_att_text(ncid, sid_id, "standard_name", 6, "int_id");
+    }
+
+  dims[1] = time_dim;
+  for (size_t v=0; v<vars.size() && ok; v++)
+    {
+      const out_var &var = vars[v];
+      ok = def_var(ncid, var.name.c_str(), NC_FLOAT, 2, dims, NULL, NULL, &var_ids[v]);
+      if (!ok)
+	break;
+
+      if (var.have_fill)
+	{
+	  float fillval = WRF_MISSING;
+	  nc_def_var_fill(ncid, var_ids[v], 0, &fillval);
+	}
+
+      if (var.from_wrf && in_ncid >= 0)
+	{
+	  int in_varid, natts;
+	  char att_name[NC_MAX_NAME+1];
+	  if (nc_inq_varid(in_ncid, var.name.c_str(), &in_varid) == NC_NOERR &&
+	      nc_inq_varnatts(in_ncid, in_varid, &natts) == NC_NOERR)
+	    for (int a=0; a<natts; a++)
+	      if (nc_inq_attname(in_ncid, in_varid, a, att_name) == NC_NOERR &&
+		  strcmp(att_name, "_FillValue") != 0)
+		nc_copy_att(in_ncid, in_varid, att_name, ncid, var_ids[v]);
+	}
+      else if (!var.from_wrf)
+	{
+	  nc_put_att_text(ncid, var_ids[v], "description", strlen(var.description), var.description);
+	  nc_put_att_text(ncid, var_ids[v], "units", strlen(var.units), var.units);
+	}
+    }
+
+  if (in_ncid >= 0)
+    nc_close(in_ncid);
+
+  if (ok && (status = nc_enddef(ncid)) != NC_NOERR)
+    ok = nc_fail(status, "could not write", tmp_file.c_str());
+
+  if (ok)
+    {
+      double ctime = (double) time(NULL);
+      vector<char> names((size_t) num_sites * NAME_STRLEN, '\0');
+      for (int ns=0; ns<num_sites; ns++)
+	strncpy(&names[ns * NAME_STRLEN], sites.stid[ns].c_str(), NAME_STRLEN);
+
+      status = nc_put_var_double(ncid, ctime_id, &ctime);
+      if (status == NC_NOERR)
+	status = nc_put_var_double(ncid, vtime_id, &times[0]);
+      if (status == NC_NOERR)
+	status = nc_put_var_int(ncid, nsites_id, &num_sites);
+      if (status == NC_NOERR)
+	status = nc_put_var_float(ncid, wlon_id, &wrf_lon[0]);
+      if (status == NC_NOERR)
+	status = nc_put_var_float(ncid, wlat_id, &wrf_lat[0]);
+      if (status == NC_NOERR)
+	status = nc_put_var_float(ncid, slon_id, &sites.lon[0]);
+      if (status == NC_NOERR)
+	status = nc_put_var_float(ncid, slat_id, &sites.lat[0]);
+      if (status == NC_NOERR)
+	status = nc_put_var_text(ncid, name_id, &names[0]);
+      if (status == NC_NOERR)
+	status = nc_put_var_int(ncid, sid_id, &sites.id[0]);
+      for (size_t v=0; v<vars.size() && status == NC_NOERR; v++)
+	status = nc_put_var_float(ncid, var_ids[v], &vars[v].data[0]);
+
+      if (status != NC_NOERR)
+	ok = nc_fail(status, "could not write", tmp_file.c_str());
+    }
+
+  if ((status = nc_close(ncid)) != NC_NOERR && ok)
+    ok = nc_fail(status, "could not close", tmp_file.c_str());
+
+  if (ok && rename(tmp_file.c_str(), out_file) != 0)
+    {
+      logFile->write_time("Error: could not rename %s to %s: %s\n", tmp_file.c_str(), out_file,
+			  strerror(errno));
+      ok = 0;
+    }
+
+  if (!ok)
+    unlink(tmp_file.c_str());
+
+  return(ok);
+}
+
+
+int main(int argc, char **argv)
+{
+  const char *calc_type = DEFAULT_CALC_TYPE;
+  const char *day_ahead = NULL;
+  const char *logbase = NULL;
+  int nthreads = DEFAULT_THREADS;
+  int debug_level = 0;
+  int ch;
+
+  while ((ch = getopt(argc, argv, "c:d:l:t:v:")) != EOF)
+    {
+      switch (ch)
+	{
+	case 'c':
+	  calc_type = optarg;
+	  break;
+	case 'd':
+	  day_ahead = optarg;
+	  break;
+	case 'l':
+	  logbase = optarg;
+	  break;
+	case 't':
+	  nthreads = atoi(optarg);
+	  if (nthreads < 1)
+	    usage(argv[0]);
+	  break;
+	case 'v':
+	  debug_level = atoi(optarg);
+	  break;
+	default:
+	  usage(argv[0]);
+	}
+    }
+
+  if (argc - optind != 5)
+    usage(argv[0]);
+
+  const char *wrf_dir = argv[optind];
+  const char *init_str = argv[optind + 1];
+  const char *site_file = argv[optind + 2];
+  const char *var_list = argv[optind + 3];
+  const char *out_file = argv[optind + 4];
+
+  logFile = new Log(logbase ? logbase : "");
+  logFile->set_debug(debug_level);
+  logFile->write_time_starting(argv[0]);
+
+  struct tm tms;
+  memset(&tms, 0, sizeof(tms));
+  if (strptime(init_str, "%Y%m%d.%H%M", &tms) == NULL)
+    {
+      logFile->write_time("Error: bad forecast init time %s, expected YYYYmmdd.HHMM\n", init_str);
+      logFile->write_time_ending(1);
+      return(1);
+    }
+  time_t init_time = timegm(&tms);
+
+  vector<string> variables;
+  char *list = strdup(var_list);
+  for (char *tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ","))
+    variables.push_back(tok);
+  free(list);
+
+  site_list sites;
+  if (!read_site_list(site_file, &sites))
+    {
+      logFile->write_time_ending(1);
+      return(1);
+    }
+
+  // Nowcast run, then the day-ahead run of the same day
+  char run_name[32];
+  strftime(run_name, sizeof(run_name), "%Y-%m-%d_%H", &tms);
+  vector<string> files = list_wrf_files(string(wrf_dir) + "/" + run_name + "/wrfout", init_time);
+
+  if (files.empty() && day_ahead)
+    {
+      logFile->write_time("Looking for WRF data in day-ahead area\n");
+      strftime(run_name, sizeof(run_name), "%Y-%m-%d_06", &tms);
+      files = list_wrf_files(string(day_ahead) + "/" + run_name + "/wrfout", init_time);
+    }
+
+  wrf_grid grid;
+  vector<site_stencil> stencils;
+  stencil_box box;
+  string nav_file;
+
+  if (files.empty() || !make_stencils(files, calc_type, sites, &grid, stencils, &box, &nav_file))
+    {
+      logFile->write_time("No WRF data, exiting\n");
+      logFile->write_time_ending(1);
+      return(1);
+    }
+
+  vector<file_result> results;
+  process_files(files, variables, &grid, stencils, box, nthreads, results);
+
+  // Times in order, one file per time
+  vector<pair<double, int> > order;
+  for (size_t f=0; f<results.size(); f++)
+    if (results[f].ok)
+      order.push_back(make_pair(results[f].valid_time, (int) f));
+  sort(order.begin(), order.end());
+
+  vector<double> times;
+  vector<int> time_file;
+  for (size_t i=0; i<order.size(); i++)
+    if (times.empty() || order[i].first != times.back())
+      {
+	times.push_back(order[i].first);
+	time_file.push_back(order[i].second);
+      }
+
+  if (times.empty())
+    {
+      logFile->write_time("Error: No wrf files to ingest\n");
+      logFile->write_time_ending(1);
+      return(1);
+    }
+
+  // Transpose the file results to [site][time]
+  size_t num_sites = sites.stid.size();
+  size_t num_times = times.size();
+  vector<out_var> vars;
+  for (size_t v=0; v<variables.size(); v++)
+    {
+      add_derived(vars, variables[v].c_str(), NULL, NULL, 0, num_sites * num_times);
+      vars.back().from_wrf = 1;
+      for (size_t t=0; t<num_times; t++)
+	{
+	  const vector<float> &data = results[time_file[t]].data;
+	  for (size_t ns=0; ns<num_sites; ns++)
+	    vars.back().data[ns * num_times + t] = data[v * num_sites + ns];
+	}
+    }
+
+  derive_vars(vars, sites, times);
+
+  // Location of each site's nearest stencil point
+  vector<float> wrf_lat(num_sites, WRF_MISSING), wrf_lon(num_sites, WRF_MISSING);
+  for (size_t ns=0; ns<num_sites; ns++)
+    if (stencils[ns].on_grid)
+      {
+	const site_stencil &st = stencils[ns];
+	int i = (st.w[1][0] + st.w[1][1] > st.w[0][0] + st.w[0][1]);
+	int j = (st.w[0][1] + st.w[1][1] > st.w[0][0] + st.w[1][0]);
+	double lat, lon;
+	cxy2ll(&grid.stcpm, st.x[i], st.y[j], &lat, &lon);
+	wrf_lat[ns] = lat;
+	wrf_lon[ns] = lon;
+      }
+
+  int ok = write_site_file(out_file, nav_file.c_str(), sites, wrf_lat, wrf_lon, times, vars);
+
+  logFile->write_time("Info: %d sites, %d of %d files\n", (int) num_sites, (int) num_times,
+		      (int) files.size());
+  logFile->write_time_ending(ok ? 0 : 1);
+  delete logFile;
+
+  return(ok ? 0 : 1);
+}
@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <netcdf.h>
+#include "dmapf/cmapf.h"
+#include "log/log.hh"
+#include "wrf_grid.h"
+
+extern Log *logFile;
+
+
+//
+// Reads a float global attribute. Returns 1 on success, 0 on failure.
+//
+
+static int get_global_float(int ncid, const char *name, float *val)
+{
+  int status = nc_get_att_float(ncid, NC_GLOBAL, name, val);
+
+  if (status != NC_NOERR)
+    {
+      logFile->write_time("Error: cannot read global attribute %s: %s\n",
+			  name, nc_strerror(status));
+      return(0);
+    }
+  return(1);
+}
+
+
+//
+// Reads the first value of a WRF coordinate variable (XLAT or XLONG),
+// dimensioned (Time, south_north, west_east) or (south_north, west_east).
+// Returns 1 on success, 0 if the variable is not there.
+//
+
+static int get_corner(int ncid, const char *name, float *val)
+{
+  size_t index[3] = {0, 0, 0};
+  int varid, ndims;
+
+  if (nc_inq_varid(ncid, name, &varid) != NC_NOERR ||
+      nc_inq_varndims(ncid, varid, &ndims) != NC_NOERR ||
+      ndims < 2 || ndims > 3)
+    return(0);
+
+  return(nc_get_var1_float(ncid, varid, index, val) == NC_NOERR);
+}
+
+
+//
+// Sets up the navigation of the mass grid of a wrfout file from its
+// global attributes. Lambert conformal, polar stereographic and mercator
+// domains are handled; x runs along west_east and y along south_north,
+// both starting at 0 on the first mass point.
+//
+// Returns 1 on success, 0 on failure.
+//
+
+int wrf_grid_nav(int ncid, wrf_grid *grid)
+{
+  int dimid, status;
+  size_t len;
+  float lat1, lon1, dx_km, pole;
+  double x1, y1;
+
+  memset(grid, 0, sizeof(*grid));
+
+  if ((status = nc_get_att_int(ncid, NC_GLOBAL, "MAP_PROJ", &grid->map_proj)) != NC_NOERR)
+    {
+      logFile->write_time("Error: cannot read global attribute MAP_PROJ: %s\n",
+			  nc_strerror(status));
+      return(0);
+    }
+
+  if (nc_inq_dimid(ncid, "west_east", &dimid) != NC_NOERR ||
+      nc_inq_dimlen(ncid, dimid, &len) != NC_NOERR)
+    {
+      logFile->write_time("Error: no west_east dimension\n");
+      return(0);
+    }
+  grid->nx = (int) len;
+
+  if (nc_inq_dimid(ncid, "south_north", &dimid) != NC_NOERR ||
+      nc_inq_dimlen(ncid, dimid, &len) != NC_NOERR)
+    {
+      logFile->write_time("Error: no south_north dimension\n");
+      return(0);
+    }
+  grid->ny = (int) len;
+
+  if (!get_global_float(ncid, "TRUELAT1", &grid->truelat1) ||
+      !get_global_float(ncid, "TRUELAT2", &grid->truelat2) ||
+      !get_global_float(ncid, "STAND_LON", &grid->stand_lon) ||
+      !get_global_float(ncid, "DX", &grid->dx))
+    return(0);
+
+  // Anchor the grid at its first mass point. Files written without the
+  // coordinate variables are anchored at the domain center instead, which
+  // WRF places on the middle mass point.
+  if (get_corner(ncid, "XLAT", &lat1) && get_corner(ncid, "XLONG", &lon1))
+    {
+      x1 = 0.;
+      y1 = 0.;
+    }
+  else
+    {
+      if (!get_global_float(ncid, "CEN_LAT", &lat1) ||
+	  !get_global_float(ncid, "CEN_LON", &lon1))
+	return(0);
+      x1 = (grid->nx - 1) / 2.;
+      y1 = (grid->ny - 1) / 2.;
+    }
+
+  dx_km = grid->dx / 1000;
+
+  switch (grid->map_proj)
+    {
+    case 1:
+      stlmbr(&grid->stcpm, eqvlat(grid->truelat1, grid->truelat2), grid->stand_lon);
+      break;
+    case 2:
+      pole = (grid->truelat1 >= 0. ? 90. : -90.);
+      sobstr(&grid->stcpm, pole, 0.);
+      break;
+    case 3:
+      stcmap(&grid->stcpm, 0., grid->stand_lon);
+      break;
+    default:
+      logFile->write_time("Error: cannot handle WRF MAP_PROJ %d\n", grid->map_proj);
+      return(0);
+    }
+
+  stcm1p(&grid->stcpm, x1, y1, lat1, lon1, grid->truelat1, grid->stand_lon, dx_km, 0);
+
+  cxy2ll(&grid->stcpm, 0., 0., &grid->lat00, &grid->lon00);
+
+  logFile->write_time(1, "Info: WRF grid MAP_PROJ %d, %d x %d, dx %.0f m, first point %.4f %.4f\n",
+		      grid->map_proj, grid->nx, grid->ny, grid->dx,
+		      grid->lat00, grid->lon00);
+
+  return(1);
+}
+
+
+//
+// Returns 1 if two navigations describe the same grid, so that stencils
+// made for one apply to the other.
+//
+
+int wrf_grid_same(const wrf_grid *a, const wrf_grid *b)
+{
+  return(a->map_proj == b->map_proj && a->nx == b->nx && a->ny == b->ny &&
+	 a->truelat1 == b->truelat1 && a->truelat2 == b->truelat2 &&
+	 a->stand_lon == b->stand_lon && a->dx == b->dx &&
+	 fabs(a->lat00 - b->lat00) < 1e-4 && fabs(a->lon00 - b->lon00) < 1e-4);
+}
+
+
+//
+// Locates the sites on the grid and sets up their stencils. calc_type is
+// "bilinear" or "nearest_neighbor", with corners and weights as in
+// grib2site's make_site_data(). Sites off the grid get on_grid 0.
+//
+// Returns 1 on success, 0 on failure.
+//
+
+int make_site_stencils(wrf_grid *grid, const char *calc_type, int num_sites,
+		       const float *lat, const float *lon, site_stencil *st)
+{
+  int nearest, ns, i, j;
+  double x, y, ival;
+  float xdist, ydist;
+
+  if (strcmp(calc_type, "bilinear") == 0)
+    nearest = 0;
+  else if (strcmp(calc_type, "nearest_neighbor") == 0)
+    nearest = 1;
+  else
+    {
+      logFile->write_time("Error: Invalid calc_type: '%s'\n", calc_type);
+      return(0);
+    }
+
+  for (ns=0; ns<num_sites; ns++)
+    {
+      memset(&st[ns], 0, sizeof(site_stencil));
+
+      cll2xy(&grid->stcpm, (double)lat[ns], (double)lon[ns], &x, &y);
+
+      if ((y < 0.) || (y > grid->ny-1) || (x < 0.) || (x > grid->nx-1))
+	{
+	  logFile->write_time(3, "Info: site-index(ns): %d, lat %f, lon %f, x %f, y %f (off grid)\n",
+			      ns, lat[ns], lon[ns], x, y);
+	  continue;
+	}
+
+      st[ns].on_grid = 1;
+
+      xdist = (float) modf(x, &ival);
+      ydist = (float) modf(y, &ival);
+
+      if (nearest)
+	{
+	  st[ns].x[0] = st[ns].x[1] = (int) floor(x) + (xdist >= 0.5);
+	  st[ns].y[0] = st[ns].y[1] = (int) floor(y) + (ydist >= 0.5);
+	  st[ns].w[0][0] = 1.;
+	}
+      else
+	{
+	  st[ns].x[0] = (int) floor(x);
+	  st[ns].x[1] = (int) ceil(x);
+	  st[ns].y[0] = (int) floor(y);
+	  st[ns].y[1] = (int) ceil(y);
+
+	  for (i=0; i<2; i++)
+	    for (j=0; j<2; j++)
+	      st[ns].w[i][j] = (i ? xdist : 1-xdist) * (j ? ydist : 1-ydist);
+	}
+
+      logFile->write_time(3, "Info: site-index(ns): %d, lat %7.2f, lon %7.2f, x %.2f, y %.2f\n",
+			  ns, lat[ns], lon[ns], x, y);
+    }
+
+  return(1);
+}
+
+
+//
+// Computes the smallest grid box holding every stencil point, the
+// hyperslab a field is read over.
+//
+
+void make_stencil_box(const site_stencil *st, int num_sites, stencil_box *box)
+{
+  int x0 = 0, y0 = 0, x1 = -1, y1 = -1;
+  int ns, first = 1;
+
+  for (ns=0; ns<num_sites; ns++)
+    {
+      if (!st[ns].on_grid)
+	continue;
+
+      if (first || st[ns].x[0] < x0) x0 = st[ns].x[0];
+      if (first || st[ns].y[0] < y0) y0 = st[ns].y[0];
+      if (first || st[ns].x[1] > x1) x1 = st[ns].x[1];
+      if (first || st[ns].y[1] > y1) y1 = st[ns].y[1];
+      first = 0;
+    }
+
+  box->x0 = x0;
+  box->y0 = y0;
+  box->nx = x1 - x0 + 1;
+  box->ny = y1 - y0 + 1;
+}
+
+
+//
+// Applies the stencils to a field read over the stencil box. A site is
+// missing if it is off the grid or any point of its stencil with a non
+// zero weight is missing (the field's fill value or NaN).
+//
+
+void apply_site_stencils(const site_stencil *st, int num_sites,
+			 const stencil_box *box, const float *box_data,
+			 int have_fill, float fillval, float *site_data)
+{
+  int ns, i, j;
+
+  for (ns=0; ns<num_sites; ns++)
+    {
+      float sum = 0.;
+      int missing = !st[ns].on_grid;
+
+      for (i=0; i<2 && !missing; i++)
+	for (j=0; j<2 && !missing; j++)
+	  {
+	    if (st[ns].w[i][j] == 0.)
+	      continue;
+
+	    float val = box_data[(st[ns].y[j] - box->y0) * box->nx + st[ns].x[i] - box->x0];
+	    if ((have_fill && val == fillval) || isnan(val))
+	      missing = 1;
+	    else
+	      sum += st[ns].w[i][j] * val;
+	  }
+
+      site_data[ns] = (missing ? WRF_MISSING : sum);
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * WRF grid navigation and grid to site stencils for wrf2site.
+ *
+ * The map projection of a wrfout file is set up from its global
+ * attributes (MAP_PROJ, TRUELAT1, TRUELAT2, STAND_LON, DX) with the
+ * dmapf library, anchored at the XLAT/XLONG of the first mass point
+ * (or CEN_LAT/CEN_LON at the domain center). Each site is located on
+ * the mass grid once and reduced to a stencil: the surrounding grid
+ * points and their weights, computed as grib2site's make_site_data()
+ * does for its bilinear and nearest_neighbor calc types. Applying the
+ * stencils to a field is then a gather over the grid box that holds
+ * all of them.
+ */
+
+#ifndef WRF_GRID_H
+#define WRF_GRID_H
+
+#include "dmapf/cmapf.h"
+
+#define WRF_MISSING -9999.f	/* missing site value */
+
+typedef struct wrf_grid {
+    int map_proj;		/* WRF MAP_PROJ: 1 lambert, 2 polar, 3 mercator */
+    int nx;			/* west_east mass points */
+    int ny;			/* south_north mass points */
+    float truelat1;
+    float truelat2;
+    float stand_lon;
+    float dx;			/* grid spacing, m */
+    double lat00;		/* location of mass point (0, 0) */
+    double lon00;
+    maparam stcpm;		/* dmapf navigation, x west_east, y south_north */
+} wrf_grid;
+
+typedef struct site_stencil {
+    int on_grid;		/* 0 if the site is off the grid */
+    int x[2];			/* west_east index of the corners */
+    int y[2];			/* south_north index of the corners */
+    float w[2][2];		/* weight of corner (x[i], y[j]) */
+} site_stencil;
+
+typedef struct stencil_box {
+    int x0, y0;			/* first grid point of the box */
+    int nx, ny;			/* box size, 0 if no site is on the grid */
+} stencil_box;
+
+int wrf_grid_nav(int ncid, wrf_grid *grid);
+int wrf_grid_same(const wrf_grid *a, const wrf_grid *b);
+int make_site_stencils(wrf_grid *grid, const char *calc_type, int num_sites,
+		       const float *lat, const float *lon, site_stencil *st);
+void make_stencil_box(const site_stencil *st, int num_sites, stencil_box *box);
+void apply_site_stencils(const site_stencil *st, int num_sites,
+			 const stencil_box *box, const float *box_data,
+			 int have_fill, float fillval, float *site_data);
+
+#endif
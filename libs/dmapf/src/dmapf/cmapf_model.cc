@@ -303,6 +303,25 @@ int CmapfModel::ll2xy(float lat, float longit, float *x, float *y)
   return 0;
 }
 
+int CmapfModel::ll2xy(const double *lat, const double *longit, double *x, double *y, size_t n)
+{
+  int noff = 0;
+
+  if(_type == gmap["latitude/longitude"])
+  {
+    for (size_t i=0; i<n; i++)
+      if (ll2xy(lat[i], longit[i], &x[i], &y[i]) != 0)
+	noff++;
+  } else {
+    cll2xy_n(&_stcpm, lat, longit, x, y, n);
+
+    for (size_t i=0; i<n; i++)
+      if ((rint(x[i]) < 0) || (rint(x[i]) >= _nx) || (rint(y[i]) < 0) || (rint(y[i]) >= _ny))
+	noff++;
+  }
+  return noff;
+}
+
 int CmapfModel::xy2ll(double x, double y, double *lat, double *longit)
 {
 
@@ -0,0 +1,308 @@
+#include <math.h>
+#include <float.h>
+#include "../include/dmapf/cmapf.h"
+
+/*
+ * Array versions of cll2xy, cxy2ll and cgszll.  Points are processed in
+ * blocks held in separate x, y and z arrays so that the inner loops are
+ * free of function calls and data dependent branches, and can be
+ * vectorized by the compiler.  Sines, cosines and arctangents come from
+ * the polynomial kernels below rather than libm; logarithms and powers
+ * still come from libm.  Points at or very near a projection pole, and
+ * Lambert projections that are nearly Mercator (where the limmath
+ * routines are needed for accuracy), are handed to the scalar routines.
+ */
+
+#define N_BLOCK 256
+
+/* Below this, |gamma| is treated as "nearly Mercator" and done point by
+ * point with the limmath routines, as in map_xe and xy_map. */
+#define N_MIN_GAMMA .01
+
+/* Points with |z| beyond this are at a projection pole or its antipodes */
+#define N_POLE_Z (1. - 1.e-12)
+
+/* pi/2 split for Cody-Waite argument reduction (from fdlibm) */
+#define PIO2_1  1.57079632673412561417e+00
+#define PIO2_1T 6.07710050650619224932e-11
+
+/*
+ * sin and cos of r (radians), for |r| up to a few thousand.  Reduces to
+ * [-pi/4,pi/4] and evaluates the fdlibm kernel polynomials, then picks
+ * and signs the results by quadrant.
+ */
+static void poly_sincos(double r, double * s, double * c) {
+double k = floor(r * (2./M_PI) + .5);
+double t = (r - k * PIO2_1) - k * PIO2_1T;
+double z = t * t;
+double ps = t + t * z * (-1.66666666666666324348e-01 + z *
+		( 8.33333333332248946124e-03 + z *
+		(-1.98412698298579493134e-04 + z *
+		( 2.75573137070700676789e-06 + z *
+		(-2.50507602534068634195e-08 + z *
+		  1.58969099521155010221e-10)))));
+double pc = 1. - .5 * z + z * z * ( 4.16666666666666019037e-02 + z *
+		(-1.38888888888741095749e-03 + z *
+		( 2.48015872894767294178e-05 + z *
+		(-2.75573143513906633035e-07 + z *
+		( 2.08757232129817482790e-09 + z *
+		 -1.13596475577881948265e-11)))));
+long q = (long) k & 3;
+  *s = (q == 0 ? ps : q == 1 ? pc : q == 2 ? -ps : -pc);
+  *c = (q == 0 ? pc : q == 1 ? -ps : q == 2 ? -pc : ps);
+}
+
+/*
+ * atan2(y,x), in (-pi,pi].  Reduces to an argument in [0,tan(pi/8)]
+ * and evaluates the Cephes rational approximation.
+ */
+static double poly_atan2(double y, double x) {
+double ax = fabs(x), ay = fabs(y);
+int swap = ay > ax;
+double num = swap ? ax : ay, den = swap ? ay : ax;
+double a = den > 0. ? num / den : 0.;
+int big = a > 0.41421356237309504880;
+double t = big ? (a - 1.) / (a + 1.) : a;
+double z = t * t;
+double p = (((-8.750608600031904122785e-01 * z
+	      - 1.615753718733365076637e+01) * z
+	      - 7.500855792314704667340e+01) * z
+	      - 1.228866684490136173410e+02) * z
+	      - 6.485021904942025371773e+01;
+double q = ((((z + 2.485846490142306297962e+01) * z
+	      + 1.650270098316988542046e+02) * z
+	      + 4.328810604912902668951e+02) * z
+	      + 4.853903996359136964868e+02) * z
+	      + 1.945506571482613964425e+02;
+double r = (big ? .25 * M_PI : 0.) + (t + t * z * p / q);
+  r = swap ? .5 * M_PI - r : r;
+  r = x < 0. ? M_PI - r : r;
+  return (signbit(y) ? -r : r);
+}
+
+/*
+ * Latitude-longitude to "map" 3-vectors: ll_geog followed by basegtom.
+ */
+static void ll_map_n(const maparam * stcprm, const double lat[],
+		     const double longit[], double mx[], double my[],
+		     double mz[], int n) {
+double r00 = stcprm->rotate[0][0], r01 = stcprm->rotate[0][1],
+       r02 = stcprm->rotate[0][2], r10 = stcprm->rotate[1][0],
+       r11 = stcprm->rotate[1][1], r12 = stcprm->rotate[1][2],
+       r20 = stcprm->rotate[2][0], r21 = stcprm->rotate[2][1],
+       r22 = stcprm->rotate[2][2];
+int k;
+  for (k=0;k<n;k++) {
+    double slat,clat,slon,clon,gx,gy,gz;
+    poly_sincos(RADPDEG * lat[k], &slat, &clat);
+    poly_sincos(RADPDEG * longit[k], &slon, &clon);
+    gx = clon * clat;
+    gy = slon * clat;
+    gz = slat;
+    mx[k] = r00 * gx + r01 * gy + r02 * gz;
+    my[k] = r10 * gx + r11 * gy + r12 * gz;
+    mz[k] = r20 * gx + r21 * gy + r22 * gz;
+  }
+}
+
+/*
+ * "map" 3-vectors to canonical map coordinates xi,eta, as map_xe with
+ * mode 0, for points away from the projection poles.
+ */
+static void map_xe_n(const maparam * stcprm, const double mx[],
+		     const double my[], const double mz[], double xi[],
+		     double eta[], int n) {
+double gamma = stcprm->gamma;
+int k;
+  if (gamma >= 1.) {
+/* Stereographic: xi,eta are rational in the map vector */
+    for (k=0;k<n;k++) {
+      double f = 1. / (1. + mz[k]);
+      xi[k] = my[k] * f;
+      eta[k] = 1. - mx[k] * f;
+    }
+  } else if (gamma <= -1.) {
+/* Stereographic, centered at the antipodes */
+    for (k=0;k<n;k++) {
+      double f = 1. / (1. - mz[k]);
+      xi[k] = -my[k] * f;
+      eta[k] = mx[k] * f - 1.;
+    }
+  } else if (gamma == 0.) {
+/* Mercator: xi = theta, eta = ymerc */
+    for (k=0;k<n;k++) {
+      double theta = poly_atan2(my[k], mx[k]);
+      xi[k] = theta <= -M_PI ? M_PI : theta;
+      eta[k] = .5 * log((1. + mz[k]) / (1. - mz[k]));
+    }
+  } else {
+/* Lambert: with E = exp(-gamma*ymerc),
+ *   xi = E sin(gamma theta)/gamma, eta = (1 - E cos(gamma theta))/gamma */
+    double hg = .5 * gamma, rg = 1. / gamma;
+    for (k=0;k<n;k++) {
+      double theta = poly_atan2(my[k], mx[k]);
+      double e = pow((1. - mz[k]) / (1. + mz[k]), hg);
+      double s,c;
+      theta = theta <= -M_PI ? M_PI : theta;
+      poly_sincos(gamma * theta, &s, &c);
+      xi[k] = e * s * rg;
+      eta[k] = (1. - e * c) * rg;
+    }
+  }
+}
+
+/*
+ * Canonical map coordinates to x,y, as xe_xy.
+ */
+static void xe_xy_n(const maparam * stcprm, const double xi[],
+		    const double eta[], double x[], double y[], int n) {
+double scale = stcprm->EarthRad / stcprm->gridszeq;
+double cr = scale * stcprm->crotate, sr = scale * stcprm->srotate;
+double x0 = stcprm->x0, y0 = stcprm->y0;
+int k;
+  for (k=0;k<n;k++) {
+    x[k] = x0 + cr * xi[k] + sr * eta[k];
+    y[k] = y0 + cr * eta[k] - sr * xi[k];
+  }
+}
+
+/*
+ * The Lambert formulas above lose accuracy as gamma goes to zero, so
+ * nearly-Mercator projections are left to the scalar routines.
+ */
+static int n_gamma_ok(const maparam * stcprm) {
+  return (stcprm->gamma == 0. || fabs(stcprm->gamma) >= N_MIN_GAMMA);
+}
+
+void cll2xy_n(const maparam * stcprm, const double lat[],
+	      const double longit[], double x[], double y[], size_t npts) {
+double mx[N_BLOCK],my[N_BLOCK],mz[N_BLOCK],xi[N_BLOCK],eta[N_BLOCK];
+char pole[N_BLOCK];
+size_t b;
+int n,k;
+  if (! n_gamma_ok(stcprm)) {
+    for (b=0;b<npts;b++) cll2xy(stcprm, lat[b],longit[b], &x[b],&y[b]);
+    return;
+  }
+  for (b=0;b<npts;b+=N_BLOCK) {
+    n = (npts - b < N_BLOCK ? (int)(npts - b) : N_BLOCK);
+    ll_map_n(stcprm, lat+b,longit+b, mx,my,mz, n);
+/* Keep the vector loops finite at the poles; those points are redone */
+    for (k=0;k<n;k++) {
+      pole[k] = fabs(mz[k]) > N_POLE_Z;
+      mz[k] = pole[k] ? 0. : mz[k];
+    }
+    map_xe_n(stcprm, mx,my,mz, xi,eta, n);
+    xe_xy_n(stcprm, xi,eta, x+b,y+b, n);
+    for (k=0;k<n;k++)
+      if (pole[k]) cll2xy(stcprm, lat[b+k],longit[b+k], &x[b+k],&y[b+k]);
+  }
+}
+
+void cxy2ll_n(const maparam * stcprm, const double x[], const double y[],
+	      double lat[], double longit[], size_t npts) {
+double mx[N_BLOCK],my[N_BLOCK],mz[N_BLOCK],xi[N_BLOCK],eta[N_BLOCK];
+char pole[N_BLOCK];
+double gamma = stcprm->gamma;
+double scale = stcprm->gridszeq / stcprm->EarthRad;
+double cr = scale * stcprm->crotate, sr = scale * stcprm->srotate;
+double r00 = stcprm->rotate[0][0], r01 = stcprm->rotate[0][1],
+       r02 = stcprm->rotate[0][2], r10 = stcprm->rotate[1][0],
+       r11 = stcprm->rotate[1][1], r12 = stcprm->rotate[1][2],
+       r20 = stcprm->rotate[2][0], r21 = stcprm->rotate[2][1],
+       r22 = stcprm->rotate[2][2];
+size_t b;
+int n,k;
+  if (! n_gamma_ok(stcprm)) {
+    for (b=0;b<npts;b++) cxy2ll(stcprm, x[b],y[b], &lat[b],&longit[b]);
+    return;
+  }
+  for (b=0;b<npts;b+=N_BLOCK) {
+    n = (npts - b < N_BLOCK ? (int)(npts - b) : N_BLOCK);
+/* x,y to xi,eta and the pole test, as in xy_map */
+    for (k=0;k<n;k++) {
+      double dx = x[b+k] - stcprm->x0, dy = y[b+k] - stcprm->y0;
+      double vsq;
+      xi[k] = cr * dx - sr * dy;
+      eta[k] = cr * dy + sr * dx;
+      vsq = gamma * (xi[k]*xi[k] + eta[k]*eta[k]) - 2. * eta[k];
+      pole[k] = gamma * vsq + 1. <= 3.e-8;
+    }
+    if (gamma >= 1.) {
+      for (k=0;k<n;k++) {
+	double vsq = gamma * (xi[k]*xi[k] + eta[k]*eta[k]) - 2. * eta[k];
+	double f = pole[k] ? 1. : 2. / (2. + vsq);
+	my[k] = xi[k] * f;
+	mx[k] = (1. - eta[k]) * f;
+	mz[k] = f - 1.;
+      }
+    } else if (gamma <= -1.) {
+      for (k=0;k<n;k++) {
+	double vsq = gamma * (xi[k]*xi[k] + eta[k]*eta[k]) - 2. * eta[k];
+	double f = pole[k] ? -1. : -2. / (2. - vsq);
+	my[k] = xi[k] * f;
+	mx[k] = (- 1. - eta[k]) * f;
+	mz[k] = f + 1.;
+      }
+    } else {
+/* Mercator or Lambert */
+      for (k=0;k<n;k++) {
+	double vsq = gamma * (xi[k]*xi[k] + eta[k]*eta[k]) - 2. * eta[k];
+	double ymerc, fact, cosphi, theta, s, c;
+	if (gamma == 0.) {
+	  ymerc = eta[k];
+	  theta = xi[k];
+	} else {
+	  ymerc = pole[k] ? 0. : -.5 * log1p(gamma * vsq) / gamma;
+	  theta = poly_atan2(gamma * xi[k], 1. - gamma * eta[k]) / gamma;
+	}
+	fact = exp(- fabs(ymerc));
+	cosphi = 2. * fact / (1. + fact * fact);
+	mz[k] = ymerc > 0. ? 1. - fact * cosphi : fact * cosphi - 1.;
+	poly_sincos(theta, &s, &c);
+	mx[k] = fabs(mz[k]) < 1. ? cosphi * c : 0.;
+	my[k] = fabs(mz[k]) < 1. ? cosphi * s : 0.;
+      }
+    }
+/* basemtog and geog_ll */
+    for (k=0;k<n;k++) {
+      double gx = mx[k] * r00 + my[k] * r10 + mz[k] * r20;
+      double gy = mx[k] * r01 + my[k] * r11 + mz[k] * r21;
+      double gz = mx[k] * r02 + my[k] * r12 + mz[k] * r22;
+      double h = gx * gx + gy * gy;
+      pole[k] |= h <= 0.;
+      lat[b+k] = DEGPRAD * poly_atan2(gz, sqrt(h));
+      longit[b+k] = DEGPRAD * poly_atan2(gy, gx);
+    }
+    for (k=0;k<n;k++)
+      if (pole[k]) cxy2ll(stcprm, x[b+k],y[b+k], &lat[b+k],&longit[b+k]);
+  }
+}
+
+void cgszll_n(const maparam * stcprm, const double lat[],
+	      const double longit[], double gsz[], size_t npts) {
+double mx[N_BLOCK],my[N_BLOCK],mz[N_BLOCK];
+char pole[N_BLOCK];
+double gamma = stcprm->gamma;
+double gszeq = stcprm->gridszeq;
+size_t b;
+int n,k;
+  for (b=0;b<npts;b+=N_BLOCK) {
+    n = (npts - b < N_BLOCK ? (int)(npts - b) : N_BLOCK);
+    ll_map_n(stcprm, lat+b,longit+b, mx,my,mz, n);
+    for (k=0;k<n;k++) {
+      pole[k] = fabs(mz[k]) >= 1.;
+      mz[k] = pole[k] ? 0. : mz[k];
+    }
+    if (fabs(gamma) >= 1.) {
+      double sg = gamma > 0. ? 1. : -1.;
+      for (k=0;k<n;k++) gsz[b+k] = gszeq * (1. + sg * mz[k]);
+    } else {
+      double hg = .5 * (1. - gamma);
+      for (k=0;k<n;k++)
+	gsz[b+k] = gszeq * pow((1. - mz[k]) / (1. + mz[k]), hg) * (1. + mz[k]);
+    }
+    for (k=0;k<n;k++)
+      if (pole[k]) gsz[b+k] = cgszll((maparam *)stcprm, lat[b+k],longit[b+k]);
+  }
+}
@@ -0,0 +1,222 @@
+/*
+ *   Module: grid_site_map.cc
+ *
+ *   Description: Map from grid points to nearby observation sites, in
+ *   compressed sparse row form. See grid_site_map.hh.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "../include/dmapf/grid_site_map.hh"
+
+static const char GSM_MAGIC[4] = {'G', 'S', 'M', 'P'};
+
+// Orders grid point indices by grid id
+struct GridIdLess
+{
+  const vector<int> &id;
+  GridIdLess(const vector<int> &i) : id(i) {}
+  bool operator()(int a, int b) const {return id[a] < id[b];}
+};
+
+
+void GridSiteMap::build(const vector<int> &grid_id, const vector<double> &grid_lat, const vector<double> &grid_lon,
+			const vector<string> &site_name, const SphereKdTree &sites, double radius_km, int max_sites)
+{
+  vector<int> index;
+  vector<double> dist_km;
+  vector<int> order(grid_id.size());
+
+  _siteName = site_name;
+  _gridId.clear();
+  _offset.assign(1, 0);
+  _site.clear();
+  _dist.clear();
+  _errString = "";
+
+  // Rows in grid id order so find() can search them
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = (int)i;
+  sort(order.begin(), order.end(), GridIdLess(grid_id));
+
+  for (size_t o = 0; o < order.size(); o++)
+    {
+      int g = order[o];
+      int n;
+
+      if (max_sites > 0)
+	n = sites.nearest(grid_lat[g], grid_lon[g], max_sites, index, dist_km, radius_km);
+      else
+	n = sites.within(grid_lat[g], grid_lon[g], radius_km, index, dist_km);
+
+      if (n == 0)
+	continue;
+
+      _gridId.push_back(grid_id[g]);
+      for (int k = 0; k < n; k++)
+	{
+	  _site.push_back(index[k]);
+	  _dist.push_back((float)dist_km[k]);
+	}
+      _offset.push_back((int)_site.size());
+    }
+}
+
+
+int GridSiteMap::find(int grid_id) const
+{
+  vector<int>::const_iterator it = lower_bound(_gridId.begin(), _gridId.end(), grid_id);
+  if (it == _gridId.end() || *it != grid_id)
+    return -1;
+  return (int)(it - _gridId.begin());
+}
+
+
+int GridSiteMap::write(const string &path)
+{
+  int header[5];
+  int name_len = 1;
+  FILE *fp;
+
+  for (size_t s = 0; s < _siteName.size(); s++)
+    if ((int)_siteName[s].size() + 1 > name_len)
+      name_len = (int)_siteName[s].size() + 1;
+
+  fp = fopen(path.c_str(), "wb");
+  if (fp == NULL)
+    {
+      _errString = "Unable to open " + path + " for writing";
+      return -1;
+    }
+
+  header[0] = GRID_SITE_MAP_VERSION;
+  header[1] = (int)_siteName.size();
+  header[2] = name_len;
+  header[3] = (int)_gridId.size();
+  header[4] = (int)_site.size();
+
+  vector<char> names(_siteName.size() * name_len, 0);
+  for (size_t s = 0; s < _siteName.size(); s++)
+    memcpy(&names[s * name_len], _siteName[s].c_str(), _siteName[s].size());
+
+  int ok = (fwrite(GSM_MAGIC, 1, 4, fp) == 4 &&
+	    fwrite(header, sizeof(int), 5, fp) == 5 &&
+	    fwrite(names.data(), 1, names.size(), fp) == names.size() &&
+	    fwrite(_gridId.data(), sizeof(int), _gridId.size(), fp) == _gridId.size() &&
+	    fwrite(_offset.data(), sizeof(int), _offset.size(), fp) == _offset.size() &&
+	    fwrite(_site.data(), sizeof(int), _site.size(), fp) == _site.size() &&
+	    fwrite(_dist.data(), sizeof(float), _dist.size(), fp) == _dist.size());
+
+  if (fclose(fp) != 0)
+    ok = 0;
+
+  if (!ok)
+    {
+      _errString = "Error writing " + path;
+      return -1;
+    }
+  return 0;
+}
+
+
+int GridSiteMap::read(const string &path)
+{
+  char magic[4];
+  int header[5];
+  FILE *fp;
+
+  _errString = "";
+  fp = fopen(path.c_str(), "rb");
+  if (fp == NULL)
+    {
+      _errString = "Unable to open " + path;
+      return -1;
+    }
+
+  if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, GSM_MAGIC, 4) != 0 ||
+      fread(header, sizeof(int), 5, fp) != 5)
+    {
+      _errString = path + " is not a grid site map file";
+      fclose(fp);
+      return -1;
+    }
+
+  if (header[0] != GRID_SITE_MAP_VERSION || header[1] < 0 || header[2] < 1 ||
+      header[3] < 0 || header[4] < 0)
+    {
+      _errString = path + ": unsupported version or bad header";
+      fclose(fp);
+      return -1;
+    }
+
+  int num_sites = header[1];
+  int name_len = header[2];
+  vector<char> names((size_t)num_sites * name_len);
+
+  _gridId.resize(header[3]);
+  _offset.resize(header[3] + 1);
+  _site.resize(header[4]);
+  _dist.resize(header[4]);
+
+  int ok = (fread(names.data(), 1, names.size(), fp) == names.size() &&
+	    fread(_gridId.data(), sizeof(int), _gridId.size(), fp) == _gridId.size() &&
+	    fread(_offset.data(), sizeof(int), _offset.size(), fp) == _offset.size() &&
+	    fread(_site.data(), sizeof(int), _site.size(), fp) == _site.size() &&
+	    fread(_dist.data(), sizeof(float), _dist.size(), fp) == _dist.size());
+  fclose(fp);
+
+  if (ok && (_offset[0] != 0 || _offset.back() != (int)_site.size()))
+    ok = 0;
+  for (size_t l = 0; ok && l < _site.size(); l++)
+    if (_site[l] < 0 || _site[l] >= num_sites)
+      ok = 0;
+
+  if (!ok)
+    {
+      _errString = path + " is truncated or corrupt";
+      _gridId.clear();
+      _offset.clear();
+      _site.clear();
+      _dist.clear();
+      return -1;
+    }
+
+  _siteName.resize(num_sites);
+  for (int s = 0; s < num_sites; s++)
+    _siteName[s] = string(&names[(size_t)s * name_len], strnlen(&names[(size_t)s * name_len], name_len));
+
+  return 0;
+}
+
+
+int GridSiteMap::write_json(const string &path, int grid_id_width)
+{
+  FILE *fp = fopen(path.c_str(), "w");
+  if (fp == NULL)
+    {
+      _errString = "Unable to open " + path + " for writing";
+      return -1;
+    }
+
+  fprintf(fp, "{");
+  for (int i = 0; i < num_grid(); i++)
+    {
+      fprintf(fp, "%s\"%0*d\": {\"ObsSites\": [", (i ? ", " : ""), grid_id_width, _gridId[i]);
+      for (int l = row_begin(i); l < row_end(i); l++)
+	fprintf(fp, "%s\"%s\"", (l > row_begin(i) ? ", " : ""), _siteName[_site[l]].c_str());
+      fprintf(fp, "], \"ObsDistance\": [");
+      for (int l = row_begin(i); l < row_end(i); l++)
+	fprintf(fp, "%s%.6f", (l > row_begin(i) ? ", " : ""), _dist[l]);
+      fprintf(fp, "]}");
+    }
+  fprintf(fp, "}");
+
+  if (fclose(fp) != 0)
+    {
+      _errString = "Error writing " + path;
+      return -1;
+    }
+  return 0;
+}
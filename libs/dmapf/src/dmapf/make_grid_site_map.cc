@@ -0,0 +1,221 @@
+//----------------------------------------------------------------------
+// Module: make_grid_site_map.cc
+//
+// Description:
+//     Builds the map from forecast grid points to the observation sites
+//     near them (grid_site_map). Reads a csv file of grid points and a csv
+//     file of sites, finds the sites within a radius of each grid point
+//     with a k-d tree, and writes the map as a binary grid site map file
+//     and optionally as json in the grid_site_map_40km.json format.
+//
+//     Both csv files have a header line. The first column is the id (grid
+//     id or station id); the latitude and longitude columns are the first
+//     whose names start with "lat" and "lon".
+//----------------------------------------------------------------------
+
+// Include files
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "../include/dmapf/sphere_kdtree.hh"
+#include "../include/dmapf/grid_site_map.hh"
+
+using namespace std;
+
+// Constant, macro and type definitions
+
+#define MAX_LINE 4096
+#define DEFAULT_RADIUS_KM 40.0
+
+// Functions and objects
+
+static void usage(char *prog)
+{
+  fprintf(stderr, "usage: %s [-r radius_km] [-k max_sites] [-j json_file] grid_file site_file out_file\n", prog);
+  fprintf(stderr, "  -r radius_km : sites within this distance of a grid point (default %g)\n", DEFAULT_RADIUS_KM);
+  fprintf(stderr, "  -k max_sites : keep at most this many sites per grid point, nearest first (default all)\n");
+  fprintf(stderr, "  -j json_file : also write the map as json\n");
+}
+
+// Splits a csv line in place
+static void split_csv(char *line, vector<char *> &fields)
+{
+  char *p = line;
+
+  fields.clear();
+  fields.push_back(p);
+  for (; *p; p++)
+    {
+      if (*p == ',')
+	{
+	  *p = '\0';
+	  fields.push_back(p + 1);
+	}
+      else if (*p == '\n' || *p == '\r')
+	*p = '\0';
+    }
+}
+
+static int starts_with_nocase(const char *s, const char *prefix)
+{
+  for (; *prefix; s++, prefix++)
+    if (tolower(*s) != *prefix)
+      return 0;
+  return 1;
+}
+
+// Reads id, lat and lon columns from a csv file. Returns 0 on success.
+static int read_locations(const char *file, vector<string> &ids, vector<double> &lats, vector<double> &lons)
+{
+  char line[MAX_LINE];
+  vector<char *> fields;
+  int lat_col = -1;
+  int lon_col = -1;
+  int line_num = 1;
+
+  FILE *fp = fopen(file, "r");
+  if (fp == NULL)
+    {
+      fprintf(stderr, "Error: could not open %s\n", file);
+      return 1;
+    }
+
+  if (fgets(line, MAX_LINE, fp) == NULL)
+    {
+      fprintf(stderr, "Error: %s is empty\n", file);
+      fclose(fp);
+      return 1;
+    }
+
+  split_csv(line, fields);
+  for (int i = 1; i < (int)fields.size(); i++)
+    {
+      if (lat_col < 0 && starts_with_nocase(fields[i], "lat"))
+	lat_col = i;
+      else if (lon_col < 0 && starts_with_nocase(fields[i], "lon"))
+	lon_col = i;
+    }
+
+  if (lat_col < 0 || lon_col < 0)
+    {
+      fprintf(stderr, "Error: no lat and lon columns in the header of %s\n", file);
+      fclose(fp);
+      return 1;
+    }
+
+  while (fgets(line, MAX_LINE, fp) != NULL)
+    {
+      line_num++;
+      split_csv(line, fields);
+      if (fields.size() == 1 && fields[0][0] == '\0')
+	continue;
+
+      char *end1, *end2;
+      if ((int)fields.size() <= lat_col || (int)fields.size() <= lon_col)
+	{
+	  fprintf(stderr, "Warning: skipping short line %d in %s\n", line_num, file);
+	  continue;
+	}
+
+      double lat = strtod(fields[lat_col], &end1);
+      double lon = strtod(fields[lon_col], &end2);
+      if (end1 == fields[lat_col] || end2 == fields[lon_col])
+	{
+	  fprintf(stderr, "Warning: skipping bad location on line %d in %s\n", line_num, file);
+	  continue;
+	}
+
+      ids.push_back(fields[0]);
+      lats.push_back(lat);
+      lons.push_back(lon);
+    }
+
+  fclose(fp);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  double radius_km = DEFAULT_RADIUS_KM;
+  int max_sites = 0;
+  char *json_file = NULL;
+  int c;
+
+  while ((c = getopt(argc, argv, "r:k:j:")) != EOF)
+    {
+      switch (c)
+	{
+	case 'r':
+	  radius_km = atof(optarg);
+	  break;
+	case 'k':
+	  max_sites = atoi(optarg);
+	  break;
+	case 'j':
+	  json_file = optarg;
+	  break;
+	default:
+	  usage(argv[0]);
+	  return 2;
+	}
+    }
+
+  if (argc - optind < 3 || radius_km <= 0)
+    {
+      usage(argv[0]);
+      return 2;
+    }
+
+  char *grid_file = argv[optind];
+  char *site_file = argv[optind + 1];
+  char *out_file = argv[optind + 2];
+
+  vector<string> grid_names, sites;
+  vector<double> grid_lats, grid_lons, site_lats, site_lons;
+
+  if (read_locations(grid_file, grid_names, grid_lats, grid_lons) != 0 ||
+      read_locations(site_file, sites, site_lats, site_lons) != 0)
+    return 1;
+
+  // Grid ids are stored as integers; the json output zero pads them
+  // back to the width used in the grid file
+  vector<int> grid_ids(grid_names.size());
+  int id_width = 1;
+  for (size_t i = 0; i < grid_names.size(); i++)
+    {
+      char *end;
+      grid_ids[i] = (int)strtol(grid_names[i].c_str(), &end, 10);
+      if (end == grid_names[i].c_str() || *end != '\0')
+	{
+	  fprintf(stderr, "Error: grid id %s in %s is not an integer\n", grid_names[i].c_str(), grid_file);
+	  return 1;
+	}
+      if ((int)grid_names[i].size() > id_width)
+	id_width = (int)grid_names[i].size();
+    }
+
+  SphereKdTree tree(site_lats, site_lons);
+  GridSiteMap gsm;
+  gsm.build(grid_ids, grid_lats, grid_lons, sites, tree, radius_km, max_sites);
+
+  printf("%d grid points, %d sites: %d grid points with sites within %g km, %d links\n",
+	 (int)grid_ids.size(), tree.size(), gsm.num_grid(), radius_km, gsm.num_links());
+
+  if (gsm.write(out_file) != 0)
+    {
+      fprintf(stderr, "Error: %s\n", gsm.error().c_str());
+      return 1;
+    }
+
+  if (json_file != NULL && gsm.write_json(json_file, id_width) != 0)
+    {
+      fprintf(stderr, "Error: %s\n", gsm.error().c_str());
+      return 1;
+    }
+
+  return 0;
+}
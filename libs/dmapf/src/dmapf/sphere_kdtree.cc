@@ -0,0 +1,251 @@
+/*
+ *   Module: sphere_kdtree.cc
+ *
+ *   Description: k-d tree over points on the earth, for nearest
+ *   neighbor and radius searches. See sphere_kdtree.hh.
+ *
+ *   The tree is implicit: the points are permuted so that in any range
+ *   [lo,hi) the point at the median position (lo+hi)/2 splits the range
+ *   on its split dimension, with smaller coordinates before it and
+ *   larger after. Small ranges are scanned directly.
+ *
+ */
+
+#include <math.h>
+#include <algorithm>
+#include "../include/dmapf/sphere_kdtree.hh"
+
+// Ranges this small are scanned rather than split
+#define KD_LEAF_SIZE 8
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+#define KD_RADPDEG (M_PI/180.)
+
+static void ll_unit(double lat, double lon, double *v)
+{
+  double clat = cos(lat * KD_RADPDEG);
+  v[0] = clat * cos(lon * KD_RADPDEG);
+  v[1] = clat * sin(lon * KD_RADPDEG);
+  v[2] = sin(lat * KD_RADPDEG);
+}
+
+static inline double dist_sq(const double *a, const double *b)
+{
+  double dx = a[0] - b[0];
+  double dy = a[1] - b[1];
+  double dz = a[2] - b[2];
+  return dx*dx + dy*dy + dz*dz;
+}
+
+// Orders point indices on one coordinate, for nth_element
+struct KdLess
+{
+  const double *xyz;
+  int dim;
+  KdLess(const double *x, int d) : xyz(x), dim(d) {}
+  bool operator()(int a, int b) const {return xyz[3*a+dim] < xyz[3*b+dim];}
+};
+
+
+SphereKdTree::SphereKdTree(const vector<double> &lat, const vector<double> &lon, double earth_radius)
+  : _lat(lat), _lon(lon), _erad(earth_radius)
+{
+  int n = (int)lat.size();
+
+  _xyz.resize(3*n);
+  _perm.resize(n);
+  _dim.assign(n, 0);
+
+  for (int i = 0; i < n; i++)
+    {
+      ll_unit(lat[i], lon[i], &_xyz[3*i]);
+      _perm[i] = i;
+    }
+
+  build(0, n);
+}
+
+
+// Splits [lo,hi) at its median on the dimension of largest spread,
+// then splits each half in turn
+void SphereKdTree::build(int lo, int hi)
+{
+  if (hi - lo <= KD_LEAF_SIZE)
+    return;
+
+  double vmin[3], vmax[3];
+  for (int d = 0; d < 3; d++)
+    {
+      vmin[d] = 2.;
+      vmax[d] = -2.;
+    }
+
+  for (int i = lo; i < hi; i++)
+    {
+      const double *p = &_xyz[3*_perm[i]];
+      for (int d = 0; d < 3; d++)
+	{
+	  if (p[d] < vmin[d]) vmin[d] = p[d];
+	  if (p[d] > vmax[d]) vmax[d] = p[d];
+	}
+    }
+
+  int dim = 0;
+  for (int d = 1; d < 3; d++)
+    if (vmax[d] - vmin[d] > vmax[dim] - vmin[dim])
+      dim = d;
+
+  int mid = (lo + hi) / 2;
+  nth_element(_perm.begin() + lo, _perm.begin() + mid, _perm.begin() + hi, KdLess(&_xyz[0], dim));
+  _dim[mid] = (char)dim;
+
+  build(lo, mid);
+  build(mid + 1, hi);
+}
+
+
+// Adds the points in [lo,hi) closer than *bound (squared chord) to best,
+// a max-heap on distance. With k > 0 only the k closest are kept, and
+// *bound shrinks to the k-th distance once best is full.
+void SphereKdTree::search(const double *q, int lo, int hi, int k, double *bound, vector<pair<double, int> > &best) const
+{
+  if (hi - lo <= KD_LEAF_SIZE)
+    {
+      for (int i = lo; i < hi; i++)
+	{
+	  int p = _perm[i];
+	  double d2 = dist_sq(q, &_xyz[3*p]);
+	  if (d2 > *bound)
+	    continue;
+
+	  best.push_back(make_pair(d2, p));
+	  push_heap(best.begin(), best.end());
+	  if (k > 0 && (int)best.size() > k)
+	    {
+	      pop_heap(best.begin(), best.end());
+	      best.pop_back();
+	    }
+	  if (k > 0 && (int)best.size() == k)
+	    *bound = best.front().first;
+	}
+      return;
+    }
+
+  int mid = (lo + hi) / 2;
+  int p = _perm[mid];
+  double diff = q[(int)_dim[mid]] - _xyz[3*p + _dim[mid]];
+
+  // Nearer side first, so the bound is as small as possible
+  // before deciding on the far side
+  if (diff < 0)
+    search(q, lo, mid, k, bound, best);
+  else
+    search(q, mid + 1, hi, k, bound, best);
+
+  search(q, mid, mid + 1, k, bound, best);
+
+  if (diff * diff <= *bound)
+    {
+      if (diff < 0)
+	search(q, mid + 1, hi, k, bound, best);
+      else
+	search(q, lo, mid, k, bound, best);
+    }
+}
+
+
+// Sorts the found points nearest first and converts to km
+void SphereKdTree::finish(double lat, double lon, vector<pair<double, int> > &best, vector<int> &index, vector<double> &dist_km) const
+{
+  sort_heap(best.begin(), best.end());
+
+  index.resize(best.size());
+  dist_km.resize(best.size());
+  for (size_t i = 0; i < best.size(); i++)
+    {
+      int p = best[i].second;
+      index[i] = p;
+      dist_km[i] = haversine(lat, lon, _lat[p], _lon[p]);
+    }
+}
+
+
+// Squared chord length of an arc of km along the surface
+double SphereKdTree::chord_sq(double km) const
+{
+  double half = km / (2. * _erad);
+  if (half >= M_PI / 2.)
+    return 4.;
+
+  double c = 2. * sin(half);
+  // Allow for rounding so points right at the limit are kept;
+  // callers check the haversine distance
+  return c * c * (1. + 1.e-9) + 1.e-15;
+}
+
+
+int SphereKdTree::nearest(double lat, double lon, int k, vector<int> &index, vector<double> &dist_km, double max_km) const
+{
+  vector<pair<double, int> > best;
+  double q[3];
+  double bound = (max_km < 0 ? 5. : chord_sq(max_km));
+
+  index.clear();
+  dist_km.clear();
+  if (k <= 0 || size() == 0)
+    return 0;
+
+  best.reserve(k + 1);
+  ll_unit(lat, lon, q);
+  search(q, 0, size(), k, &bound, best);
+  finish(lat, lon, best, index, dist_km);
+
+  if (max_km >= 0)
+    {
+      while (!dist_km.empty() && dist_km.back() > max_km)
+	{
+	  dist_km.pop_back();
+	  index.pop_back();
+	}
+    }
+
+  return (int)index.size();
+}
+
+
+int SphereKdTree::within(double lat, double lon, double radius_km, vector<int> &index, vector<double> &dist_km) const
+{
+  vector<pair<double, int> > best;
+  double q[3];
+  double bound = chord_sq(radius_km);
+
+  index.clear();
+  dist_km.clear();
+  if (radius_km < 0 || size() == 0)
+    return 0;
+
+  ll_unit(lat, lon, q);
+  search(q, 0, size(), 0, &bound, best);
+  finish(lat, lon, best, index, dist_km);
+
+  while (!dist_km.empty() && dist_km.back() > radius_km)
+    {
+      dist_km.pop_back();
+      index.pop_back();
+    }
+
+  return (int)index.size();
+}
+
+
+double SphereKdTree::haversine(double lat1, double lon1, double lat2, double lon2) const
+{
+  double slat = sin((lat2 - lat1) * KD_RADPDEG / 2.);
+  double slon = sin((lon2 - lon1) * KD_RADPDEG / 2.);
+  double a = slat * slat + cos(lat1 * KD_RADPDEG) * cos(lat2 * KD_RADPDEG) * slon * slon;
+  if (a > 1.)
+    a = 1.;
+  return 2. * _erad * asin(sqrt(a));
+}
@@ -0,0 +1,169 @@
+/*
+ * Checks the array routines cll2xy_n, cxy2ll_n and cgszll_n against the
+ * single point routines for a set of projections.  Prints the largest
+ * differences and the timings, and exits non-zero if any difference is
+ * beyond tolerance.
+ *
+ * Compile with   gcc -O2 -I../include test_cmapf_n.c ../libdmapf.a -lm
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <dmapf/cmapf.h>
+
+#define XY_TOL 1.e-7	/* grid units, scaled up for distant points */
+#define LL_TOL 1.e-9	/* degrees */
+#define GSZ_TOL 1.e-10	/* relative */
+
+static double lon_diff(double a, double b) {
+double d = fmod(a - b, 360.);
+  if (d > 180.) d -= 360.;
+  if (d < -180.) d += 360.;
+  return fabs(d);
+}
+
+static double now() {
+  return (double) clock() / CLOCKS_PER_SEC;
+}
+
+/*
+ * Compares the routines over a lat-lon lattice covering the globe,
+ * including the poles and the dateline, and over the x-y points that
+ * lattice maps to.  Returns the number of failures.
+ */
+static int check(const char * name, maparam * stcprm) {
+int nlat = 181, nlon = 361, npts = nlat * nlon;
+double * lat = malloc(npts * sizeof(double));
+double * lon = malloc(npts * sizeof(double));
+double * x = malloc(npts * sizeof(double));
+double * y = malloc(npts * sizeof(double));
+double * xn = malloc(npts * sizeof(double));
+double * yn = malloc(npts * sizeof(double));
+double * latn = malloc(npts * sizeof(double));
+double * lonn = malloc(npts * sizeof(double));
+double * gsz = malloc(npts * sizeof(double));
+double * gszn = malloc(npts * sizeof(double));
+double xy_err = 0., ll_err = 0., gsz_err = 0.;
+double t0,t1,t2;
+int i,j,k,nfail = 0;
+  for (i=0,k=0;i<nlat;i++) for (j=0;j<nlon;j++,k++) {
+    lat[k] = -90. + i;
+    lon[k] = -180. + j + .25 * (i % 4);
+  }
+
+  t0 = now();
+  for (k=0;k<npts;k++) cll2xy(stcprm, lat[k],lon[k], &x[k],&y[k]);
+  t1 = now();
+  cll2xy_n(stcprm, lat,lon, xn,yn, npts);
+  t2 = now();
+  printf("%-22s cll2xy %6.3fs  cll2xy_n %6.3fs\n", name, t1-t0, t2-t1);
+  for (k=0;k<npts;k++) {
+    double tol = XY_TOL * (1. + fabs(x[k]) + fabs(y[k]));
+    double e = fabs(xn[k] - x[k]) + fabs(yn[k] - y[k]);
+    if (!(e <= tol)) {
+      if (nfail++ < 10)
+	printf("  cll2xy_n (%g,%g): %.12g,%.12g vs %.12g,%.12g\n",
+	       lat[k],lon[k], xn[k],yn[k], x[k],y[k]);
+    } else if (e / (1. + fabs(x[k]) + fabs(y[k])) > xy_err)
+      xy_err = e / (1. + fabs(x[k]) + fabs(y[k]));
+  }
+
+  t0 = now();
+  for (k=0;k<npts;k++) cxy2ll(stcprm, x[k],y[k], &latn[k],&lonn[k]);
+  t1 = now();
+  cxy2ll_n(stcprm, x,y, lat,lon, npts);
+  t2 = now();
+  printf("%-22s cxy2ll %6.3fs  cxy2ll_n %6.3fs\n", "", t1-t0, t2-t1);
+  for (k=0;k<npts;k++) {
+    double e = fabs(lat[k] - latn[k]);
+    if (fabs(latn[k]) < 90. - 1.e-6) e += lon_diff(lon[k], lonn[k]);
+    if (!(e <= LL_TOL)) {
+      if (nfail++ < 10)
+	printf("  cxy2ll_n (%g,%g): %.12g,%.12g vs %.12g,%.12g\n",
+	       x[k],y[k], lat[k],lon[k], latn[k],lonn[k]);
+    } else if (e > ll_err) ll_err = e;
+  }
+
+  t0 = now();
+  for (k=0;k<npts;k++) gsz[k] = cgszll(stcprm, lat[k],lon[k]);
+  t1 = now();
+  cgszll_n(stcprm, lat,lon, gszn, npts);
+  t2 = now();
+  printf("%-22s cgszll %6.3fs  cgszll_n %6.3fs\n", "", t1-t0, t2-t1);
+  for (k=0;k<npts;k++) {
+    double e = fabs(gszn[k] - gsz[k]) / (fabs(gsz[k]) > 1. ? fabs(gsz[k]) : 1.);
+    if (!(e <= GSZ_TOL)) {
+      if (nfail++ < 10)
+	printf("  cgszll_n (%g,%g): %.12g vs %.12g\n",
+	       lat[k],lon[k], gszn[k],gsz[k]);
+    } else if (e > gsz_err) gsz_err = e;
+  }
+
+  printf("%-22s max err: xy %.2e (rel)  ll %.2e deg  gsz %.2e (rel)  %s\n",
+	 "", xy_err, ll_err, gsz_err, nfail ? "FAILED" : "ok");
+
+  free(lat); free(lon); free(x); free(y); free(xn); free(yn);
+  free(latn); free(lonn); free(gsz); free(gszn);
+  return nfail;
+}
+
+int main() {
+maparam stcprm;
+int nfail = 0;
+
+/* HRRR 3 km Lambert conformal, set up as in grib2site */
+  stlmbr(&stcprm, eqvlat(38.5, 38.5), -97.5);
+  stcm1p(&stcprm, 0., 0., 21.138123, -122.719528, 38.5, -97.5, 3., 0.);
+  nfail += check("Lambert (HRRR)", &stcprm);
+
+/* Lambert with two reference latitudes and a rotated grid */
+  stlmbr(&stcprm, eqvlat(25., 50.), 10.);
+  stcm2p(&stcprm, 0., 0., 30., -5., 100., 80., 55., 30.);
+  nfail += check("Lambert (2 ref lats)", &stcprm);
+
+/* North polar stereographic, set up as in grib2site */
+  sobstr(&stcprm, 90., 0.);
+  stcm1p(&stcprm, 0., 0., 30., -170., 60., -150., 6., 0.);
+  nfail += check("Polar stereographic N", &stcprm);
+
+/* South polar stereographic */
+  sobstr(&stcprm, -90., 0.);
+  stcm1p(&stcprm, 0., 0., -50., 20., -60., 0., 25., 0.);
+  nfail += check("Polar stereographic S", &stcprm);
+
+/* Mercator */
+  stcmap(&stcprm, 0., -60.);
+  stcm1p(&stcprm, 0., 0., -20., -100., 20., -60., 12., 0.);
+  nfail += check("Mercator", &stcprm);
+
+/* Transverse Mercator */
+  stvmrc(&stcprm, 40., -105.);
+  stcm1p(&stcprm, 50., 50., 40., -105., 40., -105., 10., 0.);
+  nfail += check("Transverse Mercator", &stcprm);
+
+/* Oblique stereographic */
+  sobstr(&stcprm, 40., -100.);
+  stcm1p(&stcprm, 0., 0., 20., -130., 40., -100., 20., 0.);
+  nfail += check("Oblique stereographic", &stcprm);
+
+/* Oblique Mercator */
+  sobmrc(&stcprm, 45., -90., 30., -60.);
+  stcm1p(&stcprm, 0., 0., 45., -90., 45., -90., 15., 0.);
+  nfail += check("Oblique Mercator", &stcprm);
+
+/* Oblique Lambert */
+  soblmbr(&stcprm, 45., -90., 35., -100., 55., -80.);
+  stcm1p(&stcprm, 0., 0., 45., -90., 45., -90., 15., 0.);
+  nfail += check("Oblique Lambert", &stcprm);
+
+/* Nearly Mercator Lambert, handled by the single point routines */
+  stlmbr(&stcprm, .1, 0.);
+  stcm1p(&stcprm, 0., 0., 0., 0., .1, 0., 10., 0.);
+  nfail += check("Lambert (near Mercator)", &stcprm);
+
+  if (nfail) {
+    printf("%d failures\n", nfail);
+    return 1;
+  }
+  return 0;
+}
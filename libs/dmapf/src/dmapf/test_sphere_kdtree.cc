@@ -0,0 +1,170 @@
+//----------------------------------------------------------------------
+// Module: test_sphere_kdtree.cc
+//
+// Description:
+//     Checks SphereKdTree nearest and radius searches against a brute
+//     force search over random points, including points near the poles
+//     and the dateline, and checks the grid site map binary file round
+//     trip. Exits non-zero on failure.
+//----------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../include/dmapf/sphere_kdtree.hh"
+#include "../include/dmapf/grid_site_map.hh"
+
+using namespace std;
+
+static double rand_range(double lo, double hi)
+{
+  return lo + (hi - lo) * rand() / (double)RAND_MAX;
+}
+
+// Brute force distances, nearest first
+static void brute(const SphereKdTree &tree, const vector<double> &lat, const vector<double> &lon,
+		  double qlat, double qlon, vector<pair<double, int> > &all)
+{
+  all.clear();
+  for (size_t i = 0; i < lat.size(); i++)
+    all.push_back(make_pair(tree.haversine(qlat, qlon, lat[i], lon[i]), (int)i));
+  sort(all.begin(), all.end());
+}
+
+static int check_points(const char *name, const vector<double> &lat, const vector<double> &lon, int nquery)
+{
+  SphereKdTree tree(lat, lon);
+  vector<pair<double, int> > all;
+  vector<int> index;
+  vector<double> dist;
+  int nfail = 0;
+
+  for (int q = 0; q < nquery; q++)
+    {
+      double qlat = rand_range(-90., 90.);
+      double qlon = rand_range(-180., 180.);
+      if (q % 4 == 0)
+	qlat = rand_range(80., 90.);
+      if (q % 4 == 1)
+	qlon = rand_range(175., 185.);
+
+      brute(tree, lat, lon, qlat, qlon, all);
+
+      int k = 1 + q % 10;
+      int n = tree.nearest(qlat, qlon, k, index, dist);
+      for (int i = 0; i < n; i++)
+	if (fabs(dist[i] - all[i].first) > 1.e-6)
+	  nfail++;
+      if (n != k)
+	nfail++;
+
+      double radius = rand_range(10., 2000.);
+      int m = 0;
+      while (m < (int)all.size() && all[m].first <= radius)
+	m++;
+      n = tree.within(qlat, qlon, radius, index, dist);
+      if (n != m)
+	nfail++;
+      for (int i = 0; i < n && i < m; i++)
+	if (fabs(dist[i] - all[i].first) > 1.e-6)
+	  nfail++;
+
+      n = tree.nearest(qlat, qlon, 3, index, dist, radius);
+      if (n != (m < 3 ? m : 3))
+	nfail++;
+    }
+
+  printf("%-24s %6d points %5d queries  %s\n", name, (int)lat.size(), nquery, nfail ? "FAILED" : "ok");
+  return nfail;
+}
+
+static int check_map_file()
+{
+  vector<double> slat, slon, glat, glon;
+  vector<string> names;
+  vector<int> ids;
+  char name[16];
+
+  for (int i = 0; i < 200; i++)
+    {
+      slat.push_back(rand_range(40., 45.));
+      slon.push_back(rand_range(-80., -72.));
+      sprintf(name, "S%03d", i);
+      names.push_back(name);
+    }
+  for (int i = 0; i < 5000; i++)
+    {
+      glat.push_back(rand_range(39., 46.));
+      glon.push_back(rand_range(-81., -71.));
+      ids.push_back(4999 - i);
+    }
+
+  SphereKdTree tree(slat, slon);
+  GridSiteMap out, in;
+  out.build(ids, glat, glon, names, tree, 40., 9);
+
+  const char *path = "test_sphere_kdtree.gsm";
+  if (out.write(path) != 0 || in.read(path) != 0)
+    {
+      printf("grid site map file: %s%s FAILED\n", out.error().c_str(), in.error().c_str());
+      return 1;
+    }
+  remove(path);
+
+  int nfail = (in.num_grid() != out.num_grid() || in.num_links() != out.num_links());
+  for (int i = 0; !nfail && i < in.num_grid(); i++)
+    {
+      if (in.grid_id(i) != out.grid_id(i) || in.row_end(i) != out.row_end(i) ||
+	  in.find(in.grid_id(i)) != i)
+	nfail++;
+      for (int l = in.row_begin(i); l < in.row_end(i); l++)
+	if (in.site_name(in.site(l)) != names[out.site(l)] || in.dist(l) != out.dist(l) ||
+	    in.dist(l) > 40. || (l > in.row_begin(i) && in.dist(l) < in.dist(l-1)))
+	  nfail++;
+    }
+
+  printf("%-24s %6d grid points %5d links  %s\n", "grid site map file", in.num_grid(), in.num_links(), nfail ? "FAILED" : "ok");
+  return nfail;
+}
+
+int main()
+{
+  vector<double> lat, lon;
+  int nfail = 0;
+
+  srand(17);
+
+  for (int i = 0; i < 20000; i++)
+    {
+      lat.push_back(asin(rand_range(-1., 1.)) * 180. / M_PI);
+      lon.push_back(rand_range(-180., 180.));
+    }
+  nfail += check_points("global", lat, lon, 2000);
+
+  // Clustered, as for a state mesonet, with duplicate locations
+  lat.clear();
+  lon.clear();
+  for (int i = 0; i < 500; i++)
+    {
+      lat.push_back(rand_range(40.5, 45.));
+      lon.push_back(rand_range(-79.8, -71.8));
+      if (i % 50 == 0)
+	{
+	  lat.push_back(lat.back());
+	  lon.push_back(lon.back());
+	}
+    }
+  nfail += check_points("clustered", lat, lon, 2000);
+
+  nfail += check_map_file();
+
+  if (nfail)
+    {
+      printf("%d failures\n", nfail);
+      return 1;
+    }
+  return 0;
+}
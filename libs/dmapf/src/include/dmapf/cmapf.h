@@ -1,6 +1,7 @@
 #ifndef CMAPF_H
 #define CMAPF_H
 #include <math.h>
+#include <stddef.h>
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
@@ -79,6 +80,14 @@ void cll2xy(const maparam * stcprm,double lat,double longit,
 void cxy2ll(const maparam * stcprm,double x,double y,
 				double * lat,double * longit ) ;
 
+/* Array versions of cll2xy and cxy2ll, converting npts points per call.
+ * Results agree with the single point routines to within roundoff.
+ */
+void cll2xy_n(const maparam * stcprm, const double lat[],
+	      const double longit[], double x[], double y[], size_t npts) ;
+void cxy2ll_n(const maparam * stcprm, const double x[], const double y[],
+	      double lat[], double longit[], size_t npts) ;
+
 /* Internal routines to move back and forth among the various coordinate
  * systems: user-accessible lat-long, 3d geographic vectors, 3d map-oriented
  * coordinates, canonical two-dimensional map coordinates (xi,eta), and
@@ -127,6 +136,9 @@ void cw2gll(maparam * stcprm,double latit,double longit,
  */
 double cgszxy(maparam * stcprm,double x,double y) ;
 double cgszll(maparam * stcprm,double lat,double longit) ;
+/* Array version of cgszll */
+void cgszll_n(const maparam * stcprm, const double lat[],
+	      const double longit[], double gsz[], size_t npts) ;
 
 void cgrnxy(maparam * stcprm,double x, double y,
 		double * enx,double * eny, double * enz) ;
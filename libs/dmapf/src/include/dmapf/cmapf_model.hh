@@ -51,6 +51,10 @@ public:
   int ll2xy(float lat, float longit, float *x, float *y);
   int xy2ll(float x, float y, float *lat, float *longit);
 
+  // Converts n lat,lon pairs to x,y. Returns the number of points that
+  // are off the grid.
+  int ll2xy(const double *lat, const double *longit, double *x, double *y, size_t n);
+
 private:
 
   void clear() {_errString = "";};
@@ -0,0 +1,80 @@
+/*
+ *   Module: grid_site_map.hh
+ *
+ *   Description: Map from grid points to the observation sites near
+ *   them, with distances, as used to blend gridded forecasts with site
+ *   forecasts. Holds the same information as the grid_site_map json
+ *   files (per grid point "ObsSites" and "ObsDistance", nearest first)
+ *   in compressed sparse row form: grid point g has links
+ *   offset[g] .. offset[g+1]-1 into site[] and dist[].
+ *
+ *   The binary file is the arrays written in native byte order after a
+ *   small header:
+ *     char  magic[4]   "GSMP"
+ *     int   version, num_sites, name_len, num_grid, num_links
+ *     char  names[num_sites][name_len]   (nul padded)
+ *     int   grid_id[num_grid]
+ *     int   offset[num_grid+1]
+ *     int   site[num_links]
+ *     float dist[num_links]               (km)
+ *
+ */
+
+#ifndef GRID_SITE_MAP_HH
+#define GRID_SITE_MAP_HH
+
+#include <string>
+#include <vector>
+#include "sphere_kdtree.hh"
+
+using namespace std;
+
+#define GRID_SITE_MAP_VERSION 1
+
+class GridSiteMap
+{
+public:
+
+  GridSiteMap() {};
+  ~GridSiteMap() {};
+
+  // Builds the map: each grid point gets the sites within radius_km,
+  // at most max_sites of them (all if max_sites <= 0). Grid points with
+  // no site in range are left out.
+  void build(const vector<int> &grid_id, const vector<double> &grid_lat, const vector<double> &grid_lon,
+	     const vector<string> &site_name, const SphereKdTree &sites, double radius_km, int max_sites);
+
+  // Binary file i/o. Return 0 on success, -1 on error with error()
+  // describing the problem.
+  int write(const string &path);
+  int read(const string &path);
+
+  // Writes the map in the grid_site_map json format
+  int write_json(const string &path, int grid_id_width = 7);
+
+  inline int num_grid() const {return (int)_gridId.size();}
+  inline int num_links() const {return (int)_site.size();}
+  inline const string &error() const {return _errString;}
+
+  // Row access: links of the i-th grid point in the map
+  inline int grid_id(int i) const {return _gridId[i];}
+  inline int row_begin(int i) const {return _offset[i];}
+  inline int row_end(int i) const {return _offset[i+1];}
+  inline int site(int l) const {return _site[l];}
+  inline float dist(int l) const {return _dist[l];}
+  inline const string &site_name(int s) const {return _siteName[s];}
+
+  // Row of a grid id, or -1 if the grid point has no sites
+  int find(int grid_id) const;
+
+private:
+
+  vector<string> _siteName;
+  vector<int> _gridId;		// ascending
+  vector<int> _offset;
+  vector<int> _site;
+  vector<float> _dist;
+  string _errString;
+};
+
+#endif /* GRID_SITE_MAP_HH */
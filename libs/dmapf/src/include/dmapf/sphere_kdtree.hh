@@ -0,0 +1,58 @@
+/*
+ *   Module: sphere_kdtree.hh
+ *
+ *   Description: k-d tree over points on the earth, for nearest
+ *   neighbor and radius searches such as matching grid points to
+ *   observation sites. Points are kept as 3-d unit vectors, so that
+ *   straight line (chord) distance orders points the same way as great
+ *   circle distance. Distances returned are haversine distances in km.
+ *
+ */
+
+#ifndef SPHERE_KDTREE_HH
+#define SPHERE_KDTREE_HH
+
+#include <vector>
+
+using namespace std;
+
+// Mean earth radius (km), as used for the grid to site maps
+#define SPHERE_EARTH_RADIUS 6371.0
+
+class SphereKdTree
+{
+public:
+
+  SphereKdTree(const vector<double> &lat, const vector<double> &lon, double earth_radius = SPHERE_EARTH_RADIUS);
+  ~SphereKdTree() {};
+
+  // Number of points in the tree
+  inline int size() const {return (int)_perm.size();}
+
+  // Finds the k points nearest lat,lon, optionally no further than
+  // max_km. Indices (into the lat/lon vectors given to the constructor)
+  // and distances are returned nearest first. Returns the number found.
+  int nearest(double lat, double lon, int k, vector<int> &index, vector<double> &dist_km, double max_km = -1) const;
+
+  // Finds all points within radius_km of lat,lon, nearest first.
+  // Returns the number found.
+  int within(double lat, double lon, double radius_km, vector<int> &index, vector<double> &dist_km) const;
+
+  // Great circle distance (km) between two points
+  double haversine(double lat1, double lon1, double lat2, double lon2) const;
+
+private:
+
+  void build(int lo, int hi);
+  void search(const double *q, int lo, int hi, int k, double *bound, vector<pair<double, int> > &best) const;
+  void finish(double lat, double lon, vector<pair<double, int> > &best, vector<int> &index, vector<double> &dist_km) const;
+  double chord_sq(double km) const;
+
+  vector<double> _lat, _lon;	// point locations (degrees)
+  vector<double> _xyz;		// unit vectors, 3 per point
+  vector<int> _perm;		// point order; each range's median splits it
+  vector<char> _dim;		// split dimension, indexed by median position
+  double _erad;
+};
+
+#endif /* SPHERE_KDTREE_HH */
@@ -16,8 +16,11 @@ solution "dmapf"
       targetdir(dmapf_lib_dir)
       files {
     "dmapf/cmapf_model.cc",
+    "dmapf/grid_site_map.cc",
+    "dmapf/sphere_kdtree.cc",
     "dmapf/basegm.c",
     "dmapf/cmapf.c",
+    "dmapf/cmapf_n.c",
     "dmapf/eqvlat.c",
     "dmapf/geog_ll.c",
     "dmapf/kcllxy.c",
@@ -37,7 +40,9 @@ solution "dmapf"
     "dmapf/vector_3.c",
     "include/dmapf/cmapf.h",
     "include/dmapf/cmapf_model.hh",
+    "include/dmapf/grid_site_map.hh",
     "include/dmapf/limmath.h",
+    "include/dmapf/sphere_kdtree.hh",
     "include/dmapf/vector_3.h"
  }
  
@@ -21,6 +21,7 @@
 #include <cstdarg>
 #include <cstdio>
 #include <ctime>
+#include <pthread.h>
 using namespace std;
 
 const int LOG_MAX_LINE = 2048;
@@ -100,6 +101,7 @@ public:
 
 private:
   int basic_write(const char *fmt, int time_flag, int dl, va_list ap);
+  int locked_write(const char *fmt, int time_flag, va_list ap);
   int debug_low;
   int debug_high;
   const char *err_string;
@@ -107,6 +109,7 @@ private:
   struct tm last_tms;
   char path[LOG_MAX_PATH+LOG_DATE_LEN];
   int path_len;
+  pthread_mutex_t lock;	/** serializes writes from several threads */
 };
 
 
@@ -34,6 +34,7 @@ Log::Log()
 
   /* initialize last_tms.tm_mday to impossible value */
   last_tms.tm_mday = -1;
+  pthread_mutex_init(&lock, NULL);
 }
 
 Log::Log(const char *base_name)
@@ -54,6 +55,7 @@ Log::Log(const char *base_name)
 
   /* initialize last_tms.tm_mday to impossible value */
   last_tms.tm_mday = -1;
+  pthread_mutex_init(&lock, NULL);
 }
 
 Log::Log(const Log &log)	/* copy constructor */
@@ -65,6 +67,7 @@ Log::Log(const Log &log)	/* copy constructor */
   last_tms = log.last_tms;
   strcpy(path, log.path);
   path_len = log.path_len;
+  pthread_mutex_init(&lock, NULL);
 }
 
 /* assignment operator */
@@ -93,62 +96,78 @@ Log::~Log()
 {
   if (fp != NULL)
     fclose(fp);
+  pthread_mutex_destroy(&lock);
 }
 
+/*
+ * Writes are serialized so that threads sharing a log neither interleave
+ * lines nor race on the daily file switch
+ */
 int Log::basic_write(const char *fmt, int time_flag, int dl, va_list ap)
+{
+  int ret;
+
+  if (debug_low <= dl && dl <= debug_high)
+    {
+      pthread_mutex_lock(&lock);
+      ret = locked_write(fmt, time_flag, ap);
+      pthread_mutex_unlock(&lock);
+      return(ret);
+    }
+
+  return(0);
+}
+
+int Log::locked_write(const char *fmt, int time_flag, va_list ap)
 {
   char buf[LOG_MAX_LINE+LOG_TIME_LEN];
   time_t curr_time;
   int ret;
+  struct tm tms;
   struct tm *ptms;
 
-  if (debug_low <= dl && dl <= debug_high)
-    {
-      /* get time */
-      time(&curr_time);
+  /* get time */
+  time(&curr_time);
 
-      /* convert to UTC */
-      ptms = gmtime(&curr_time);
+  /* convert to UTC */
+  ptms = gmtime_r(&curr_time, &tms);
 
-      if (path[0] == '\0')
-	fp = stdout;
-      else
+  if (path[0] == '\0')
+    fp = stdout;
+  else
+    {
+      /* close out old file and open new one if necessary */
+      if (fp == NULL || ptms->tm_mday != last_tms.tm_mday)
 	{
-	  /* close out old file and open new one if necessary */
-	  if (fp == NULL || ptms->tm_mday != last_tms.tm_mday)
-	    {
-	      if (fp != NULL)
-		fclose(fp);
-
-	      /* set year/month/day string */
-	      sprintf(&path[path_len], ".%d%.2d%.2d.asc", ptms->tm_year + 1900, ptms->tm_mon + 1, ptms->tm_mday);
-
-	      fp = fopen(path, "a");
-	      if (fp == NULL)
-		return(-1);
-	      last_tms = *ptms;
-	    }
-	}
+	  if (fp != NULL)
+	    fclose(fp);
 
-      /* fp cannot be NULL at this point */
-      if (time_flag)
-	{
-	  sprintf(buf, "%02d:%02d:%02d ", ptms->tm_hour, ptms->tm_min, ptms->tm_sec);
-	  ret = vsnprintf(&buf[LOG_TIME_LEN], LOG_MAX_LINE, fmt, ap);
-	  // Not safe ret = vsprintf(&buf[LOG_TIME_LEN], fmt, ap);
-	}
-      else
-	{
-	  ret = vsnprintf(buf, LOG_MAX_LINE, fmt, ap);
-	  // Not safe ret = vsprintf(buf, fmt, ap);
+	  /* set year/month/day string */
+	  sprintf(&path[path_len], ".%d%.2d%.2d.asc", ptms->tm_year + 1900, ptms->tm_mon + 1, ptms->tm_mday);
+
+	  fp = fopen(path, "a");
+	  if (fp == NULL)
+	    return(-1);
+	  last_tms = *ptms;
 	}
+    }
 
-      fputs(buf, fp);
-      fflush(fp);
-      return(ret);
+  /* fp cannot be NULL at this point */
+  if (time_flag)
+    {
+      sprintf(buf, "%02d:%02d:%02d ", ptms->tm_hour, ptms->tm_min, ptms->tm_sec);
+      ret = vsnprintf(&buf[LOG_TIME_LEN], LOG_MAX_LINE, fmt, ap);
+      // Not safe ret = vsprintf(&buf[LOG_TIME_LEN], fmt, ap);
+    }
+  else
+    {
+      ret = vsnprintf(buf, LOG_MAX_LINE, fmt, ap);
+      // Not safe ret = vsprintf(buf, fmt, ap);
     }
 
-  return(0);
+  fputs(buf, fp);
+  fflush(fp);
+  return(ret);
 }
 
 int Log::write(const char *fmt, ...)
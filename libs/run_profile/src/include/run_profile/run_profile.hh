@@ -0,0 +1,144 @@
+/*
+ *   Module: run_profile.hh
+ *
+ *   Description: Per stage run profile of a forecast program. Stages are
+ *   timed with a ScopedTimer, which adds the wall clock time, CPU time and
+ *   bytes read (rchar of /proc/thread-self/io, 0 where that is not
+ *   available) of the calling thread between its construction and
+ *   destruction to the stage. A stage timed more than once, e.g. by tasks
+ *   running concurrently, accumulates, so its wall time may exceed the
+ *   elapsed time. Missing predictor values are counted per variable.
+ *
+ *   Each stage may have a latency budget in seconds; over_budget() lists
+ *   the stages whose wall time exceeded theirs. The profile is written as
+ *   a JSON object:
+ *
+ *     {
+ *       "program": "ghi_fcst",
+ *       "start_time": 1630900800,
+ *       "wall_secs": 12.5,
+ *       "cpu_secs": 11.8,
+ *       "stages": [
+ *         {"name": "parse_nwp", "calls": 2, "wall_secs": 3.2,
+ *          "cpu_secs": 3.0, "bytes_read": 81234567, "budget_secs": 5,
+ *          "over_budget": false},
+ *         ...
+ *       ],
+ *       "missing_predictors": {"obs_Kt": 3, ...}
+ *     }
+ *
+ *   Stages are listed in the order they were first timed. All methods
+ *   may be called from several threads.
+ *
+ */
+
+#ifndef RUN_PROFILE_HH
+#define RUN_PROFILE_HH
+
+#include <time.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class RunProfile
+{
+public:
+
+  RunProfile(const string &program);
+  ~RunProfile() {};
+
+  // Add a timed interval to a stage
+  void add(const string &stage, double wall_secs, double cpu_secs, long bytes_read);
+
+  // Count missing values of a predictor
+  void count_missing(const string &variable, long count = 1);
+
+  // Set the budget of a stage, or with stage "" the default budget of
+  // stages without their own
+  void set_budget(const string &stage, double seconds);
+
+  // Set budgets from a specification, either seconds for every stage or
+  // a comma separated list of stage=seconds with an optional bare seconds
+  // entry as the default, e.g. "parse_nwp=5,predict=20,30". Returns 0 on
+  // success, -1 if the specification is invalid.
+  int parse_budgets(const string &spec);
+
+  // Messages for the stages whose wall time exceeded their budget
+  void over_budget(vector<string> &messages) const;
+
+  // Wall time, seconds, and bytes read of a stage, 0 if never timed
+  double stage_wall(const string &stage) const;
+  long stage_bytes(const string &stage) const;
+
+  // Missing count of a predictor
+  long missing(const string &variable) const;
+
+  // Write the profile. Returns 0 on success, -1 on error.
+  int write_json(const string &path) const;
+
+  // Path of the profile written next to an output file: the output path
+  // with its extension replaced by ".profile.json"
+  static string profile_path(const string &output_path);
+
+  // Wall clock and process CPU seconds
+  static double wall_clock();
+  static double cpu_clock();
+
+  // CPU seconds and bytes read of the calling thread
+  static double thread_cpu_clock();
+  static long bytes_read();
+
+  const string &error() const { return err; }
+
+private:
+
+  struct stage_stats
+  {
+    int calls;
+    double wall;
+    double cpu;
+    long bytes;
+  };
+
+  double budget(const string &stage) const;
+
+  string program;
+  time_t start_time;
+  double start_wall;
+  double start_cpu;
+  vector<string> order;
+  map<string, stage_stats> stages;
+  map<string, long> missing_counts;
+  map<string, double> budgets;
+  double default_budget;
+  mutable string err;
+  mutable std::mutex lock;
+};
+
+// Times a stage from construction to destruction, or to stop(). A NULL
+// profile times nothing, so that profiling can be optional.
+class ScopedTimer
+{
+public:
+
+  ScopedTimer(RunProfile *profile, const string &stage);
+  ~ScopedTimer() { stop(); }
+
+  void stop();
+
+private:
+
+  ScopedTimer(const ScopedTimer &);
+  ScopedTimer &operator=(const ScopedTimer &);
+
+  RunProfile *profile;
+  string stage;
+  double wall;
+  double cpu;
+  long bytes;
+};
+
+#endif /* RUN_PROFILE_HH */
@@ -0,0 +1,294 @@
+//----------------------------------------------------------------------
+// Module: run_profile.cc
+//
+// Description:
+//     Per stage timing, bytes read and missing predictor counts, written
+//     as JSON.
+//----------------------------------------------------------------------
+
+// Include files
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/run_profile/run_profile.hh"
+
+using namespace std;
+
+// Constant, macro and type definitions
+
+static const char *THREAD_IO = "/proc/thread-self/io";
+static const char *PROC_IO = "/proc/self/io";
+
+// Functions and objects
+
+// Write a string as a JSON string
+static void json_string(FILE *fp, const string &s)
+{
+  fputc('"', fp);
+  for (size_t i = 0; i < s.size(); i++)
+    {
+      unsigned char c = s[i];
+      if (c == '"' || c == '\\')
+	fprintf(fp, "\\%c", c);
+      else if (c < 0x20)
+	fprintf(fp, "\\u%04x", c);
+      else
+	fputc(c, fp);
+    }
+  fputc('"', fp);
+}
+
+RunProfile::RunProfile(const string &program_name) :
+  program(program_name), start_time(time(0)), start_wall(wall_clock()),
+  start_cpu(cpu_clock()), default_budget(-1)
+{
+}
+
+double RunProfile::wall_clock()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double RunProfile::cpu_clock()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double RunProfile::thread_cpu_clock()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+long RunProfile::bytes_read()
+{
+  // Before Linux 3.17 there is no thread-self; the thread group leader's
+  // counts are the best available
+  FILE *fp = fopen(THREAD_IO, "r");
+  if (fp == NULL)
+    fp = fopen(PROC_IO, "r");
+  if (fp == NULL)
+    return 0;
+
+  char line[128];
+  long bytes = 0;
+  while (fgets(line, sizeof(line), fp) != NULL)
+    if (sscanf(line, "rchar: %ld", &bytes) == 1)
+      break;
+
+  fclose(fp);
+  return bytes;
+}
+
+void RunProfile::add(const string &stage, double wall_secs, double cpu_secs, long bytes)
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  map<string, stage_stats>::iterator it = stages.find(stage);
+  if (it == stages.end())
+    {
+      stage_stats stats = {0, 0, 0, 0};
+      it = stages.insert(make_pair(stage, stats)).first;
+      order.push_back(stage);
+    }
+
+  it->second.calls++;
+  it->second.wall += wall_secs;
+  it->second.cpu += cpu_secs;
+  it->second.bytes += bytes;
+}
+
+void RunProfile::count_missing(const string &variable, long count)
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  missing_counts[variable] += count;
+}
+
+void RunProfile::set_budget(const string &stage, double seconds)
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  if (stage.empty())
+    default_budget = seconds;
+  else
+    budgets[stage] = seconds;
+}
+
+int RunProfile::parse_budgets(const string &spec)
+{
+  size_t start = 0;
+
+  while (start <= spec.size())
+    {
+      size_t end = spec.find(',', start);
+      if (end == string::npos)
+	end = spec.size();
+
+      string item = spec.substr(start, end - start);
+      size_t eq = item.find('=');
+      string stage = (eq == string::npos ? string("") : item.substr(0, eq));
+      string value = (eq == string::npos ? item : item.substr(eq + 1));
+
+      char *value_end;
+      double seconds = strtod(value.c_str(), &value_end);
+      if (value.empty() || *value_end != '\0' || seconds < 0 ||
+	  (eq != string::npos && stage.empty()))
+	{
+	  err = string("invalid latency budget '") + item + "'";
+	  return -1;
+	}
+
+      set_budget(stage, seconds);
+      start = end + 1;
+    }
+
+  return 0;
+}
+
+double RunProfile::budget(const string &stage) const
+{
+  map<string, double>::const_iterator it = budgets.find(stage);
+
+  return (it != budgets.end() ? it->second : default_budget);
+}
+
+void RunProfile::over_budget(vector<string> &messages) const
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  messages.clear();
+  for (size_t i = 0; i < order.size(); i++)
+    {
+      const stage_stats &stats = stages.find(order[i])->second;
+      double limit = budget(order[i]);
+
+      if (limit >= 0 && stats.wall > limit)
+	{
+	  char msg[256];
+	  snprintf(msg, sizeof(msg), "stage %s took %.3f s, over its budget of %.3f s",
+		   order[i].c_str(), stats.wall, limit);
+	  messages.push_back(msg);
+	}
+    }
+}
+
+double RunProfile::stage_wall(const string &stage) const
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  map<string, stage_stats>::const_iterator it = stages.find(stage);
+  return (it == stages.end() ? 0 : it->second.wall);
+}
+
+long RunProfile::stage_bytes(const string &stage) const
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  map<string, stage_stats>::const_iterator it = stages.find(stage);
+  return (it == stages.end() ? 0 : it->second.bytes);
+}
+
+long RunProfile::missing(const string &variable) const
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  map<string, long>::const_iterator it = missing_counts.find(variable);
+  return (it == missing_counts.end() ? 0 : it->second);
+}
+
+string RunProfile::profile_path(const string &output_path)
+{
+  size_t slash = output_path.find_last_of('/');
+  size_t dot = output_path.find_last_of('.');
+
+  if (dot == string::npos || (slash != string::npos && dot < slash))
+    return output_path + ".profile.json";
+
+  return output_path.substr(0, dot) + ".profile.json";
+}
+
+int RunProfile::write_json(const string &path) const
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  string tmp_path = path + ".tmp";
+  FILE *fp = fopen(tmp_path.c_str(), "w");
+  if (fp == NULL)
+    {
+      err = string("cannot open ") + tmp_path;
+      return -1;
+    }
+
+  fprintf(fp, "{\n  \"program\": ");
+  json_string(fp, program);
+  fprintf(fp, ",\n  \"start_time\": %ld,\n", (long)start_time);
+  fprintf(fp, "  \"wall_secs\": %.6f,\n", wall_clock() - start_wall);
+  fprintf(fp, "  \"cpu_secs\": %.6f,\n", cpu_clock() - start_cpu);
+
+  fprintf(fp, "  \"stages\": [");
+  for (size_t i = 0; i < order.size(); i++)
+    {
+      const stage_stats &stats = stages.find(order[i])->second;
+      double limit = budget(order[i]);
+
+      fprintf(fp, "%s\n    {\"name\": ", i ? "," : "");
+      json_string(fp, order[i]);
+      fprintf(fp, ", \"calls\": %d, \"wall_secs\": %.6f, \"cpu_secs\": %.6f, \"bytes_read\": %ld",
+	      stats.calls, stats.wall, stats.cpu, stats.bytes);
+      if (limit >= 0)
+	fprintf(fp, ", \"budget_secs\": %.3f, \"over_budget\": %s", limit,
+		stats.wall > limit ? "true" : "false");
+      fprintf(fp, "}");
+    }
+  fprintf(fp, "%s],\n", order.size() ? "\n  " : "");
+
+  fprintf(fp, "  \"missing_predictors\": {");
+  size_t n = 0;
+  for (map<string, long>::const_iterator it = missing_counts.begin(); it != missing_counts.end(); ++it, ++n)
+    {
+      fprintf(fp, "%s\n    ", n ? "," : "");
+      json_string(fp, it->first);
+      fprintf(fp, ": %ld", it->second);
+    }
+  fprintf(fp, "%s}\n}\n", n ? "\n  " : "");
+
+  if (fclose(fp) != 0 || rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+      err = string("cannot write ") + path;
+      remove(tmp_path.c_str());
+      return -1;
+    }
+
+  return 0;
+}
+
+ScopedTimer::ScopedTimer(RunProfile *run_profile, const string &stage_name) :
+  profile(run_profile), stage(stage_name), wall(0), cpu(0), bytes(0)
+{
+  if (profile == NULL)
+    return;
+
+  wall = RunProfile::wall_clock();
+  cpu = RunProfile::thread_cpu_clock();
+  bytes = RunProfile::bytes_read();
+}
+
+void ScopedTimer::stop()
+{
+  if (profile == NULL)
+    return;
+
+  profile->add(stage, RunProfile::wall_clock() - wall, RunProfile::thread_cpu_clock() - cpu,
+	       RunProfile::bytes_read() - bytes);
+  profile = NULL;
+}
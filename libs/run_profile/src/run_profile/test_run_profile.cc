@@ -0,0 +1,130 @@
+//----------------------------------------------------------------------
+// Module: test_run_profile.cc
+//
+// Description:
+//     Times a few stages, checks accumulation, bytes read (skipped
+//     without /proc/self/io), budgets and the JSON output. Exits non-zero
+//     on failure.
+//----------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/run_profile/run_profile.hh"
+
+using namespace std;
+
+// The rchar counts ScopedTimer reads, where the kernel provides them
+static const char *PROC_IO = "/proc/self/io";
+
+int main()
+{
+  RunProfile profile("test_run_profile");
+  int nfail = 0;
+
+  {
+    ScopedTimer timer(&profile, "sleep");
+    usleep(20000);
+  }
+  {
+    ScopedTimer timer(&profile, "sleep");
+    usleep(20000);
+  }
+  {
+    ScopedTimer timer(NULL, "none");
+  }
+  double wall = profile.stage_wall("sleep");
+  bool ok = wall >= 0.039 && wall < 1 && profile.stage_wall("none") == 0;
+  printf("%-24s %.3f s  %s\n", "accumulate", wall, ok ? "ok" : "FAILED");
+  if (!ok)
+    nfail++;
+
+  // Read a file of known size through stdio
+  char path[] = "/tmp/test_run_profileXXXXXX";
+  int fd = mkstemp(path);
+  vector<char> block(1 << 20, 'x');
+  if (write(fd, &block[0], block.size()) != (ssize_t)block.size())
+    perror("write");
+  close(fd);
+  {
+    ScopedTimer timer(&profile, "read");
+    FILE *fp = fopen(path, "r");
+    while (fread(&block[0], 1, block.size(), fp) > 0)
+      ;
+    fclose(fp);
+  }
+
+  // Reads of another thread are not counted
+  {
+    ScopedTimer timer(&profile, "other_thread");
+    std::thread reader([&]() {
+      FILE *fp = fopen(path, "r");
+      while (fread(&block[0], 1, block.size(), fp) > 0)
+        ;
+      fclose(fp);
+    });
+    reader.join();
+  }
+
+  FILE *io = fopen(PROC_IO, "r");
+  if (io == NULL)
+    printf("%-24s skipped, no %s\n", "bytes read", PROC_IO);
+  else
+    {
+      fclose(io);
+      long bytes = profile.stage_bytes("read");
+      long other = profile.stage_bytes("other_thread");
+      ok = bytes >= (1 << 20) && bytes < (1 << 20) + 65536 && other < 65536;
+      printf("%-24s %ld, other thread %ld  %s\n", "bytes read", bytes, other, ok ? "ok" : "FAILED");
+      if (!ok)
+	nfail++;
+    }
+
+  profile.count_missing("obs_Kt");
+  profile.count_missing("obs_Kt", 2);
+  ok = profile.missing("obs_Kt") == 3 && profile.missing("nwp_T") == 0;
+  printf("%-24s %s\n", "missing counts", ok ? "ok" : "FAILED");
+  if (!ok)
+    nfail++;
+
+  vector<string> messages;
+  ok = profile.parse_budgets("sleep=x") != 0 && profile.parse_budgets("=3") != 0 &&
+    profile.parse_budgets("sleep=0.01,100") == 0;
+  profile.over_budget(messages);
+  ok = ok && messages.size() == 1 && messages[0].find("sleep") != string::npos;
+  printf("%-24s %s\n", "budgets", ok ? "ok" : "FAILED");
+  if (!ok)
+    nfail++;
+
+  ok = RunProfile::profile_path("/d/ghi_fcst.m.20210906.120000.nc") ==
+    "/d/ghi_fcst.m.20210906.120000.profile.json" &&
+    RunProfile::profile_path("/d.x/out") == "/d.x/out.profile.json";
+  printf("%-24s %s\n", "profile path", ok ? "ok" : "FAILED");
+  if (!ok)
+    nfail++;
+
+  string json = string(path) + ".json";
+  ok = profile.write_json(json) == 0;
+
+  FILE *fp = fopen(json.c_str(), "r");
+  string text;
+  char buf[256];
+  while (fp && fgets(buf, sizeof(buf), fp) != NULL)
+    text += buf;
+  if (fp)
+    fclose(fp);
+  ok = ok && text.find("\"name\": \"sleep\", \"calls\": 2") != string::npos &&
+    text.find("\"over_budget\": true") != string::npos &&
+    text.find("\"obs_Kt\": 3") != string::npos;
+  printf("%-24s %s\n", "json", ok ? "ok" : "FAILED");
+  if (!ok)
+    nfail++;
+
+  unlink(path);
+  unlink(json.c_str());
+
+  return nfail ? 1 : 0;
+}
@@ -0,0 +1,101 @@
+/*
+ *   Module: shading_mask.hh
+ *
+ *   Description: Minutes during which the pyranometer of a mesonet site
+ *   is shaded, compiled from the tables of the shading directory into a
+ *   bitmask per site and minute of the year, replacing the pandas joins
+ *   of nymeso_basic_and_shading_qc.py.
+ *
+ *   The tables are csv files with a "Jday" column and one column per
+ *   station name:
+ *     Sunrise.UTCs.17sites.csv                            decimal UTC hours
+ *     Sunset.UTCs.17sites.csv                             decimal UTC hours
+ *     Srad.Flag.mins.sunrise.a10m.20200804-17sites.csv    minutes
+ *     Srad.Flag.mins.sunset.a10m.20200804-17sites.csv     minutes
+ *
+ *   As in the python QC, minute m (UTC) of day of year d is shaded if
+ *     m / 60 <= sunrise[d] + sunrise_flag[d] / 60  or
+ *     m / 60 >= sunset[d] - sunset_flag[d] / 60
+ *   Days and stations missing from the tables are not shaded. Station
+ *   names are mapped to integer site ids with a site list csv with
+ *   "stid" and "int_id" columns, e.g. static/site_list/nymeso_match_wrf.csv.
+ *
+ */
+
+#ifndef SHADING_MASK_HH
+#define SHADING_MASK_HH
+
+#include <stdint.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define SHADING_MASK_DAYS 366
+#define SHADING_MASK_DAY_MINUTES 1440
+
+class ShadingMask
+{
+public:
+
+  ShadingMask() {};
+  ~ShadingMask() {};
+
+  // Compile the tables in shading_dir for the stations of site_list.
+  // Returns 0 on success, -1 on error.
+  int compile(const string &shading_dir, const string &site_list);
+
+  // Compile the tables for stations named in station_ids
+  int compile(const string &shading_dir, const map<string, int> &station_ids);
+
+  // Read the "stid" and "int_id" columns of a site list csv. Returns 0
+  // on success, -1 on error.
+  static int read_station_ids(const string &site_list, map<string, int> &station_ids,
+			      string &error);
+
+  int num_sites() const { return (int)site_ids.size(); }
+
+  // True if the site is in the tables
+  bool have_site(int site_id) const { return slot(site_id) >= 0; }
+
+  // True if the site is shaded in the minute holding unix_time
+  bool is_shaded(int site_id, time_t unix_time) const
+  {
+    int s = slot(site_id);
+    if (s < 0)
+      return false;
+
+    size_t bit = (size_t)s * SITE_BITS + minute_of_year(unix_time);
+    return (bits[bit >> 6] >> (bit & 63)) & 1;
+  }
+
+  // Number of shaded minutes among the minutes one minute samples ending
+  // at end_time, as averaged into a time ending period mean
+  int num_shaded(int site_id, time_t end_time, int minutes) const;
+
+  const string &error() const { return err; }
+
+private:
+
+  static const size_t SITE_BITS = (size_t)SHADING_MASK_DAYS * SHADING_MASK_DAY_MINUTES;
+  static const size_t SITE_WORDS = (SITE_BITS + 63) / 64;
+
+  int slot(int site_id) const
+  {
+    if (site_id < 0 || site_id >= (int)id_slot.size())
+      return -1;
+    return id_slot[site_id];
+  }
+
+  // Day of year (0 based) * 1440 + minute of the day, UTC
+  static size_t minute_of_year(time_t unix_time);
+
+  vector<int> site_ids;
+  vector<int> id_slot;
+  vector<uint64_t> bits;
+  string err;
+};
+
+#endif /* SHADING_MASK_HH */
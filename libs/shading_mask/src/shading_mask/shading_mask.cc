@@ -0,0 +1,256 @@
+//----------------------------------------------------------------------
+// Module: shading_mask.cc
+//
+// Description:
+//     Compiles the shading tables into a bitmask per site and minute of
+//     the year.
+//----------------------------------------------------------------------
+
+// Include files
+#include <math.h>
+#include <stdlib.h>
+#include <fstream>
+#include "../include/shading_mask/shading_mask.hh"
+
+using namespace std;
+
+// Constant, macro and type definitions
+
+static const char *SUNRISE_FILE = "Sunrise.UTCs.17sites.csv";
+static const char *SUNSET_FILE = "Sunset.UTCs.17sites.csv";
+static const char *SUNRISE_FLAG_FILE = "Srad.Flag.mins.sunrise.a10m.20200804-17sites.csv";
+static const char *SUNSET_FLAG_FILE = "Srad.Flag.mins.sunset.a10m.20200804-17sites.csv";
+
+// Per station table columns, indexed by day of year - 1
+typedef map<string, vector<float> > table;
+
+// Functions and objects
+
+// Split a csv line, trimming white space, quotes and carriage returns
+static void split_csv(const string &line, vector<string> &fields)
+{
+  fields.clear();
+
+  size_t start = 0;
+  while (true)
+    {
+      size_t pos = line.find(',', start);
+      string field = line.substr(start, pos == string::npos ? string::npos : pos - start);
+      size_t first = field.find_first_not_of(" \t\r\"");
+      size_t last = field.find_last_not_of(" \t\r\"");
+
+      fields.push_back(first == string::npos ? string("") : field.substr(first, last - first + 1));
+      if (pos == string::npos)
+	break;
+      start = pos + 1;
+    }
+}
+
+static int find_column(const vector<string> &header, const string &name)
+{
+  for (size_t c = 0; c < header.size(); c++)
+    if (header[c] == name)
+      return (int)c;
+
+  return -1;
+}
+
+// Read a table; entries that are absent or not numbers are NaN
+static int read_table(const string &path, table &columns, string &err)
+{
+  ifstream infile(path.c_str());
+  if (!infile.is_open())
+    {
+      err = string("cannot open ") + path;
+      return -1;
+    }
+
+  string line;
+  vector<string> header, fields;
+  if (!getline(infile, line))
+    {
+      err = string("empty table ") + path;
+      return -1;
+    }
+
+  split_csv(line, header);
+  if (header.size() < 2 || header[0] != "Jday")
+    {
+      err = string("no Jday column in ") + path;
+      return -1;
+    }
+
+  for (size_t c = 1; c < header.size(); c++)
+    columns[header[c]].assign(SHADING_MASK_DAYS, NAN);
+
+  while (getline(infile, line))
+    {
+      split_csv(line, fields);
+
+      int jday = atoi(fields[0].c_str());
+      if (jday < 1 || jday > SHADING_MASK_DAYS)
+	continue;
+
+      for (size_t c = 1; c < header.size() && c < fields.size(); c++)
+	{
+	  char *end;
+	  double val = strtod(fields[c].c_str(), &end);
+	  if (!fields[c].empty() && *end == '\0')
+	    columns[header[c]][jday - 1] = (float)val;
+	}
+    }
+
+  return 0;
+}
+
+// Days since 1970-01-01 of January 1st of a year (proleptic Gregorian)
+static long days_to_year(long year)
+{
+  long y = year - 1;
+  long era = (y >= 0 ? y : y - 399) / 400;
+  long yoe = y - era * 400;
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + 306;
+
+  return era * 146097 + doe - 719468;
+}
+
+size_t ShadingMask::minute_of_year(time_t unix_time)
+{
+  long days = (long)(unix_time >= 0 ? unix_time / 86400 : (unix_time - 86399) / 86400);
+  long minute = (long)((unix_time - (time_t)days * 86400) / 60);
+
+  // Year of the day, from the civil from days algorithm of H. Hinnant
+  long z = days + 719468;
+  long era = (z >= 0 ? z : z - 146096) / 146097;
+  long doe = z - era * 146097;
+  long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  long mp = (5 * doy + 2) / 153;
+  long year = yoe + era * 400 + (mp >= 10 ? 1 : 0);
+
+  return (size_t)(days - days_to_year(year)) * SHADING_MASK_DAY_MINUTES + minute;
+}
+
+int ShadingMask::read_station_ids(const string &site_list, map<string, int> &station_ids,
+				  string &error)
+{
+  ifstream infile(site_list.c_str());
+  if (!infile.is_open())
+    {
+      error = string("cannot open ") + site_list;
+      return -1;
+    }
+
+  string line;
+  vector<string> fields;
+  if (!getline(infile, line))
+    {
+      error = string("empty site list ") + site_list;
+      return -1;
+    }
+
+  split_csv(line, fields);
+  int name_col = find_column(fields, "stid");
+  int id_col = find_column(fields, "int_id");
+  if (name_col < 0 || id_col < 0)
+    {
+      error = string("no stid and int_id columns in ") + site_list;
+      return -1;
+    }
+
+  while (getline(infile, line))
+    {
+      split_csv(line, fields);
+      if ((int)fields.size() <= name_col || (int)fields.size() <= id_col ||
+	  fields[name_col].empty() || fields[id_col].empty())
+	continue;
+
+      station_ids[fields[name_col]] = atoi(fields[id_col].c_str());
+    }
+
+  return 0;
+}
+
+int ShadingMask::compile(const string &shading_dir, const string &site_list)
+{
+  map<string, int> station_ids;
+
+  if (read_station_ids(site_list, station_ids, err) != 0)
+    return -1;
+
+  return compile(shading_dir, station_ids);
+}
+
+int ShadingMask::compile(const string &shading_dir, const map<string, int> &station_ids)
+{
+  table sunrise, sunset, sunrise_flag, sunset_flag;
+
+  site_ids.clear();
+  id_slot.clear();
+  bits.clear();
+
+  if (read_table(shading_dir + "/" + SUNRISE_FILE, sunrise, err) != 0 ||
+      read_table(shading_dir + "/" + SUNSET_FILE, sunset, err) != 0 ||
+      read_table(shading_dir + "/" + SUNRISE_FLAG_FILE, sunrise_flag, err) != 0 ||
+      read_table(shading_dir + "/" + SUNSET_FLAG_FILE, sunset_flag, err) != 0)
+    return -1;
+
+  // Stations of the sunrise tables with a site id
+  vector<string> names;
+  for (table::const_iterator it = sunrise.begin(); it != sunrise.end(); ++it)
+    {
+      map<string, int>::const_iterator id = station_ids.find(it->first);
+      if (id == station_ids.end() || id->second < 0 || sunrise_flag.count(it->first) == 0)
+	continue;
+
+      names.push_back(it->first);
+      site_ids.push_back(id->second);
+      if (id->second >= (int)id_slot.size())
+	id_slot.resize(id->second + 1, -1);
+      id_slot[id->second] = (int)site_ids.size() - 1;
+    }
+
+  bits.assign(site_ids.size() * SITE_WORDS, 0);
+
+  const vector<float> no_table(SHADING_MASK_DAYS, NAN);
+  for (size_t s = 0; s < names.size(); s++)
+    {
+      const vector<float> &rise = sunrise[names[s]];
+      const vector<float> &rise_flag = sunrise_flag[names[s]];
+      bool have_set = sunset.count(names[s]) && sunset_flag.count(names[s]);
+      const vector<float> &set = have_set ? sunset[names[s]] : no_table;
+      const vector<float> &set_flag = have_set ? sunset_flag[names[s]] : no_table;
+
+      for (int d = 0; d < SHADING_MASK_DAYS; d++)
+	{
+	  // Comparisons with NaN, for missing days, are false
+	  float morning_end = rise[d] + rise_flag[d] / 60;
+	  float evening_start = set[d] - set_flag[d] / 60;
+
+	  for (int m = 0; m < SHADING_MASK_DAY_MINUTES; m++)
+	    {
+	      float hour = (m / 60) + (m % 60) / 60.0f;
+	      if (hour <= morning_end || hour >= evening_start)
+		{
+		  size_t bit = s * SITE_BITS + (size_t)d * SHADING_MASK_DAY_MINUTES + m;
+		  bits[bit >> 6] |= (uint64_t)1 << (bit & 63);
+		}
+	    }
+	}
+    }
+
+  return 0;
+}
+
+int ShadingMask::num_shaded(int site_id, time_t end_time, int minutes) const
+{
+  if (slot(site_id) < 0)
+    return 0;
+
+  int num = 0;
+  for (int k = 0; k < minutes; k++)
+    if (is_shaded(site_id, end_time - (time_t)k * 60))
+      num++;
+
+  return num;
+}
@@ -0,0 +1,90 @@
+//----------------------------------------------------------------------
+// Module: test_shading_mask.cc
+//
+// Description:
+//     Compiles a small set of shading tables and checks the mask against
+//     the rule of the python QC, including leap years and missing days.
+//     Exits non-zero on failure.
+//----------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "../include/shading_mask/shading_mask.hh"
+
+using namespace std;
+
+static void write_file(const string &path, const char *text)
+{
+  FILE *fp = fopen(path.c_str(), "w");
+  fputs(text, fp);
+  fclose(fp);
+}
+
+int main()
+{
+  char dir_template[] = "/tmp/test_shading_maskXXXXXX";
+  string dir = mkdtemp(dir_template);
+
+  // Day 1: AAAA sunrise 12.5 + 30 minutes -> shaded through 13:00,
+  // sunset 21.5 - 30 minutes -> shaded from 21:00. Day 2 of BBBB is
+  // missing. Day 60 covers Feb 29 / Mar 1.
+  write_file(dir + "/Sunrise.UTCs.17sites.csv",
+	     "\"Jday\",\"AAAA\",\"BBBB\"\n1,12.5,12\n2,12.5,\n60,12,12\n");
+  write_file(dir + "/Srad.Flag.mins.sunrise.a10m.20200804-17sites.csv",
+	     "\"Jday\",\"AAAA\",\"BBBB\"\n1,30,0\n2,30,0\n60,0,0\n");
+  write_file(dir + "/Sunset.UTCs.17sites.csv",
+	     "\"Jday\",\"AAAA\",\"BBBB\"\n1,21.5,22\n2,21.5,22\n60,22,22\n");
+  write_file(dir + "/Srad.Flag.mins.sunset.a10m.20200804-17sites.csv",
+	     "\"Jday\",\"AAAA\",\"BBBB\"\n1,30,-10\n2,30,0\n60,0,0\n");
+  write_file(dir + "/sites.csv", "stid,lat [degrees],lon [degrees],int_id\nAAAA,42,-74,3\nBBBB,43,-75,7\n");
+
+  ShadingMask mask;
+  int nfail = 0;
+
+  int ret = mask.compile(dir, dir + "/sites.csv");
+  bool ok = ret == 0 && mask.num_sites() == 2 && mask.have_site(3) && !mask.have_site(4);
+  printf("%-24s %s\n", "compile", ok ? "ok" : "FAILED");
+  if (!ok)
+    nfail++;
+
+  // 2021-01-01 00:00 UTC: night, the sunrise and sunset flags to the
+  // minute, a negative flag, BBBB's missing day 2 and a site not in the
+  // tables
+  time_t jan1 = 1609459200;
+  ok = mask.is_shaded(3, jan1 + 5 * 3600) &&
+    mask.is_shaded(3, jan1 + 13 * 3600) && !mask.is_shaded(3, jan1 + 13 * 3600 + 60) &&
+    !mask.is_shaded(3, jan1 + 13 * 3600 + 119) &&
+    !mask.is_shaded(3, jan1 + 21 * 3600 - 60) && mask.is_shaded(3, jan1 + 21 * 3600) &&
+    !mask.is_shaded(7, jan1 + 22 * 3600) && mask.is_shaded(7, jan1 + 22 * 3600 + 600) &&
+    !mask.is_shaded(7, jan1 + 86400 + 5 * 3600) &&
+    !mask.is_shaded(4, jan1 + 5 * 3600);
+  printf("%-24s %s\n", "january 1 and 2", ok ? "ok" : "FAILED");
+  if (!ok)
+    nfail++;
+
+  // Day of year 60 is Mar 1 2021 and Feb 29 2020
+  ok = mask.is_shaded(3, 1614556800 + 11 * 3600) && mask.is_shaded(3, 1582934400 + 11 * 3600) &&
+    !mask.is_shaded(3, 1614556800 + 12 * 3600 + 60) &&
+    !mask.is_shaded(3, 1614556800 - 86400 + 5 * 3600);
+  printf("%-24s %s\n", "day 60", ok ? "ok" : "FAILED");
+  if (!ok)
+    nfail++;
+
+  // The 15 minute period ending 13:10 has 5 shaded minutes, 12:56 .. 13:00
+  int nshaded = mask.num_shaded(3, jan1 + 13 * 3600 + 600, 15);
+  printf("%-24s %d shaded  %s\n", "period", nshaded, nshaded == 5 ? "ok" : "FAILED");
+  if (nshaded != 5)
+    nfail++;
+
+  ok = mask.compile(dir + "/none", dir + "/sites.csv") != 0;
+  printf("%-24s %s\n", "missing tables", ok ? "ok" : "FAILED");
+  if (!ok)
+    nfail++;
+
+  string cmd = string("rm -rf ") + dir;
+  if (system(cmd.c_str()) != 0)
+    perror("rm");
+
+  return nfail ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+/*
+ *   Module: nc_lock.hh
+ *
+ *   Description: One process-wide lock around the netCDF library, which
+ *   is not thread safe. Every thread opening, reading or writing a netCDF
+ *   file holds it, so that programs built from several apps in one process
+ *   (solar_pipeline) share a single lock. Site store files are mapped
+ *   rather than read through netCDF and need no lock.
+ *
+ */
+
+#ifndef NC_LOCK_HH
+#define NC_LOCK_HH
+
+#include <mutex>
+
+// The netCDF library lock
+std::mutex &netcdf_lock();
+
+#endif /* NC_LOCK_HH */
@@ -0,0 +1,358 @@
+/*
+ *   Module: site_store.hh
+ *
+ *   Description: Memory mapped columnar store of site time series. One
+ *   file holds the variables of one source file (NWP site forecast,
+ *   observations, blended forecast) decoded once, so that every process
+ *   using the source maps the values instead of reading the netCDF file.
+ *
+ *   Values are float, site major: variable v, site s, time t is at
+ *   values(v)[s * num_times + t]. Each variable has a missing value and a
+ *   bitmap with a bit set for every missing value. Values are stored as
+ *   they were in the source file, missing ones included, so readers get
+ *   the same numbers they would from the netCDF file.
+ *
+ *   The file is written in native byte order:
+ *     char   magic[4]   "SSTR"
+ *     int    version, num_sites, num_times, num_vars, name_len, pad
+ *     double gen_time                           (-1 if none)
+ *     int    site_id[num_sites]
+ *     double time[num_times]
+ *     char   var_name[num_vars][name_len]       (nul padded)
+ *     float  var_missing[num_vars]
+ *     then, each starting on an 8 byte boundary:
+ *     float  values[num_vars][num_sites * num_times]
+ *     uchar  missing_bits[num_vars][(num_sites * num_times + 7) / 8]
+ *
+ *   SiteInterp is a view of site major columns at times between their
+ *   valid times, so that a source with hourly valid times can serve 15
+ *   minute times without an interpolated copy of the source.
+ *
+ *   SiteVarDef and SiteColumns hold the variables of a reader as one
+ *   table known at compile time, loaded from netCDF or viewed in a store
+ *   in one loop.
+ *
+ */
+
+#ifndef SITE_STORE_HH
+#define SITE_STORE_HH
+
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define SITE_STORE_VERSION 1
+#define SITE_STORE_NAME_LEN 32
+
+// Read only view of a site store file
+class SiteStore
+{
+public:
+
+  SiteStore();
+  ~SiteStore();
+
+  // Map a store file. Returns 0 on success, -1 on error.
+  int open(const string &path);
+
+  // Unmap the file
+  void close();
+
+  // Returns true if the file starts with the store magic number
+  static bool is_store(const string &path);
+
+  int num_sites() const { return nsites; }
+  int num_times() const { return ntimes; }
+  int num_vars() const { return nvars; }
+  double gen_time() const { return gen; }
+
+  int site_id(int s) const { return sites[s]; }
+  double time(int t) const { return times[t]; }
+  const int *site_ids() const { return sites; }
+  const double *time_values() const { return times; }
+  string var_name(int v) const;
+  float var_missing(int v) const { return missing[v]; }
+
+  // Index of a variable, site id or time, or -1
+  int find_var(const string &name) const;
+  int find_site(int site_id) const;
+  int find_time(double t) const;
+
+  // All values of a variable, site major, in the mapped file
+  const float *values(int v) const { return vals[v]; }
+
+  // Time series of a variable at a site index
+  const float *column(int v, int s) const { return vals[v] + (size_t)s * ntimes; }
+
+  // True if the value at (site index, time index) is missing
+  bool is_missing(int v, int s, int t) const
+  {
+    size_t i = (size_t)s * ntimes + t;
+    return (bits[v][i >> 3] >> (i & 7)) & 1;
+  }
+
+  // Value of a variable at a site id and time, or the variable's missing
+  // value if the site or time is not in the store
+  float get(int v, int site_id, double t) const;
+
+  const string &error() const { return err; }
+
+private:
+
+  SiteStore(const SiteStore &);
+  SiteStore &operator=(const SiteStore &);
+
+  void *addr;
+  size_t size;
+  int nsites;
+  int ntimes;
+  int nvars;
+  double gen;
+  const int *sites;
+  const double *times;
+  const char *names;
+  const float *missing;
+  vector<const float *> vals;
+  vector<const unsigned char *> bits;
+  map<int, int> site_index;
+  bool uniform_times;
+  string err;
+};
+
+// Builds a store file from arrays
+class SiteStoreWriter
+{
+public:
+
+  SiteStoreWriter() : gen(-1) {};
+  ~SiteStoreWriter() {};
+
+  void set_sites(const vector<int> &site_ids) { sites = site_ids; }
+  void set_times(const vector<double> &time_values) { times = time_values; }
+  void set_gen_time(double gen_time) { gen = gen_time; }
+
+  // Add a variable with values site major. Values equal to missing_value,
+  // or NaN, are marked missing. Returns 0 on success, -1 if the name is
+  // too long or the size does not match the sites and times.
+  int add_var(const string &name, const vector<float> &values, float missing_value);
+
+  // Write the store under a temporary name and rename it into place, so
+  // that readers never map a partial file. Returns 0 on success, -1 on
+  // error.
+  int write(const string &path);
+
+  const string &error() const { return err; }
+
+private:
+
+  vector<int> sites;
+  vector<double> times;
+  double gen;
+  vector<string> names;
+  vector<float> missing;
+  vector< vector<float> > values;
+  string err;
+};
+
+// Float array that either owns its values or views values owned elsewhere,
+// such as a column of a mapped SiteStore. Readers filling their arrays from
+// netCDF use push_back(); readers backed by a store use view().
+class SiteColumn
+{
+public:
+
+  SiteColumn() : view_ptr(0), view_size(0) {};
+
+  void push_back(float value) { own.push_back(value); }
+  void view(const float *ptr, size_t n) { view_ptr = ptr; view_size = n; own.clear(); }
+  void clear() { own.clear(); view_ptr = 0; view_size = 0; }
+
+  // Take over the values of a vector, leaving it empty
+  void take(vector<float> &values) { own.swap(values); values.clear(); view_ptr = 0; view_size = 0; }
+
+  size_t size() const { return view_ptr ? view_size : own.size(); }
+  float operator[](size_t i) const { return view_ptr ? view_ptr[i] : own[i]; }
+
+private:
+
+  vector<float> own;
+  const float *view_ptr;
+  size_t view_size;
+};
+
+// Compile time schema of the variables of a site reader. A reader lists its
+// variables once, as an enum and a constexpr table of SiteVarDef in enum
+// order, and keeps their values in a SiteColumns, so that they are loaded,
+// viewed and read in generic loops instead of with a member, a copy loop
+// and a getter per variable.
+
+enum SiteVarType
+{
+  SITE_VAR_FLOAT,		// float in the netCDF file
+  SITE_VAR_INT			// int in the netCDF file, held as float
+};
+
+enum SiteVarLayout
+{
+  SITE_VAR_SITE_TIME,		// [site][time] in the netCDF file
+  SITE_VAR_TIME_SITE,		// [time][site] in the netCDF file
+  SITE_VAR_SITE			// [site]; repeated over times in a store
+};
+
+// SiteVarDef flags. SITE_VAR_NON_NEGATIVE is applied by SiteColumns, the
+// others by the reader.
+enum
+{
+  SITE_VAR_SOLAR = 1,		// solar geometry, computed rather than read
+				// when the reader has site locations
+  SITE_VAR_IRRADIANCE = 2,	// interpolated in time as clear sky index
+  SITE_VAR_NON_NEGATIVE = 4,	// negative values are read as 0
+  SITE_VAR_SHADED = 8		// missing while the site's sensor is shaded
+};
+
+struct SiteVarDef
+{
+  const char *name;		// netCDF and site store variable name
+  SiteVarType type;
+  SiteVarLayout layout;
+  int flags;
+};
+
+// Columns of the N variables of a reader, indexed by its variable enum Var
+template <typename Var, int N>
+class SiteColumns
+{
+public:
+
+  explicit SiteColumns(const SiteVarDef (&var_defs)[N]) : defs(var_defs) {};
+
+  static int size() { return N; }
+  const SiteVarDef &def(Var v) const { return defs[v]; }
+  bool has(Var v, int flags) const { return (defs[v].flags & flags) != 0; }
+
+  SiteColumn &operator[](Var v) { return cols[v]; }
+  const SiteColumn &operator[](Var v) const { return cols[v]; }
+
+  // Copy n values of v from a netCDF array of its type
+  void copy(Var v, const void *ptr, size_t n)
+  {
+    cols[v].clear();
+    for (size_t i = 0; i < n; i++)
+      put(v, defs[v].type == SITE_VAR_INT ? (float)((const int *)ptr)[i] :
+	  ((const float *)ptr)[i]);
+  }
+
+  // View v in a mapped store. Per site variables, and those whose values
+  // are changed on reading, are copied instead. Returns 0 on success, -1 if
+  // v is not in the store.
+  int view(Var v, const SiteStore &store)
+  {
+    int sv = store.find_var(defs[v].name);
+    size_t n = (size_t)store.num_sites() * store.num_times();
+
+    if (sv < 0)
+      return -1;
+
+    cols[v].clear();
+    if (defs[v].layout == SITE_VAR_SITE)
+      for (int s = 0; s < store.num_sites(); s++)
+	put(v, store.num_times() > 0 ? store.column(sv, s)[0] : 0.f);
+    else if (has(v, SITE_VAR_NON_NEGATIVE))
+      for (size_t i = 0; i < n; i++)
+	put(v, store.values(sv)[i]);
+    else
+      cols[v].view(store.values(sv), n);
+    return 0;
+  }
+
+  // Values of n variables at one offset into the columns, or missing for
+  // all if the offset is negative
+  void gather(const Var *vars, int n, long offset, float missing, float *out) const
+  {
+    for (int i = 0; i < n; i++)
+      out[i] = (offset >= 0 ? cols[vars[i]][offset] : missing);
+  }
+
+  void clear()
+  {
+    for (int v = 0; v < N; v++)
+      cols[v].clear();
+  }
+
+private:
+
+  const SiteVarDef *defs;
+  SiteColumn cols[N];
+
+  void put(Var v, float value)
+  {
+    cols[v].push_back(has(v, SITE_VAR_NON_NEGATIVE) && value < 0 ? 0.f : value);
+  }
+};
+
+// Interpolation in time of site major columns with the same valid times.
+// Values are linear in time between the bracketing valid times, or, for
+// irradiance, the clear sky index (value / clear sky value) is linear in
+// time and scaled by the clear sky value at the requested time. A value is
+// missing if a bracketing value is missing or the brackets are further
+// apart than the maximum gap.
+class SiteInterp
+{
+public:
+
+  // Smallest clear sky value of a bracket for which the clear sky index is
+  // interpolated; below it the value itself is
+  static const float MIN_CLEAR;
+
+  SiteInterp() : missing(0), max_gap(0) {};
+
+  // Set the increasing valid times of the columns, their missing value and
+  // the largest time between bracketing valid times that is interpolated
+  void set_times(const vector<double> &time_values, float missing_value, double max_gap_secs);
+
+  int num_times() const { return (int)times.size(); }
+
+  // True if t is within the valid times
+  bool covers(double t) const
+  {
+    return (times.size() > 0 && t >= times[0] && t <= times.back());
+  }
+
+  // Bracketing time indices of t and the weight of i1. At a valid time
+  // i0 == i1 and w is 0. Returns false if t is not covered or the brackets
+  // are too far apart.
+  bool bracket(double t, int &i0, int &i1, float &w) const;
+
+  // Value at site index s and time t
+  float value(const SiteColumn &column, int s, double t) const;
+
+  // Clear sky index aware value at site index s and time t. clear holds
+  // the clear sky values at the valid times, clear_t the clear sky value
+  // at t.
+  float value_csi(const SiteColumn &column, const SiteColumn &clear, int s, double t,
+		  float clear_t) const;
+
+  // Values of num_sites sites at time t. Returns false, leaving out
+  // unchanged, if t cannot be interpolated.
+  bool values(const SiteColumn &column, int num_sites, double t, float *out) const;
+
+  // Clear sky index aware values of num_sites sites at time t, clear_t
+  // holding the clear sky value of each site at t
+  bool values_csi(const SiteColumn &column, const SiteColumn &clear, int num_sites, double t,
+		  const float *clear_t, float *out) const;
+
+private:
+
+  vector<double> times;
+  float missing;
+  double max_gap;
+
+  bool is_missing(float v) const { return (v == missing || v != v); }
+  float lerp(float v0, float v1, float w) const;
+  float csi(float v0, float v1, float c0, float c1, float w, float clear_t) const;
+};
+
+#endif /* SITE_STORE_HH */
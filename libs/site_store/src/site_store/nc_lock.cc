@@ -0,0 +1,17 @@
+//----------------------------------------------------------------------
+// Module: nc_lock.cc
+//
+// Description:
+//     The process-wide netCDF library lock.
+//----------------------------------------------------------------------
+
+// Include files
+#include "../include/site_store/nc_lock.hh"
+
+
+std::mutex &netcdf_lock()
+{
+  static std::mutex lock;
+
+  return lock;
+}
@@ -0,0 +1,431 @@
+//----------------------------------------------------------------------
+// Module: site_store.cc
+//
+// Description:
+//     Memory mapped columnar store of site time series: SiteStore maps a
+//     store file read only, SiteStoreWriter writes one. SiteInterp
+//     interpolates site columns in time.
+//----------------------------------------------------------------------
+
+// Include files
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/site_store/site_store.hh"
+
+// Constant, macro and type definitions
+
+static const char STORE_MAGIC[4] = {'S', 'S', 'T', 'R'};
+
+typedef struct
+{
+  char magic[4];
+  int version;
+  int num_sites;
+  int num_times;
+  int num_vars;
+  int name_len;
+  int pad;
+  double gen_time;
+} store_header;
+
+// Functions and objects
+
+static size_t align8(size_t n)
+{
+  return (n + 7) & ~(size_t)7;
+}
+
+// Offsets of the sections of a store file
+static void section_offsets(int nsites, int ntimes, int nvars, size_t &sites_off,
+			    size_t &times_off, size_t &names_off, size_t &missing_off,
+			    size_t &values_off, size_t &bits_off, size_t &total)
+{
+  size_t n = (size_t)nsites * ntimes;
+
+  sites_off = sizeof(store_header);
+  times_off = align8(sites_off + nsites * sizeof(int));
+  names_off = times_off + ntimes * sizeof(double);
+  missing_off = names_off + (size_t)nvars * SITE_STORE_NAME_LEN;
+  values_off = align8(missing_off + nvars * sizeof(float));
+  bits_off = align8(values_off + nvars * n * sizeof(float));
+  total = bits_off + nvars * align8((n + 7) / 8);
+}
+
+SiteStore::SiteStore() :
+  addr(0), size(0), nsites(0), ntimes(0), nvars(0), gen(-1), sites(0), times(0),
+  names(0), missing(0), uniform_times(false)
+{
+}
+
+SiteStore::~SiteStore()
+{
+  close();
+}
+
+void SiteStore::close()
+{
+  if (addr)
+    munmap(addr, size);
+  addr = 0;
+  size = 0;
+  nsites = ntimes = nvars = 0;
+  vals.clear();
+  bits.clear();
+  site_index.clear();
+}
+
+bool SiteStore::is_store(const string &path)
+{
+  char magic[4];
+  FILE *fp = fopen(path.c_str(), "rb");
+
+  if (fp == NULL)
+    return false;
+
+  bool ret = (fread(magic, 1, 4, fp) == 4 && memcmp(magic, STORE_MAGIC, 4) == 0);
+  fclose(fp);
+  return ret;
+}
+
+int SiteStore::open(const string &path)
+{
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    {
+      err = "could not open " + path;
+      return -1;
+    }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(store_header))
+    {
+      ::close(fd);
+      err = "store file too short: " + path;
+      return -1;
+    }
+
+  size = st.st_size;
+  addr = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+    {
+      addr = 0;
+      err = "could not map " + path;
+      return -1;
+    }
+
+  const char *base = (const char *)addr;
+  const store_header *header = (const store_header *)base;
+
+  if (memcmp(header->magic, STORE_MAGIC, 4) != 0 || header->version != SITE_STORE_VERSION ||
+      header->name_len != SITE_STORE_NAME_LEN || header->num_sites < 0 ||
+      header->num_times < 0 || header->num_vars < 0)
+    {
+      close();
+      err = "not a site store file: " + path;
+      return -1;
+    }
+
+  size_t sites_off, times_off, names_off, missing_off, values_off, bits_off, total;
+  section_offsets(header->num_sites, header->num_times, header->num_vars, sites_off,
+		  times_off, names_off, missing_off, values_off, bits_off, total);
+  if (total != size)
+    {
+      close();
+      err = "site store file size does not match its header: " + path;
+      return -1;
+    }
+
+  nsites = header->num_sites;
+  ntimes = header->num_times;
+  nvars = header->num_vars;
+  gen = header->gen_time;
+  sites = (const int *)(base + sites_off);
+  times = (const double *)(base + times_off);
+  names = base + names_off;
+  missing = (const float *)(base + missing_off);
+
+  size_t n = (size_t)nsites * ntimes;
+  for (int v = 0; v < nvars; v++)
+    {
+      vals.push_back((const float *)(base + values_off) + v * n);
+      bits.push_back((const unsigned char *)(base + bits_off) + v * align8((n + 7) / 8));
+    }
+
+  for (int s = 0; s < nsites; s++)
+    site_index[sites[s]] = s;
+
+  // Times are usually evenly spaced, allowing direct indexing
+  uniform_times = (ntimes > 1);
+  for (int t = 2; t < ntimes && uniform_times; t++)
+    uniform_times = (times[t] - times[t-1] == times[1] - times[0]);
+
+  return 0;
+}
+
+string SiteStore::var_name(int v) const
+{
+  const char *name = names + (size_t)v * SITE_STORE_NAME_LEN;
+  return string(name, strnlen(name, SITE_STORE_NAME_LEN));
+}
+
+int SiteStore::find_var(const string &name) const
+{
+  for (int v = 0; v < nvars; v++)
+    if (var_name(v) == name)
+      return v;
+  return -1;
+}
+
+int SiteStore::find_site(int id) const
+{
+  map<int, int>::const_iterator it = site_index.find(id);
+  return (it == site_index.end() ? -1 : it->second);
+}
+
+int SiteStore::find_time(double t) const
+{
+  if (ntimes == 0 || t < times[0] || t > times[ntimes-1])
+    return -1;
+
+  if (uniform_times)
+    {
+      double step = times[1] - times[0];
+      int i = (int)((t - times[0]) / step + 0.5);
+      return (times[i] == t ? i : -1);
+    }
+
+  int lo = 0;
+  int hi = ntimes - 1;
+  while (lo < hi)
+    {
+      int mid = (lo + hi) / 2;
+      if (times[mid] < t)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return (times[lo] == t ? lo : -1);
+}
+
+float SiteStore::get(int v, int id, double t) const
+{
+  int s = find_site(id);
+  int i = find_time(t);
+
+  if (s < 0 || i < 0)
+    return missing[v];
+  return vals[v][(size_t)s * ntimes + i];
+}
+
+int SiteStoreWriter::add_var(const string &name, const vector<float> &var_values, float missing_value)
+{
+  if (name.size() == 0 || name.size() > SITE_STORE_NAME_LEN)
+    {
+      err = "bad variable name: " + name;
+      return -1;
+    }
+
+  if (var_values.size() != sites.size() * times.size())
+    {
+      err = "variable " + name + " size does not match sites and times";
+      return -1;
+    }
+
+  names.push_back(name);
+  missing.push_back(missing_value);
+  values.push_back(var_values);
+  return 0;
+}
+
+int SiteStoreWriter::write(const string &path)
+{
+  int nsites = (int)sites.size();
+  int ntimes = (int)times.size();
+  int nvars = (int)names.size();
+  size_t n = (size_t)nsites * ntimes;
+
+  size_t sites_off, times_off, names_off, missing_off, values_off, bits_off, total;
+  section_offsets(nsites, ntimes, nvars, sites_off, times_off, names_off, missing_off,
+		  values_off, bits_off, total);
+
+  // Assemble the file in memory; stores are a few tens of MB at most
+  vector<char> buf(total, 0);
+
+  store_header *header = (store_header *)&buf[0];
+  memcpy(header->magic, STORE_MAGIC, 4);
+  header->version = SITE_STORE_VERSION;
+  header->num_sites = nsites;
+  header->num_times = ntimes;
+  header->num_vars = nvars;
+  header->name_len = SITE_STORE_NAME_LEN;
+  header->gen_time = gen;
+
+  if (nsites > 0)
+    memcpy(&buf[sites_off], &sites[0], nsites * sizeof(int));
+  if (ntimes > 0)
+    memcpy(&buf[times_off], &times[0], ntimes * sizeof(double));
+
+  for (int v = 0; v < nvars; v++)
+    {
+      memcpy(&buf[names_off + (size_t)v * SITE_STORE_NAME_LEN], names[v].data(), names[v].size());
+      memcpy(&buf[missing_off + v * sizeof(float)], &missing[v], sizeof(float));
+
+      if (n == 0)
+	continue;
+
+      memcpy(&buf[values_off + v * n * sizeof(float)], &values[v][0], n * sizeof(float));
+
+      unsigned char *vbits = (unsigned char *)&buf[bits_off + v * align8((n + 7) / 8)];
+      for (size_t i = 0; i < n; i++)
+	if (values[v][i] == missing[v] || isnan(values[v][i]))
+	  vbits[i >> 3] |= (unsigned char)(1 << (i & 7));
+    }
+
+  string tmp_path = path + ".tmp";
+  FILE *fp = fopen(tmp_path.c_str(), "wb");
+  if (fp == NULL)
+    {
+      err = "could not open " + tmp_path;
+      return -1;
+    }
+
+  bool ok = (fwrite(&buf[0], 1, total, fp) == total);
+  if (fclose(fp) != 0 || !ok || rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+      remove(tmp_path.c_str());
+      err = "could not write " + path;
+      return -1;
+    }
+
+  return 0;
+}
+
+const float SiteInterp::MIN_CLEAR = 1.f;
+
+void SiteInterp::set_times(const vector<double> &time_values, float missing_value, double max_gap_secs)
+{
+  times = time_values;
+  missing = missing_value;
+  max_gap = max_gap_secs;
+}
+
+bool SiteInterp::bracket(double t, int &i0, int &i1, float &w) const
+{
+  if (!covers(t))
+    return false;
+
+  // First time not before t
+  int hi = (int)(std::lower_bound(times.begin(), times.end(), t) - times.begin());
+  if (times[hi] == t)
+    {
+      i0 = i1 = hi;
+      w = 0;
+      return true;
+    }
+
+  i0 = hi - 1;
+  i1 = hi;
+  if (times[i1] - times[i0] > max_gap)
+    return false;
+
+  w = (float)((t - times[i0]) / (times[i1] - times[i0]));
+  return true;
+}
+
+float SiteInterp::lerp(float v0, float v1, float w) const
+{
+  if (is_missing(v0) || is_missing(v1))
+    return missing;
+  return v0 + w * (v1 - v0);
+}
+
+float SiteInterp::csi(float v0, float v1, float c0, float c1, float w, float clear_t) const
+{
+  if (is_missing(v0) || is_missing(v1))
+    return missing;
+
+  // Night or twilight at a bracket, or no clear sky value: plain linear
+  if (is_missing(c0) || is_missing(c1) || is_missing(clear_t) || c0 < MIN_CLEAR ||
+      c1 < MIN_CLEAR)
+    return v0 + w * (v1 - v0);
+
+  if (clear_t <= 0)
+    return 0;
+
+  float k0 = v0 / c0;
+  float k1 = v1 / c1;
+  return (k0 + w * (k1 - k0)) * clear_t;
+}
+
+float SiteInterp::value(const SiteColumn &column, int s, double t) const
+{
+  int i0, i1;
+  float w;
+
+  if (s < 0 || !bracket(t, i0, i1, w))
+    return missing;
+
+  size_t row = (size_t)s * times.size();
+  return lerp(column[row + i0], column[row + i1], w);
+}
+
+float SiteInterp::value_csi(const SiteColumn &column, const SiteColumn &clear, int s, double t,
+			    float clear_t) const
+{
+  int i0, i1;
+  float w;
+
+  if (s < 0 || !bracket(t, i0, i1, w))
+    return missing;
+
+  size_t row = (size_t)s * times.size();
+  if (i0 == i1)
+    return (is_missing(column[row + i0]) ? missing : column[row + i0]);
+  return csi(column[row + i0], column[row + i1], clear[row + i0], clear[row + i1], w, clear_t);
+}
+
+bool SiteInterp::values(const SiteColumn &column, int num_sites, double t, float *out) const
+{
+  int i0, i1;
+  float w;
+
+  if (!bracket(t, i0, i1, w))
+    return false;
+
+  // One bracket search for all sites
+  size_t ntimes = times.size();
+  for (int s = 0; s < num_sites; s++)
+    out[s] = lerp(column[s * ntimes + i0], column[s * ntimes + i1], w);
+  return true;
+}
+
+bool SiteInterp::values_csi(const SiteColumn &column, const SiteColumn &clear, int num_sites,
+			    double t, const float *clear_t, float *out) const
+{
+  int i0, i1;
+  float w;
+
+  if (!bracket(t, i0, i1, w))
+    return false;
+
+  size_t ntimes = times.size();
+  for (int s = 0; s < num_sites; s++)
+    {
+      float v0 = column[s * ntimes + i0];
+      if (i0 == i1)
+	out[s] = (is_missing(v0) ? missing : v0);
+      else
+	out[s] = csi(v0, column[s * ntimes + i1], clear[s * ntimes + i0], clear[s * ntimes + i1],
+		     w, clear_t[s]);
+    }
+  return true;
+}
@@ -0,0 +1,194 @@
+//----------------------------------------------------------------------
+// Module: test_site_store.cc
+//
+// Description:
+//     Writes a site store, maps it back and checks site and time lookup,
+//     values, missing bits, SiteColumn views and SiteColumns loads and
+//     gathers, then SiteInterp over hourly columns. Exits non-zero on
+//     failure.
+//----------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "../include/site_store/site_store.hh"
+
+using namespace std;
+
+enum TestVar { TEST_GHI, TEST_ZONE, TEST_T2, NUM_TEST_VARS };
+
+static constexpr SiteVarDef TEST_VARS[NUM_TEST_VARS] = {
+  { "ghi", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, SITE_VAR_NON_NEGATIVE },
+  { "zone", SITE_VAR_INT, SITE_VAR_SITE, 0 },
+  { "T2", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+};
+
+static constexpr SiteVarDef ABSENT_VARS[1] = {
+  { "RH", SITE_VAR_FLOAT, SITE_VAR_SITE_TIME, 0 },
+};
+
+int main()
+{
+  const int nsites = 37;
+  const int ntimes = 25;
+  const float fill = 9.96921e+36f;
+  vector<int> ids;
+  vector<double> times;
+  vector<float> ghi, temp, zone;
+  int nfail = 0;
+
+  for (int s = 0; s < nsites; s++)
+    ids.push_back(1000 + 3 * s);
+  for (int t = 0; t < ntimes; t++)
+    times.push_back(1600000000. + 900. * t);
+  for (int s = 0; s < nsites; s++)
+    for (int t = 0; t < ntimes; t++)
+      {
+	ghi.push_back((s + t) % 7 == 0 ? fill : (t == 1 ? -1.f : 10.f * s + t));
+	temp.push_back(t == 3 ? NAN : 270.f + s);
+	zone.push_back(s % 5);
+      }
+
+  SiteStoreWriter writer;
+  writer.set_sites(ids);
+  writer.set_times(times);
+  writer.set_gen_time(times[0] - 900.);
+  if (writer.add_var("ghi", ghi, fill) != 0 || writer.add_var("T2", temp, -9999.f) != 0 ||
+      writer.add_var("zone", zone, -1.f) != 0 ||
+      writer.add_var("short", vector<float>(3), 0.f) == 0)
+    {
+      printf("add_var: %s FAILED\n", writer.error().c_str());
+      return 1;
+    }
+
+  const char *path = "test_site_store.sst";
+  if (writer.write(path) != 0)
+    {
+      printf("write: %s FAILED\n", writer.error().c_str());
+      return 1;
+    }
+
+  SiteStore store;
+  if (!SiteStore::is_store(path) || store.open(path) != 0)
+    {
+      printf("open: %s FAILED\n", store.error().c_str());
+      return 1;
+    }
+
+  if (store.num_sites() != nsites || store.num_times() != ntimes || store.num_vars() != 3 ||
+      store.gen_time() != times[0] - 900. || store.var_name(1) != "T2" || store.find_var("T2") != 1 ||
+      store.find_var("RH") != -1 || store.find_site(1003) != 1 || store.find_site(1004) != -1 ||
+      store.find_time(times[5]) != 5 || store.find_time(times[5] + 1) != -1 ||
+      store.find_time(times[0] - 900.) != -1)
+    nfail++;
+
+  int v = store.find_var("ghi");
+  for (int s = 0; s < nsites; s++)
+    for (int t = 0; t < ntimes; t++)
+      {
+	float expected = ghi[s * ntimes + t];
+	if (store.get(v, ids[s], times[t]) != expected || store.column(v, s)[t] != expected ||
+	    store.is_missing(v, s, t) != (expected == fill) || store.is_missing(1, s, t) != (t == 3))
+	  nfail++;
+      }
+  if (store.get(v, 5, times[0]) != fill)
+    nfail++;
+
+  SiteColumn column;
+  column.push_back(1.f);
+  column.view(store.values(v), (size_t)nsites * ntimes);
+  if (column.size() != ghi.size() || column[40] != ghi[40])
+    nfail++;
+
+  // Columns of a reader schema viewed in the store and copied from
+  // netCDF arrays
+  SiteColumns<TestVar, NUM_TEST_VARS> columns(TEST_VARS), copied(TEST_VARS);
+  if (columns.view(TEST_GHI, store) != 0 || columns.view(TEST_ZONE, store) != 0 ||
+      columns.view(TEST_T2, store) != 0 || columns[TEST_ZONE].size() != (size_t)nsites ||
+      columns[TEST_ZONE][7] != 2.f || columns[TEST_GHI][ntimes + 1] != 0.f ||
+      columns[TEST_GHI][ntimes + 2] != ghi[ntimes + 2] || columns[TEST_T2][5] != temp[5])
+    nfail++;
+
+  vector<int> zone_ints(nsites);
+  for (int s = 0; s < nsites; s++)
+    zone_ints[s] = s % 5;
+  copied.copy(TEST_GHI, &ghi[0], ghi.size());
+  copied.copy(TEST_ZONE, &zone_ints[0], zone_ints.size());
+  if (copied[TEST_GHI].size() != ghi.size() || copied[TEST_GHI][1] != 0.f ||
+      copied[TEST_GHI][2] != ghi[2] || copied[TEST_ZONE][9] != 4.f)
+    nfail++;
+
+  const TestVar gvars[2] = { TEST_T2, TEST_GHI };
+  float gout[2];
+  columns.gather(gvars, 2, 4 * ntimes + 2, fill, gout);
+  if (gout[0] != temp[4 * ntimes + 2] || gout[1] != ghi[4 * ntimes + 2])
+    nfail++;
+  columns.gather(gvars, 2, -1, fill, gout);
+  if (gout[0] != fill || gout[1] != fill)
+    nfail++;
+
+  SiteColumns<TestVar, 1> absent(ABSENT_VARS);
+  if (absent.view(TEST_GHI, store) != -1 || absent[TEST_GHI].size() != 0)
+    nfail++;
+
+  store.close();
+  remove(path);
+
+  printf("%-24s %d sites %d times  %s\n", "site store", nsites, ntimes, nfail ? "FAILED" : "ok");
+
+  // Hourly columns served at 15 minute times
+  int ninterp_fail = 0;
+  vector<double> hours;
+  vector<float> hourly, clear;
+  for (int t = 0; t < 4; t++)
+    hours.push_back(1600000000. + 3600. * t);
+  hours.push_back(hours.back() + 3 * 3600.);
+  for (int s = 0; s < 3; s++)
+    for (int t = 0; t < 5; t++)
+      {
+	hourly.push_back(s == 2 && t == 1 ? -9999.f : 100.f * (s + 1) + 40.f * t);
+	clear.push_back(t == 0 ? 0.f : 200.f * (s + 1) + 100.f * t);
+      }
+  SiteColumn hourly_col, clear_col;
+  hourly_col.take(hourly);
+  clear_col.take(clear);
+
+  SiteInterp interp;
+  interp.set_times(hours, -9999.f, 3600.);
+  int i0, i1;
+  float w;
+  if (!interp.bracket(hours[1] + 900., i0, i1, w) || i0 != 1 || i1 != 2 || fabs(w - 0.25) > 1e-6 ||
+      !interp.bracket(hours[2], i0, i1, w) || i0 != 2 || i1 != 2 || w != 0 ||
+      interp.bracket(hours[0] - 900., i0, i1, w) || interp.bracket(hours[3] + 900., i0, i1, w) ||
+      !interp.covers(hours[4]) || interp.covers(hours[4] + 1))
+    ninterp_fail++;
+
+  // Linear: site 0 goes 100, 140, 180, 220 by hour
+  if (fabs(interp.value(hourly_col, 0, hours[1] + 900.) - 150.f) > 1e-3 ||
+      interp.value(hourly_col, 0, hours[2]) != 180.f ||
+      interp.value(hourly_col, 2, hours[1] + 1800.) != -9999.f ||
+      interp.value(hourly_col, 2, hours[2]) != 380.f ||
+      interp.value(hourly_col, 0, hours[3] + 3600.) != -9999.f)
+    ninterp_fail++;
+
+  // Clear sky index: site 0 is 140 / 300 and 180 / 400 at hours 1 and 2
+  float k = 140.f / 300 + 0.5f * (180.f / 400 - 140.f / 300);
+  if (fabs(interp.value_csi(hourly_col, clear_col, 0, hours[1] + 1800., 360.f) - k * 360.f) > 1e-3 ||
+      fabs(interp.value_csi(hourly_col, clear_col, 0, hours[0] + 1800., 50.f) - 120.f) > 1e-3 ||
+      interp.value_csi(hourly_col, clear_col, 0, hours[1] + 1800., 0.f) != 0.f)
+    ninterp_fail++;
+
+  float out[3];
+  float clear_t[3] = {360.f, 720.f, 1080.f};
+  if (!interp.values(hourly_col, 3, hours[2] + 2700., out) || fabs(out[0] - 210.f) > 1e-3 ||
+      fabs(out[2] - 410.f) > 1e-3 ||
+      !interp.values_csi(hourly_col, clear_col, 3, hours[1] + 1800., clear_t, out) ||
+      fabs(out[0] - k * 360.f) > 1e-3 || out[2] != -9999.f ||
+      interp.values(hourly_col, 3, hours[4] - 900., out))
+    ninterp_fail++;
+
+  printf("%-24s %d sites %d times  %s\n", "site interp", 3, 5, ninterp_fail ? "FAILED" : "ok");
+  nfail += ninterp_fail;
+  return nfail ? 1 : 0;
+}
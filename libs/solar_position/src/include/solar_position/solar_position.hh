@@ -0,0 +1,83 @@
+/*
+ *   Module: solar_position.hh
+ *
+ *   Description: Solar position and top of atmosphere irradiance for
+ *   sites and times, replacing the pvlib get_solarposition and
+ *   calculate_toa steps of the python preprocessing.
+ *
+ *   Angles are in degrees, times in unix seconds (UTC). Azimuth is
+ *   measured clockwise from north. Apparent elevation includes
+ *   atmospheric refraction, as pvlib's apparent_elevation does.
+ *
+ *   Two accuracies are offered:
+ *
+ *   precise  Apparent solar coordinates from the Meeus ephemeris with
+ *            nutation and aberration, topocentric parallax and pressure
+ *            and temperature dependent refraction as in the NREL SPA.
+ *            Within 0.01 degree of the SPA for 1950-2050.
+ *   fast     Astronomical Almanac low precision ephemeris, geocentric,
+ *            standard atmosphere refraction, in single precision. The
+ *            sun is computed once per time and shared by all sites, and
+ *            the per site loop runs over contiguous arrays so that it
+ *            vectorizes. Within 0.02 degree of the precise mode.
+ *
+ *   The NWP site files and the observation files carry 15 minute, time
+ *   ending means of one minute values; solar_period_mean() and
+ *   solar_period_mean_grid() reproduce them.
+ *
+ */
+
+#ifndef SOLAR_POSITION_HH
+#define SOLAR_POSITION_HH
+
+// Standard atmosphere used when pressure and temperature are unknown,
+// the pvlib defaults
+#define SOLAR_STD_PRESSURE 1013.25
+#define SOLAR_STD_TEMPERATURE 12.0
+
+// Terrestrial minus universal time, seconds
+#define SOLAR_DELTA_T 67.0
+
+// Solar constant of the TOA calculation, W m-2
+#define SOLAR_CONSTANT 1367.0
+
+typedef struct
+{
+  double zenith;                // topocentric zenith angle, no refraction
+  double elevation;             // 90 - zenith
+  double apparent_elevation;    // elevation corrected for refraction
+  double azimuth;               // clockwise from north
+  double declination;
+  double earth_sun_distance;    // au
+} solar_pos;
+
+// Precise solar position at a site. height is in m above sea level,
+// pressure in mb, temperature in C.
+void solar_position(double unix_time, double lat, double lon, double height,
+		    double pressure, double temperature, solar_pos *pos);
+
+// Fast apparent elevation and azimuth for num_sites sites at num_times
+// times. Outputs are site major: [site * num_times + time].
+void solar_position_grid(int num_sites, const float *lat, const float *lon,
+			 int num_times, const double *times,
+			 float *apparent_elevation, float *azimuth);
+
+// Top of atmosphere irradiance on a horizontal surface, W m-2, as the
+// python calculate_toa: day of year eccentricity correction times the
+// sine of the apparent elevation, zero with the sun below the horizon.
+double solar_toa(double unix_time, double apparent_elevation);
+
+// Mean apparent elevation, azimuth and TOA over the minutes minute
+// samples ending at end_time (end_time - (minutes-1)*60 .. end_time).
+// precise selects the precise mode at sea level and standard atmosphere.
+void solar_period_mean(double lat, double lon, double end_time, int minutes,
+		       int precise, float *apparent_elevation, float *azimuth,
+		       float *toa);
+
+// solar_period_mean() in fast mode for num_sites sites at num_times
+// times, outputs site major. Any output pointer may be NULL.
+void solar_period_mean_grid(int num_sites, const float *lat, const float *lon,
+			    int num_times, const double *times, int minutes,
+			    float *apparent_elevation, float *azimuth, float *toa);
+
+#endif /* SOLAR_POSITION_HH */
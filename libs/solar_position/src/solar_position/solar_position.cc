@@ -0,0 +1,279 @@
+//----------------------------------------------------------------------
+// Module: solar_position.cc
+//
+// Description:
+//     Solar position and top of atmosphere irradiance. The precise mode
+//     follows Meeus, Astronomical Algorithms, ch. 22, 25 and 40, with the
+//     refraction of Reda and Andreas, Solar Position Algorithm for Solar
+//     Radiation Applications (NREL, 2008). The fast mode uses the
+//     Astronomical Almanac low precision formulas.
+//----------------------------------------------------------------------
+
+// Include files
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include "../include/solar_position/solar_position.hh"
+
+using namespace std;
+
+// Constant, macro and type definitions
+
+static const double DEG = M_PI / 180.0;
+static const float DEGF = (float)(M_PI / 180.0);
+
+static const double UNIX_EPOCH_JD = 2440587.5;
+static const double J2000_JD = 2451545.0;
+
+// Sun radius and refraction at the horizon; below this no refraction
+// is applied, as in the SPA
+static const double HORIZON_LIMIT = -(0.26667 + 0.5667);
+
+// Functions and objects
+
+static double norm360(double x)
+{
+  x = fmod(x, 360.0);
+  return (x < 0 ? x + 360.0 : x);
+}
+
+// Refraction correction to the elevation, degrees (SPA eq. 42)
+static double refraction(double e0, double pressure, double temperature)
+{
+  if (e0 < HORIZON_LIMIT)
+    return 0;
+
+  return (pressure / 1010.0) * (283.0 / (273.0 + temperature)) *
+    1.02 / (60.0 * tan((e0 + 10.3 / (e0 + 5.11)) * DEG));
+}
+
+// Day of year eccentricity correction of the TOA calculation, W m-2
+static double toa_factor(double unix_time)
+{
+  time_t t = (time_t)floor(unix_time);
+  struct tm tms;
+
+  gmtime_r(&t, &tms);
+
+  double b = 2 * M_PI * (tms.tm_yday + 1) / 365.0;
+  return SOLAR_CONSTANT * (1.00011 + 0.034221 * cos(b) + 0.00128 * sin(b) +
+			   0.000719 * cos(2 * b) + 0.000077 * sin(2 * b));
+}
+
+void solar_position(double unix_time, double lat, double lon, double height,
+		    double pressure, double temperature, solar_pos *pos)
+{
+  double jd = unix_time / 86400.0 + UNIX_EPOCH_JD;
+  double jde = jd + SOLAR_DELTA_T / 86400.0;
+  double t = (jde - J2000_JD) / 36525.0;
+
+  // Geometric mean longitude, mean anomaly, eccentricity and equation of
+  // center of the sun
+  double l0 = norm360(280.46646 + t * (36000.76983 + 0.0003032 * t));
+  double m = norm360(357.52911 + t * (35999.05029 - 0.0001537 * t));
+  double e = 0.016708634 - t * (0.000042037 + 0.0000001267 * t);
+  double c = (1.914602 - t * (0.004817 + 0.000014 * t)) * sin(m * DEG) +
+    (0.019993 - 0.000101 * t) * sin(2 * m * DEG) + 0.000289 * sin(3 * m * DEG);
+
+  double true_lon = l0 + c;
+  double r = 1.000001018 * (1 - e * e) / (1 + e * cos((m + c) * DEG));
+
+  // Nutation in longitude and obliquity, principal terms
+  double omega = (125.04452 - 1934.136261 * t) * DEG;
+  double moon_lon = (218.3165 + 481267.8813 * t) * DEG;
+  double dpsi = (-17.20 * sin(omega) - 1.32 * sin(2 * l0 * DEG) - 0.23 * sin(2 * moon_lon) +
+		 0.21 * sin(2 * omega)) / 3600.0;
+  double deps = (9.20 * cos(omega) + 0.57 * cos(2 * l0 * DEG) + 0.10 * cos(2 * moon_lon) -
+		 0.09 * cos(2 * omega)) / 3600.0;
+
+  double eps = 23.0 + (26.0 + (21.448 - t * (46.8150 + t * (0.00059 - 0.001813 * t))) / 60.0) / 60.0 + deps;
+
+  // Apparent longitude, corrected for nutation and aberration, and the
+  // geocentric right ascension and declination
+  double lambda = (true_lon + dpsi - 20.4898 / (3600.0 * r)) * DEG;
+  double alpha = atan2(cos(eps * DEG) * sin(lambda), cos(lambda)) / DEG;
+  double delta = asin(sin(eps * DEG) * sin(lambda));
+
+  // Apparent sidereal time at Greenwich and local hour angle
+  double d = jd - J2000_JD;
+  double tu = d / 36525.0;
+  double theta = 280.46061837 + 360.98564736629 * d + tu * tu * (0.000387933 - tu / 38710000.0) +
+    dpsi * cos(eps * DEG);
+  double h = norm360(theta + lon - alpha) * DEG;
+
+  // Topocentric parallax
+  double phi = lat * DEG;
+  double xi = 8.794 / (3600.0 * r) * DEG;
+  double u = atan(0.99664719 * tan(phi));
+  double x = cos(u) + height / 6378140.0 * cos(phi);
+  double y = 0.99664719 * sin(u) + height / 6378140.0 * sin(phi);
+  double den = cos(delta) - x * sin(xi) * cos(h);
+  double dalpha = atan2(-x * sin(xi) * sin(h), den);
+  double delta_p = atan2((sin(delta) - y * sin(xi)) * cos(dalpha), den);
+  double h_p = h - dalpha;
+
+  double e0 = asin(sin(phi) * sin(delta_p) + cos(phi) * cos(delta_p) * cos(h_p)) / DEG;
+
+  pos->elevation = e0;
+  pos->zenith = 90.0 - e0;
+  pos->apparent_elevation = e0 + refraction(e0, pressure, temperature);
+  pos->azimuth = norm360(atan2(sin(h_p), cos(h_p) * sin(phi) - tan(delta_p) * cos(phi)) / DEG + 180.0);
+  pos->declination = delta_p / DEG;
+  pos->earth_sun_distance = r;
+}
+
+// Low precision sun: sine and cosine of declination and Greenwich hour
+// angle (degrees) at each time
+static void fast_sun(int num_times, const double *times, float *sin_decl, float *cos_decl, float *gha)
+{
+  for (int i = 0; i < num_times; i++)
+    {
+      double n = times[i] / 86400.0 + UNIX_EPOCH_JD - J2000_JD;
+      double g = (357.528 + 0.9856003 * n) * DEG;
+      double lambda = (280.460 + 0.9856474 * n + 1.915 * sin(g) + 0.020 * sin(2 * g)) * DEG;
+      double eps = (23.439 - 0.0000004 * n) * DEG;
+      double alpha = atan2(cos(eps) * sin(lambda), cos(lambda)) / DEG;
+      double sd = sin(eps) * sin(lambda);
+
+      sin_decl[i] = (float)sd;
+      cos_decl[i] = (float)sqrt(1 - sd * sd);
+      gha[i] = (float)norm360(280.46061837 + 360.98564736629 * n - alpha);
+    }
+}
+
+// Fast apparent elevation and azimuth of one site at the times of the
+// fast_sun() arrays
+static void fast_site(float lat, float lon, int num_times, const float *sin_decl,
+		      const float *cos_decl, const float *gha, float *apparent_elevation,
+		      float *azimuth)
+{
+  const float refraction_scale = (float)((SOLAR_STD_PRESSURE / 1010.0) * (283.0 / (273.0 + SOLAR_STD_TEMPERATURE)));
+  const float horizon_limit = (float)HORIZON_LIMIT;
+  float sin_lat = sinf(lat * DEGF);
+  float cos_lat = cosf(lat * DEGF);
+
+  for (int i = 0; i < num_times; i++)
+    {
+      float h = (gha[i] + lon) * DEGF;
+      float ch = cosf(h);
+      float sh = sinf(h);
+      float se = sin_lat * sin_decl[i] + cos_lat * cos_decl[i] * ch;
+      float e0 = asinf(se > 1.f ? 1.f : (se < -1.f ? -1.f : se)) / DEGF;
+      float refr = refraction_scale * 1.02f / (60.f * tanf((e0 + 10.3f / (e0 + 5.11f)) * DEGF));
+      float az = atan2f(-cos_decl[i] * sh, sin_decl[i] * cos_lat - cos_decl[i] * ch * sin_lat) / DEGF;
+
+      apparent_elevation[i] = e0 + (e0 < horizon_limit ? 0.f : refr);
+      azimuth[i] = (az < 0.f ? az + 360.f : az);
+    }
+}
+
+void solar_position_grid(int num_sites, const float *lat, const float *lon,
+			 int num_times, const double *times,
+			 float *apparent_elevation, float *azimuth)
+{
+  vector<float> sin_decl(num_times), cos_decl(num_times), gha(num_times);
+
+  if (num_times <= 0)
+    return;
+
+  fast_sun(num_times, times, &sin_decl[0], &cos_decl[0], &gha[0]);
+
+  for (int s = 0; s < num_sites; s++)
+    fast_site(lat[s], lon[s], num_times, &sin_decl[0], &cos_decl[0], &gha[0],
+	      apparent_elevation + (size_t)s * num_times, azimuth + (size_t)s * num_times);
+}
+
+double solar_toa(double unix_time, double apparent_elevation)
+{
+  double toa = toa_factor(unix_time) * sin(apparent_elevation * DEG);
+
+  return (toa < 0 ? 0 : toa);
+}
+
+void solar_period_mean(double lat, double lon, double end_time, int minutes,
+		       int precise, float *apparent_elevation, float *azimuth,
+		       float *toa)
+{
+  double sum_el = 0, sum_az = 0, sum_toa = 0;
+
+  for (int k = 0; k < minutes; k++)
+    {
+      double t = end_time - (minutes - 1 - k) * 60.0;
+      double el, az;
+
+      if (precise)
+	{
+	  solar_pos pos;
+	  solar_position(t, lat, lon, 0, SOLAR_STD_PRESSURE, SOLAR_STD_TEMPERATURE, &pos);
+	  el = pos.apparent_elevation;
+	  az = pos.azimuth;
+	}
+      else
+	{
+	  float flat = (float)lat, flon = (float)lon, fel, faz;
+	  solar_position_grid(1, &flat, &flon, 1, &t, &fel, &faz);
+	  el = fel;
+	  az = faz;
+	}
+
+      sum_el += el;
+      sum_az += az;
+      sum_toa += solar_toa(t, el);
+    }
+
+  *apparent_elevation = (float)(sum_el / minutes);
+  *azimuth = (float)(sum_az / minutes);
+  *toa = (float)(sum_toa / minutes);
+}
+
+void solar_period_mean_grid(int num_sites, const float *lat, const float *lon,
+			    int num_times, const double *times, int minutes,
+			    float *apparent_elevation, float *azimuth, float *toa)
+{
+  int num_samples = num_times * minutes;
+
+  if (num_samples <= 0)
+    return;
+
+  // One minute sample times, time major, and their sun
+  vector<double> sample_times(num_samples);
+  vector<float> factor(num_samples);
+  for (int i = 0; i < num_times; i++)
+    for (int k = 0; k < minutes; k++)
+      {
+	double t = times[i] - (minutes - 1 - k) * 60.0;
+	sample_times[i * minutes + k] = t;
+	factor[i * minutes + k] = (float)toa_factor(t);
+      }
+
+  vector<float> sin_decl(num_samples), cos_decl(num_samples), gha(num_samples);
+  fast_sun(num_samples, &sample_times[0], &sin_decl[0], &cos_decl[0], &gha[0]);
+
+  vector<float> el(num_samples), az(num_samples);
+  for (int s = 0; s < num_sites; s++)
+    {
+      fast_site(lat[s], lon[s], num_samples, &sin_decl[0], &cos_decl[0], &gha[0], &el[0], &az[0]);
+
+      for (int i = 0; i < num_times; i++)
+	{
+	  float sum_el = 0, sum_az = 0, sum_toa = 0;
+
+	  for (int k = i * minutes; k < (i + 1) * minutes; k++)
+	    {
+	      float sample_toa = factor[k] * sinf(el[k] * DEGF);
+	      sum_el += el[k];
+	      sum_az += az[k];
+	      sum_toa += (sample_toa < 0.f ? 0.f : sample_toa);
+	    }
+
+	  size_t out = (size_t)s * num_times + i;
+	  if (apparent_elevation)
+	    apparent_elevation[out] = sum_el / minutes;
+	  if (azimuth)
+	    azimuth[out] = sum_az / minutes;
+	  if (toa)
+	    toa[out] = sum_toa / minutes;
+	}
+    }
+}
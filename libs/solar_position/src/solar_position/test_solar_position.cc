@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------
+// Module: test_solar_position.cc
+//
+// Description:
+//     Checks the precise mode against the example of the NREL SPA report
+//     and the fast and period mean modes against the precise mode over a
+//     year of New York sites. Exits non-zero on failure.
+//----------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+#include "../include/solar_position/solar_position.hh"
+
+using namespace std;
+
+int main()
+{
+  int nfail = 0;
+
+  // SPA report example: 2003-10-17 12:30:30 MST at NREL, Golden
+  // (19:30:30 UTC), zenith 50.11162, azimuth 194.34024
+  solar_pos pos;
+  solar_position(1066419030., 39.742476, -105.1786, 1830.14, 820., 11., &pos);
+  double dzen = fabs(90. - pos.apparent_elevation - 50.11162);
+  double daz = fabs(pos.azimuth - 194.34024);
+  printf("%-24s zenith %.5f azimuth %.5f  %s\n", "spa example", 90. - pos.apparent_elevation,
+	 pos.azimuth, (dzen < 0.01 && daz < 0.01) ? "ok" : "FAILED");
+  if (dzen >= 0.01 || daz >= 0.01)
+    nfail++;
+
+  // Fast grid against precise over a year, hourly, sun above the horizon
+  const float lat[] = {42.04036f, 40.860113f, 44.9f};
+  const float lon[] = {-77.23726f, -72.852164f, -73.5f};
+  const int nsites = 3;
+  vector<double> times;
+  for (double t = 1609459200.; t < 1609459200. + 365 * 86400.; t += 3607.)
+    times.push_back(t);
+  int ntimes = (int)times.size();
+
+  vector<float> el(nsites * ntimes), az(nsites * ntimes);
+  solar_position_grid(nsites, lat, lon, ntimes, &times[0], &el[0], &az[0]);
+
+  double max_del = 0, max_daz = 0;
+  for (int s = 0; s < nsites; s++)
+    for (int i = 0; i < ntimes; i++)
+      {
+	solar_position(times[i], lat[s], lon[s], 0, SOLAR_STD_PRESSURE, SOLAR_STD_TEMPERATURE, &pos);
+	if (pos.apparent_elevation < 5)
+	  continue;
+	double de = fabs(el[s * ntimes + i] - pos.apparent_elevation);
+	double da = fabs(az[s * ntimes + i] - pos.azimuth);
+	if (de > max_del)
+	  max_del = de;
+	if (da > max_daz)
+	  max_daz = da;
+      }
+  printf("%-24s max diff elevation %.4f azimuth %.4f  %s\n", "fast grid", max_del, max_daz,
+	 (max_del < 0.02 && max_daz < 0.05) ? "ok" : "FAILED");
+  if (max_del >= 0.02 || max_daz >= 0.05)
+    nfail++;
+
+  // Period means: grid against single site, and TOA bounds
+  vector<float> mel(nsites * ntimes), maz(nsites * ntimes), mtoa(nsites * ntimes);
+  solar_period_mean_grid(nsites, lat, lon, ntimes, &times[0], 15, &mel[0], &maz[0], &mtoa[0]);
+
+  int nbad = 0;
+  for (int s = 0; s < nsites; s++)
+    for (int i = 0; i < ntimes; i += 37)
+      {
+	float pel, paz, ptoa;
+	solar_period_mean(lat[s], lon[s], times[i], 15, 1, &pel, &paz, &ptoa);
+	size_t k = s * ntimes + i;
+	if (fabs(mel[k] - pel) > 0.02 || fabs(mtoa[k] - ptoa) > 0.5 || mtoa[k] < 0 || mtoa[k] > 1420 ||
+	    (pel > 5 && fabs(maz[k] - paz) > 0.05))
+	  nbad++;
+      }
+  printf("%-24s %d mismatches  %s\n", "period means", nbad, nbad ? "FAILED" : "ok");
+  if (nbad)
+    nfail++;
+
+  // TOA at the sun in the zenith on January 1st
+  double toa = solar_toa(1609459200., 90.);
+  printf("%-24s %.2f  %s\n", "toa", toa, fabs(toa - 1414.9) < 1. ? "ok" : "FAILED");
+  if (fabs(toa - 1414.9) >= 1.)
+    nfail++;
+
+  return nfail ? 1 : 0;
+}